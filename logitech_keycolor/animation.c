@@ -0,0 +1,242 @@
+//
+//  animation.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include "animation.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "color.h"
+#include "compositor.h"
+#include "expr.h"
+
+static volatile sig_atomic_t animationStopRequested = 0;
+
+static void animationSignalHandler(int sig)
+{
+    animationStopRequested = sig;
+}
+
+enum animationEffect animationParseEffect(const char *name)
+{
+    static const struct {
+        const char *name;
+        enum animationEffect effect;
+    } effects[] = {
+        { "fade", EFFECT_FADE },
+        { "breathe", EFFECT_BREATHE },
+        { "cycle", EFFECT_CYCLE },
+        { "strobe", EFFECT_STROBE },
+        { NULL, EFFECT_NONE }
+    };
+    
+    for (int i = 0; effects[i].name; i++) {
+        if (strcmp(name, effects[i].name) == 0) {
+            return effects[i].effect;
+        }
+    }
+    
+    return EFFECT_NONE;
+}
+
+static uint8_t clampColor(double value)
+{
+    if (value <= 0.0) {
+        return 0;
+    }
+    
+    if (value >= 255.0) {
+        return 255;
+    }
+    
+    return (uint8_t)(value + 0.5);
+}
+
+// Fully saturated hue in [0, 1) at brightness value, written to report[1..3]
+static void hueToReport(double hue, double value, uint8_t *report)
+{
+    double h = hue * 6.0;
+    int sector = (int)h % 6;
+    double f = h - floor(h);
+    double rgb[3];
+    
+    switch (sector) {
+        case 0: rgb[0] = 1; rgb[1] = f; rgb[2] = 0; break;
+        case 1: rgb[0] = 1 - f; rgb[1] = 1; rgb[2] = 0; break;
+        case 2: rgb[0] = 0; rgb[1] = 1; rgb[2] = f; break;
+        case 3: rgb[0] = 0; rgb[1] = 1 - f; rgb[2] = 1; break;
+        case 4: rgb[0] = f; rgb[1] = 0; rgb[2] = 1; break;
+        default: rgb[0] = 1; rgb[1] = 0; rgb[2] = 1 - f; break;
+    }
+    
+    for (int i = 0; i < 3; i++) {
+        report[i + 1] = clampColor(rgb[i] * value);
+    }
+}
+
+void animationRender(const struct animationOptions *opts, uint64_t t, uint8_t *report)
+{
+    double phase = opts->period ? (double)(t % opts->period) / (double)opts->period : 0.0;
+    
+    switch (opts->effect) {
+        case EFFECT_FADE: {
+            uint32_t mix = opts->period && t < opts->period ? (uint32_t)(t * 65536 / opts->period) : 65536;
+            
+            // Straight line in linear light, the table encode keeps every step even to the eye
+            colorMixReport(opts->from, opts->to, mix, report, KEYCOLOR_REPORT_SIZE);
+            break;
+        }
+        case EFFECT_BREATHE: {
+            double level = 0.5 - 0.5 * cos(2.0 * M_PI * phase);
+            
+            colorScaleReport(opts->from, (uint32_t)(level * 65536.0), report, KEYCOLOR_REPORT_SIZE);
+            break;
+        }
+        case EFFECT_CYCLE: {
+            uint8_t peak = opts->from[1];
+            
+            if (opts->from[2] > peak) peak = opts->from[2];
+            if (opts->from[3] > peak) peak = opts->from[3];
+            
+            report[0] = opts->from[0];
+            hueToReport(phase, peak ? peak : 255, report);
+            break;
+        }
+        case EFFECT_STROBE:
+            memcpy(report, phase < 0.5 ? opts->from : opts->to, KEYCOLOR_REPORT_SIZE);
+            break;
+        case EFFECT_EXPR:
+            memcpy(report, opts->from, KEYCOLOR_REPORT_SIZE);
+            exprRender(opts->program, t / 1e9, report, KEYCOLOR_REPORT_SIZE);
+            break;
+        default:
+            memcpy(report, opts->from, KEYCOLOR_REPORT_SIZE);
+            break;
+    }
+}
+
+int animationRun(const struct animationOptions *opts, struct keyColorTarget *targets, size_t numTargets, struct animationStats *stats)
+{
+    uint64_t framePeriod = (uint64_t)(1e9 / opts->rate);
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    uint64_t frame = 0;
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    if (framePeriod == 0) {
+        framePeriod = 1;
+    }
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = animationSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    
+    uint64_t startTime = monotonicNanos();
+    
+    while (!animationStopRequested) {
+        // Deadlines are fixed multiples of the frame period from the start so lateness never accumulates
+        uint64_t t = frame * framePeriod;
+        int lastFrame = 0;
+        
+        // The end state is always rendered, even when catching up or an odd duration would step past it
+        if (opts->duration && t >= opts->duration) {
+            t = opts->duration;
+            lastFrame = 1;
+        }
+        
+        sleepUntilNanos(startTime + t);
+        
+        uint64_t jitter = monotonicNanos() - (startTime + t);
+        
+        animationRender(opts, t, report);
+        
+        if (opts->layers) {
+            compositorRender(opts->layers, t, report, report, sizeof(report));
+        }
+        
+        stats->writeFailures += transportWrite(targets, numTargets, report, sizeof(report));
+        stats->framesSent++;
+        
+        // Welford's running mean/variance, no per-frame storage for long runs
+        double delta = (double)jitter - stats->jitterMean;
+        stats->jitterMean += delta / (double)stats->framesSent;
+        stats->jitterM2 += delta * ((double)jitter - stats->jitterMean);
+        
+        if (jitter > stats->jitterMax) {
+            stats->jitterMax = jitter;
+        }
+        
+        if (lastFrame) {
+            break;
+        }
+        
+        // Skip any deadlines already missed instead of bursting to catch up
+        uint64_t now = monotonicNanos() - startTime;
+        uint64_t nextFrame = frame + 1;
+        
+        if (now > nextFrame * framePeriod) {
+            uint64_t caughtUp = now / framePeriod + 1;
+            
+            // Never skip past the frame that lands on the end
+            if (opts->duration && caughtUp > (opts->duration + framePeriod - 1) / framePeriod) {
+                caughtUp = (opts->duration + framePeriod - 1) / framePeriod;
+            }
+            
+            stats->framesDropped += caughtUp - nextFrame;
+            nextFrame = caughtUp;
+        }
+        
+        frame = nextFrame;
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    
+    return stats->writeFailures ? -1 : 0;
+}
+
+void animationPrintStats(const struct animationOptions *opts, const struct animationStats *stats)
+{
+    double seconds = stats->elapsed / 1e9;
+    double jitterStdDev = stats->framesSent > 1 ? sqrt(stats->jitterM2 / (double)(stats->framesSent - 1)) : 0.0;
+    
+    fprintf(stderr, "frames=%llu dropped=%llu failed=%llu elapsed=%.3fs target=%.1ffps achieved=%.1ffps\n",
+            (unsigned long long)stats->framesSent, (unsigned long long)stats->framesDropped,
+            (unsigned long long)stats->writeFailures, seconds, opts->rate,
+            seconds > 0 ? stats->framesSent / seconds : 0.0);
+    fprintf(stderr, "jitter mean=%.1fus stddev=%.1fus max=%.1fus\n",
+            stats->jitterMean / 1000.0, jitterStdDev / 1000.0, stats->jitterMax / 1000.0);
+}
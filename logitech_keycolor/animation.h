@@ -0,0 +1,74 @@
+//
+//  animation.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef animation_h
+#define animation_h
+
+#include "keycolor.h"
+
+struct compositor;
+struct exprProgram;
+
+enum animationEffect {
+    EFFECT_NONE = 0,
+    EFFECT_FADE,        // from -> to once over period
+    EFFECT_BREATHE,     // from, brightness following a sine of period
+    EFFECT_CYCLE,       // full hue rotation every period at the brightness of from
+    EFFECT_STROBE,      // from for the first half of period, to for the second
+    EFFECT_EXPR         // program, from for any report bytes outside its zones
+};
+
+struct animationOptions {
+    enum animationEffect effect;
+    double rate;                // target frames per second
+    uint64_t period;            // nanoseconds per effect cycle
+    uint64_t duration;          // nanoseconds to run, 0 runs until SIGINT/SIGTERM
+    uint8_t from[KEYCOLOR_REPORT_SIZE];
+    uint8_t to[KEYCOLOR_REPORT_SIZE];
+    const struct compositor *layers;    // optional, stacked over every rendered frame
+    const struct exprProgram *program;  // EFFECT_EXPR
+};
+
+struct animationStats {
+    uint64_t framesSent;
+    uint64_t framesDropped;
+    uint64_t writeFailures;
+    uint64_t elapsed;           // nanoseconds from first deadline to exit
+    uint64_t jitterMax;         // nanoseconds a frame went out after its deadline
+    double jitterMean;
+    double jitterM2;            // running sum of squared deviations, see animationPrintStats
+};
+
+enum animationEffect animationParseEffect(const char *name);
+void animationRender(const struct animationOptions *opts, uint64_t t, uint8_t *report);
+int animationRun(const struct animationOptions *opts, struct keyColorTarget *targets, size_t numTargets, struct animationStats *stats);
+void animationPrintStats(const struct animationOptions *opts, const struct animationStats *stats);
+
+#endif /* animation_h */
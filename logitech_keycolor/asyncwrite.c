@@ -0,0 +1,339 @@
+//
+//  asyncwrite.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "asyncwrite.h"
+#include "timeutil.h"
+#include "color.h"
+
+// Runs on the backend's completion thread, or inline for backends without asynchronous writes
+static void asyncWriteDone(struct transportAsyncWrite *write, int status)
+{
+    struct asyncSlot *slot = write->context;
+    struct asyncTarget *owner = slot->owner;
+    struct asyncWriter *writer = owner->writer;
+    uint64_t latency = monotonicNanos() - write->startTime;
+    
+    pthread_mutex_lock(&writer->lock);
+    latencyHistogramRecord(&writer->completion, latency, status != 0);
+    owner->completed++;
+    
+    if (status) {
+        owner->failed++;
+        writer->unreported++;
+    }
+    
+    slot->busy = 0;
+    owner->inFlight--;
+    pthread_cond_broadcast(&writer->done);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+struct asyncWriter *asyncWriterCreate(struct keyColorTarget *targets, size_t numTargets, unsigned window, uint64_t timeout)
+{
+    struct asyncWriter *writer = calloc(1, sizeof(struct asyncWriter));
+    
+    if (!writer || !(writer->targets = calloc(numTargets ? numTargets : 1, sizeof(struct asyncTarget)))) {
+        fprintf(stderr, "Failed to allocate async writer!\n");
+        free(writer);
+        return NULL;
+    }
+    
+    writer->numTargets = numTargets;
+    writer->window = window < 1 ? 1 : window > ASYNC_MAX_WINDOW ? ASYNC_MAX_WINDOW : window;
+    writer->timeout = timeout;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->done, NULL);
+    
+    for (size_t i = 0; i < numTargets; i++) {
+        struct asyncTarget *owner = &writer->targets[i];
+        
+        owner->writer = writer;
+        owner->target = &targets[i];
+        
+        for (unsigned j = 0; j < writer->window; j++) {
+            owner->slots[j].owner = owner;
+            owner->slots[j].write.target = &targets[i];
+            owner->slots[j].write.timeout = timeout;
+            owner->slots[j].write.completion = asyncWriteDone;
+            owner->slots[j].write.context = &owner->slots[j];
+        }
+    }
+    
+    return writer;
+}
+
+// Hands the report to every target and returns without waiting for the writes to land. A target with its
+// window full holds the caller until a slot frees up, at most writer->timeout, and then misses this report.
+// Returns the failures known so far: reports dropped now plus completions that failed since the last call
+int asyncWriterSubmit(struct asyncWriter *writer, const uint8_t *report, size_t reportLen)
+{
+    int numFailed = 0;
+    
+    if (reportLen > TRANSPORT_MAX_REPORT_SIZE) {
+        return (int)writer->numTargets;
+    }
+    
+    pthread_mutex_lock(&writer->lock);
+    
+    for (size_t i = 0; i < writer->numTargets; i++) {
+        struct asyncTarget *owner = &writer->targets[i];
+        
+        if (owner->inFlight == writer->window) {
+            uint64_t deadline = monotonicNanos() + writer->timeout;
+            uint64_t now;
+            
+            owner->windowWaits++;
+            
+            while (owner->inFlight == writer->window && (now = monotonicNanos()) < deadline) {
+                struct timespec ts;
+                
+                deadlineToTimespec(deadline - now, &ts);
+                pthread_cond_timedwait(&writer->done, &writer->lock, &ts);
+            }
+            
+            if (owner->inFlight == writer->window) {
+                owner->dropped++;
+                numFailed++;
+                continue;
+            }
+        }
+        
+        struct asyncSlot *slot = owner->slots;
+        
+        while (slot->busy) {
+            slot++;
+        }
+        
+        slot->busy = 1;
+        owner->inFlight++;
+        owner->submitted++;
+        
+        if (owner->inFlight > owner->maxInFlight) {
+            owner->maxInFlight = owner->inFlight;
+        }
+        
+        memcpy(slot->write.report, report, reportLen);
+        slot->write.reportLen = reportLen;
+        
+        // Backends may complete inline, which takes the lock
+        pthread_mutex_unlock(&writer->lock);
+        int started = transportWriteTargetAsync(&slot->write);
+        pthread_mutex_lock(&writer->lock);
+        
+        if (started != 0) {
+            slot->busy = 0;
+            owner->inFlight--;
+            
+            if (started > 0) {
+                owner->suppressed++;
+            } else {
+                owner->failed++;
+                numFailed++;
+            }
+        }
+    }
+    
+    numFailed += (int)writer->unreported;
+    writer->unreported = 0;
+    
+    pthread_mutex_unlock(&writer->lock);
+    
+    return numFailed;
+}
+
+static int asyncWriterInFlight(struct asyncWriter *writer)
+{
+    int inFlight = 0;
+    
+    for (size_t i = 0; i < writer->numTargets; i++) {
+        inFlight += (int)writer->targets[i].inFlight;
+    }
+    
+    return inFlight;
+}
+
+// Waits up to the timeout for everything in flight, returns the failures not yet reported by a submit,
+// counting writes that never completed
+int asyncWriterDrain(struct asyncWriter *writer)
+{
+    uint64_t deadline = monotonicNanos() + writer->timeout;
+    uint64_t now;
+    
+    pthread_mutex_lock(&writer->lock);
+    
+    while (asyncWriterInFlight(writer) && (now = monotonicNanos()) < deadline) {
+        struct timespec ts;
+        
+        deadlineToTimespec(deadline - now, &ts);
+        pthread_cond_timedwait(&writer->done, &writer->lock, &ts);
+    }
+    
+    int numFailed = (int)writer->unreported + asyncWriterInFlight(writer);
+    
+    writer->unreported = 0;
+    pthread_mutex_unlock(&writer->lock);
+    
+    return numFailed;
+}
+
+void asyncWriterPrintStats(struct asyncWriter *writer, FILE *fp)
+{
+    pthread_mutex_lock(&writer->lock);
+    
+    for (size_t i = 0; i < writer->numTargets; i++) {
+        struct asyncTarget *owner = &writer->targets[i];
+        
+        fprintf(fp, "async[%d] window=%u submitted=%llu completed=%llu failed=%llu suppressed=%llu dropped=%llu waits=%llu max-in-flight=%u\n",
+                owner->target->index, writer->window, (unsigned long long)owner->submitted,
+                (unsigned long long)owner->completed, (unsigned long long)owner->failed,
+                (unsigned long long)owner->suppressed, (unsigned long long)owner->dropped,
+                (unsigned long long)owner->windowWaits, owner->maxInFlight);
+    }
+    
+    if (writer->completion.count) {
+        fprintf(fp, "async completion p50=%.1fus p99=%.1fus max=%.1fus\n",
+                latencyHistogramPercentile(&writer->completion, 50) / 1e3,
+                latencyHistogramPercentile(&writer->completion, 99) / 1e3, writer->completion.max / 1e3);
+    }
+    
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void asyncWriterDestroy(struct asyncWriter *writer)
+{
+    if (!writer) {
+        return;
+    }
+    
+    asyncWriterDrain(writer);
+    
+    // A completion that never came would still land in the slots, they are left behind for it
+    pthread_mutex_lock(&writer->lock);
+    int inFlight = asyncWriterInFlight(writer);
+    pthread_mutex_unlock(&writer->lock);
+    
+    if (inFlight) {
+        fprintf(stderr, "WARNING: abandoning %d writes still in flight\n", inFlight);
+        return;
+    }
+    
+    pthread_cond_destroy(&writer->done);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->targets);
+    free(writer);
+}
+
+// As many frames as the device will take, each rendered while the previous ones are still on the wire
+static int asyncBenchmarkRun(const char *spec, unsigned window, int numFrames)
+{
+    struct hidTransport *transport = transportOpen(spec, 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        transportClose(transport);
+        return -1;
+    }
+    
+    transportSetCaching(transport, 0);
+    
+    if (window && transportStartAsync(transport, targets, numTargets, window, 1000000000ull)) {
+        transportReleaseTargets(targets, numTargets);
+        transportClose(transport);
+        return -1;
+    }
+    
+    const uint8_t from[KEYCOLOR_REPORT_SIZE] = { 255, 255, 128, 0 };
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    int numFailed = 0;
+    char label[32];
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (int frame = 0; frame < numFrames; frame++) {
+        colorScaleReport(from, (uint32_t)(frame * 257) & 0xffff, report, sizeof(report));
+        numFailed += transportWrite(targets, numTargets, report, sizeof(report));
+    }
+    
+    struct latencyHistogram completion;
+    
+    // The last window of completions belongs in both the elapsed time and the histogram
+    if (window) {
+        numFailed += asyncWriterDrain(transport->async);
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    
+    if (window) {
+        completion = transport->async->completion;
+    }
+    
+    numFailed += transportStopAsync(transport);
+    
+    if (window) {
+        snprintf(label, sizeof(label), "window=%u", window);
+    } else {
+        snprintf(label, sizeof(label), "sync");
+    }
+    
+    benchReportThroughput(label, (uint64_t)numFrames, elapsed, benchAllocations() - allocs, 0);
+    
+    if (window) {
+        fprintf(benchNotes(), "# %s completion p50=%.1fus p99=%.1fus failed=%d\n", label,
+                latencyHistogramPercentile(&completion, 50) / 1e3, latencyHistogramPercentile(&completion, 99) / 1e3, numFailed);
+    }
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return numFailed ? -1 : 0;
+}
+
+int asyncWriterBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:latency=1ms,service=100us";
+    static const unsigned windows[] = { 0, 1, 2, 4, 8, 16 };
+    int numFrames = opts->iterations * 2;
+    int ret = 0;
+    
+    fprintf(benchNotes(), "# %s, ops/s is the achieved frame rate\n", spec);
+    
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        if (asyncBenchmarkRun(spec, windows[i], numFrames)) {
+            ret = -1;
+        }
+    }
+    
+    return ret;
+}
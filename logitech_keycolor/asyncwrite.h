@@ -0,0 +1,83 @@
+//
+//  asyncwrite.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef asyncwrite_h
+#define asyncwrite_h
+
+#include <pthread.h>
+#include "keycolor.h"
+#include "transport.h"
+#include "latency.h"
+#include "bench.h"
+
+// Writes allowed in flight per target
+#define ASYNC_MAX_WINDOW 64
+
+struct asyncWriter;
+
+struct asyncSlot {
+    struct transportAsyncWrite write;
+    struct asyncTarget *owner;
+    int busy;
+};
+
+struct asyncTarget {
+    struct asyncWriter *writer;
+    struct keyColorTarget *target;
+    struct asyncSlot slots[ASYNC_MAX_WINDOW];
+    unsigned inFlight;
+    unsigned maxInFlight;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t suppressed;        // the board already showed it, see transportWriteTargetAsync
+    uint64_t dropped;           // window still full after the timeout
+    uint64_t windowWaits;       // submits that had to wait for a slot
+};
+
+struct asyncWriter {
+    struct asyncTarget *targets;
+    size_t numTargets;
+    unsigned window;
+    uint64_t timeout;           // nanoseconds a submit waits for a slot, and drain for the last completions
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    uint64_t unreported;        // failed completions not yet returned by a submit
+    struct latencyHistogram completion;     // submit to completion, all targets
+};
+
+struct asyncWriter *asyncWriterCreate(struct keyColorTarget *targets, size_t numTargets, unsigned window, uint64_t timeout);
+int asyncWriterSubmit(struct asyncWriter *writer, const uint8_t *report, size_t reportLen);
+int asyncWriterDrain(struct asyncWriter *writer);
+void asyncWriterPrintStats(struct asyncWriter *writer, FILE *fp);
+void asyncWriterDestroy(struct asyncWriter *writer);
+int asyncWriterBenchmark(struct benchOptions *opts);
+
+#endif /* asyncwrite_h */
@@ -0,0 +1,615 @@
+//
+//  audio.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include "audio.h"
+#include "transport.h"
+#include "timeutil.h"
+
+// Levels are relative to a running peak per band, anything this far below it is dark
+#define AUDIO_RANGE_DB 24.0f
+#define AUDIO_FLOOR_DB -50.0f           // peaks never drop below this, silence stays dark
+#define AUDIO_SPREAD_DB 24.0f           // band peaks stay within this of the overall peak, leakage stays dark
+#define AUDIO_PEAK_DECAY_DB 6.0f        // per second
+#define AUDIO_RELEASE_SECONDS 0.15f
+
+// Four lanes, SSE on x86 and NEON on arm from the same source via gcc/clang vector extensions
+typedef float audioVec4 __attribute__((vector_size(16)));
+
+static volatile sig_atomic_t audioStopRequested = 0;
+
+static const float bandEdges[AUDIO_BAND_ALL + 1] = { 20.0f, 250.0f, 2000.0f, 12000.0f };
+
+struct audioAnalyzer {
+    size_t fftSize;
+    unsigned log2Size;
+    size_t bandStart[AUDIO_NUM_BANDS];  // FFT bin range, end exclusive
+    size_t bandEnd[AUDIO_NUM_BANDS];
+    float powerScale;                   // full scale sine in both channels reads 0dB
+    float peakDecay;                    // dB per frame
+    float release;                      // level kept per frame while falling
+    float peakDb[AUDIO_NUM_BANDS];
+    float level[AUDIO_NUM_BANDS];
+    float power[AUDIO_NUM_BANDS];       // last frame, before gain
+    uint32_t *bitReverse;
+    float *window;
+    float *twiddleRe;                   // stage with half size h starts at h - 1
+    float *twiddleIm;
+    float *re;
+    float *im;
+    float *left;                        // most recent fftSize samples, oldest first
+    float *right;
+};
+
+static void audioSignalHandler(int sig)
+{
+    audioStopRequested = sig;
+}
+
+// "RATE[:CHANNELS[:s16|f32]]", anything left out keeps its current value
+int audioParseSpec(const char *spec, struct audioOptions *opts)
+{
+    char *end;
+    
+    if (!spec || !*spec) {
+        return 0;
+    }
+    
+    unsigned long sampleRate = strtoul(spec, &end, 10);
+    
+    if (end == spec || sampleRate < 8000 || sampleRate > 384000) {
+        return -1;
+    }
+    
+    opts->sampleRate = (uint32_t)sampleRate;
+    
+    if (*end == ':') {
+        const char *cp = end + 1;
+        unsigned long channels = strtoul(cp, &end, 10);
+        
+        if (end == cp || channels < 1 || channels > 2) {
+            return -1;
+        }
+        
+        opts->channels = (uint32_t)channels;
+    }
+    
+    if (*end == ':') {
+        if (strcmp(end + 1, "s16") == 0) {
+            opts->format = AUDIO_FORMAT_S16;
+        } else if (strcmp(end + 1, "f32") == 0) {
+            opts->format = AUDIO_FORMAT_F32;
+        } else {
+            return -1;
+        }
+    } else if (*end) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static size_t audioFrequencyBin(float frequency, uint32_t sampleRate, size_t fftSize)
+{
+    size_t bin = (size_t)(frequency * fftSize / sampleRate + 0.5f);
+    
+    if (bin < 1) {
+        bin = 1;
+    }
+    
+    return bin > fftSize / 2 + 1 ? fftSize / 2 + 1 : bin;
+}
+
+struct audioAnalyzer *audioAnalyzerCreate(uint32_t sampleRate, size_t hop)
+{
+    size_t n = AUDIO_MIN_FFT_SIZE;
+    unsigned log2Size = 10;
+    
+    while (n < hop && n < AUDIO_MAX_FFT_SIZE) {
+        n <<= 1;
+        log2Size++;
+    }
+    
+    // One block, tables then work buffers
+    struct audioAnalyzer *analyzer = calloc(1, sizeof(struct audioAnalyzer) + n * sizeof(uint32_t) + 7 * n * sizeof(float));
+    
+    if (!analyzer) {
+        return NULL;
+    }
+    
+    analyzer->fftSize = n;
+    analyzer->log2Size = log2Size;
+    analyzer->bitReverse = (uint32_t *)(analyzer + 1);
+    analyzer->window = (float *)(analyzer->bitReverse + n);
+    analyzer->twiddleRe = analyzer->window + n;
+    analyzer->twiddleIm = analyzer->twiddleRe + n;
+    analyzer->re = analyzer->twiddleIm + n;
+    analyzer->im = analyzer->re + n;
+    analyzer->left = analyzer->im + n;
+    analyzer->right = analyzer->left + n;
+    
+    double windowSum = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        uint32_t reversed = 0;
+        
+        for (unsigned b = 0; b < log2Size; b++) {
+            reversed |= (uint32_t)((i >> b) & 1) << (log2Size - 1 - b);
+        }
+        
+        analyzer->bitReverse[i] = reversed;
+        analyzer->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / n));
+        windowSum += analyzer->window[i];
+    }
+    
+    for (size_t h = 1; h < n; h <<= 1) {
+        for (size_t j = 0; j < h; j++) {
+            analyzer->twiddleRe[h - 1 + j] = (float)cos(-M_PI * j / h);
+            analyzer->twiddleIm[h - 1 + j] = (float)sin(-M_PI * j / h);
+        }
+    }
+    
+    for (int b = 0; b < AUDIO_BAND_ALL; b++) {
+        analyzer->bandStart[b] = audioFrequencyBin(bandEdges[b], sampleRate, n);
+        analyzer->bandEnd[b] = audioFrequencyBin(bandEdges[b + 1], sampleRate, n);
+    }
+    
+    analyzer->bandStart[AUDIO_BAND_ALL] = analyzer->bandStart[0];
+    analyzer->bandEnd[AUDIO_BAND_ALL] = analyzer->bandEnd[AUDIO_BAND_ALL - 1];
+    
+    float frameSeconds = (float)hop / sampleRate;
+    
+    analyzer->powerScale = (float)(2.0 / (windowSum * windowSum));
+    analyzer->peakDecay = AUDIO_PEAK_DECAY_DB * frameSeconds;
+    analyzer->release = expf(-frameSeconds / AUDIO_RELEASE_SECONDS);
+    
+    for (int b = 0; b < AUDIO_NUM_BANDS; b++) {
+        analyzer->peakDb[b] = AUDIO_FLOOR_DB;
+    }
+    
+    return analyzer;
+}
+
+void audioAnalyzerFree(struct audioAnalyzer *analyzer)
+{
+    free(analyzer);
+}
+
+size_t audioAnalyzerFftSize(const struct audioAnalyzer *analyzer)
+{
+    return analyzer->fftSize;
+}
+
+void audioAnalyzerPush(struct audioAnalyzer *analyzer, const float *left, const float *right, size_t numSamples)
+{
+    size_t n = analyzer->fftSize;
+    
+    if (numSamples >= n) {
+        memcpy(analyzer->left, left + numSamples - n, n * sizeof(float));
+        memcpy(analyzer->right, right + numSamples - n, n * sizeof(float));
+        return;
+    }
+    
+    memmove(analyzer->left, analyzer->left + numSamples, (n - numSamples) * sizeof(float));
+    memmove(analyzer->right, analyzer->right + numSamples, (n - numSamples) * sizeof(float));
+    memcpy(analyzer->left + n - numSamples, left, numSamples * sizeof(float));
+    memcpy(analyzer->right + n - numSamples, right, numSamples * sizeof(float));
+}
+
+static inline audioVec4 audioLoad(const float *p)
+{
+    audioVec4 v;
+    
+    memcpy(&v, p, sizeof(v));
+    
+    return v;
+}
+
+static inline void audioStore(float *p, audioVec4 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+// Iterative radix-2 in place on re/im, input already in bit reversed order
+static void audioFft(struct audioAnalyzer *analyzer)
+{
+    size_t n = analyzer->fftSize;
+    float *re = analyzer->re, *im = analyzer->im;
+    
+    for (size_t h = 1; h < n; h <<= 1) {
+        const float *wr = analyzer->twiddleRe + h - 1;
+        const float *wi = analyzer->twiddleIm + h - 1;
+        
+        for (size_t start = 0; start < n; start += 2 * h) {
+            float *ar = re + start, *ai = im + start, *br = re + start + h, *bi = im + start + h;
+            size_t j = 0;
+            
+            // Every stage from h = 4 on is whole vectors, the first two fall through to scalar
+            for (; j + 4 <= h; j += 4) {
+                audioVec4 xr = audioLoad(br + j), xi = audioLoad(bi + j);
+                audioVec4 twr = audioLoad(wr + j), twi = audioLoad(wi + j);
+                audioVec4 tr = xr * twr - xi * twi;
+                audioVec4 ti = xr * twi + xi * twr;
+                audioVec4 yr = audioLoad(ar + j), yi = audioLoad(ai + j);
+                
+                audioStore(ar + j, yr + tr);
+                audioStore(ai + j, yi + ti);
+                audioStore(br + j, yr - tr);
+                audioStore(bi + j, yi - ti);
+            }
+            
+            for (; j < h; j++) {
+                float tr = br[j] * wr[j] - bi[j] * wi[j];
+                float ti = br[j] * wi[j] + bi[j] * wr[j];
+                
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+// Left and right ride in one complex FFT as real and imaginary parts, Z[k] and Z[n-k] separate them again
+static inline float audioBinPower(const struct audioAnalyzer *analyzer, size_t k)
+{
+    size_t mirror = (analyzer->fftSize - k) & (analyzer->fftSize - 1);
+    float zr = analyzer->re[k], zi = analyzer->im[k], mr = analyzer->re[mirror], mi = analyzer->im[mirror];
+    
+    return 0.5f * (zr * zr + zi * zi + mr * mr + mi * mi);
+}
+
+void audioAnalyzerFrame(struct audioAnalyzer *analyzer, const uint8_t *ceiling, uint8_t *report)
+{
+    size_t n = analyzer->fftSize;
+    
+    for (size_t i = 0; i < n; i++) {
+        uint32_t j = analyzer->bitReverse[i];
+        
+        analyzer->re[j] = analyzer->left[i] * analyzer->window[i];
+        analyzer->im[j] = analyzer->right[i] * analyzer->window[i];
+    }
+    
+    audioFft(analyzer);
+    
+    analyzer->power[AUDIO_BAND_ALL] = 0;
+    
+    for (int b = 0; b < AUDIO_BAND_ALL; b++) {
+        float power = 0;
+        
+        for (size_t k = analyzer->bandStart[b]; k < analyzer->bandEnd[b]; k++) {
+            power += audioBinPower(analyzer, k);
+        }
+        
+        analyzer->power[b] = power;
+        analyzer->power[AUDIO_BAND_ALL] += power;
+    }
+    
+    // Overall level first, it sets the floor for the band peaks
+    for (int i = 0; i < AUDIO_NUM_BANDS; i++) {
+        int b = (AUDIO_BAND_ALL + i) % AUDIO_NUM_BANDS;
+        float db = 10.0f * log10f(analyzer->power[b] * analyzer->powerScale + 1e-12f);
+        float peak = analyzer->peakDb[b] - analyzer->peakDecay;
+        float floor = b == AUDIO_BAND_ALL ? AUDIO_FLOOR_DB : analyzer->peakDb[AUDIO_BAND_ALL] - AUDIO_SPREAD_DB;
+        
+        if (db > peak) {
+            peak = db;
+        }
+        
+        if (peak < floor) {
+            peak = floor;
+        }
+        
+        analyzer->peakDb[b] = peak;
+        
+        float target = (db - (peak - AUDIO_RANGE_DB)) / AUDIO_RANGE_DB;
+        
+        if (target < 0) {
+            target = 0;
+        }
+        
+        // Instant attack, exponential release so beats flash instead of flicker
+        if (target > analyzer->level[b]) {
+            analyzer->level[b] = target;
+        } else {
+            analyzer->level[b] = analyzer->level[b] * analyzer->release + target * (1.0f - analyzer->release);
+        }
+    }
+    
+    report[0] = (uint8_t)(ceiling[0] * analyzer->level[AUDIO_BAND_ALL] + 0.5f);
+    report[1] = (uint8_t)(ceiling[1] * analyzer->level[AUDIO_BAND_BASS] + 0.5f);
+    report[2] = (uint8_t)(ceiling[2] * analyzer->level[AUDIO_BAND_MID] + 0.5f);
+    report[3] = (uint8_t)(ceiling[3] * analyzer->level[AUDIO_BAND_TREBLE] + 0.5f);
+}
+
+// Little endian hosts only, which is every Mac and Linux box this drives a keyboard from
+static void audioDecode(const struct audioOptions *opts, const uint8_t *pcm, size_t numSamples, float *left, float *right)
+{
+    for (size_t i = 0; i < numSamples; i++) {
+        for (uint32_t c = 0; c < opts->channels; c++) {
+            float *out = c == 0 ? left : right;
+            
+            if (opts->format == AUDIO_FORMAT_S16) {
+                int16_t value;
+                
+                memcpy(&value, pcm, sizeof(value));
+                out[i] = value * (1.0f / 32768.0f);
+                pcm += sizeof(value);
+            } else {
+                memcpy(&out[i], pcm, sizeof(float));
+                pcm += sizeof(float);
+            }
+        }
+        
+        if (opts->channels == 1) {
+            right[i] = left[i];
+        }
+    }
+}
+
+// Returns the bytes read, short only at end of input, on error or when interrupted by a stop request
+static size_t audioReadFull(int fd, uint8_t *buf, size_t len)
+{
+    size_t total = 0;
+    
+    while (total < len) {
+        ssize_t got = read(fd, buf + total, len - total);
+        
+        if (got > 0) {
+            total += (size_t)got;
+        } else if (got == 0 || errno != EINTR || audioStopRequested) {
+            break;
+        }
+    }
+    
+    return total;
+}
+
+int audioRun(const struct audioOptions *opts, int fd, struct keyColorTarget *targets, size_t numTargets, struct audioStats *stats)
+{
+    size_t hop = (size_t)(opts->sampleRate / opts->rate + 0.5);
+    size_t frameBytes = (opts->format == AUDIO_FORMAT_S16 ? sizeof(int16_t) : sizeof(float)) * opts->channels;
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    struct stat st;
+    int retVal = 0;
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    if (hop == 0) {
+        hop = 1;
+    }
+    
+    struct audioAnalyzer *analyzer = audioAnalyzerCreate(opts->sampleRate, hop);
+    uint8_t *pcm = malloc(hop * frameBytes);
+    float *left = malloc(hop * 2 * sizeof(float));
+    float *right = left ? left + hop : NULL;
+    
+    if (!analyzer || !pcm || !left) {
+        fprintf(stderr, "Failed to allocate audio buffers!\n");
+        audioAnalyzerFree(analyzer);
+        free(pcm);
+        free(left);
+        return -1;
+    }
+    
+    stats->fftSize = analyzer->fftSize;
+    stats->sampleRate = opts->sampleRate;
+    stats->framePeriod = (uint64_t)hop * 1000000000ull / opts->sampleRate;
+    
+    // A file plays back in real time, a pipe is already paced by whatever is capturing
+    int paced = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = audioSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    
+    uint64_t startTime = monotonicNanos();
+    
+    while (!audioStopRequested) {
+        uint64_t t = (stats->samples + hop) * 1000000000ull / opts->sampleRate;
+        
+        if (opts->duration && t > opts->duration) {
+            break;
+        }
+        
+        if (audioReadFull(fd, pcm, hop * frameBytes) < hop * frameBytes) {
+            break;
+        }
+        
+        audioDecode(opts, pcm, hop, left, right);
+        audioAnalyzerPush(analyzer, left, right, hop);
+        stats->samples += hop;
+        
+        if (paced) {
+            sleepUntilNanos(startTime + t);
+        }
+        
+        // Behind the audio, keep feeding the history but skip analysis and writes until caught up
+        int behind = 0;
+        
+        if (paced) {
+            behind = monotonicNanos() - startTime > t + stats->framePeriod;
+        } else {
+            int available = 0;
+            
+            behind = ioctl(fd, FIONREAD, &available) == 0 && (size_t)available >= hop * frameBytes;
+        }
+        
+        if (behind) {
+            stats->framesDropped++;
+            continue;
+        }
+        
+        uint64_t analysisStart = monotonicNanos();
+        
+        audioAnalyzerFrame(analyzer, opts->ceiling, report);
+        latencyHistogramRecord(&stats->analysis, monotonicNanos() - analysisStart, 0);
+        
+        stats->writeFailures += transportWrite(targets, numTargets, report, sizeof(report));
+        stats->framesSent++;
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    
+    if (stats->writeFailures) {
+        retVal = -1;
+    }
+    
+    audioAnalyzerFree(analyzer);
+    free(pcm);
+    free(left);
+    
+    return retVal;
+}
+
+void audioPrintStats(const struct audioStats *stats, FILE *fp)
+{
+    const struct latencyHistogram *analysis = &stats->analysis;
+    
+    fprintf(fp, "frames=%llu dropped=%llu failed=%llu audio=%.3fs elapsed=%.3fs fft=%zu\n",
+            (unsigned long long)stats->framesSent, (unsigned long long)stats->framesDropped,
+            (unsigned long long)stats->writeFailures, stats->sampleRate ? (double)stats->samples / stats->sampleRate : 0.0,
+            stats->elapsed / 1e9, stats->fftSize);
+    
+    if (analysis->count) {
+        fprintf(fp, "analysis p50=%.1fus p99=%.1fus max=%.1fus, worst %.2f%% of the %.2fms frame\n",
+                latencyHistogramPercentile(analysis, 50) / 1000.0, latencyHistogramPercentile(analysis, 99) / 1000.0,
+                analysis->max / 1000.0, stats->framePeriod ? 100.0 * analysis->max / stats->framePeriod : 0.0,
+                stats->framePeriod / 1e6);
+    }
+}
+
+// Direct DFT of one bin of the windowed history, what the FFT has to agree with
+static float audioDirectPower(const struct audioAnalyzer *analyzer, size_t k)
+{
+    double lr = 0, li = 0, rr = 0, ri = 0;
+    size_t n = analyzer->fftSize;
+    
+    for (size_t i = 0; i < n; i++) {
+        double angle = -2.0 * M_PI * (double)(k * i % n) / n;
+        double l = analyzer->left[i] * analyzer->window[i], r = analyzer->right[i] * analyzer->window[i];
+        
+        lr += l * cos(angle);
+        li += l * sin(angle);
+        rr += r * cos(angle);
+        ri += r * sin(angle);
+    }
+    
+    return (float)(lr * lr + li * li + rr * rr + ri * ri);
+}
+
+int audioBenchmark(struct benchOptions *opts)
+{
+    const uint32_t sampleRate = 48000;
+    const size_t hop = 800;             // 60fps
+    const uint8_t ceiling[KEYCOLOR_REPORT_SIZE] = { 255, 255, 255, 255 };
+    int numFrames = opts->iterations * 50;
+    uint8_t report[KEYCOLOR_REPORT_SIZE] = { 0 };
+    float left[800], right[800];
+    uint32_t noise = 1;
+    
+    struct audioAnalyzer *analyzer = audioAnalyzerCreate(sampleRate, hop);
+    uint64_t *samples = calloc((size_t)numFrames, sizeof(uint64_t));
+    
+    if (!analyzer || !samples) {
+        audioAnalyzerFree(analyzer);
+        free(samples);
+        return -1;
+    }
+    
+    fprintf(benchNotes(), "# 48kHz stereo, %zu samples per frame, fft=%zu\n", hop, analyzer->fftSize);
+    
+    // Kick drum on the left, hi-hat on the right, a little noise under both
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (int frame = 0; frame < numFrames; frame++) {
+        for (size_t i = 0; i < hop; i++) {
+            double t = (double)((uint64_t)frame * hop + i) / sampleRate;
+            
+            noise = noise * 1664525u + 1013904223u;
+            left[i] = (float)(0.8 * sin(2.0 * M_PI * 60.0 * t)) + (float)(noise >> 8) * (1.0f / 16777216.0f) * 0.002f;
+            right[i] = (float)(0.3 * sin(2.0 * M_PI * 6000.0 * t));
+        }
+        
+        uint64_t frameStart = monotonicNanos();
+        
+        audioAnalyzerPush(analyzer, left, right, hop);
+        audioAnalyzerFrame(analyzer, ceiling, report);
+        samples[frame] = monotonicNanos() - frameStart;
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    uint64_t analysis = 0;
+    
+    for (int frame = 0; frame < numFrames; frame++) {
+        analysis += samples[frame];
+    }
+    
+    allocs = benchAllocations() - allocs;
+    benchReportLatency("frame", samples, numFrames);
+    benchReportThroughput("analyze", (uint64_t)numFrames, analysis, allocs, (uint64_t)numFrames * hop * 2 * sizeof(int16_t));
+    
+    float maxError = 0;
+    size_t bins[] = { 1, 3, 64, 128, 200, 511 };
+    
+    for (size_t i = 0; i < sizeof(bins) / sizeof(bins[0]); i++) {
+        float direct = audioDirectPower(analyzer, bins[i]);
+        float fft = audioBinPower(analyzer, bins[i]);
+        float error = fabsf(fft - direct) / (direct > 1.0f ? direct : 1.0f);
+        
+        if (error > maxError) {
+            maxError = error;
+        }
+    }
+    
+    fprintf(benchNotes(), "# %.0fx real time on one core, analysis %.1f%% of wall time\n",
+            (double)numFrames * hop / sampleRate * 1e9 / (analysis ? analysis : 1), elapsed ? 100.0 * analysis / elapsed : 0.0);
+    fprintf(benchNotes(), "# last report wasd=%u r=%u g=%u b=%u, fft vs direct dft max relative error %.2g\n",
+            report[0], report[1], report[2], report[3], maxError);
+    
+    audioAnalyzerFree(analyzer);
+    free(samples);
+    
+    return maxError > 1e-3f ? -1 : 0;
+}
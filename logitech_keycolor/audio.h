@@ -0,0 +1,89 @@
+//
+//  audio.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef audio_h
+#define audio_h
+
+#include <stdio.h>
+#include "keycolor.h"
+#include "latency.h"
+#include "bench.h"
+
+#define AUDIO_MIN_FFT_SIZE 1024
+#define AUDIO_MAX_FFT_SIZE 16384
+
+enum audioSampleFormat {
+    AUDIO_FORMAT_S16,           // signed 16 bit little endian
+    AUDIO_FORMAT_F32            // 32 bit float little endian
+};
+
+enum audioBand {
+    AUDIO_BAND_BASS,            // 20-250Hz, red
+    AUDIO_BAND_MID,             // 250-2000Hz, green
+    AUDIO_BAND_TREBLE,          // 2-12kHz, blue
+    AUDIO_BAND_ALL,             // 20Hz-12kHz, wasd
+    AUDIO_NUM_BANDS
+};
+
+struct audioOptions {
+    uint32_t sampleRate;
+    uint32_t channels;          // 1 or 2, stereo is analyzed as one complex FFT
+    enum audioSampleFormat format;
+    double rate;                // frames per second
+    uint64_t duration;          // nanoseconds of audio to play, 0 runs to end of input
+    uint8_t ceiling[KEYCOLOR_REPORT_SIZE];  // report value at full level per field
+};
+
+struct audioStats {
+    uint64_t framesSent;
+    uint64_t framesDropped;     // analyzed late enough that the next frames were skipped
+    uint64_t writeFailures;
+    uint64_t samples;           // sample frames consumed
+    uint32_t sampleRate;
+    uint64_t elapsed;
+    size_t fftSize;
+    uint64_t framePeriod;       // nanoseconds of audio per frame
+    struct latencyHistogram analysis;   // window, FFT and band mapping per frame
+};
+
+// FFT, window and band state for one stream, a single allocation
+struct audioAnalyzer;
+
+int audioParseSpec(const char *spec, struct audioOptions *opts);
+struct audioAnalyzer *audioAnalyzerCreate(uint32_t sampleRate, size_t hop);
+void audioAnalyzerFree(struct audioAnalyzer *analyzer);
+size_t audioAnalyzerFftSize(const struct audioAnalyzer *analyzer);
+void audioAnalyzerPush(struct audioAnalyzer *analyzer, const float *left, const float *right, size_t numSamples);
+void audioAnalyzerFrame(struct audioAnalyzer *analyzer, const uint8_t *ceiling, uint8_t *report);
+int audioRun(const struct audioOptions *opts, int fd, struct keyColorTarget *targets, size_t numTargets, struct audioStats *stats);
+void audioPrintStats(const struct audioStats *stats, FILE *fp);
+int audioBenchmark(struct benchOptions *opts);
+
+#endif /* audio_h */
@@ -0,0 +1,241 @@
+//
+//  batch.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "batch.h"
+#include "command.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "bench.h"
+
+// Apply one parsed command to the current report, returns -1 if a write failed. With merge set and the
+// boards not ready for another report yet, the write is left for the next command to carry
+static int batchApply(struct keyColorCommand *cmd, uint8_t *report, struct keyColorTarget *targets, size_t numTargets, int merge, int *dirty)
+{
+    switch (cmd->type) {
+        case COMMAND_RGB:
+        case COMMAND_GRAY:
+            report[1] = cmd->red;
+            report[2] = cmd->green;
+            report[3] = cmd->blue;
+            break;
+        case COMMAND_WASD:
+            report[0] = cmd->red;
+            break;
+        case COMMAND_SLEEP: {
+            int failed = *dirty && transportWrite(targets, numTargets, report, KEYCOLOR_REPORT_SIZE);
+            
+            *dirty = 0;
+            sleepNanos(cmd->nanos);
+            return failed ? -1 : 0;
+        }
+        default:
+            return 0;
+    }
+    
+    if (merge && transportWriteDelay(targets, numTargets)) {
+        *dirty = 1;
+        return 1;
+    }
+    
+    *dirty = 0;
+    
+    return transportWrite(targets, numTargets, report, KEYCOLOR_REPORT_SIZE) ? -1 : 0;
+}
+
+// Lines are parsed in place out of one fixed buffer, nothing is allocated per command
+int batchRun(int fd, uint8_t *report, struct keyColorTarget *targets, size_t numTargets, int verbose, struct batchStats *stats)
+{
+    static char buf[BATCH_BUFFER_SIZE + 1];
+    size_t bufLen = 0;
+    int eof = 0, skipping = 0, dirty = 0;
+    uint64_t startTime = monotonicNanos();
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    while (!eof || bufLen) {
+        if (!eof) {
+            // A merged color goes out before blocking on more input
+            if (dirty) {
+                dirty = 0;
+                
+                if (transportWrite(targets, numTargets, report, KEYCOLOR_REPORT_SIZE)) {
+                    stats->writeFailures++;
+                }
+            }
+            
+            ssize_t n = read(fd, buf + bufLen, BATCH_BUFFER_SIZE - bufLen);
+            
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            
+            if (n < 0) {
+                perror("read");
+                return -1;
+            }
+            
+            if (n == 0) {
+                eof = 1;
+            }
+            
+            bufLen += (size_t)n;
+        }
+        
+        char *line = buf;
+        char *bufEnd = buf + bufLen;
+        char *newline;
+        
+        while (line < bufEnd && ((newline = memchr(line, '\n', bufEnd - line)) != NULL || eof)) {
+            struct keyColorCommand cmd;
+            
+            if (!newline) {
+                newline = bufEnd;
+            }
+            *newline = '\0';
+            stats->lines++;
+            
+            // Tail of a line that did not fit in the buffer, already reported
+            if (skipping) {
+                skipping = 0;
+                line = newline + 1;
+                continue;
+            }
+            
+            if (parseCommand(line, &cmd) == COMMAND_ERROR) {
+                fprintf(stderr, "line %llu: bad command '%s'\n", (unsigned long long)stats->lines, line);
+                stats->errors++;
+            } else if (cmd.type != COMMAND_NONE) {
+                // Only merge into a command that has already arrived, never hold a color waiting on the producer
+                int merge = newline < bufEnd && memchr(newline + 1, '\n', bufEnd - newline - 1) != NULL;
+                int status = batchApply(&cmd, report, targets, numTargets, merge, &dirty);
+                
+                stats->commands++;
+                
+                if (status < 0) {
+                    stats->writeFailures++;
+                } else if (status > 0) {
+                    stats->merged++;
+                }
+                
+                if (verbose > 1) {
+                    printf("%s -> wasd=%d rgb=%d,%d,%d\n", line, report[0], report[1], report[2], report[3]);
+                }
+            }
+            
+            line = newline + 1;
+        }
+        
+        if (line >= bufEnd) {
+            bufLen = 0;
+        } else if (line == buf && bufLen == BATCH_BUFFER_SIZE) {
+            fprintf(stderr, "line %llu: longer than %d bytes, skipped\n", (unsigned long long)stats->lines + 1, BATCH_BUFFER_SIZE);
+            stats->errors++;
+            skipping = 1;
+            bufLen = 0;
+        } else {
+            bufLen = bufEnd - line;
+            memmove(buf, line, bufLen);
+        }
+    }
+    
+    if (dirty && transportWrite(targets, numTargets, report, KEYCOLOR_REPORT_SIZE)) {
+        stats->writeFailures++;
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    
+    return stats->errors || stats->writeFailures ? -1 : 0;
+}
+
+void batchPrintStats(const struct batchStats *stats)
+{
+    double seconds = stats->elapsed / 1e9;
+    
+    fprintf(stderr, "lines=%llu commands=%llu merged=%llu errors=%llu failed=%llu elapsed=%.3fs rate=%.0f commands/s\n",
+            (unsigned long long)stats->lines, (unsigned long long)stats->commands, (unsigned long long)stats->merged,
+            (unsigned long long)stats->errors, (unsigned long long)stats->writeFailures,
+            seconds, seconds > 0 ? stats->commands / seconds : 0.0);
+}
+
+// Synthetic command stream through the fake device, parse + cache + write per command
+int batchBenchmark(struct benchOptions *opts)
+{
+    FILE *fp = tmpfile();
+    
+    if (!fp) {
+        perror("tmpfile");
+        return -1;
+    }
+    
+    for (int i = 0; i < opts->iterations; i++) {
+        switch (i % 3) {
+            case 0: fprintf(fp, "rgb %d,%d,%d\n", i & 0xff, (i >> 8) & 0xff, 255 - (i & 0xff)); break;
+            case 1: fprintf(fp, "gray %d\n", (i * 7) & 0xff); break;
+            default: fprintf(fp, "wasd %d\n", (i * 13) & 0xff); break;
+        }
+    }
+    fflush(fp);
+    
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets)) {
+        transportClose(transport);
+        fclose(fp);
+        return -1;
+    }
+    
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    struct batchStats stats;
+    
+    memcpy(report, opts->report, sizeof(report));
+    
+    long inputBytes = ftell(fp);
+    
+    lseek(fileno(fp), 0, SEEK_SET);
+    
+    uint64_t allocs = benchAllocations();
+    int ret = batchRun(fileno(fp), report, targets, numTargets, 0, &stats);
+    
+    benchReportThroughput("batch", stats.commands, stats.elapsed, benchAllocations() - allocs, inputBytes > 0 ? (uint64_t)inputBytes : 0);
+    transportPrintStats(transport, benchNotes());
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    fclose(fp);
+    
+    return ret;
+}
@@ -0,0 +1,52 @@
+//
+//  batch.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef batch_h
+#define batch_h
+
+#include "keycolor.h"
+#include "bench.h"
+
+#define BATCH_BUFFER_SIZE 65536     // also the longest accepted line
+
+struct batchStats {
+    uint64_t lines;
+    uint64_t commands;
+    uint64_t merged;            // folded into a later command's write while the boards were paced
+    uint64_t errors;
+    uint64_t writeFailures;
+    uint64_t elapsed;
+};
+
+int batchRun(int fd, uint8_t *report, struct keyColorTarget *targets, size_t numTargets, int verbose, struct batchStats *stats);
+void batchPrintStats(const struct batchStats *stats);
+int batchBenchmark(struct benchOptions *opts);
+
+#endif /* batch_h */
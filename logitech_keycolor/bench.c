@@ -0,0 +1,300 @@
+//
+//  bench.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "daemon.h"
+#include "transport.h"
+#include "batch.h"
+#include "writers.h"
+#include "dumpwriter.h"
+#include "command.h"
+#include "profiles.h"
+#include "hiddescriptor.h"
+#include "latency.h"
+#include "hotplug.h"
+#include "audio.h"
+#include "color.h"
+#include "timeline.h"
+#include "ratecontrol.h"
+#include "asyncwrite.h"
+#include "compositor.h"
+#include "expr.h"
+#include "recorder.h"
+#include "shmcontrol.h"
+#include "phaselock.h"
+#include "framebuffer.h"
+#include "statefile.h"
+#include "timeutil.h"
+
+extern char **environ;
+
+#define BENCH_ALLOCS_UNSUPPORTED UINT64_MAX
+
+static const char *currentBench = "";
+static enum benchFormat currentFormat = BENCH_FORMAT_TEXT;
+
+#ifndef __has_feature
+#define __has_feature(x) 0
+#endif
+
+// Counting replaces the process allocator, so it is only built into bench builds (-DKEYCOLOR_BENCH_ALLOC).
+// Sanitizers bring their own allocator, counting is left off under them
+#if defined(KEYCOLOR_BENCH_ALLOC) && defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__) && \
+    !__has_feature(address_sanitizer) && !__has_feature(thread_sanitizer)
+// Every allocation in the process is counted, so allocs/op covers libc and the code under test alike
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static uint64_t benchAllocCount;
+
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&benchAllocCount, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __atomic_fetch_add(&benchAllocCount, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&benchAllocCount, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+uint64_t benchAllocations(void)
+{
+    return __atomic_load_n(&benchAllocCount, __ATOMIC_RELAXED);
+}
+#else
+uint64_t benchAllocations(void)
+{
+    return BENCH_ALLOCS_UNSUPPORTED;
+}
+#endif
+
+struct benchEntry {
+    const char *name;
+    const char *description;
+    int (*run)(struct benchOptions *opts);
+};
+
+static struct benchEntry benchmarks[] = {
+    { "daemon", "per-command latency of the one-shot CLI vs. the daemon socket", daemonBenchmark },
+    { "pipeline", "report write throughput and latency through a transport", transportBenchmark },
+    { "cache", "writes issued vs. suppressed for a 500fps breathe effect", transportCacheBenchmark },
+    { "batch", "--batch command stream throughput against the fake device", batchBenchmark },
+    { "writers", "serial vs. per-device writer threads, with and without a stalled board", writerPoolBenchmark },
+    { "startup", "one-shot CLI with cold element matching vs. the resolve cache", transportStartupBenchmark },
+    { "dump", "streaming --dump writer over 10k element synthetic trees, per --dump-format", dumpWriterBenchmark },
+    { "parse", "color value, -C component and --batch command parsing", commandBenchmark },
+    { "encode", "zone encodes into the color report for every device profile", deviceProfileBenchmark },
+    { "descriptor", "report descriptor parse and flat element table lookups", hidDescriptorBenchmark },
+    { "latency", "latency histogram recording, percentile queries and the clock itself", latencyBenchmark },
+    { "hotplug", "attach to color applied under a simulated attach/detach storm", hotplugBenchmark },
+    { "audio", "per frame windowed FFT and band mapping of 48kHz stereo", audioBenchmark },
+    { "color", "color parsing, linear light fades through the lookup tables and calibration", colorBenchmark },
+    { "timeline", "keyframe script compile and zero-copy playback of the mapped frames", timelineBenchmark },
+    { "rate", "500fps producer against a board that punishes early writes, with and without rate control", rateControlBenchmark },
+    { "async", "frame rate against a 1ms board synchronously and with 1-16 writes in flight", asyncWriterBenchmark },
+    { "compose", "layer stack flattening and a layered breathe counting reports per frame", compositorBenchmark },
+    { "expr", "effect expression compile, and per frame bytecode evaluation against the same effect in C", exprBenchmark },
+    { "record", "lock free report recording from 1 and 4 threads, write overhead, and replay of the recording", recorderBenchmark },
+    { "shared", "shared memory color slots: producer publish cost and publish to written latency", shmControlBenchmark },
+    { "sync", "inter-device skew of one effect on boards of differing latency, fanned out and phase locked", phaseLockBenchmark },
+    { "framebuffer", "per-key chunked reports for a typing ripple and a full board gradient, dirty runs against full refresh", framebufferBenchmark },
+    { "devdump", "--dump of 48 boards with a 1ms read each, serial vs. parallel formatting, with and without --dump-filter", transportDumpBenchmark },
+    { "state", "state file parse cost and reload to applied latency of config pushes into a followed file", stateFileBenchmark },
+    { NULL, NULL, NULL }
+};
+
+static int compareSamples(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+    
+    return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
+int benchFormatParse(const char *name, enum benchFormat *format)
+{
+    if (strcmp(name, "text") == 0) {
+        *format = BENCH_FORMAT_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        *format = BENCH_FORMAT_JSON;
+    } else {
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Commentary that is not a result, kept off stdout when it has to stay machine readable
+FILE *benchNotes(void)
+{
+    return currentFormat == BENCH_FORMAT_JSON ? stderr : stdout;
+}
+
+void benchReportLatency(const char *label, uint64_t *samples, int numSamples)
+{
+    if (numSamples <= 0) {
+        if (currentFormat == BENCH_FORMAT_JSON) {
+            printf("{\"bench\":\"%s\",\"case\":\"%s\",\"n\":0}\n", currentBench, label);
+        } else {
+            printf("%-10s no samples\n", label);
+        }
+        return;
+    }
+    
+    qsort(samples, numSamples, sizeof(uint64_t), compareSamples);
+    
+    double total = 0;
+    
+    for (int i = 0; i < numSamples; i++) {
+        total += samples[i];
+    }
+    
+    if (currentFormat == BENCH_FORMAT_JSON) {
+        printf("{\"bench\":\"%s\",\"case\":\"%s\",\"n\":%d,\"mean_ns\":%.0f,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}\n",
+               currentBench, label, numSamples, total / numSamples,
+               (unsigned long long)samples[numSamples * 50 / 100],
+               (unsigned long long)samples[numSamples * 90 / 100],
+               (unsigned long long)samples[numSamples * 99 / 100],
+               (unsigned long long)samples[numSamples - 1]);
+        return;
+    }
+    
+    printf("%-10s n=%d mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus max=%.1fus\n", label, numSamples,
+           total / numSamples / 1000.0,
+           samples[numSamples * 50 / 100] / 1000.0,
+           samples[numSamples * 90 / 100] / 1000.0,
+           samples[numSamples * 99 / 100] / 1000.0,
+           samples[numSamples - 1] / 1000.0);
+}
+
+// allocs is a benchAllocations() delta, bytes may be 0 when throughput means nothing
+void benchReportThroughput(const char *label, uint64_t ops, uint64_t elapsedNanos, uint64_t allocs, uint64_t bytes)
+{
+    double nsPerOp = ops ? (double)elapsedNanos / ops : 0.0;
+    double opsPerSec = elapsedNanos ? ops * 1e9 / elapsedNanos : 0.0;
+    double bytesPerSec = elapsedNanos ? bytes * 1e9 / elapsedNanos : 0.0;
+    int haveAllocs = benchAllocations() != BENCH_ALLOCS_UNSUPPORTED;
+    double allocsPerOp = ops && haveAllocs ? (double)allocs / ops : 0.0;
+    
+    if (currentFormat == BENCH_FORMAT_JSON) {
+        printf("{\"bench\":\"%s\",\"case\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f,\"allocs_per_op\":",
+               currentBench, label, (unsigned long long)ops, nsPerOp, opsPerSec);
+        
+        if (haveAllocs) {
+            printf("%.3f", allocsPerOp);
+        } else {
+            printf("null");
+        }
+        
+        printf(",\"bytes_per_sec\":%.0f}\n", bytesPerSec);
+        return;
+    }
+    
+    printf("%-10s ops=%llu %.1fns/op %.0f ops/s", label, (unsigned long long)ops, nsPerOp, opsPerSec);
+    
+    if (haveAllocs) {
+        printf(" %.3f allocs/op", allocsPerOp);
+    } else {
+        printf(" - allocs/op");
+    }
+    
+    if (bytes) {
+        printf(" %.1fMB/s", bytesPerSec / 1e6);
+    }
+    
+    printf("\n");
+}
+
+// Wall time to spawn and reap one child, 0 if it could not be started
+uint64_t benchTimeSpawn(char *const spawnArgv[])
+{
+    uint64_t startTime = monotonicNanos();
+    pid_t pid;
+    int status;
+    
+    if (posix_spawnp(&pid, spawnArgv[0], NULL, NULL, spawnArgv, environ)) {
+        return 0;
+    }
+    
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    
+    return monotonicNanos() - startTime;
+}
+
+int benchRun(const char *name, struct benchOptions *opts)
+{
+    int ran = 0, failed = 0;
+    
+    if (strcmp(name, "list") == 0) {
+        for (struct benchEntry *b = benchmarks; b->name; b++) {
+            printf("%-10s %s\n", b->name, b->description);
+        }
+        return 0;
+    }
+    
+    currentFormat = opts->format;
+    
+    for (struct benchEntry *b = benchmarks; b->name; b++) {
+        if (strcmp(name, "all") != 0 && strcmp(name, b->name) != 0) {
+            continue;
+        }
+        
+        currentBench = b->name;
+        fprintf(benchNotes(), "# %s: %s (%d iterations)\n", b->name, b->description, opts->iterations);
+        
+        if (b->run(opts)) {
+            failed++;
+        }
+        fflush(stdout);
+        ran++;
+    }
+    
+    if (!ran) {
+        fprintf(stderr, "Unknown benchmark '%s', try --bench list\n", name);
+        return 1;
+    }
+    
+    return failed ? 1 : 0;
+}
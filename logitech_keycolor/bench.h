@@ -0,0 +1,60 @@
+//
+//  bench.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef bench_h
+#define bench_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum benchFormat {
+    BENCH_FORMAT_TEXT,
+    BENCH_FORMAT_JSON          // one object per result line, notes go to stderr
+};
+
+struct benchOptions {
+    const char *progPath;       // argv[0], used to time the one-shot CLI
+    const char *socketPath;
+    const char *transportSpec;  // --transport, benchmarks default to the fake device
+    int iterations;
+    int verbose;
+    uint8_t report[4];
+    enum benchFormat format;
+};
+
+int benchRun(const char *name, struct benchOptions *opts);
+int benchFormatParse(const char *name, enum benchFormat *format);
+void benchReportLatency(const char *label, uint64_t *samples, int numSamples);
+void benchReportThroughput(const char *label, uint64_t ops, uint64_t elapsedNanos, uint64_t allocs, uint64_t bytes);
+FILE *benchNotes(void);
+uint64_t benchAllocations(void);
+uint64_t benchTimeSpawn(char *const spawnArgv[]);
+
+#endif /* bench_h */
@@ -0,0 +1,355 @@
+//
+//  color.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "color.h"
+#include "command.h"
+#include "keycolor.h"
+#include "timeutil.h"
+#include "colortables.h"
+
+static const struct {
+    const char *name;
+    uint32_t rgb;               // sRGB 0xrrggbb, or a color temperature when kelvin is set
+    int kelvin;
+} namedColors[] = {
+    { "black", 0x000000, 0 },
+    { "white", 0xffffff, 0 },
+    { "red", 0xff0000, 0 },
+    { "green", 0x00ff00, 0 },
+    { "blue", 0x0000ff, 0 },
+    { "yellow", 0xffff00, 0 },
+    { "cyan", 0x00ffff, 0 },
+    { "magenta", 0xff00ff, 0 },
+    { "orange", 0xff8000, 0 },
+    { "amber", 0xffbf00, 0 },
+    { "purple", 0x8000ff, 0 },
+    { "violet", 0xee82ee, 0 },
+    { "pink", 0xff69b4, 0 },
+    { "teal", 0x008080, 0 },
+    { "gold", 0xffd700, 0 },
+    { "candle", 1900, 1 },
+    { "warmwhite", 2700, 1 },
+    { "neutralwhite", 4000, 1 },
+    { "daylight", 6500, 1 },
+    { "coolwhite", 8000, 1 },
+    { NULL, 0, 0 }
+};
+
+static void colorFromSrgb(uint8_t red, uint8_t green, uint8_t blue, struct colorLinear *color)
+{
+    color->red = colorDecode(red);
+    color->green = colorDecode(green);
+    color->blue = colorDecode(blue);
+}
+
+static int hexDigit(char ch)
+{
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    
+    ch |= 0x20;
+    
+    return ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+}
+
+static int colorParseHex(const char *str, struct colorLinear *color)
+{
+    size_t len = strlen(str);
+    int digits[6];
+    
+    if (len != 3 && len != 6) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < len; i++) {
+        if ((digits[i] = hexDigit(str[i])) < 0) {
+            return -1;
+        }
+    }
+    
+    if (len == 3) {
+        colorFromSrgb((uint8_t)(digits[0] * 17), (uint8_t)(digits[1] * 17), (uint8_t)(digits[2] * 17), color);
+    } else {
+        colorFromSrgb((uint8_t)(digits[0] << 4 | digits[1]), (uint8_t)(digits[2] << 4 | digits[3]), (uint8_t)(digits[4] << 4 | digits[5]), color);
+    }
+    
+    return 0;
+}
+
+// Hue in degrees, saturation and value in percent, converted on sRGB values as every color picker does
+static int colorParseHsv(const char *str, struct colorLinear *color)
+{
+    double hue, saturation, value;
+    char trailing;
+    
+    if (sscanf(str, "%lf,%lf,%lf%c", &hue, &saturation, &value, &trailing) != 3 ||
+        saturation < 0 || saturation > 100 || value < 0 || value > 100) {
+        return -1;
+    }
+    
+    hue = fmod(hue, 360.0);
+    
+    if (hue < 0) {
+        hue += 360.0;
+    }
+    
+    double v = value / 100.0, s = saturation / 100.0;
+    double h = hue / 60.0;
+    int sector = (int)h % 6;
+    double f = h - floor(h);
+    double p = v * (1 - s), q = v * (1 - s * f), t = v * (1 - s * (1 - f));
+    double rgb[3];
+    
+    switch (sector) {
+        case 0: rgb[0] = v; rgb[1] = t; rgb[2] = p; break;
+        case 1: rgb[0] = q; rgb[1] = v; rgb[2] = p; break;
+        case 2: rgb[0] = p; rgb[1] = v; rgb[2] = t; break;
+        case 3: rgb[0] = p; rgb[1] = q; rgb[2] = v; break;
+        case 4: rgb[0] = t; rgb[1] = p; rgb[2] = v; break;
+        default: rgb[0] = v; rgb[1] = p; rgb[2] = q; break;
+    }
+    
+    colorFromSrgb((uint8_t)(rgb[0] * 255 + 0.5), (uint8_t)(rgb[1] * 255 + 0.5), (uint8_t)(rgb[2] * 255 + 0.5), color);
+    
+    return 0;
+}
+
+// Full brightness white of a color temperature, interpolated in linear light between table steps
+int colorKelvin(unsigned kelvin, struct colorLinear *color)
+{
+    if (kelvin < 1000 || kelvin > 40000) {
+        return -1;
+    }
+    
+    if (kelvin < COLOR_KELVIN_MIN) {
+        kelvin = COLOR_KELVIN_MIN;
+    } else if (kelvin > COLOR_KELVIN_MAX) {
+        kelvin = COLOR_KELVIN_MAX;
+    }
+    
+    unsigned step = (kelvin - COLOR_KELVIN_MIN) / COLOR_KELVIN_STEP;
+    unsigned next = kelvin == COLOR_KELVIN_MAX ? step : step + 1;
+    uint32_t weight = (uint32_t)((kelvin - COLOR_KELVIN_MIN) % COLOR_KELVIN_STEP) * 65536 / COLOR_KELVIN_STEP;
+    
+    color->red = colorMix(colorKelvinTable[step][0], colorKelvinTable[next][0], weight);
+    color->green = colorMix(colorKelvinTable[step][1], colorKelvinTable[next][1], weight);
+    color->blue = colorMix(colorKelvinTable[step][2], colorKelvinTable[next][2], weight);
+    
+    return 0;
+}
+
+// Digits then K, "2700K" or "6500k"
+static int colorParseKelvin(const char *str, struct colorLinear *color)
+{
+    char *end;
+    unsigned long kelvin = strtoul(str, &end, 10);
+    
+    if (end == str || (*end != 'K' && *end != 'k') || end[1] != '\0') {
+        return -1;
+    }
+    
+    return colorKelvin((unsigned)kelvin, color);
+}
+
+int colorParse(const char *str, struct colorLinear *color)
+{
+    while (*str == ' ' || *str == '\t') {
+        str++;
+    }
+    
+    if (*str == '#') {
+        return colorParseHex(str + 1, color);
+    }
+    
+    if (strncasecmp(str, "hsv:", 4) == 0) {
+        return colorParseHsv(str + 4, color);
+    }
+    
+    if (colorParseKelvin(str, color) == 0) {
+        return 0;
+    }
+    
+    // Numbers keep the old -C rules exactly, garbage included
+    if (*str == '\0' || *str == ',' || *str == '-' || *str == '+' || (*str >= '0' && *str <= '9')) {
+        uint8_t red, green, blue;
+        
+        parseColorComponents(str, &red, &green, &blue);
+        colorFromSrgb(red, green, blue, color);
+        
+        return 0;
+    }
+    
+    for (int i = 0; namedColors[i].name; i++) {
+        if (strcasecmp(namedColors[i].name, str) == 0) {
+            if (namedColors[i].kelvin) {
+                return colorKelvin(namedColors[i].rgb, color);
+            }
+            
+            colorFromSrgb((uint8_t)(namedColors[i].rgb >> 16), (uint8_t)(namedColors[i].rgb >> 8), (uint8_t)namedColors[i].rgb, color);
+            
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+// Report bytes for any color form, numeric input comes back byte for byte
+int colorParseBytes(const char *str, uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+    struct colorLinear color;
+    
+    if (colorParse(str, &color)) {
+        return -1;
+    }
+    
+    *red = colorEncode(color.red);
+    *green = colorEncode(color.green);
+    *blue = colorEncode(color.blue);
+    
+    return 0;
+}
+
+void colorMixReport(const uint8_t *from, const uint8_t *to, uint32_t weight, uint8_t *report, size_t reportLen)
+{
+    for (size_t i = 0; i < reportLen; i++) {
+        report[i] = colorEncode(colorMix(colorDecode(from[i]), colorDecode(to[i]), weight));
+    }
+}
+
+// level is 0-65536 of linear light
+void colorScaleReport(const uint8_t *from, uint32_t level, uint8_t *report, size_t reportLen)
+{
+    for (size_t i = 0; i < reportLen; i++) {
+        report[i] = colorEncode((uint16_t)(((uint32_t)colorDecode(from[i]) * level) >> 16));
+    }
+}
+
+// One table per report byte mapping it to what the board needs to show it
+void colorCalibrate(const uint8_t (*calibration)[256], const uint8_t *report, uint8_t *out, size_t reportLen)
+{
+    for (size_t i = 0; i < reportLen; i++) {
+        out[i] = calibration[i][report[i]];
+    }
+}
+
+void colorList(void)
+{
+    for (int i = 0; namedColors[i].name; i++) {
+        if (namedColors[i].kelvin) {
+            printf("%-14s %dK\n", namedColors[i].name, (int)namedColors[i].rgb);
+        } else {
+            printf("%-14s #%06x\n", namedColors[i].name, namedColors[i].rgb);
+        }
+    }
+}
+
+// Per frame cost of a four field fade, tables against the pow() the tables replace
+int colorBenchmark(struct benchOptions *opts)
+{
+    static const char *inputs[] = { "255,128,0", "#ff8000", "#f80", "hsv:30,100,100", "2700K", "warmwhite", "orange", "12,200,40" };
+    const int numInputs = sizeof(inputs) / sizeof(inputs[0]);
+    uint64_t ops = (uint64_t)opts->iterations * 10000;
+    uint8_t from[KEYCOLOR_REPORT_SIZE] = { 255, 255, 0, 0 }, to[KEYCOLOR_REPORT_SIZE] = { 0, 0, 64, 255 };
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    unsigned sink = 0;
+    int roundTripErrors = 0;
+    
+    for (int i = 0; i < 256; i++) {
+        if (colorEncode(colorDecode((uint8_t)i)) != i) {
+            roundTripErrors++;
+        }
+    }
+    
+    fprintf(benchNotes(), "# %d of 256 byte values change on a decode/encode round trip\n", roundTripErrors);
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops / 10; i++) {
+        struct colorLinear color;
+        
+        sink += colorParse(inputs[i % numInputs], &color) ? 1 : color.green;
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    
+    benchReportThroughput("parse", ops / 10, elapsed, benchAllocations() - allocs, 0);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        colorMixReport(from, to, (uint32_t)(i & 0xffff), report, sizeof(report));
+        sink += report[1];
+    }
+    
+    elapsed = monotonicNanos() - startTime;
+    benchReportThroughput("fade", ops, elapsed, benchAllocations() - allocs, 0);
+    
+    // What a client doing the same fade in floating point pays every frame
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        float weight = (float)(i & 0xffff) / 65536.0f;
+        
+        for (int c = 0; c < KEYCOLOR_REPORT_SIZE; c++) {
+            float a = powf(from[c] / 255.0f, 2.2f), b = powf(to[c] / 255.0f, 2.2f);
+            
+            report[c] = (uint8_t)(255.0f * powf(a + (b - a) * weight, 1.0f / 2.2f) + 0.5f);
+        }
+        sink += report[1];
+    }
+    
+    elapsed = monotonicNanos() - startTime;
+    benchReportThroughput("fade-pow", ops, elapsed, benchAllocations() - allocs, 0);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        from[1] = (uint8_t)i;
+        colorCalibrate(colorCalibrationG710, from, report, sizeof(report));
+        sink += report[1];
+    }
+    
+    elapsed = monotonicNanos() - startTime;
+    benchReportThroughput("calibrate", ops, elapsed, benchAllocations() - allocs, 0);
+    fprintf(benchNotes(), "# checksum %u\n", sink & 0xffff);
+    
+    return roundTripErrors ? -1 : 0;
+}
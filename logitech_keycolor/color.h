@@ -0,0 +1,77 @@
+//
+//  color.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef color_h
+#define color_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bench.h"
+
+// Linear light, 0-65535 per channel, where mixing and scaling happen
+struct colorLinear {
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+};
+
+// Generated tables, see gencolortables.py
+extern const uint16_t colorSrgbToLinearTable[256];
+extern const uint8_t colorLinearToSrgbTable[];
+extern const uint8_t colorCalibrationG710[4][256];
+
+static inline uint16_t colorDecode(uint8_t value)
+{
+    return colorSrgbToLinearTable[value];
+}
+
+static inline uint8_t colorEncode(uint16_t linear)
+{
+    return colorLinearToSrgbTable[linear >> 3];
+}
+
+// weight is 0-65536, a straight line in linear light so fades brighten evenly
+static inline uint16_t colorMix(uint16_t from, uint16_t to, uint32_t weight)
+{
+    return (uint16_t)(from + (int32_t)(((int64_t)((int32_t)to - (int32_t)from) * weight) >> 16));
+}
+
+// "r,g,b" as -C always took it, "#rrggbb", "#rgb", "hsv:H,S,V" (degrees, percent), "2700K" or a color name
+int colorParse(const char *str, struct colorLinear *color);
+int colorParseBytes(const char *str, uint8_t *red, uint8_t *green, uint8_t *blue);
+int colorKelvin(unsigned kelvin, struct colorLinear *color);
+void colorMixReport(const uint8_t *from, const uint8_t *to, uint32_t weight, uint8_t *report, size_t reportLen);
+void colorScaleReport(const uint8_t *from, uint32_t level, uint8_t *report, size_t reportLen);
+void colorCalibrate(const uint8_t (*calibration)[256], const uint8_t *report, uint8_t *out, size_t reportLen);
+void colorList(void);
+
+int colorBenchmark(struct benchOptions *opts);
+
+#endif /* color_h */
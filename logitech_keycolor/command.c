@@ -0,0 +1,244 @@
+//
+//  command.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include "command.h"
+#include "timeutil.h"
+#include "bench.h"
+#include "color.h"
+
+#define COMMAND_BENCH_INPUTS 1024
+#define COMMAND_BENCH_INPUT_SIZE 32
+
+// (uint8_t)atoi(str) without the locale lookups, stops at the first non-digit
+uint8_t parseColorValue(const char *str)
+{
+    unsigned value = 0;
+    int negative = 0;
+    
+    while (*str == ' ' || *str == '\t') {
+        str++;
+    }
+    
+    if (*str == '-' || *str == '+') {
+        negative = *str++ == '-';
+    }
+    
+    while (*str >= '0' && *str <= '9') {
+        value = value * 10 + (unsigned)(*str++ - '0');
+    }
+    
+    return (uint8_t)(negative ? 0u - value : value);
+}
+
+// Comma separated like strtok(str, ","): empty fields are skipped, missing components are 0
+void parseColorComponents(const char *str, uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+    uint8_t *cc[] = { red, green, blue };
+    int cIdx = 0;
+    
+    while (*str && cIdx < 3) {
+        if (*str == ',') {
+            str++;
+            continue;
+        }
+        
+        *cc[cIdx++] = parseColorValue(str);
+        
+        while (*str && *str != ',') {
+            str++;
+        }
+    }
+    
+    while (cIdx < 3) {
+        *cc[cIdx++] = 0;
+    }
+}
+
+static int isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+enum commandType parseCommand(char *line, struct keyColorCommand *cmd)
+{
+    static const struct {
+        const char *name;
+        size_t len;
+        enum commandType type;
+    } verbs[] = {
+        { "rgb", 3, COMMAND_RGB },
+        { "gray", 4, COMMAND_GRAY },
+        { "wasd", 4, COMMAND_WASD },
+        { "sleep", 5, COMMAND_SLEEP },
+        { NULL, 0, COMMAND_NONE }
+    };
+    
+    while (isSpace(*line)) {
+        line++;
+    }
+    
+    cmd->type = COMMAND_NONE;
+    
+    if (*line == '\0' || *line == '#') {
+        return cmd->type;
+    }
+    
+    char *arg = line;
+    
+    while (*arg && !isSpace(*arg)) {
+        arg++;
+    }
+    
+    size_t verbLen = arg - line;
+    
+    while (isSpace(*arg)) {
+        arg++;
+    }
+    
+    // Trailing whitespace would otherwise end up in the duration suffix
+    char *end = arg + strlen(arg);
+    
+    while (end > arg && isSpace(end[-1])) {
+        *--end = '\0';
+    }
+    
+    cmd->type = COMMAND_ERROR;
+    
+    for (int i = 0; verbs[i].name; i++) {
+        if (verbs[i].len == verbLen && memcmp(verbs[i].name, line, verbLen) == 0) {
+            cmd->type = verbs[i].type;
+            break;
+        }
+    }
+    
+    if (cmd->type != COMMAND_ERROR && *arg == '\0') {
+        cmd->type = COMMAND_ERROR;
+    }
+    
+    switch (cmd->type) {
+        case COMMAND_RGB:
+            if (colorParseBytes(arg, &cmd->red, &cmd->green, &cmd->blue)) {
+                cmd->type = COMMAND_ERROR;
+            }
+            break;
+        case COMMAND_GRAY:
+        case COMMAND_WASD:
+            cmd->red = cmd->green = cmd->blue = parseColorValue(arg);
+            break;
+        case COMMAND_SLEEP: {
+            int64_t nanos = parseDuration(arg);
+            
+            if (nanos < 0) {
+                cmd->type = COMMAND_ERROR;
+            } else {
+                cmd->nanos = (uint64_t)nanos;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    return cmd->type;
+}
+
+// Cycles through a pool of generated inputs so the branch predictor can't memorize one string
+int commandBenchmark(struct benchOptions *opts)
+{
+    static char values[COMMAND_BENCH_INPUTS][COMMAND_BENCH_INPUT_SIZE];
+    static char components[COMMAND_BENCH_INPUTS][COMMAND_BENCH_INPUT_SIZE];
+    static char lines[COMMAND_BENCH_INPUTS][COMMAND_BENCH_INPUT_SIZE];
+    uint64_t ops = (uint64_t)opts->iterations * 10000;
+    uint64_t valueBytes = 0, componentBytes = 0, lineBytes = 0;
+    unsigned sink = 0;
+    
+    for (int i = 0; i < COMMAND_BENCH_INPUTS; i++) {
+        snprintf(values[i], sizeof(values[i]), i % 7 ? "%d" : " %d", (i * 37) % 300);
+        // Mix of full triples, empty fields and short lists, all legal -C input
+        switch (i % 4) {
+            case 0: snprintf(components[i], sizeof(components[i]), "%d,%d,%d", i & 0xff, (i * 3) & 0xff, 255 - (i & 0xff)); break;
+            case 1: snprintf(components[i], sizeof(components[i]), "%d,,%d", i & 0xff, (i * 5) & 0xff); break;
+            case 2: snprintf(components[i], sizeof(components[i]), "%d", i & 0xff); break;
+            default: snprintf(components[i], sizeof(components[i]), ",%d,%d,%d", i % 10, i % 100, i & 0xff); break;
+        }
+        switch (i % 5) {
+            case 0: snprintf(lines[i], sizeof(lines[i]), "rgb %.24s", components[i]); break;
+            case 1: snprintf(lines[i], sizeof(lines[i]), "gray %d", i & 0xff); break;
+            case 2: snprintf(lines[i], sizeof(lines[i]), "wasd %d", (i * 13) & 0xff); break;
+            case 3: snprintf(lines[i], sizeof(lines[i]), "sleep %dms", i % 50); break;
+            default: snprintf(lines[i], sizeof(lines[i]), "# comment %d", i); break;
+        }
+    }
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        const char *str = values[i % COMMAND_BENCH_INPUTS];
+        
+        sink += parseColorValue(str);
+        valueBytes += strlen(str);
+    }
+    
+    benchReportThroughput("value", ops, monotonicNanos() - startTime, benchAllocations() - allocs, valueBytes);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        const char *str = components[i % COMMAND_BENCH_INPUTS];
+        uint8_t red, green, blue;
+        
+        parseColorComponents(str, &red, &green, &blue);
+        sink += red + green + blue;
+        componentBytes += strlen(str);
+    }
+    
+    benchReportThroughput("rgb", ops, monotonicNanos() - startTime, benchAllocations() - allocs, componentBytes);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        char *line = lines[i % COMMAND_BENCH_INPUTS];
+        struct keyColorCommand cmd;
+        
+        sink += parseCommand(line, &cmd);
+        lineBytes += strlen(line);
+    }
+    
+    benchReportThroughput("command", ops, monotonicNanos() - startTime, benchAllocations() - allocs, lineBytes);
+    
+    fprintf(benchNotes(), "# checksum %u\n", sink);
+    
+    return 0;
+}
@@ -0,0 +1,58 @@
+//
+//  command.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef command_h
+#define command_h
+
+#include <stdint.h>
+
+enum commandType {
+    COMMAND_NONE = 0,       // blank line or comment
+    COMMAND_RGB,            // rgb R,G,B   same rules as -C
+    COMMAND_GRAY,           // gray N      same rules as -c
+    COMMAND_WASD,           // wasd N
+    COMMAND_SLEEP,          // sleep DURATION
+    COMMAND_ERROR
+};
+
+struct keyColorCommand {
+    enum commandType type;
+    uint8_t red, green, blue;
+    uint64_t nanos;
+};
+
+uint8_t parseColorValue(const char *str);
+void parseColorComponents(const char *str, uint8_t *red, uint8_t *green, uint8_t *blue);
+enum commandType parseCommand(char *line, struct keyColorCommand *cmd);
+
+struct benchOptions;
+int commandBenchmark(struct benchOptions *opts);
+
+#endif /* command_h */
@@ -0,0 +1,365 @@
+//
+//  compositor.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compositor.h"
+#include "keycolor.h"
+#include "transport.h"
+#include "animation.h"
+#include "color.h"
+#include "timeutil.h"
+
+void compositorInit(struct compositor *comp, const struct deviceProfile *profile)
+{
+    memset(comp, 0, sizeof(*comp));
+    comp->profile = profile;
+}
+
+int compositorBlendParse(const char *name, enum compositorBlend *blend)
+{
+    static const struct {
+        const char *name;
+        enum compositorBlend blend;
+    } blends[] = {
+        { "normal", BLEND_NORMAL },
+        { "add", BLEND_ADD },
+        { "multiply", BLEND_MULTIPLY },
+        { "screen", BLEND_SCREEN },
+        { "lighten", BLEND_LIGHTEN },
+        { NULL, BLEND_NORMAL }
+    };
+    
+    for (int i = 0; blends[i].name; i++) {
+        if (strcmp(name, blends[i].name) == 0) {
+            *blend = blends[i].blend;
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+// "200" is a level for every channel, anything else goes through colorParse
+static int compositorParseValue(const char *str, struct colorLinear *color)
+{
+    char *end;
+    long level = strtol(str, &end, 10);
+    
+    if (end != str && *end == '\0' && level >= 0 && level <= 255) {
+        color->red = color->green = color->blue = colorDecode((uint8_t)level);
+        return 0;
+    }
+    
+    return colorParse(str, color);
+}
+
+// zone=color[,blend=MODE][,opacity=PERCENT][,flash=DURATION], zone is a profile zone name or "all".
+// Single level zones take the brightest channel of the color
+int compositorAddLayer(struct compositor *comp, const char *spec)
+{
+    if (comp->numLayers == COMPOSITOR_MAX_LAYERS) {
+        fprintf(stderr, "At most %d layers\n", COMPOSITOR_MAX_LAYERS);
+        return -1;
+    }
+    
+    struct compositorLayer *layer = &comp->layers[comp->numLayers];
+    char *specCopy = strdup(spec);
+    char *value = specCopy ? strchr(specCopy, '=') : NULL;
+    char *options = NULL;
+    struct colorLinear color;
+    int ret = 0;
+    
+    if (!value) {
+        fprintf(stderr, "Bad layer '%s', expected zone=color\n", spec);
+        free(specCopy);
+        return -1;
+    }
+    *value++ = '\0';
+    
+    // Colors have commas of their own, the options start at the first comma followed by name=
+    for (char *cp = strchr(value, ','); cp; cp = strchr(cp + 1, ',')) {
+        size_t len = strcspn(cp + 1, ",");
+        char *equals = strchr(cp + 1, '=');
+        
+        if (equals && equals < cp + 1 + len) {
+            *cp = '\0';
+            options = cp + 1;
+            break;
+        }
+    }
+    
+    memset(layer, 0, sizeof(*layer));
+    layer->blend = BLEND_NORMAL;
+    layer->opacity = 65536;
+    
+    if (strcmp(specCopy, "all") == 0) {
+        layer->zones = (1u << comp->profile->numZones) - 1;
+    } else {
+        for (int i = 0; i < comp->profile->numZones; i++) {
+            if (strcmp(comp->profile->zones[i].name, specCopy) == 0) {
+                layer->zones = 1u << i;
+            }
+        }
+    }
+    
+    if (!layer->zones) {
+        fprintf(stderr, "No zone '%s' on the %s\n", specCopy, comp->profile->name);
+        ret = -1;
+    } else if (compositorParseValue(value, &color)) {
+        fprintf(stderr, "Unknown color '%s', --rgb list shows the names\n", value);
+        ret = -1;
+    }
+    
+    for (char *cp = options ? strtok(options, ",") : NULL; cp && ret == 0; cp = strtok(NULL, ",")) {
+        char *arg = strchr(cp, '=');
+        
+        if (!arg) {
+            fprintf(stderr, "Bad layer option '%s'\n", cp);
+            ret = -1;
+            break;
+        }
+        *arg++ = '\0';
+        
+        if (strcmp(cp, "blend") == 0) {
+            if (compositorBlendParse(arg, &layer->blend)) {
+                fprintf(stderr, "Unknown blend '%s', expected normal, add, multiply, screen or lighten\n", arg);
+                ret = -1;
+            }
+        } else if (strcmp(cp, "opacity") == 0) {
+            double percent = atof(arg);
+            
+            if (percent < 0 || percent > 100) {
+                fprintf(stderr, "Opacity must be 0-100\n");
+                ret = -1;
+            }
+            layer->opacity = (uint32_t)(percent * 65536.0 / 100.0 + 0.5);
+        } else if (strcmp(cp, "flash") == 0) {
+            int64_t period = parseDuration(arg);
+            
+            if (period <= 0) {
+                fprintf(stderr, "Bad flash period '%s'\n", arg);
+                ret = -1;
+            }
+            layer->flashPeriod = period > 0 ? (uint64_t)period : 0;
+        } else {
+            fprintf(stderr, "Unknown layer option '%s'\n", cp);
+            ret = -1;
+        }
+    }
+    
+    free(specCopy);
+    
+    if (ret) {
+        return ret;
+    }
+    
+    for (int i = 0; i < comp->profile->numZones; i++) {
+        uint16_t peak = color.red > color.green ? color.red : color.green;
+        
+        peak = color.blue > peak ? color.blue : peak;
+        
+        if (comp->profile->zones[i].length == 1) {
+            layer->values[i][0] = peak;
+        } else {
+            layer->values[i][0] = color.red;
+            layer->values[i][1] = color.green;
+            layer->values[i][2] = color.blue;
+        }
+    }
+    
+    comp->numLayers++;
+    
+    return 0;
+}
+
+// Whether the output depends on time, so a still image has to be rendered as frames
+int compositorAnimated(const struct compositor *comp)
+{
+    for (int i = 0; i < comp->numLayers; i++) {
+        if (comp->layers[i].flashPeriod) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+static uint16_t compositorBlend(enum compositorBlend blend, uint16_t under, uint16_t over)
+{
+    uint32_t product = ((uint32_t)under * over + 32767) / 65535;
+    
+    switch (blend) {
+        case BLEND_ADD:
+            return under + over > 65535 ? 65535 : (uint16_t)(under + over);
+        case BLEND_MULTIPLY:
+            return (uint16_t)product;
+        case BLEND_SCREEN:
+            return (uint16_t)(under + over - product);
+        case BLEND_LIGHTEN:
+            return under > over ? under : over;
+        default:
+            return over;
+    }
+}
+
+// Flattens every visible layer over under into one report. Zones no visible layer covers keep their
+// bytes untouched, so an empty stack hands under through exactly. under and report may be the same
+void compositorRender(const struct compositor *comp, uint64_t t, const uint8_t *under, uint8_t *report, size_t reportLen)
+{
+    const struct deviceProfile *profile = comp->profile;
+    
+    if (report != under) {
+        memcpy(report, under, reportLen);
+    }
+    
+    for (int z = 0; z < profile->numZones; z++) {
+        const struct deviceZone *zone = &profile->zones[z];
+        uint16_t linear[COMPOSITOR_MAX_CHANNELS];
+        uint8_t values[COMPOSITOR_MAX_CHANNELS];
+        int covered = 0;
+        
+        if ((size_t)zone->offset + zone->length > reportLen || zone->length > COMPOSITOR_MAX_CHANNELS) {
+            continue;
+        }
+        
+        for (int c = 0; c < zone->length; c++) {
+            linear[c] = colorDecode(report[zone->offset + c]);
+        }
+        
+        for (int i = 0; i < comp->numLayers; i++) {
+            const struct compositorLayer *layer = &comp->layers[i];
+            
+            if (!(layer->zones & (1u << z)) || (layer->flashPeriod && t % layer->flashPeriod >= layer->flashPeriod / 2)) {
+                continue;
+            }
+            
+            for (int c = 0; c < zone->length; c++) {
+                linear[c] = colorMix(linear[c], compositorBlend(layer->blend, linear[c], layer->values[z][c]), layer->opacity);
+            }
+            covered = 1;
+        }
+        
+        if (covered) {
+            for (int c = 0; c < zone->length; c++) {
+                values[c] = colorEncode(linear[c]);
+            }
+            deviceProfileEncodeZone(zone, values, report, reportLen);
+        }
+    }
+}
+
+// Flatten cost as the stack grows, then a layered breathe against the fake board counting reports per frame
+int compositorBenchmark(struct benchOptions *opts)
+{
+    static const char *stack[] = {
+        "keys=teal", "wasd=255,blend=multiply,opacity=50", "keys=orange,blend=screen,opacity=40",
+        "all=white,blend=add,opacity=10", "keys=red,blend=lighten,flash=500ms", "wasd=0,opacity=25",
+        "keys=2700K,blend=multiply", "all=hsv:200,100,100,opacity=5"
+    };
+    static const int depths[] = { 0, 1, 4, 8 };
+    uint64_t ops = (uint64_t)opts->iterations * 1000;
+    const uint8_t from[KEYCOLOR_REPORT_SIZE] = { 128, 40, 200, 90 };
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    unsigned sink = 0;
+    char label[32];
+    
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        struct compositor comp;
+        
+        compositorInit(&comp, &deviceProfiles[0]);
+        
+        for (int i = 0; i < depths[d]; i++) {
+            if (compositorAddLayer(&comp, stack[i])) {
+                return -1;
+            }
+        }
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (uint64_t i = 0; i < ops; i++) {
+            compositorRender(&comp, i * 1000000ull, from, report, sizeof(report));
+            sink += report[1];
+        }
+        
+        snprintf(label, sizeof(label), "layers=%d", depths[d]);
+        benchReportThroughput(label, ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    }
+    
+    fprintf(benchNotes(), "# checksum %u\n", sink);
+    
+    // Layers are flattened before the write, a deeper stack never means more reports
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    struct compositor comp;
+    struct animationOptions animation = { EFFECT_BREATHE, 60.0, 1000000000ull, 0, { 0 }, { 0 }, NULL, NULL };
+    int numFrames = opts->iterations;
+    int numFailed = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        transportClose(transport);
+        return -1;
+    }
+    
+    transportSetCaching(transport, 0);
+    transportSetRateControl(transport, 0);
+    compositorInit(&comp, &deviceProfiles[0]);
+    memcpy(animation.from, from, sizeof(from));
+    
+    for (size_t i = 0; i < sizeof(stack) / sizeof(stack[0]); i++) {
+        compositorAddLayer(&comp, stack[i]);
+    }
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (int frame = 0; frame < numFrames; frame++) {
+        uint64_t t = (uint64_t)frame * 16666667ull;
+        
+        animationRender(&animation, t, report);
+        compositorRender(&comp, t, report, report, sizeof(report));
+        numFailed += transportWrite(targets, numTargets, report, sizeof(report));
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    size_t numRecords = 0;
+    
+    fakeTransportRecords(transport, &numRecords);
+    benchReportThroughput("frames", (uint64_t)numFrames, elapsed, benchAllocations() - allocs, 0);
+    fprintf(benchNotes(), "# %d layers, %d frames, %zu reports written, failed=%d\n", comp.numLayers, numFrames, numRecords, numFailed);
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return numFailed || (numRecords && numRecords != (size_t)numFrames * numTargets) ? -1 : 0;
+}
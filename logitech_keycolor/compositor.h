@@ -0,0 +1,73 @@
+//
+//  compositor.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef compositor_h
+#define compositor_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "profiles.h"
+#include "bench.h"
+
+#define COMPOSITOR_MAX_LAYERS 16
+#define COMPOSITOR_MAX_CHANNELS 3
+
+// How a layer combines with what is under it, per channel in linear light
+enum compositorBlend {
+    BLEND_NORMAL,
+    BLEND_ADD,
+    BLEND_MULTIPLY,
+    BLEND_SCREEN,
+    BLEND_LIGHTEN
+};
+
+struct compositorLayer {
+    enum compositorBlend blend;
+    uint32_t opacity;           // 0-65536
+    uint32_t zones;             // bit per profile zone the layer covers
+    uint64_t flashPeriod;       // nanoseconds, shown for the first half of each period, 0 always shown
+    uint16_t values[PROFILE_MAX_ZONES][COMPOSITOR_MAX_CHANNELS];   // linear light
+};
+
+// Layers stacked bottom up over whatever report is handed to compositorRender
+struct compositor {
+    const struct deviceProfile *profile;
+    int numLayers;
+    struct compositorLayer layers[COMPOSITOR_MAX_LAYERS];
+};
+
+void compositorInit(struct compositor *comp, const struct deviceProfile *profile);
+int compositorBlendParse(const char *name, enum compositorBlend *blend);
+int compositorAddLayer(struct compositor *comp, const char *spec);
+int compositorAnimated(const struct compositor *comp);
+void compositorRender(const struct compositor *comp, uint64_t t, const uint8_t *under, uint8_t *report, size_t reportLen);
+int compositorBenchmark(struct benchOptions *opts);
+
+#endif /* compositor_h */
@@ -0,0 +1,602 @@
+//
+//  daemon.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "daemon.h"
+#include "bench.h"
+#include "transport.h"
+#include "reportcache.h"
+#include "timeutil.h"
+
+#define DAEMON_MAX_CLIENTS 32
+#define DAEMON_MAX_BATCH 64
+#define DAEMON_STALL_TIMEOUT 1000000000ull      // nanos a client may sit on half a request or unread replies
+#define DAEMON_STALL_POLL_MS 100
+
+extern char **environ;
+
+
+static volatile sig_atomic_t daemonStopRequested = 0;
+
+static void daemonSignalHandler(int sig)
+{
+    daemonStopRequested = sig;
+}
+
+const char *daemonDefaultSocketPath(void)
+{
+    static char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    const char *dir = getenv("TMPDIR");
+    
+    if (!dir || !*dir) {
+        dir = "/tmp";
+    }
+    
+    // Per-uid like the shared memory segment, so users sharing /tmp don't collide
+    snprintf(path, sizeof(path), "%s%slogitech_keycolor.%u.sock", dir, dir[strlen(dir) - 1] == '/' ? "" : "/", (unsigned)getuid());
+    
+    return path;
+}
+
+static int daemonSocketAddress(const char *socketPath, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    
+    if (strlen(socketPath) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socketPath);
+        return -1;
+    }
+    
+    strcpy(addr->sun_path, socketPath);
+    
+    return 0;
+}
+
+int daemonConnect(const char *socketPath)
+{
+    struct sockaddr_un addr;
+    
+    if (daemonSocketAddress(socketPath, &addr)) {
+        return -1;
+    }
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+static int readFully(int fd, void *buf, size_t len)
+{
+    uint8_t *bp = buf;
+    
+    while (len > 0) {
+        ssize_t n = read(fd, bp, len);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n <= 0) {
+            return -1;
+        }
+        
+        bp += n;
+        len -= n;
+    }
+    
+    return 0;
+}
+
+static int writeFully(int fd, const void *buf, size_t len)
+{
+    const uint8_t *bp = buf;
+    
+    while (len > 0) {
+        ssize_t n = write(fd, bp, len);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n <= 0) {
+            return -1;
+        }
+        
+        bp += n;
+        len -= n;
+    }
+    
+    return 0;
+}
+
+int daemonRequest(int fd, uint8_t command, const uint8_t *report, struct daemonReply *reply)
+{
+    struct daemonRequest request = { DAEMON_PROTOCOL_VERSION, command, { 0 } };
+    
+    if (report) {
+        memcpy(request.report, report, sizeof(request.report));
+    }
+    
+    if (writeFully(fd, &request, sizeof(request)) || readFully(fd, reply, sizeof(*reply))) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+int daemonSend(const char *socketPath, const uint8_t *report)
+{
+    int fd = daemonConnect(socketPath);
+    
+    if (fd < 0) {
+        fprintf(stderr, "Failed to connect to daemon at %s: %s\n", socketPath, strerror(errno));
+        return -1;
+    }
+    
+    struct daemonReply reply;
+    int ret = daemonRequest(fd, DAEMON_CMD_SET, report, &reply);
+    
+    close(fd);
+    
+    if (ret) {
+        fprintf(stderr, "Lost connection to daemon at %s\n", socketPath);
+        return -1;
+    }
+    
+    if (reply.status) {
+        fprintf(stderr, "WARNING: daemon reported %d failed writes to %d targets\n", reply.status, reply.numTargets);
+    }
+    
+    return reply.status;
+}
+
+// Replies owed to one client for the requests read during the current poll round
+struct daemonClientRound {
+    int numOwed;                        // -1 when the connection should be dropped
+    int8_t owed[DAEMON_MAX_BATCH];
+};
+
+// Per-connection state, client sockets are non-blocking so one slow client can't wedge the rest
+struct daemonClient {
+    uint8_t partial[sizeof(struct daemonRequest)];
+    size_t partialLen;                  // bytes of a request still waiting for the rest
+    struct daemonReply replies[DAEMON_MAX_BATCH];
+    size_t replyOffset, replyLen;       // bytes of replies not yet taken by the client
+    uint64_t stalledSince;              // when the client was last seen half way through a request or reply, 0 if idle
+};
+
+enum {
+    DAEMON_OWE_OK,
+    DAEMON_OWE_WRITE,                   // status of this round's write
+    DAEMON_OWE_BAD
+};
+
+static int daemonStageRequest(struct daemonRequest *request, struct latestReport *desired, struct reportCache *cache, int verbose)
+{
+    if (request->version != DAEMON_PROTOCOL_VERSION) {
+        return DAEMON_OWE_BAD;
+    }
+    
+    switch (request->command) {
+        case DAEMON_CMD_SET:
+            if (verbose > 1) {
+                printf("SET wasd=%d rgb=%d,%d,%d\n", request->report[0], request->report[1], request->report[2], request->report[3]);
+            }
+            
+            // Latest wins, a burst of requests in one round collapses into a single write
+            if (latestReportPut(desired, request->report, sizeof(request->report)) && cache) {
+                cache->requestsCoalesced++;
+            }
+            return DAEMON_OWE_WRITE;
+        case DAEMON_CMD_PING:
+            return DAEMON_OWE_OK;
+        default:
+            return DAEMON_OWE_BAD;
+    }
+}
+
+// Read whatever the client has queued without blocking, staging each complete request
+static int daemonClientRead(int fd, struct daemonClient *client, struct daemonClientRound *round, struct latestReport *desired, struct reportCache *cache, int verbose)
+{
+    uint8_t buf[DAEMON_MAX_BATCH * sizeof(struct daemonRequest)];
+    ssize_t n;
+    
+    memcpy(buf, client->partial, client->partialLen);
+    
+    while ((n = read(fd, buf + client->partialLen, sizeof(buf) - client->partialLen)) < 0 && errno == EINTR)
+        ;
+    
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return -1;
+    }
+    
+    if (n < 0) {
+        return 0;
+    }
+    
+    size_t len = client->partialLen + (size_t)n;
+    size_t numRequests = len / sizeof(struct daemonRequest);
+    
+    // Pipelined requests are all staged in this round so they coalesce too
+    for (size_t k = 0; k < numRequests; k++) {
+        struct daemonRequest request;
+        
+        memcpy(&request, buf + k * sizeof(request), sizeof(request));
+        round->owed[round->numOwed++] = (int8_t)daemonStageRequest(&request, desired, cache, verbose);
+    }
+    
+    client->partialLen = len - numRequests * sizeof(struct daemonRequest);
+    memcpy(client->partial, buf + numRequests * sizeof(struct daemonRequest), client->partialLen);
+    
+    return 0;
+}
+
+// Push queued replies without blocking, anything the client isn't ready for waits for POLLOUT
+static int daemonClientFlush(int fd, struct daemonClient *client)
+{
+    while (client->replyOffset < client->replyLen) {
+        ssize_t n = write(fd, (uint8_t *)client->replies + client->replyOffset, client->replyLen - client->replyOffset);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        
+        if (n <= 0) {
+            return -1;
+        }
+        
+        client->replyOffset += (size_t)n;
+    }
+    
+    client->replyOffset = client->replyLen = 0;
+    
+    return 0;
+}
+
+int daemonRun(const char *socketPath, struct keyColorTarget *targets, size_t numTargets, int verbose)
+{
+    struct sockaddr_un addr;
+    
+    if (daemonSocketAddress(socketPath, &addr)) {
+        return -1;
+    }
+    
+    // Refuse to steal the socket from a live daemon, otherwise clear out a stale one
+    int probeFd = daemonConnect(socketPath);
+    
+    if (probeFd >= 0) {
+        close(probeFd);
+        fprintf(stderr, "Another daemon is already listening on %s\n", socketPath);
+        return -1;
+    }
+    
+    unlink(socketPath);
+    
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    
+    if (listenFd < 0) {
+        perror("socket");
+        return -1;
+    }
+    
+    if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listenFd, DAEMON_MAX_CLIENTS)) {
+        fprintf(stderr, "Failed to listen on %s: %s\n", socketPath, strerror(errno));
+        close(listenFd);
+        return -1;
+    }
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemonSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    if (verbose) {
+        printf("Listening on %s with %zu targets\n", socketPath, numTargets);
+    }
+    
+    struct pollfd fds[1 + DAEMON_MAX_CLIENTS];
+    struct daemonClient clients[1 + DAEMON_MAX_CLIENTS];
+    struct daemonClientRound rounds[1 + DAEMON_MAX_CLIENTS];
+    struct reportCache *cache = numTargets ? targets[0].transport->cache : NULL;
+    nfds_t numFds = 1;
+    int numStalled = 0;
+    
+    fds[0].fd = listenFd;
+    fds[0].events = POLLIN;
+    
+    while (!daemonStopRequested) {
+        // Only wake up on a timer while someone is half way through a request or reply
+        if (poll(fds, numFds, numStalled ? DAEMON_STALL_POLL_MS : -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        
+        struct latestReport desired;
+        
+        desired.pending = 0;
+        
+        for (nfds_t i = 1; i < numFds; i++) {
+            rounds[i].numOwed = 0;
+            
+            if (!fds[i].revents) {
+                continue;
+            }
+            
+            if (fds[i].revents & POLLOUT) {
+                if (daemonClientFlush(fds[i].fd, &clients[i])) {
+                    rounds[i].numOwed = -1;
+                    continue;
+                }
+            }
+            
+            // Don't take new requests until the client has read the replies to its last ones
+            if (fds[i].revents & POLLIN && clients[i].replyLen == 0) {
+                if (daemonClientRead(fds[i].fd, &clients[i], &rounds[i], &desired, cache, verbose)) {
+                    rounds[i].numOwed = -1;
+                }
+            } else if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                rounds[i].numOwed = -1;
+            }
+        }
+        
+        uint8_t report[REPORT_CACHE_MAX_REPORT];
+        size_t reportLen;
+        int32_t writeStatus = 0;
+        
+        if (latestReportTake(&desired, report, &reportLen)) {
+            writeStatus = transportWrite(targets, numTargets, report, reportLen);
+        }
+        
+        uint64_t now = monotonicNanos();
+        
+        numStalled = 0;
+        
+        for (nfds_t i = numFds - 1; i > 0; i--) {
+            struct daemonClient *client = &clients[i];
+            int dropClient = rounds[i].numOwed < 0;
+            
+            for (int k = 0; k < rounds[i].numOwed; k++) {
+                struct daemonReply *reply = &client->replies[k];
+                
+                reply->numTargets = (int32_t)numTargets;
+                reply->status = rounds[i].owed[k] == DAEMON_OWE_WRITE ? writeStatus : rounds[i].owed[k] == DAEMON_OWE_BAD ? -1 : 0;
+            }
+            
+            if (!dropClient && rounds[i].numOwed > 0) {
+                client->replyOffset = 0;
+                client->replyLen = rounds[i].numOwed * sizeof(struct daemonReply);
+                dropClient = daemonClientFlush(fds[i].fd, client) != 0;
+            }
+            
+            fds[i].events = client->replyLen ? POLLOUT : POLLIN;
+            
+            if (client->partialLen || client->replyLen) {
+                if (!client->stalledSince) {
+                    client->stalledSince = now;
+                } else if (now - client->stalledSince > DAEMON_STALL_TIMEOUT) {
+                    if (verbose) {
+                        printf("Dropping client %d, stalled for %.1f ms\n", fds[i].fd, (now - client->stalledSince) / 1e6);
+                    }
+                    dropClient = 1;
+                }
+            } else {
+                client->stalledSince = 0;
+            }
+            
+            if (dropClient) {
+                close(fds[i].fd);
+                --numFds;
+                fds[i] = fds[numFds];
+                clients[i] = clients[numFds];
+            } else if (client->stalledSince) {
+                numStalled++;
+            }
+        }
+        
+        if (fds[0].revents & POLLIN) {
+            int clientFd = accept(listenFd, NULL, NULL);
+            
+            if (clientFd >= 0) {
+                if (numFds < sizeof(fds) / sizeof(fds[0]) && fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK) == 0) {
+                    fds[numFds].fd = clientFd;
+                    fds[numFds].events = POLLIN;
+                    fds[numFds].revents = 0;
+                    memset(&clients[numFds], 0, sizeof(clients[numFds]));
+                    numFds++;
+                } else {
+                    close(clientFd);
+                }
+            }
+        }
+    }
+    
+    for (nfds_t i = 0; i < numFds; i++) {
+        close(fds[i].fd);
+    }
+    
+    unlink(socketPath);
+    
+    if (verbose) {
+        printf("Daemon exiting on signal %d\n", (int)daemonStopRequested);
+    }
+    
+    return 0;
+}
+
+static void daemonBenchmarkStop(pid_t pid)
+{
+    kill(pid, SIGTERM);
+    
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+        ;
+}
+
+// Start a private daemon for the benchmark and wait until it answers
+static pid_t daemonBenchmarkStart(struct benchOptions *opts, const char *spec, const char *socketPath)
+{
+    char *daemonArgv[] = { (char *)opts->progPath, "--daemon", "--socket", (char *)socketPath, "--transport", (char *)spec, NULL };
+    pid_t pid;
+    
+    if (posix_spawnp(&pid, daemonArgv[0], NULL, NULL, daemonArgv, environ)) {
+        fprintf(stderr, "Failed to start benchmark daemon: %s\n", opts->progPath);
+        return -1;
+    }
+    
+    for (int tries = 0; tries < 500; tries++) {
+        int fd = daemonConnect(socketPath);
+        
+        if (fd >= 0) {
+            close(fd);
+            return pid;
+        }
+        
+        if (waitpid(pid, NULL, WNOHANG) == pid) {
+            fprintf(stderr, "Benchmark daemon exited before listening on %s\n", socketPath);
+            return -1;
+        }
+        
+        usleep(10000);
+    }
+    
+    fprintf(stderr, "Benchmark daemon never started listening on %s\n", socketPath);
+    daemonBenchmarkStop(pid);
+    
+    return -1;
+}
+
+int daemonBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake";
+    uint64_t *samples = calloc(opts->iterations, sizeof(uint64_t));
+    char socketPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    char rgb[16];
+    int numSamples;
+    
+    if (!samples) {
+        fprintf(stderr, "Failed to allocate benchmark samples!\n");
+        return -1;
+    }
+    
+    snprintf(rgb, sizeof(rgb), "%d,%d,%d", opts->report[1], opts->report[2], opts->report[3]);
+    
+    // One-shot CLI: full enumeration and element matching per command
+    char *cliArgv[] = { (char *)opts->progPath, "-C", rgb, "--transport", (char *)spec, NULL };
+    
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        if ((samples[numSamples] = benchTimeSpawn(cliArgv)) == 0) {
+            break;
+        }
+    }
+    benchReportLatency("cli", samples, numSamples);
+    
+    // A private daemon on the same transport, so the comparison never depends on one being left running
+    snprintf(socketPath, sizeof(socketPath), "/tmp/logitech_keycolor.bench.%d.sock", (int)getpid());
+    
+    pid_t daemonPid = daemonBenchmarkStart(opts, spec, socketPath);
+    int fd = daemonPid > 0 ? daemonConnect(socketPath) : -1;
+    
+    if (fd < 0) {
+        if (daemonPid > 0) {
+            daemonBenchmarkStop(daemonPid);
+        }
+        free(samples);
+        return -1;
+    }
+    
+    // Thin client: process startup plus one socket round trip
+    char *clientArgv[] = { (char *)opts->progPath, "--send", "--socket", socketPath, "-C", rgb, NULL };
+    
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        if ((samples[numSamples] = benchTimeSpawn(clientArgv)) == 0) {
+            break;
+        }
+    }
+    benchReportLatency("client", samples, numSamples);
+    
+    // Persistent connection: what a long-lived status script pays per command
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        struct daemonReply reply;
+        uint64_t startTime = monotonicNanos();
+        
+        if (daemonRequest(fd, DAEMON_CMD_SET, opts->report, &reply)) {
+            break;
+        }
+        samples[numSamples] = monotonicNanos() - startTime;
+    }
+    benchReportLatency("socket", samples, numSamples);
+    
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        struct daemonReply reply;
+        uint64_t startTime = monotonicNanos();
+        
+        if (daemonRequest(fd, DAEMON_CMD_PING, NULL, &reply)) {
+            break;
+        }
+        samples[numSamples] = monotonicNanos() - startTime;
+    }
+    benchReportLatency("ping", samples, numSamples);
+    
+    close(fd);
+    daemonBenchmarkStop(daemonPid);
+    free(samples);
+    
+    return 0;
+}
@@ -0,0 +1,64 @@
+//
+//  daemon.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef daemon_h
+#define daemon_h
+
+#include <stdint.h>
+#include "keycolor.h"
+#include "bench.h"
+
+#define DAEMON_PROTOCOL_VERSION 1
+
+enum {
+    DAEMON_CMD_SET = 1,     // write report[] to every cached target
+    DAEMON_CMD_PING = 2     // round trip only, no device I/O
+};
+
+// Fixed size request, one per color change
+struct daemonRequest {
+    uint8_t version;
+    uint8_t command;
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+};
+
+struct daemonReply {
+    int32_t status;         // number of failed writes, -1 for a bad request
+    int32_t numTargets;
+};
+
+const char *daemonDefaultSocketPath(void);
+int daemonRun(const char *socketPath, struct keyColorTarget *targets, size_t numTargets, int verbose);
+int daemonConnect(const char *socketPath);
+int daemonRequest(int fd, uint8_t command, const uint8_t *report, struct daemonReply *reply);
+int daemonSend(const char *socketPath, const uint8_t *report);
+int daemonBenchmark(struct benchOptions *opts);
+
+#endif /* daemon_h */
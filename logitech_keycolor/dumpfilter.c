@@ -0,0 +1,124 @@
+//
+//  dumpfilter.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dumpfilter.h"
+
+static int dumpFilterParseValue(enum dumpFilterField field, const char *str, uint32_t *value)
+{
+    static const char *kinds[] = { "input", "output", "feature", "collection" };
+    char *end;
+    
+    if (field == DUMP_FILTER_TYPE) {
+        for (uint32_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+            if (strcmp(str, kinds[i]) == 0) {
+                *value = i;
+                return 0;
+            }
+        }
+        return -1;
+    }
+    
+    unsigned long parsed = strtoul(str, &end, 0);
+    
+    if (end == str || *end != '\0' || parsed > UINT32_MAX) {
+        return -1;
+    }
+    
+    *value = (uint32_t)parsed;
+    
+    return 0;
+}
+
+// field=value[/value...][,field=...] where a value may be a min-max range, e.g. page=0xff00-0xffff,type=output/feature
+int dumpFilterParse(const char *spec, struct dumpFilter *filter)
+{
+    static const char *names[DUMP_FILTER_FIELDS] = { "vendor", "product", "page", "usage", "type", "report", "cookie" };
+    char *specCopy = strdup(spec);
+    int ret = 0;
+    
+    memset(filter, 0, sizeof(*filter));
+    
+    if (!specCopy) {
+        return -1;
+    }
+    
+    for (char *cp = strtok(specCopy, ","); cp && ret == 0; cp = strtok(NULL, ",")) {
+        char *values = strchr(cp, '=');
+        int field = 0;
+        
+        if (values) {
+            *values++ = '\0';
+        }
+        
+        while (field < DUMP_FILTER_FIELDS && strcmp(cp, names[field]) != 0) {
+            field++;
+        }
+        
+        if (!values || field == DUMP_FILTER_FIELDS) {
+            fprintf(stderr, "Bad dump filter term '%s', expected vendor, product, page, usage, type, report or cookie=value\n", cp);
+            ret = -1;
+            break;
+        }
+        
+        for (char *value = values, *next; value && ret == 0; value = next) {
+            struct dumpFilterRange *range = &filter->ranges[field][filter->numRanges[field]];
+            char *dash = field == DUMP_FILTER_TYPE ? NULL : strchr(value, '-');
+            
+            if ((next = strchr(value, '/'))) {
+                *next++ = '\0';
+            }
+            
+            if (dash) {
+                *dash++ = '\0';
+            }
+            
+            if (filter->numRanges[field] == DUMP_FILTER_MAX_RANGES) {
+                fprintf(stderr, "At most %d values per dump filter field\n", DUMP_FILTER_MAX_RANGES);
+                ret = -1;
+            } else if (dumpFilterParseValue(field, value, &range->min) || dumpFilterParseValue(field, dash ? dash : value, &range->max) || range->max < range->min) {
+                fprintf(stderr, "Bad value for %s in dump filter\n", names[field]);
+                ret = -1;
+            } else {
+                filter->numRanges[field]++;
+            }
+        }
+        
+        if (field >= DUMP_FILTER_PAGE) {
+            filter->elementFields = 1;
+        }
+    }
+    
+    free(specCopy);
+    
+    return ret;
+}
@@ -0,0 +1,102 @@
+//
+//  dumpfilter.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef dumpfilter_h
+#define dumpfilter_h
+
+#include <stdint.h>
+
+#define DUMP_FILTER_MAX_RANGES 8
+
+enum dumpFilterField {
+    DUMP_FILTER_VENDOR,
+    DUMP_FILTER_PRODUCT,
+    DUMP_FILTER_PAGE,
+    DUMP_FILTER_USAGE,
+    DUMP_FILTER_TYPE,
+    DUMP_FILTER_REPORT,
+    DUMP_FILTER_COOKIE,
+    DUMP_FILTER_FIELDS
+};
+
+// Element types as the filter sees them, input covers misc, button, axis and scan codes alike
+enum dumpElementKind {
+    DUMP_KIND_INPUT,
+    DUMP_KIND_OUTPUT,
+    DUMP_KIND_FEATURE,
+    DUMP_KIND_COLLECTION
+};
+
+struct dumpFilterRange {
+    uint32_t min;
+    uint32_t max;
+};
+
+// Fields are and-ed, the ranges within a field or-ed, a field with no ranges matches anything
+struct dumpFilter {
+    int numRanges[DUMP_FILTER_FIELDS];
+    struct dumpFilterRange ranges[DUMP_FILTER_FIELDS][DUMP_FILTER_MAX_RANGES];
+    int elementFields;          // any element field given, matches are listed flat and devices without one left out
+};
+
+int dumpFilterParse(const char *spec, struct dumpFilter *filter);
+
+static inline int dumpFilterField(const struct dumpFilter *filter, enum dumpFilterField field, uint32_t value)
+{
+    for (int i = 0; i < filter->numRanges[field]; i++) {
+        if (value >= filter->ranges[field][i].min && value <= filter->ranges[field][i].max) {
+            return 1;
+        }
+    }
+    
+    return filter->numRanges[field] == 0;
+}
+
+// Raw ids only, checked before anything about the device is read or formatted
+static inline int dumpFilterDevice(const struct dumpFilter *filter, uint32_t vendorId, uint32_t productId)
+{
+    return !filter || (dumpFilterField(filter, DUMP_FILTER_VENDOR, vendorId) && dumpFilterField(filter, DUMP_FILTER_PRODUCT, productId));
+}
+
+static inline int dumpFilterElement(const struct dumpFilter *filter, enum dumpElementKind kind, uint32_t usagePage, uint32_t usage, uint32_t reportId, uint32_t cookie)
+{
+    return !filter || (dumpFilterField(filter, DUMP_FILTER_TYPE, kind) &&
+                       dumpFilterField(filter, DUMP_FILTER_PAGE, usagePage) &&
+                       dumpFilterField(filter, DUMP_FILTER_USAGE, usage) &&
+                       dumpFilterField(filter, DUMP_FILTER_REPORT, reportId) &&
+                       dumpFilterField(filter, DUMP_FILTER_COOKIE, cookie));
+}
+
+static inline int dumpFilterElements(const struct dumpFilter *filter)
+{
+    return filter && filter->elementFields;
+}
+
+#endif /* dumpfilter_h */
@@ -0,0 +1,1018 @@
+//
+//  dumpwriter.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "dumpwriter.h"
+#include "bench.h"
+#include "timeutil.h"
+
+// Binary format: "LKCD" + version byte, then tagged records, little endian throughout.
+// Keys are a u8 length plus bytes, strings a u16 length plus bytes.
+#define DUMP_BINARY_MAGIC "LKCD"
+#define DUMP_BINARY_VERSION 1
+
+enum dumpTag {
+    DUMP_TAG_DEVICE_BEGIN = 0x01,   // u32 index
+    DUMP_TAG_DEVICE_END = 0x02,
+    DUMP_TAG_ELEMENTS_BEGIN = 0x03, // u32 count
+    DUMP_TAG_ELEMENTS_END = 0x04,
+    DUMP_TAG_ELEMENT_BEGIN = 0x05,  // 9 x u32, 4 x i64, type, collectionType, usagePageName, name
+    DUMP_TAG_ELEMENT_END = 0x06,
+    DUMP_TAG_STRING = 0x10,         // key, string
+    DUMP_TAG_INT = 0x11,            // key, i64
+    DUMP_TAG_BOOL = 0x12,           // key, u8
+    DUMP_TAG_NULL = 0x13,           // key
+    DUMP_TAG_LIST_BEGIN = 0x14,     // key
+    DUMP_TAG_LIST_END = 0x15,
+    DUMP_TAG_MAP_BEGIN = 0x16,      // key
+    DUMP_TAG_MAP_END = 0x17,
+    DUMP_TAG_END = 0xff
+};
+
+enum dumpFrameKind {
+    DUMP_FRAME_ROOT,
+    DUMP_FRAME_DEVICE,
+    DUMP_FRAME_ELEMENTS,
+    DUMP_FRAME_ELEMENT,
+    DUMP_FRAME_LIST,
+    DUMP_FRAME_MAP
+};
+
+static const struct {
+    uint32_t flag;
+    const char *name;
+} elementFlagNames[] = {
+    { DUMP_ELEMENT_NULL_STATE, "HasNullState" },
+    { DUMP_ELEMENT_PREFERRED_STATE, "HasPreferredState" },
+    { DUMP_ELEMENT_ARRAY, "IsArray" },
+    { DUMP_ELEMENT_NON_LINEAR, "IsNonLinear" },
+    { DUMP_ELEMENT_RELATIVE, "IsRelative" },
+    { DUMP_ELEMENT_VIRTUAL, "IsVirtual" },
+    { DUMP_ELEMENT_WRAPPING, "IsWrapping" },
+    { 0, NULL }
+};
+
+int dumpFormatParse(const char *name, enum dumpFormat *format)
+{
+    if (strcmp(name, "text") == 0) {
+        *format = DUMP_FORMAT_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        *format = DUMP_FORMAT_JSON;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = DUMP_FORMAT_BINARY;
+    } else {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static void dumpFlush(struct dumpWriter *writer)
+{
+    size_t offset = 0;
+    
+    if (writer->fd < 0) {
+        if (writer->spillLen + writer->len > writer->spillCap && !writer->error) {
+            size_t spillCap = writer->spillCap ? writer->spillCap * 2 : sizeof(writer->buf);
+            
+            while (spillCap < writer->spillLen + writer->len) {
+                spillCap *= 2;
+            }
+            
+            char *grown = realloc(writer->spill, spillCap);
+            
+            if (grown) {
+                writer->spill = grown;
+                writer->spillCap = spillCap;
+            } else {
+                writer->error = ENOMEM;
+            }
+        }
+        
+        if (!writer->error) {
+            memcpy(writer->spill + writer->spillLen, writer->buf, writer->len);
+            writer->spillLen += writer->len;
+        }
+        
+        writer->len = 0;
+        return;
+    }
+    
+    while (offset < writer->len && !writer->error) {
+        ssize_t n = write(writer->fd, writer->buf + offset, writer->len - offset);
+        
+        if (n < 0) {
+            if (errno != EINTR) {
+                writer->error = errno;
+            }
+            continue;
+        }
+        offset += (size_t)n;
+    }
+    
+    writer->bytesWritten += offset;
+    writer->len = 0;
+}
+
+static void dumpPut(struct dumpWriter *writer, const void *data, size_t len)
+{
+    const char *cp = data;
+    
+    while (len) {
+        size_t chunk = sizeof(writer->buf) - writer->len;
+        
+        if (chunk == 0) {
+            dumpFlush(writer);
+            continue;
+        }
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(writer->buf + writer->len, cp, chunk);
+        writer->len += chunk;
+        cp += chunk;
+        len -= chunk;
+    }
+}
+
+static inline void dumpPutChar(struct dumpWriter *writer, char c)
+{
+    if (writer->len == sizeof(writer->buf)) {
+        dumpFlush(writer);
+    }
+    writer->buf[writer->len++] = c;
+}
+
+static inline void dumpPutStr(struct dumpWriter *writer, const char *str)
+{
+    dumpPut(writer, str, strlen(str));
+}
+
+// Formatted straight into the buffer, only ever used for short numeric fields
+static void dumpPrintf(struct dumpWriter *writer, const char *fmt, ...)
+{
+    va_list ap;
+    
+    if (sizeof(writer->buf) - writer->len < 128) {
+        dumpFlush(writer);
+    }
+    
+    va_start(ap, fmt);
+    int n = vsnprintf(writer->buf + writer->len, sizeof(writer->buf) - writer->len, fmt, ap);
+    va_end(ap);
+    
+    if (n > 0) {
+        writer->len += (size_t)n < sizeof(writer->buf) - writer->len ? (size_t)n : sizeof(writer->buf) - writer->len - 1;
+    }
+}
+
+static void dumpPutLE(struct dumpWriter *writer, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        dumpPutChar(writer, (char)(value >> (8 * i)));
+    }
+}
+
+static void dumpPutBinaryString(struct dumpWriter *writer, const char *str, int lenBytes)
+{
+    size_t len = str ? strlen(str) : 0;
+    size_t max = lenBytes == 1 ? 0xff : 0xffff;
+    
+    if (len > max) {
+        len = max;
+    }
+    dumpPutLE(writer, len, lenBytes);
+    dumpPut(writer, str, len);
+}
+
+static void dumpPutJsonString(struct dumpWriter *writer, const char *str)
+{
+    const char *run = str;
+    
+    dumpPutChar(writer, '"');
+    
+    for (const char *cp = str; *cp; cp++) {
+        unsigned char c = (unsigned char)*cp;
+        
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        
+        dumpPut(writer, run, (size_t)(cp - run));
+        run = cp + 1;
+        
+        switch (c) {
+            case '"': dumpPutStr(writer, "\\\""); break;
+            case '\\': dumpPutStr(writer, "\\\\"); break;
+            case '\n': dumpPutStr(writer, "\\n"); break;
+            case '\t': dumpPutStr(writer, "\\t"); break;
+            default: dumpPrintf(writer, "\\u%04x", c); break;
+        }
+    }
+    
+    dumpPutStr(writer, run);
+    dumpPutChar(writer, '"');
+}
+
+static struct dumpFrame *dumpTop(struct dumpWriter *writer)
+{
+    return &writer->frames[writer->depth - 1];
+}
+
+static void dumpPush(struct dumpWriter *writer, enum dumpFrameKind kind)
+{
+    if (writer->depth == DUMP_WRITER_MAX_DEPTH) {
+        writer->overflow++;
+        return;
+    }
+    
+    struct dumpFrame *frame = &writer->frames[writer->depth++];
+    
+    frame->kind = (uint8_t)kind;
+    frame->childrenOpen = 0;
+    frame->prefixLen = (uint16_t)writer->prefixLen;
+    frame->count = 0;
+}
+
+static void dumpPop(struct dumpWriter *writer)
+{
+    if (writer->overflow) {
+        writer->overflow--;
+        return;
+    }
+    
+    if (writer->depth > 1) {
+        writer->prefixLen = dumpTop(writer)->prefixLen;
+        writer->prefix[writer->prefixLen] = '\0';
+        writer->depth--;
+    }
+}
+
+static void dumpAppendPrefix(struct dumpWriter *writer, const char *fmt, ...)
+{
+    va_list ap;
+    
+    va_start(ap, fmt);
+    int n = vsnprintf(writer->prefix + writer->prefixLen, sizeof(writer->prefix) - writer->prefixLen, fmt, ap);
+    va_end(ap);
+    
+    if (n > 0) {
+        writer->prefixLen += (size_t)n < sizeof(writer->prefix) - writer->prefixLen ? (size_t)n : sizeof(writer->prefix) - writer->prefixLen - 1;
+    }
+}
+
+static void dumpWriterReset(struct dumpWriter *writer, int fd, enum dumpFormat format)
+{
+    writer->fd = fd;
+    writer->threads = 0;
+    writer->spill = NULL;
+    writer->spillLen = 0;
+    writer->spillCap = 0;
+    writer->format = format;
+    writer->keyWidth = 20;
+    writer->error = 0;
+    writer->bytesWritten = 0;
+    writer->depth = 0;
+    writer->overflow = 0;
+    writer->prefixLen = 0;
+    writer->prefix[0] = '\0';
+    writer->len = 0;
+    
+    dumpPush(writer, DUMP_FRAME_ROOT);
+}
+
+void dumpWriterInit(struct dumpWriter *writer, int fd, enum dumpFormat format)
+{
+    dumpWriterReset(writer, fd, format);
+    
+    switch (format) {
+        case DUMP_FORMAT_TEXT:
+            dumpPutStr(writer, "Device Dump:\n\n");
+            break;
+        case DUMP_FORMAT_JSON:
+            dumpPutStr(writer, "{\"devices\":[");
+            break;
+        case DUMP_FORMAT_BINARY:
+            dumpPutStr(writer, DUMP_BINARY_MAGIC);
+            dumpPutChar(writer, DUMP_BINARY_VERSION);
+            break;
+    }
+}
+
+int dumpWriterFinish(struct dumpWriter *writer)
+{
+    switch (writer->format) {
+        case DUMP_FORMAT_TEXT:
+            break;
+        case DUMP_FORMAT_JSON:
+            dumpPutStr(writer, "]}\n");
+            break;
+        case DUMP_FORMAT_BINARY:
+            dumpPutChar(writer, (char)DUMP_TAG_END);
+            break;
+    }
+    
+    dumpFlush(writer);
+    
+    return writer->error ? -1 : 0;
+}
+
+// One device's worth of output kept in memory, to be spliced into the real writer in order
+void dumpWriterInitFragment(struct dumpWriter *writer, enum dumpFormat format, int keyWidth)
+{
+    dumpWriterReset(writer, -1, format);
+    writer->keyWidth = keyWidth;
+}
+
+void dumpWriterAppend(struct dumpWriter *writer, struct dumpWriter *fragment)
+{
+    if (fragment->error && !writer->error) {
+        writer->error = fragment->error;
+    }
+    
+    if (fragment->spillLen + fragment->len == 0) {
+        return;
+    }
+    
+    // The device separator the fragment could not know it needed
+    if (writer->format == DUMP_FORMAT_JSON && dumpTop(writer)->count) {
+        dumpPutChar(writer, ',');
+    }
+    dumpTop(writer)->count++;
+    
+    dumpPut(writer, fragment->spill, fragment->spillLen);
+    dumpPut(writer, fragment->buf, fragment->len);
+}
+
+void dumpWriterRelease(struct dumpWriter *writer)
+{
+    free(writer->spill);
+    writer->spill = NULL;
+    writer->spillLen = 0;
+    writer->spillCap = 0;
+}
+
+struct dumpParallel {
+    struct dumpWriter *writer;
+    dumpDeviceFunc dumpDevice;
+    void *context;
+    int numDevices;
+    int next;                       // next device a worker takes
+    struct dumpWriter **fragments;  // done and not yet appended, NULL if its allocation failed
+    uint8_t *done;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+};
+
+static void *dumpParallelWorker(void *arg)
+{
+    struct dumpParallel *parallel = arg;
+    int index;
+    
+    while ((index = __atomic_fetch_add(&parallel->next, 1, __ATOMIC_RELAXED)) < parallel->numDevices) {
+        struct dumpWriter *fragment = malloc(sizeof(struct dumpWriter));
+        
+        if (fragment) {
+            dumpWriterInitFragment(fragment, parallel->writer->format, parallel->writer->keyWidth);
+            parallel->dumpDevice(fragment, index, parallel->context);
+            dumpFlush(fragment);
+        }
+        
+        pthread_mutex_lock(&parallel->lock);
+        parallel->fragments[index] = fragment;
+        parallel->done[index] = 1;
+        pthread_cond_broadcast(&parallel->ready);
+        pthread_mutex_unlock(&parallel->lock);
+    }
+    
+    return NULL;
+}
+
+// Devices are read and formatted on several threads into fragments and written out in index order as
+// soon as each is next in line, so the output is the same as a serial dump. One thread, one device or
+// a failure to start threads formats straight into writer
+int dumpDevicesParallel(struct dumpWriter *writer, int numDevices, dumpDeviceFunc dumpDevice, void *context)
+{
+    struct dumpParallel parallel;
+    pthread_t threads[16];
+    int numThreads = writer->threads;
+    int numStarted = 0;
+    
+    // Most of a device's time goes to waiting on property and descriptor reads, not the cpu
+    if (numThreads <= 0 || numThreads > (int)(sizeof(threads) / sizeof(threads[0]))) {
+        numThreads = (int)(sizeof(threads) / sizeof(threads[0]));
+    }
+    
+    if (numThreads > numDevices) {
+        numThreads = numDevices;
+    }
+    
+    memset(&parallel, 0, sizeof(parallel));
+    parallel.writer = writer;
+    parallel.dumpDevice = dumpDevice;
+    parallel.context = context;
+    parallel.numDevices = numDevices;
+    
+    if (numThreads > 1) {
+        parallel.fragments = calloc((size_t)numDevices, sizeof(struct dumpWriter *));
+        parallel.done = calloc((size_t)numDevices, 1);
+    }
+    
+    if (!parallel.fragments || !parallel.done) {
+        free(parallel.fragments);
+        free(parallel.done);
+        
+        for (int i = 0; i < numDevices; i++) {
+            dumpDevice(writer, i, context);
+        }
+        
+        return writer->error ? -1 : 0;
+    }
+    
+    pthread_mutex_init(&parallel.lock, NULL);
+    pthread_cond_init(&parallel.ready, NULL);
+    
+    for (; numStarted < numThreads; numStarted++) {
+        if (pthread_create(&threads[numStarted], NULL, dumpParallelWorker, &parallel)) {
+            break;
+        }
+    }
+    
+    // Whatever no thread picked up gets done here
+    if (numStarted == 0) {
+        dumpParallelWorker(&parallel);
+    }
+    
+    for (int i = 0; i < numDevices; i++) {
+        pthread_mutex_lock(&parallel.lock);
+        while (!parallel.done[i]) {
+            pthread_cond_wait(&parallel.ready, &parallel.lock);
+        }
+        pthread_mutex_unlock(&parallel.lock);
+        
+        if (parallel.fragments[i]) {
+            dumpWriterAppend(writer, parallel.fragments[i]);
+            dumpWriterRelease(parallel.fragments[i]);
+            free(parallel.fragments[i]);
+        } else if (!writer->error) {
+            writer->error = ENOMEM;
+        }
+    }
+    
+    for (int i = 0; i < numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    pthread_cond_destroy(&parallel.ready);
+    pthread_mutex_destroy(&parallel.lock);
+    free(parallel.fragments);
+    free(parallel.done);
+    
+    return writer->error ? -1 : 0;
+}
+
+// Separator and key for the next value in whatever container is open
+static void dumpValuePrefix(struct dumpWriter *writer, const char *key)
+{
+    struct dumpFrame *frame = dumpTop(writer);
+    int first = frame->count++ == 0;
+    
+    if (writer->format == DUMP_FORMAT_JSON) {
+        if (!first) {
+            dumpPutChar(writer, ',');
+        }
+        if (frame->kind != DUMP_FRAME_LIST && frame->kind != DUMP_FRAME_ROOT && frame->kind != DUMP_FRAME_ELEMENTS) {
+            dumpPutJsonString(writer, key ? key : "");
+            dumpPutChar(writer, ':');
+        }
+        return;
+    }
+    
+    // Text: one property per line at device level, inline inside lists and maps
+    if (frame->kind == DUMP_FRAME_DEVICE) {
+        dumpPut(writer, writer->prefix, writer->prefixLen);
+        dumpPrintf(writer, " %-*s: ", writer->keyWidth, key ? key : "");
+        return;
+    }
+    
+    if (!first) {
+        dumpPutStr(writer, ", ");
+    }
+    if (frame->kind == DUMP_FRAME_MAP) {
+        dumpPutStr(writer, key ? key : "");
+        dumpPutChar(writer, '=');
+    }
+}
+
+static void dumpValueEnd(struct dumpWriter *writer)
+{
+    if (writer->format == DUMP_FORMAT_TEXT && dumpTop(writer)->kind == DUMP_FRAME_DEVICE) {
+        dumpPutChar(writer, '\n');
+    }
+}
+
+static void dumpBinaryTag(struct dumpWriter *writer, enum dumpTag tag, const char *key)
+{
+    dumpPutChar(writer, (char)tag);
+    dumpPutBinaryString(writer, key, 1);
+}
+
+void dumpString(struct dumpWriter *writer, const char *key, const char *value)
+{
+    if (!value) {
+        dumpNull(writer, key);
+        return;
+    }
+    
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpBinaryTag(writer, DUMP_TAG_STRING, key);
+        dumpPutBinaryString(writer, value, 2);
+        return;
+    }
+    
+    dumpValuePrefix(writer, key);
+    
+    if (writer->format == DUMP_FORMAT_JSON) {
+        dumpPutJsonString(writer, value);
+    } else {
+        dumpPutStr(writer, value);
+    }
+    
+    dumpValueEnd(writer);
+}
+
+void dumpInt(struct dumpWriter *writer, const char *key, int64_t value)
+{
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpBinaryTag(writer, DUMP_TAG_INT, key);
+        dumpPutLE(writer, (uint64_t)value, 8);
+        return;
+    }
+    
+    dumpValuePrefix(writer, key);
+    dumpPrintf(writer, "%lld", (long long)value);
+    dumpValueEnd(writer);
+}
+
+// Same as dumpInt except text output shows hex
+void dumpHex(struct dumpWriter *writer, const char *key, uint64_t value)
+{
+    if (writer->format != DUMP_FORMAT_TEXT) {
+        dumpInt(writer, key, (int64_t)value);
+        return;
+    }
+    
+    dumpValuePrefix(writer, key);
+    dumpPrintf(writer, "0x%llx", (unsigned long long)value);
+    dumpValueEnd(writer);
+}
+
+void dumpBool(struct dumpWriter *writer, const char *key, int value)
+{
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpBinaryTag(writer, DUMP_TAG_BOOL, key);
+        dumpPutChar(writer, value ? 1 : 0);
+        return;
+    }
+    
+    dumpValuePrefix(writer, key);
+    
+    if (writer->format == DUMP_FORMAT_JSON) {
+        dumpPutStr(writer, value ? "true" : "false");
+    } else {
+        dumpPutStr(writer, value ? "TRUE" : "FALSE");
+    }
+    
+    dumpValueEnd(writer);
+}
+
+void dumpNull(struct dumpWriter *writer, const char *key)
+{
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpBinaryTag(writer, DUMP_TAG_NULL, key);
+        return;
+    }
+    
+    dumpValuePrefix(writer, key);
+    dumpPutStr(writer, writer->format == DUMP_FORMAT_JSON ? "null" : "<notSet>");
+    dumpValueEnd(writer);
+}
+
+static void dumpBeginContainer(struct dumpWriter *writer, const char *key, enum dumpFrameKind kind)
+{
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpBinaryTag(writer, kind == DUMP_FRAME_LIST ? DUMP_TAG_LIST_BEGIN : DUMP_TAG_MAP_BEGIN, key);
+    } else {
+        dumpValuePrefix(writer, key);
+        
+        if (writer->format == DUMP_FORMAT_JSON) {
+            dumpPutChar(writer, kind == DUMP_FRAME_LIST ? '[' : '{');
+        } else {
+            dumpPutStr(writer, kind == DUMP_FRAME_LIST ? "[ " : "{ ");
+        }
+    }
+    
+    dumpPush(writer, kind);
+}
+
+static void dumpEndContainer(struct dumpWriter *writer, enum dumpFrameKind kind)
+{
+    dumpPop(writer);
+    
+    if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpPutChar(writer, kind == DUMP_FRAME_LIST ? DUMP_TAG_LIST_END : DUMP_TAG_MAP_END);
+    } else if (writer->format == DUMP_FORMAT_JSON) {
+        dumpPutChar(writer, kind == DUMP_FRAME_LIST ? ']' : '}');
+    } else {
+        dumpPutStr(writer, kind == DUMP_FRAME_LIST ? " ]" : " }");
+        dumpValueEnd(writer);
+    }
+}
+
+void dumpBeginList(struct dumpWriter *writer, const char *key)
+{
+    dumpBeginContainer(writer, key, DUMP_FRAME_LIST);
+}
+
+void dumpEndList(struct dumpWriter *writer)
+{
+    dumpEndContainer(writer, DUMP_FRAME_LIST);
+}
+
+void dumpBeginMap(struct dumpWriter *writer, const char *key)
+{
+    dumpBeginContainer(writer, key, DUMP_FRAME_MAP);
+}
+
+void dumpEndMap(struct dumpWriter *writer)
+{
+    dumpEndContainer(writer, DUMP_FRAME_MAP);
+}
+
+void dumpBeginDevice(struct dumpWriter *writer, int index)
+{
+    switch (writer->format) {
+        case DUMP_FORMAT_TEXT:
+            dumpPush(writer, DUMP_FRAME_DEVICE);
+            dumpAppendPrefix(writer, "%02d ", index);
+            return;
+        case DUMP_FORMAT_JSON:
+            dumpValuePrefix(writer, NULL);
+            dumpPrintf(writer, "{\"index\":%d", index);
+            dumpPush(writer, DUMP_FRAME_DEVICE);
+            dumpTop(writer)->count = 1;
+            return;
+        case DUMP_FORMAT_BINARY:
+            dumpPutChar(writer, DUMP_TAG_DEVICE_BEGIN);
+            dumpPutLE(writer, (uint32_t)index, 4);
+            dumpPush(writer, DUMP_FRAME_DEVICE);
+            return;
+    }
+}
+
+void dumpEndDevice(struct dumpWriter *writer)
+{
+    dumpPop(writer);
+    
+    switch (writer->format) {
+        case DUMP_FORMAT_TEXT:
+            dumpPutChar(writer, '\n');
+            break;
+        case DUMP_FORMAT_JSON:
+            dumpPutChar(writer, '}');
+            break;
+        case DUMP_FORMAT_BINARY:
+            dumpPutChar(writer, DUMP_TAG_DEVICE_END);
+            break;
+    }
+}
+
+void dumpBeginElements(struct dumpWriter *writer, long count)
+{
+    switch (writer->format) {
+        case DUMP_FORMAT_TEXT:
+            dumpPut(writer, writer->prefix, writer->prefixLen);
+            dumpPrintf(writer, " %ld Elements:\n", count);
+            dumpPush(writer, DUMP_FRAME_ELEMENTS);
+            dumpAppendPrefix(writer, " ");
+            return;
+        case DUMP_FORMAT_JSON:
+            dumpValuePrefix(writer, "elements");
+            dumpPutChar(writer, '[');
+            break;
+        case DUMP_FORMAT_BINARY:
+            dumpPutChar(writer, DUMP_TAG_ELEMENTS_BEGIN);
+            dumpPutLE(writer, (uint32_t)count, 4);
+            break;
+    }
+    
+    dumpPush(writer, DUMP_FRAME_ELEMENTS);
+}
+
+void dumpEndElements(struct dumpWriter *writer)
+{
+    dumpPop(writer);
+    
+    if (writer->format == DUMP_FORMAT_JSON) {
+        dumpPutChar(writer, ']');
+    } else if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpPutChar(writer, DUMP_TAG_ELEMENTS_END);
+    }
+}
+
+static void dumpElementText(struct dumpWriter *writer, struct dumpFrame *parent, const struct dumpElement *element)
+{
+    // Children carry their position under the parent, as the recursive dump always has
+    if (parent->kind == DUMP_FRAME_ELEMENT) {
+        dumpAppendPrefix(writer, "[%u] ", parent->count);
+    }
+    parent->count++;
+    dumpAppendPrefix(writer, "cookie:0x%04x ", element->cookie);
+    
+    dumpPut(writer, writer->prefix, writer->prefixLen);
+    dumpPutStr(writer, "{ ");
+    
+    if (element->name) {
+        dumpPutStr(writer, "Name=");
+        dumpPutStr(writer, element->name);
+        dumpPutStr(writer, ", ");
+    }
+    
+    dumpPutStr(writer, "Type=");
+    dumpPutStr(writer, element->type);
+    dumpPutStr(writer, ", CollectionType=");
+    dumpPutStr(writer, element->collectionType);
+    
+    if (element->usagePageName) {
+        dumpPutStr(writer, ", UsagePage=");
+        dumpPutStr(writer, element->usagePageName);
+    } else {
+        dumpPrintf(writer, ", UsagePage=<0x%x>", element->usagePage);
+    }
+    
+    dumpPrintf(writer, ", Usage=0x%x, ReportSize=0x%x, ReportCount=0x%x, ReportID=0x%x, Unit=0x%x, UnitExponent=0x%x",
+               element->usage, element->reportSize, element->reportCount, element->reportId, element->unit, (uint32_t)element->unitExponent);
+    
+    for (int i = 0; elementFlagNames[i].name; i++) {
+        if (element->flags & elementFlagNames[i].flag) {
+            dumpPutStr(writer, ", ");
+            dumpPutStr(writer, elementFlagNames[i].name);
+            dumpPutStr(writer, "=TRUE");
+        }
+    }
+    
+    dumpPrintf(writer, ", LogicalRange=%lld-%lld", (long long)element->logicalMin, (long long)element->logicalMax);
+    dumpPrintf(writer, ", PhysicalRange=%lld-%lld }\n", (long long)element->physicalMin, (long long)element->physicalMax);
+}
+
+static void dumpElementJson(struct dumpWriter *writer, const struct dumpElement *element)
+{
+    struct dumpFrame *parent = dumpTop(writer);
+    
+    if (parent->kind == DUMP_FRAME_ELEMENT && !parent->childrenOpen) {
+        dumpPutStr(writer, ",\"children\":[");
+        parent->childrenOpen = 1;
+        parent->count = 0;
+    }
+    if (parent->count++) {
+        dumpPutChar(writer, ',');
+    }
+    
+    dumpPrintf(writer, "{\"cookie\":%u,\"name\":", element->cookie);
+    
+    if (element->name) {
+        dumpPutJsonString(writer, element->name);
+    } else {
+        dumpPutStr(writer, "null");
+    }
+    
+    dumpPutStr(writer, ",\"type\":");
+    dumpPutJsonString(writer, element->type);
+    dumpPutStr(writer, ",\"collectionType\":");
+    dumpPutJsonString(writer, element->collectionType);
+    dumpPrintf(writer, ",\"usagePage\":%u,\"usagePageName\":", element->usagePage);
+    
+    if (element->usagePageName) {
+        dumpPutJsonString(writer, element->usagePageName);
+    } else {
+        dumpPutStr(writer, "null");
+    }
+    
+    dumpPrintf(writer, ",\"usage\":%u,\"reportSize\":%u,\"reportCount\":%u,\"reportId\":%u,\"unit\":%u,\"unitExponent\":%d",
+               element->usage, element->reportSize, element->reportCount, element->reportId, element->unit, element->unitExponent);
+    
+    for (int i = 0; elementFlagNames[i].name; i++) {
+        dumpPrintf(writer, ",\"%s\":%s", elementFlagNames[i].name, element->flags & elementFlagNames[i].flag ? "true" : "false");
+    }
+    
+    dumpPrintf(writer, ",\"logicalMin\":%lld,\"logicalMax\":%lld", (long long)element->logicalMin, (long long)element->logicalMax);
+    dumpPrintf(writer, ",\"physicalMin\":%lld,\"physicalMax\":%lld", (long long)element->physicalMin, (long long)element->physicalMax);
+}
+
+static void dumpElementBinary(struct dumpWriter *writer, const struct dumpElement *element)
+{
+    dumpPutChar(writer, DUMP_TAG_ELEMENT_BEGIN);
+    dumpPutLE(writer, element->cookie, 4);
+    dumpPutLE(writer, element->usagePage, 4);
+    dumpPutLE(writer, element->usage, 4);
+    dumpPutLE(writer, element->reportSize, 4);
+    dumpPutLE(writer, element->reportCount, 4);
+    dumpPutLE(writer, element->reportId, 4);
+    dumpPutLE(writer, element->unit, 4);
+    dumpPutLE(writer, (uint32_t)element->unitExponent, 4);
+    dumpPutLE(writer, element->flags, 4);
+    dumpPutLE(writer, (uint64_t)element->logicalMin, 8);
+    dumpPutLE(writer, (uint64_t)element->logicalMax, 8);
+    dumpPutLE(writer, (uint64_t)element->physicalMin, 8);
+    dumpPutLE(writer, (uint64_t)element->physicalMax, 8);
+    dumpPutBinaryString(writer, element->type, 2);
+    dumpPutBinaryString(writer, element->collectionType, 2);
+    dumpPutBinaryString(writer, element->usagePageName, 2);
+    dumpPutBinaryString(writer, element->name, 2);
+}
+
+// Written immediately, children follow until the matching dumpEndElement
+void dumpBeginElement(struct dumpWriter *writer, const struct dumpElement *element)
+{
+    switch (writer->format) {
+        case DUMP_FORMAT_TEXT:
+            // Pushed first so popping this element restores the parent's prefix
+            dumpPush(writer, DUMP_FRAME_ELEMENT);
+            dumpElementText(writer, writer->overflow ? dumpTop(writer) : &writer->frames[writer->depth - 2], element);
+            return;
+        case DUMP_FORMAT_JSON:
+            dumpElementJson(writer, element);
+            break;
+        case DUMP_FORMAT_BINARY:
+            dumpElementBinary(writer, element);
+            break;
+    }
+    
+    dumpPush(writer, DUMP_FRAME_ELEMENT);
+}
+
+void dumpEndElement(struct dumpWriter *writer)
+{
+    int childrenOpen = writer->overflow ? 0 : dumpTop(writer)->childrenOpen;
+    
+    dumpPop(writer);
+    
+    if (writer->format == DUMP_FORMAT_JSON) {
+        dumpPutStr(writer, childrenOpen ? "]}" : "}");
+    } else if (writer->format == DUMP_FORMAT_BINARY) {
+        dumpPutChar(writer, DUMP_TAG_ELEMENT_END);
+    }
+}
+
+#define DUMP_BENCH_COLLECTIONS 16
+#define DUMP_BENCH_KEYS 40
+
+// Synthetic device with a 10k element tree: applications holding logical collections of keys
+static void dumpBenchDevice(struct dumpWriter *writer, int index, long *numElements)
+{
+    struct dumpElement element;
+    uint32_t cookie = 1;
+    
+    memset(&element, 0, sizeof(element));
+    
+    dumpBeginDevice(writer, index);
+    dumpString(writer, "Transport", "USB");
+    dumpHex(writer, "VendorID", 0x046d);
+    dumpString(writer, "Manufacturer", "Logitech");
+    dumpHex(writer, "ProductID", 0xc24d);
+    dumpString(writer, "Product", "Logitech G710 Keyboard");
+    dumpHex(writer, "LocationID", 0x14200000 | (uint32_t)index);
+    dumpNull(writer, "SerialNumber");
+    dumpBeginList(writer, "DeviceUsagePairs");
+    for (int i = 0; i < 3; i++) {
+        dumpBeginMap(writer, NULL);
+        dumpHex(writer, "DeviceUsagePage", i ? 0xff00 : 1);
+        dumpHex(writer, "DeviceUsage", i ? 0 : 6);
+        dumpEndMap(writer);
+    }
+    dumpEndList(writer);
+    
+    dumpBeginElements(writer, DUMP_BENCH_COLLECTIONS);
+    
+    for (int a = 0; a < DUMP_BENCH_COLLECTIONS; a++) {
+        memset(&element, 0, sizeof(element));
+        element.cookie = cookie++;
+        element.type = "Collection";
+        element.collectionType = "Application";
+        element.usagePage = 1;
+        element.usagePageName = "GenericDesktop";
+        element.usage = 6;
+        dumpBeginElement(writer, &element);
+        
+        for (int c = 0; c < DUMP_BENCH_COLLECTIONS; c++) {
+            element.cookie = cookie++;
+            element.collectionType = "Logical";
+            element.usagePage = 0xff00 + (uint32_t)c;
+            element.usagePageName = NULL;
+            element.name = c & 1 ? "Vendor Keys" : NULL;
+            dumpBeginElement(writer, &element);
+            
+            for (uint32_t k = 0; k < DUMP_BENCH_KEYS; k++) {
+                struct dumpElement key;
+                
+                memset(&key, 0, sizeof(key));
+                key.cookie = cookie++;
+                key.type = "Button";
+                key.collectionType = "unknown";
+                key.usagePage = 7;
+                key.usagePageName = "Keyboard";
+                key.usage = k + 4;
+                key.reportSize = 1;
+                key.reportCount = 1;
+                key.reportId = 1;
+                key.logicalMax = 1;
+                key.physicalMax = 1;
+                key.flags = DUMP_ELEMENT_PREFERRED_STATE;
+                dumpBeginElement(writer, &key);
+                dumpEndElement(writer);
+            }
+            
+            dumpEndElement(writer);
+        }
+        
+        dumpEndElement(writer);
+    }
+    
+    *numElements += cookie - 1;
+    
+    dumpEndElements(writer);
+    dumpEndDevice(writer);
+}
+
+int dumpWriterBenchmark(struct benchOptions *opts)
+{
+    static const char *formats[] = { "text", "json", "binary", NULL };
+    struct dumpWriter *writer = malloc(sizeof(struct dumpWriter));
+    int fd = open("/dev/null", O_WRONLY);
+    int numDevices = opts->iterations / 20 + 1;
+    
+    if (!writer || fd < 0) {
+        fprintf(stderr, "Failed to set up dump benchmark!\n");
+        free(writer);
+        return -1;
+    }
+    
+    for (int f = 0; formats[f]; f++) {
+        enum dumpFormat format;
+        long numElements = 0;
+        
+        dumpFormatParse(formats[f], &format);
+        dumpWriterInit(writer, fd, format);
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < numDevices; i++) {
+            dumpBenchDevice(writer, i, &numElements);
+        }
+        dumpWriterFinish(writer);
+        
+        uint64_t elapsed = monotonicNanos() - startTime;
+        
+        benchReportThroughput(formats[f], (uint64_t)numElements, elapsed, benchAllocations() - allocs, writer->bytesWritten);
+    }
+    
+    close(fd);
+    free(writer);
+    
+    return 0;
+}
@@ -0,0 +1,138 @@
+//
+//  dumpwriter.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef dumpwriter_h
+#define dumpwriter_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DUMP_WRITER_BUFFER_SIZE 65536
+#define DUMP_WRITER_MAX_DEPTH 32
+#define DUMP_WRITER_PREFIX_SIZE 512
+
+enum dumpFormat {
+    DUMP_FORMAT_TEXT,
+    DUMP_FORMAT_JSON,
+    DUMP_FORMAT_BINARY
+};
+
+// Element flags, only the set ones are printed in text form
+#define DUMP_ELEMENT_NULL_STATE         0x01
+#define DUMP_ELEMENT_PREFERRED_STATE    0x02
+#define DUMP_ELEMENT_ARRAY              0x04
+#define DUMP_ELEMENT_NON_LINEAR         0x08
+#define DUMP_ELEMENT_RELATIVE           0x10
+#define DUMP_ELEMENT_VIRTUAL            0x20
+#define DUMP_ELEMENT_WRAPPING           0x40
+
+// One HID element, filled on the stack by the backend and streamed straight out
+struct dumpElement {
+    uint32_t cookie;
+    const char *name;               // NULL when the element has none
+    const char *type;               // Misc, Button, Feature, Collection...
+    const char *collectionType;
+    const char *usagePageName;      // NULL prints the raw page
+    uint32_t usagePage;
+    uint32_t usage;
+    uint32_t reportSize;
+    uint32_t reportCount;
+    uint32_t reportId;
+    uint32_t unit;
+    int32_t unitExponent;
+    uint32_t flags;                 // DUMP_ELEMENT_*
+    int64_t logicalMin;
+    int64_t logicalMax;
+    int64_t physicalMin;
+    int64_t physicalMax;
+};
+
+struct dumpFrame {
+    uint8_t kind;
+    uint8_t childrenOpen;           // json: "children" array started under this element
+    uint16_t prefixLen;             // text: prefix length to restore on exit
+    uint32_t count;                 // values or children written so far
+};
+
+// Buffered sink, nothing is allocated while dumping to a file. A fragment has no file and keeps what
+// overflows the buffer in spill until dumpWriterAppend copies it out
+struct dumpWriter {
+    int fd;                         // -1 for a fragment
+    int threads;                    // devices read and formatted at once by dumpDevicesParallel, 0 for as many as it allows
+    enum dumpFormat format;
+    int keyWidth;                   // text: property name column width
+    int error;
+    uint64_t bytesWritten;
+    int depth;
+    int overflow;                   // nesting past DUMP_WRITER_MAX_DEPTH, emitted but not tracked
+    struct dumpFrame frames[DUMP_WRITER_MAX_DEPTH];
+    char prefix[DUMP_WRITER_PREFIX_SIZE];
+    size_t prefixLen;
+    char *spill;
+    size_t spillLen;
+    size_t spillCap;
+    size_t len;
+    char buf[DUMP_WRITER_BUFFER_SIZE];
+};
+
+struct benchOptions;
+
+// Writes device index into writer, or nothing when the device is filtered out
+typedef void (*dumpDeviceFunc)(struct dumpWriter *writer, int index, void *context);
+
+int dumpFormatParse(const char *name, enum dumpFormat *format);
+void dumpWriterInit(struct dumpWriter *writer, int fd, enum dumpFormat format);
+int dumpWriterFinish(struct dumpWriter *writer);
+void dumpWriterInitFragment(struct dumpWriter *writer, enum dumpFormat format, int keyWidth);
+void dumpWriterAppend(struct dumpWriter *writer, struct dumpWriter *fragment);
+void dumpWriterRelease(struct dumpWriter *writer);
+int dumpDevicesParallel(struct dumpWriter *writer, int numDevices, dumpDeviceFunc dumpDevice, void *context);
+
+void dumpBeginDevice(struct dumpWriter *writer, int index);
+void dumpEndDevice(struct dumpWriter *writer);
+void dumpBeginElements(struct dumpWriter *writer, long count);
+void dumpEndElements(struct dumpWriter *writer);
+void dumpBeginElement(struct dumpWriter *writer, const struct dumpElement *element);
+void dumpEndElement(struct dumpWriter *writer);
+
+// Property values, key is ignored inside lists
+void dumpString(struct dumpWriter *writer, const char *key, const char *value);
+void dumpInt(struct dumpWriter *writer, const char *key, int64_t value);
+void dumpHex(struct dumpWriter *writer, const char *key, uint64_t value);
+void dumpBool(struct dumpWriter *writer, const char *key, int value);
+void dumpNull(struct dumpWriter *writer, const char *key);
+void dumpBeginList(struct dumpWriter *writer, const char *key);
+void dumpEndList(struct dumpWriter *writer);
+void dumpBeginMap(struct dumpWriter *writer, const char *key);
+void dumpEndMap(struct dumpWriter *writer);
+
+int dumpWriterBenchmark(struct benchOptions *opts);
+
+#endif /* dumpwriter_h */
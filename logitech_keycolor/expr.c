@@ -0,0 +1,761 @@
+//
+//  expr.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "expr.h"
+#include "keycolor.h"
+#include "timeutil.h"
+
+enum exprCode {
+    OP_CONST,
+    OP_LOAD,
+    OP_STORE,
+    OP_NEG,
+    OP_NOT,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_POW,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_OR,
+    OP_SELECT,
+    OP_SIN,
+    OP_COS,
+    OP_TAN,
+    OP_ABS,
+    OP_FLOOR,
+    OP_FRACT,
+    OP_SQRT,
+    OP_EXP,
+    OP_LOG,
+    OP_TRI,
+    OP_MIN,
+    OP_MAX,
+    OP_STEP,
+    OP_CLAMP,
+    OP_MIX
+};
+
+static const struct {
+    const char *name;
+    uint8_t code;
+    int arity;
+} exprFunctions[] = {
+    { "sin", OP_SIN, 1 },
+    { "cos", OP_COS, 1 },
+    { "tan", OP_TAN, 1 },
+    { "abs", OP_ABS, 1 },
+    { "floor", OP_FLOOR, 1 },
+    { "fract", OP_FRACT, 1 },
+    { "sqrt", OP_SQRT, 1 },
+    { "exp", OP_EXP, 1 },
+    { "log", OP_LOG, 1 },
+    { "tri", OP_TRI, 1 },       // triangle wave, 0 to 1 and back once per unit
+    { "min", OP_MIN, 2 },
+    { "max", OP_MAX, 2 },
+    { "step", OP_STEP, 2 },     // step(edge, x), 0 below edge and 1 from it on
+    { "pow", OP_POW, 2 },
+    { "clamp", OP_CLAMP, 3 },
+    { "mix", OP_MIX, 3 },       // mix(a, b, w), a straight line from a at w=0 to b at w=1
+    { NULL, 0, 0 }
+};
+
+static const char *exprOpNames[] = {
+    "const", "load", "store", "neg", "not", "add", "sub", "mul", "div", "mod", "pow",
+    "lt", "le", "gt", "ge", "eq", "ne", "and", "or", "select",
+    "sin", "cos", "tan", "abs", "floor", "fract", "sqrt", "exp", "log", "tri",
+    "min", "max", "step", "clamp", "mix"
+};
+
+// The interpreter, also run at compile time to fold constant subexpressions
+static void exprExecute(const struct exprOp *code, size_t numOps, const double *consts, double *vars, double *stack)
+{
+    double *sp = stack;
+    
+    for (const struct exprOp *op = code; op < code + numOps; op++) {
+        switch (op->code) {
+            case OP_CONST: *sp++ = consts[op->arg]; break;
+            case OP_LOAD: *sp++ = vars[op->arg]; break;
+            case OP_STORE: vars[op->arg] = *--sp; break;
+            case OP_NEG: sp[-1] = -sp[-1]; break;
+            case OP_NOT: sp[-1] = sp[-1] == 0.0; break;
+            case OP_ADD: sp--; sp[-1] += sp[0]; break;
+            case OP_SUB: sp--; sp[-1] -= sp[0]; break;
+            case OP_MUL: sp--; sp[-1] *= sp[0]; break;
+            case OP_DIV: sp--; sp[-1] = sp[0] != 0.0 ? sp[-1] / sp[0] : 0.0; break;
+            case OP_MOD: sp--; sp[-1] = sp[0] != 0.0 ? sp[-1] - sp[0] * floor(sp[-1] / sp[0]) : 0.0; break;
+            case OP_POW: sp--; sp[-1] = pow(sp[-1], sp[0]); break;
+            case OP_LT: sp--; sp[-1] = sp[-1] < sp[0]; break;
+            case OP_LE: sp--; sp[-1] = sp[-1] <= sp[0]; break;
+            case OP_GT: sp--; sp[-1] = sp[-1] > sp[0]; break;
+            case OP_GE: sp--; sp[-1] = sp[-1] >= sp[0]; break;
+            case OP_EQ: sp--; sp[-1] = sp[-1] == sp[0]; break;
+            case OP_NE: sp--; sp[-1] = sp[-1] != sp[0]; break;
+            case OP_AND: sp--; sp[-1] = sp[-1] != 0.0 && sp[0] != 0.0; break;
+            case OP_OR: sp--; sp[-1] = sp[-1] != 0.0 || sp[0] != 0.0; break;
+            case OP_SELECT: sp -= 2; sp[-1] = sp[-1] != 0.0 ? sp[0] : sp[1]; break;
+            case OP_SIN: sp[-1] = sin(sp[-1]); break;
+            case OP_COS: sp[-1] = cos(sp[-1]); break;
+            case OP_TAN: sp[-1] = tan(sp[-1]); break;
+            case OP_ABS: sp[-1] = fabs(sp[-1]); break;
+            case OP_FLOOR: sp[-1] = floor(sp[-1]); break;
+            case OP_FRACT: sp[-1] -= floor(sp[-1]); break;
+            case OP_SQRT: sp[-1] = sp[-1] > 0.0 ? sqrt(sp[-1]) : 0.0; break;
+            case OP_EXP: sp[-1] = exp(sp[-1]); break;
+            case OP_LOG: sp[-1] = sp[-1] > 0.0 ? log(sp[-1]) : 0.0; break;
+            case OP_TRI: sp[-1] = 1.0 - fabs(2.0 * (sp[-1] - floor(sp[-1])) - 1.0); break;
+            case OP_MIN: sp--; sp[-1] = sp[0] < sp[-1] ? sp[0] : sp[-1]; break;
+            case OP_MAX: sp--; sp[-1] = sp[0] > sp[-1] ? sp[0] : sp[-1]; break;
+            case OP_STEP: sp--; sp[-1] = sp[0] >= sp[-1]; break;
+            case OP_CLAMP: sp -= 2; sp[-1] = sp[-1] < sp[0] ? sp[0] : sp[-1] > sp[1] ? sp[1] : sp[-1]; break;
+            case OP_MIX: sp -= 2; sp[-1] += (sp[0] - sp[-1]) * sp[1]; break;
+        }
+    }
+}
+
+struct exprParser {
+    const char *source;
+    const char *pos;
+    struct exprProgram *prog;
+    size_t depth;               // values on the stack at this point of the program
+    int failed;
+};
+
+static void exprError(struct exprParser *parser, const char *message)
+{
+    if (!parser->failed) {
+        int line = 1, column = 1;
+        
+        for (const char *cp = parser->source; cp < parser->pos; cp++) {
+            if (*cp == '\n') {
+                line++;
+                column = 1;
+            } else {
+                column++;
+            }
+        }
+        fprintf(stderr, "Expression line %d column %d: %s\n", line, column, message);
+    }
+    parser->failed = 1;
+}
+
+// Skips blanks and comments, not newlines, they end statements
+static void exprSkip(struct exprParser *parser)
+{
+    for (;;) {
+        while (*parser->pos == ' ' || *parser->pos == '\t' || *parser->pos == '\r') {
+            parser->pos++;
+        }
+        
+        if (*parser->pos != '#') {
+            return;
+        }
+        
+        while (*parser->pos && *parser->pos != '\n') {
+            parser->pos++;
+        }
+    }
+}
+
+static int exprAccept(struct exprParser *parser, const char *token)
+{
+    size_t len = strlen(token);
+    
+    exprSkip(parser);
+    
+    if (strncmp(parser->pos, token, len) != 0) {
+        return 0;
+    }
+    
+    // "=" must not eat the first half of "==", nor "<" of "<="
+    if (len == 1 && strchr("=<>!", token[0]) && parser->pos[1] == '=') {
+        return 0;
+    }
+    
+    parser->pos += len;
+    
+    return 1;
+}
+
+static void exprExpect(struct exprParser *parser, const char *token)
+{
+    if (!exprAccept(parser, token)) {
+        char message[32];
+        
+        snprintf(message, sizeof(message), "expected '%s'", token);
+        exprError(parser, message);
+    }
+}
+
+static int exprIdentifier(struct exprParser *parser, char *name, size_t nameSize)
+{
+    size_t len = 0;
+    
+    exprSkip(parser);
+    
+    if (!isalpha((unsigned char)*parser->pos) && *parser->pos != '_') {
+        return 0;
+    }
+    
+    while (isalnum((unsigned char)parser->pos[len]) || parser->pos[len] == '_') {
+        len++;
+    }
+    
+    if (len >= nameSize) {
+        exprError(parser, "name too long");
+        return 0;
+    }
+    
+    memcpy(name, parser->pos, len);
+    name[len] = '\0';
+    parser->pos += len;
+    
+    return 1;
+}
+
+static int exprConstant(struct exprParser *parser, double value)
+{
+    struct exprProgram *prog = parser->prog;
+    
+    for (size_t i = 0; i < prog->numConsts; i++) {
+        if (memcmp(&prog->consts[i], &value, sizeof(value)) == 0) {
+            return (int)i;
+        }
+    }
+    
+    if (prog->numConsts == EXPR_MAX_CONSTS) {
+        exprError(parser, "too many constants");
+        return 0;
+    }
+    
+    prog->consts[prog->numConsts] = value;
+    
+    return (int)prog->numConsts++;
+}
+
+// Appends an op taking arity values and leaving one, or none for a store. When every operand is a constant
+// the op runs right away and the whole run collapses into the constant it produced
+static void exprEmit(struct exprParser *parser, uint8_t code, int arg, int arity)
+{
+    struct exprProgram *prog = parser->prog;
+    
+    if (parser->failed) {
+        return;
+    }
+    
+    if (prog->numOps == EXPR_MAX_CODE) {
+        exprError(parser, "expression too long");
+        return;
+    }
+    
+    prog->code[prog->numOps].code = code;
+    prog->code[prog->numOps].arg = (uint8_t)arg;
+    prog->numOps++;
+    
+    if (code == OP_STORE) {
+        parser->depth--;
+        return;
+    }
+    
+    parser->depth = parser->depth - (size_t)arity + 1;
+    
+    if (parser->depth > EXPR_MAX_STACK) {
+        exprError(parser, "expression nests too deeply");
+        return;
+    }
+    
+    if (parser->depth > prog->maxStack) {
+        prog->maxStack = parser->depth;
+    }
+    
+    if (code == OP_CONST || code == OP_LOAD || prog->numOps < (size_t)arity + 1) {
+        return;
+    }
+    
+    struct exprOp *run = &prog->code[prog->numOps - arity - 1];
+    double stack[3];
+    
+    for (int i = 0; i < arity; i++) {
+        if (run[i].code != OP_CONST) {
+            return;
+        }
+    }
+    
+    exprExecute(run, (size_t)arity + 1, prog->consts, NULL, stack);
+    prog->numOps -= (size_t)arity + 1;
+    run->code = OP_CONST;
+    run->arg = (uint8_t)exprConstant(parser, stack[0]);
+    prog->numOps++;
+}
+
+static int exprLookupVar(struct exprProgram *prog, const char *name)
+{
+    for (size_t i = 0; i < prog->numVars; i++) {
+        if (strcmp(prog->names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    
+    return -1;
+}
+
+static void exprParseExpression(struct exprParser *parser);
+
+static void exprParsePrimary(struct exprParser *parser)
+{
+    char name[sizeof(parser->prog->names[0])];
+    
+    exprSkip(parser);
+    
+    if (isdigit((unsigned char)*parser->pos) || *parser->pos == '.') {
+        char *end;
+        double value = strtod(parser->pos, &end);
+        
+        parser->pos = end;
+        exprEmit(parser, OP_CONST, exprConstant(parser, value), 0);
+        return;
+    }
+    
+    if (exprAccept(parser, "(")) {
+        exprParseExpression(parser);
+        exprExpect(parser, ")");
+        return;
+    }
+    
+    if (!exprIdentifier(parser, name, sizeof(name))) {
+        exprError(parser, "expected a number, name or '('");
+        return;
+    }
+    
+    if (exprAccept(parser, "(")) {
+        for (int i = 0; exprFunctions[i].name; i++) {
+            if (strcmp(exprFunctions[i].name, name) == 0) {
+                for (int arg = 0; arg < exprFunctions[i].arity; arg++) {
+                    if (arg) {
+                        exprExpect(parser, ",");
+                    }
+                    exprParseExpression(parser);
+                }
+                exprExpect(parser, ")");
+                exprEmit(parser, exprFunctions[i].code, 0, exprFunctions[i].arity);
+                return;
+            }
+        }
+        
+        exprError(parser, "unknown function");
+        return;
+    }
+    
+    int var = exprLookupVar(parser->prog, name);
+    
+    if (var >= 0) {
+        exprEmit(parser, OP_LOAD, var, 0);
+        return;
+    }
+    
+    if (strcmp(name, "pi") == 0) {
+        exprEmit(parser, OP_CONST, exprConstant(parser, M_PI), 0);
+        return;
+    }
+    
+    const struct deviceProfile *profile = parser->prog->profile;
+    
+    for (int i = 0; i < profile->numZones; i++) {
+        if (strcmp(profile->zones[i].name, name) == 0) {
+            exprEmit(parser, OP_CONST, exprConstant(parser, i), 0);
+            return;
+        }
+    }
+    
+    exprError(parser, "unknown name");
+}
+
+static void exprParseUnary(struct exprParser *parser)
+{
+    if (exprAccept(parser, "-")) {
+        exprParseUnary(parser);
+        exprEmit(parser, OP_NEG, 0, 1);
+    } else if (exprAccept(parser, "!")) {
+        exprParseUnary(parser);
+        exprEmit(parser, OP_NOT, 0, 1);
+    } else if (exprAccept(parser, "+")) {
+        exprParseUnary(parser);
+    } else {
+        exprParsePrimary(parser);
+        
+        // Right associative and tighter than a leading minus on its right, 2^-1 works
+        if (exprAccept(parser, "^")) {
+            exprParseUnary(parser);
+            exprEmit(parser, OP_POW, 0, 2);
+        }
+    }
+}
+
+static void exprParseProduct(struct exprParser *parser)
+{
+    exprParseUnary(parser);
+    
+    while (!parser->failed) {
+        if (exprAccept(parser, "*")) {
+            exprParseUnary(parser);
+            exprEmit(parser, OP_MUL, 0, 2);
+        } else if (exprAccept(parser, "/")) {
+            exprParseUnary(parser);
+            exprEmit(parser, OP_DIV, 0, 2);
+        } else if (exprAccept(parser, "%")) {
+            exprParseUnary(parser);
+            exprEmit(parser, OP_MOD, 0, 2);
+        } else {
+            return;
+        }
+    }
+}
+
+static void exprParseSum(struct exprParser *parser)
+{
+    exprParseProduct(parser);
+    
+    while (!parser->failed) {
+        if (exprAccept(parser, "+")) {
+            exprParseProduct(parser);
+            exprEmit(parser, OP_ADD, 0, 2);
+        } else if (exprAccept(parser, "-")) {
+            exprParseProduct(parser);
+            exprEmit(parser, OP_SUB, 0, 2);
+        } else {
+            return;
+        }
+    }
+}
+
+static void exprParseComparison(struct exprParser *parser)
+{
+    static const struct {
+        const char *token;
+        uint8_t code;
+    } comparisons[] = {
+        { "<=", OP_LE }, { ">=", OP_GE }, { "==", OP_EQ }, { "!=", OP_NE }, { "<", OP_LT }, { ">", OP_GT }, { NULL, 0 }
+    };
+    
+    exprParseSum(parser);
+    
+    for (int i = 0; comparisons[i].token; i++) {
+        if (exprAccept(parser, comparisons[i].token)) {
+            exprParseSum(parser);
+            exprEmit(parser, comparisons[i].code, 0, 2);
+            return;
+        }
+    }
+}
+
+// Both sides are always evaluated, nothing in the language has side effects
+static void exprParseLogical(struct exprParser *parser)
+{
+    exprParseComparison(parser);
+    
+    while (!parser->failed) {
+        if (exprAccept(parser, "&&")) {
+            exprParseComparison(parser);
+            exprEmit(parser, OP_AND, 0, 2);
+        } else if (exprAccept(parser, "||")) {
+            exprParseComparison(parser);
+            exprEmit(parser, OP_OR, 0, 2);
+        } else {
+            return;
+        }
+    }
+}
+
+static void exprParseExpression(struct exprParser *parser)
+{
+    exprParseLogical(parser);
+    
+    if (exprAccept(parser, "?")) {
+        exprParseExpression(parser);
+        exprExpect(parser, ":");
+        exprParseExpression(parser);
+        exprEmit(parser, OP_SELECT, 0, 3);
+    }
+}
+
+// name = expression, a new name gets the next free variable
+static void exprParseStatement(struct exprParser *parser)
+{
+    struct exprProgram *prog = parser->prog;
+    char name[sizeof(prog->names[0])];
+    
+    if (!exprIdentifier(parser, name, sizeof(name))) {
+        exprError(parser, "expected an assignment");
+        return;
+    }
+    
+    int var = exprLookupVar(prog, name);
+    
+    if (var == EXPR_VAR_T || var == EXPR_VAR_Z) {
+        exprError(parser, "t and z are read only");
+        return;
+    }
+    
+    exprExpect(parser, "=");
+    exprParseExpression(parser);
+    
+    if (parser->failed) {
+        return;
+    }
+    
+    // Declared after the right hand side so "x = x + 1" on a new name is caught
+    if (var < 0) {
+        if (prog->numVars == EXPR_MAX_VARS) {
+            exprError(parser, "too many variables");
+            return;
+        }
+        var = (int)prog->numVars;
+        snprintf(prog->names[prog->numVars++], sizeof(prog->names[0]), "%s", name);
+    }
+    
+    exprEmit(parser, OP_STORE, var, 1);
+}
+
+// Statements separated by ';' or newlines, '#' comments to the end of the line
+int exprCompile(const char *source, const struct deviceProfile *profile, struct exprProgram *prog)
+{
+    static const char *fixed[EXPR_VAR_FIXED] = { "t", "z", "r", "g", "b", "l" };
+    struct exprParser parser = { source, source, prog, 0, 0 };
+    
+    memset(prog, 0, sizeof(*prog));
+    prog->profile = profile;
+    
+    for (int i = 0; i < EXPR_VAR_FIXED; i++) {
+        snprintf(prog->names[prog->numVars++], sizeof(prog->names[0]), "%s", fixed[i]);
+    }
+    
+    while (!parser.failed) {
+        exprSkip(&parser);
+        
+        if (*parser.pos == '\0') {
+            break;
+        }
+        
+        if (*parser.pos == ';' || *parser.pos == '\n') {
+            parser.pos++;
+            continue;
+        }
+        
+        exprParseStatement(&parser);
+        exprSkip(&parser);
+        
+        if (!parser.failed && *parser.pos && *parser.pos != ';' && *parser.pos != '\n') {
+            exprError(&parser, "expected the end of the statement");
+        }
+    }
+    
+    if (!parser.failed && prog->numOps == 0) {
+        exprError(&parser, "nothing is assigned");
+    }
+    
+    return parser.failed ? -1 : 0;
+}
+
+// The program itself, or @path to read it from a file
+int exprLoad(const char *arg, const struct deviceProfile *profile, struct exprProgram *prog)
+{
+    if (arg[0] != '@') {
+        return exprCompile(arg, profile, prog);
+    }
+    
+    FILE *fp = fopen(arg + 1, "r");
+    
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", arg + 1);
+        return -1;
+    }
+    
+    char source[EXPR_MAX_CODE * 16];
+    size_t len = fread(source, 1, sizeof(source) - 1, fp);
+    
+    fclose(fp);
+    
+    if (len == sizeof(source) - 1) {
+        fprintf(stderr, "%s is too long for an expression\n", arg + 1);
+        return -1;
+    }
+    source[len] = '\0';
+    
+    return exprCompile(source, profile, prog);
+}
+
+static uint8_t exprByte(double value)
+{
+    if (!(value > 0.0)) {
+        return 0;
+    }
+    
+    return value >= 255.0 ? 255 : (uint8_t)(value + 0.5);
+}
+
+// Runs the program once per zone of the profile with t and z set and writes what it left in r,g,b or l
+void exprRender(const struct exprProgram *prog, double t, uint8_t *report, size_t reportLen)
+{
+    const struct deviceProfile *profile = prog->profile;
+    double vars[EXPR_MAX_VARS];
+    double stack[EXPR_MAX_STACK];
+    
+    for (int z = 0; z < profile->numZones; z++) {
+        const struct deviceZone *zone = &profile->zones[z];
+        uint8_t values[3];
+        
+        memset(vars, 0, sizeof(double) * prog->numVars);
+        vars[EXPR_VAR_T] = t;
+        vars[EXPR_VAR_Z] = z;
+        vars[EXPR_VAR_L] = NAN;
+        
+        exprExecute(prog->code, prog->numOps, prog->consts, vars, stack);
+        
+        if (zone->length == 1) {
+            double level = vars[EXPR_VAR_L];
+            
+            if (isnan(level)) {
+                level = fmax(vars[EXPR_VAR_R], fmax(vars[EXPR_VAR_G], vars[EXPR_VAR_B]));
+            }
+            values[0] = exprByte(level);
+        } else {
+            for (int c = 0; c < 3; c++) {
+                values[c] = exprByte(vars[EXPR_VAR_R + c]);
+            }
+        }
+        
+        if (zone->length <= 3) {
+            deviceProfileEncodeZone(zone, values, report, reportLen);
+        }
+    }
+}
+
+void exprDisassemble(const struct exprProgram *prog, FILE *fp)
+{
+    fprintf(fp, "expr: %zu ops, %zu constants, %zu variables, stack %zu\n", prog->numOps, prog->numConsts, prog->numVars, prog->maxStack);
+    
+    for (size_t i = 0; i < prog->numOps; i++) {
+        const struct exprOp *op = &prog->code[i];
+        
+        if (op->code == OP_CONST) {
+            fprintf(fp, "%4zu %-7s %g\n", i, exprOpNames[op->code], prog->consts[op->arg]);
+        } else if (op->code == OP_LOAD || op->code == OP_STORE) {
+            fprintf(fp, "%4zu %-7s %s\n", i, exprOpNames[op->code], prog->names[op->arg]);
+        } else {
+            fprintf(fp, "%4zu %s\n", i, exprOpNames[op->code]);
+        }
+    }
+}
+
+// What the benchmark program compiles to, written out by hand
+static void exprBaseline(double t, uint8_t *report)
+{
+    double phase = t * 2;
+    
+    report[0] = exprByte(255 * (1.0 - fabs(2.0 * (t / 4 - floor(t / 4)) - 1.0)));
+    report[1] = exprByte(128 + 127 * sin(phase));
+    report[2] = exprByte(128 + 127 * sin(phase + 2 * M_PI / 3));
+    report[3] = exprByte(128 + 127 * sin(phase + 4 * M_PI / 3));
+}
+
+// Compile cost, then the same rainbow evaluated for every zone by the interpreter and by plain C
+int exprBenchmark(struct benchOptions *opts)
+{
+    static const char *source =
+        "# rainbow on the keys, WASD pulsing\n"
+        "phase = t * 2\n"
+        "r = 128 + 127 * sin(phase); g = 128 + 127 * sin(phase + 2 * pi / 3); b = 128 + 127 * sin(phase + 4 * pi / 3)\n"
+        "l = 255 * tri(t / 4)\n";
+    static struct exprProgram prog;
+    uint64_t ops = (uint64_t)opts->iterations * 100;
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    uint8_t expected[KEYCOLOR_REPORT_SIZE];
+    uint64_t mismatches = 0;
+    unsigned sink = 0;
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        if (exprCompile(source, &deviceProfiles[0], &prog)) {
+            return -1;
+        }
+    }
+    
+    benchReportThroughput("compile", ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    
+    if (opts->verbose) {
+        exprDisassemble(&prog, benchNotes());
+    }
+    
+    ops = (uint64_t)opts->iterations * 1000;
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        exprRender(&prog, i / 500.0, report, sizeof(report));
+        sink += report[1];
+    }
+    
+    benchReportThroughput("bytecode", ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        exprBaseline(i / 500.0, report);
+        sink += report[1];
+    }
+    
+    benchReportThroughput("baseline", ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    
+    for (uint64_t i = 0; i < ops; i += 97) {
+        exprRender(&prog, i / 500.0, report, sizeof(report));
+        exprBaseline(i / 500.0, expected);
+        mismatches += memcmp(report, expected, sizeof(report)) != 0;
+    }
+    
+    fprintf(benchNotes(), "# ops are frames covering all %d zones, %zu bytecode ops, %llu frames differ from the baseline, checksum %u\n",
+            deviceProfiles[0].numZones, prog.numOps, (unsigned long long)mismatches, sink);
+    
+    return mismatches ? -1 : 0;
+}
@@ -0,0 +1,79 @@
+//
+//  expr.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef expr_h
+#define expr_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "profiles.h"
+#include "bench.h"
+
+#define EXPR_MAX_CODE 512
+#define EXPR_MAX_CONSTS 128
+#define EXPR_MAX_VARS 32
+#define EXPR_MAX_STACK 32
+
+// Fixed slots, names the program assigns to on its own get the slots after these
+enum exprVar {
+    EXPR_VAR_T,                 // seconds since the effect started
+    EXPR_VAR_Z,                 // zone index, the zone names are constants holding theirs
+    EXPR_VAR_R,
+    EXPR_VAR_G,
+    EXPR_VAR_B,
+    EXPR_VAR_L,                 // level of single level zones, the brightest of r,g,b if never set
+    EXPR_VAR_FIXED
+};
+
+struct exprOp {
+    uint8_t code;
+    uint8_t arg;                // constant or variable index
+};
+
+// Compiled once, everything evaluation touches lives in here so a frame never allocates
+struct exprProgram {
+    const struct deviceProfile *profile;
+    struct exprOp code[EXPR_MAX_CODE];
+    size_t numOps;
+    double consts[EXPR_MAX_CONSTS];
+    size_t numConsts;
+    char names[EXPR_MAX_VARS][16];
+    size_t numVars;
+    size_t maxStack;
+};
+
+int exprCompile(const char *source, const struct deviceProfile *profile, struct exprProgram *prog);
+int exprLoad(const char *arg, const struct deviceProfile *profile, struct exprProgram *prog);
+void exprRender(const struct exprProgram *prog, double t, uint8_t *report, size_t reportLen);
+void exprDisassemble(const struct exprProgram *prog, FILE *fp);
+int exprBenchmark(struct benchOptions *opts);
+
+#endif /* expr_h */
@@ -0,0 +1,409 @@
+//
+//  framebuffer.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "framebuffer.h"
+#include "transport.h"
+#include "timeutil.h"
+
+// Full size board with 64 byte reports, a stand-in until real per-key boards get profiles of their own
+const struct framebufferLayout framebufferSampleLayout = {
+    "sample104", 104, 64, 4, { 0x12, 0xff, 0x0c, 0x3e }, 18
+};
+
+struct framebuffer *framebufferCreate(const struct framebufferLayout *layout)
+{
+    struct framebuffer *fb = calloc(1, sizeof(struct framebuffer));
+    
+    if (layout->reportSize > TRANSPORT_MAX_REPORT_SIZE || layout->headerSize > FRAMEBUFFER_MAX_HEADER ||
+        layout->reportSize < layout->headerSize + FRAMEBUFFER_RUN_HEADER + 3) {
+        fprintf(stderr, "Layout %s does not fit a key in a report\n", layout->name);
+        free(fb);
+        return NULL;
+    }
+    
+    if (fb) {
+        fb->layout = layout;
+        fb->maxReports = framebufferFullReports(layout);
+        fb->colors = calloc(layout->numKeys ? layout->numKeys : 1, 3);
+        fb->shown = calloc(layout->numKeys ? layout->numKeys : 1, 3);
+        fb->reports = calloc(fb->maxReports ? fb->maxReports : 1, layout->reportSize);
+    }
+    
+    if (!fb || !fb->colors || !fb->shown || !fb->reports) {
+        fprintf(stderr, "Failed to allocate framebuffer!\n");
+        framebufferFree(fb);
+        return NULL;
+    }
+    
+    return fb;
+}
+
+void framebufferFree(struct framebuffer *fb)
+{
+    if (!fb) {
+        return;
+    }
+    
+    free(fb->colors);
+    free(fb->shown);
+    free(fb->reports);
+    free(fb);
+}
+
+void framebufferSetKey(struct framebuffer *fb, int key, uint8_t red, uint8_t green, uint8_t blue)
+{
+    if (key < 0 || key >= fb->layout->numKeys) {
+        return;
+    }
+    
+    fb->colors[key * 3] = red;
+    fb->colors[key * 3 + 1] = green;
+    fb->colors[key * 3 + 2] = blue;
+}
+
+void framebufferFill(struct framebuffer *fb, uint8_t red, uint8_t green, uint8_t blue)
+{
+    for (int key = 0; key < fb->layout->numKeys; key++) {
+        framebufferSetKey(fb, key, red, green, blue);
+    }
+}
+
+// The board's state is unknown, the next frame goes out whole
+void framebufferInvalidate(struct framebuffer *fb)
+{
+    fb->valid = 0;
+}
+
+// One run per report, as many keys as fit after the prefix and run header
+size_t framebufferFullReports(const struct framebufferLayout *layout)
+{
+    size_t perReport = (size_t)(layout->reportSize - layout->headerSize - FRAMEBUFFER_RUN_HEADER) / 3;
+    
+    return ((size_t)layout->numKeys + perReport - 1) / perReport;
+}
+
+// Packs count keys from start into the chunks, splitting the run where a report fills. -1 once it would
+// take more than limit reports
+static int framebufferEmit(struct framebuffer *fb, size_t *numReports, size_t *pos, int start, int count, size_t limit, uint64_t *payload)
+{
+    const struct framebufferLayout *layout = fb->layout;
+    
+    while (count > 0) {
+        if (*numReports == 0 || layout->reportSize - *pos < FRAMEBUFFER_RUN_HEADER + 3) {
+            if (*numReports == limit) {
+                return -1;
+            }
+            
+            uint8_t *report = fb->reports + *numReports * layout->reportSize;
+            
+            memset(report, 0, layout->reportSize);
+            memcpy(report, layout->header, layout->headerSize);
+            (*numReports)++;
+            *pos = layout->headerSize;
+        }
+        
+        uint8_t *cp = fb->reports + (*numReports - 1) * layout->reportSize + *pos;
+        int take = (int)((layout->reportSize - *pos - FRAMEBUFFER_RUN_HEADER) / 3);
+        
+        if (take > count) {
+            take = count;
+        }
+        
+        cp[0] = (uint8_t)start;
+        cp[1] = (uint8_t)(start >> 8);
+        cp[2] = (uint8_t)take;
+        memcpy(cp + FRAMEBUFFER_RUN_HEADER, fb->colors + start * 3, (size_t)take * 3);
+        
+        *pos += FRAMEBUFFER_RUN_HEADER + (size_t)take * 3;
+        *payload += FRAMEBUFFER_RUN_HEADER + (uint64_t)take * 3;
+        start += take;
+        count -= take;
+    }
+    
+    return 0;
+}
+
+// Fills fb->reports with the chunks that bring the board from shown to colors and returns how many. Changed
+// keys go out as runs, with clean gaps of a key merged in because skipping one costs as much as a run header.
+// Whenever that needs as many reports as the whole board, the whole board goes instead
+size_t framebufferEncode(struct framebuffer *fb, struct framebufferStats *stats)
+{
+    const struct framebufferLayout *layout = fb->layout;
+    size_t numReports = 0, pos = 0;
+    uint64_t payload = 0, dirty = 0;
+    int full = !fb->valid;
+    
+    if (!full) {
+        int runStart = -1, runEnd = -1;
+        
+        for (int key = 0; key < layout->numKeys && !full; key++) {
+            if (memcmp(fb->colors + key * 3, fb->shown + key * 3, 3) == 0) {
+                continue;
+            }
+            
+            dirty++;
+            
+            if (runStart >= 0 && (key - runEnd) * 3 <= FRAMEBUFFER_RUN_HEADER) {
+                runEnd = key + 1;
+                continue;
+            }
+            
+            if (runStart >= 0 && framebufferEmit(fb, &numReports, &pos, runStart, runEnd - runStart, fb->maxReports - 1, &payload)) {
+                full = 1;
+            }
+            
+            runStart = key;
+            runEnd = key + 1;
+        }
+        
+        if (!full && runStart >= 0 && framebufferEmit(fb, &numReports, &pos, runStart, runEnd - runStart, fb->maxReports - 1, &payload)) {
+            full = 1;
+        }
+    }
+    
+    if (full) {
+        numReports = 0;
+        pos = 0;
+        payload = 0;
+        framebufferEmit(fb, &numReports, &pos, 0, layout->numKeys, fb->maxReports, &payload);
+        stats->fullRefreshes++;
+        
+        if (!fb->valid) {
+            dirty = layout->numKeys;
+        } else {
+            // Counting stopped at the fallback, finish it for the stats
+            dirty = 0;
+            
+            for (int key = 0; key < layout->numKeys; key++) {
+                dirty += memcmp(fb->colors + key * 3, fb->shown + key * 3, 3) != 0;
+            }
+        }
+    }
+    
+    memcpy(fb->shown, fb->colors, (size_t)layout->numKeys * 3);
+    fb->valid = 1;
+    
+    stats->frames++;
+    stats->reports += numReports;
+    stats->dirtyKeys += dirty;
+    stats->payloadBytes += payload;
+    
+    return numReports;
+}
+
+// Encodes and sends the frame to every target, a failure anywhere makes the next frame a full refresh.
+// Chunks go straight to each target in order, the writer pool and async window are latest-wins and
+// would let one chunk of a frame replace another
+int framebufferWrite(struct framebuffer *fb, struct keyColorTarget *targets, size_t numTargets, struct framebufferStats *stats)
+{
+    size_t numReports = framebufferEncode(fb, stats);
+    int numFailed = 0;
+    
+    for (size_t t = 0; t < numTargets; t++) {
+        for (size_t i = 0; i < numReports; i++) {
+            if (transportWriteTarget(&targets[t], fb->reports + i * fb->layout->reportSize, fb->layout->reportSize)) {
+                numFailed++;
+                break;
+            }
+        }
+    }
+    
+    if (numFailed) {
+        framebufferInvalidate(fb);
+        stats->writeFailures += (uint64_t)numFailed;
+    }
+    
+    return numFailed;
+}
+
+void framebufferPrintStats(const struct framebuffer *fb, const struct framebufferStats *stats, FILE *fp)
+{
+    double frames = stats->frames ? (double)stats->frames : 1.0;
+    
+    fprintf(fp, "%s frames=%llu full=%llu failed=%llu reports/frame=%.2f of %zu keys/frame=%.1f bytes/frame=%.1f wire=%.1f\n",
+            fb->layout->name, (unsigned long long)stats->frames, (unsigned long long)stats->fullRefreshes,
+            (unsigned long long)stats->writeFailures, stats->reports / frames, fb->maxReports, stats->dirtyKeys / frames,
+            stats->payloadBytes / frames, (double)stats->reports * fb->layout->reportSize / frames);
+}
+
+// Applies chunks to colors the way a board would, -1 on a malformed one
+static int framebufferDecode(const struct framebufferLayout *layout, const uint8_t *reports, size_t numReports, uint8_t *colors)
+{
+    for (size_t i = 0; i < numReports; i++) {
+        const uint8_t *report = reports + i * layout->reportSize;
+        size_t pos = layout->headerSize;
+        
+        if (memcmp(report, layout->header, layout->headerSize) != 0) {
+            return -1;
+        }
+        
+        while (pos + FRAMEBUFFER_RUN_HEADER <= layout->reportSize && report[pos + 2]) {
+            int start = report[pos] | report[pos + 1] << 8;
+            int count = report[pos + 2];
+            
+            if (start + count > layout->numKeys || pos + FRAMEBUFFER_RUN_HEADER + (size_t)count * 3 > layout->reportSize) {
+                return -1;
+            }
+            
+            memcpy(colors + start * 3, report + pos + FRAMEBUFFER_RUN_HEADER, (size_t)count * 3);
+            pos += FRAMEBUFFER_RUN_HEADER + (size_t)count * 3;
+        }
+    }
+    
+    return 0;
+}
+
+static uint8_t framebufferLevel(double value)
+{
+    return value <= 0 ? 0 : value >= 1 ? 255 : (uint8_t)(value * 255.0 + 0.5);
+}
+
+// Keypresses every few frames, each a ring spreading from the key and fading out
+static void framebufferRipple(struct framebuffer *fb, uint64_t frame)
+{
+    const struct framebufferLayout *layout = fb->layout;
+    const int life = 16, every = 10;
+    
+    framebufferFill(fb, 0, 0, 0);
+    
+    for (uint64_t press = frame >= (uint64_t)life ? (frame - (uint64_t)life) / every + 1 : 0; press * every <= frame; press++) {
+        uint64_t seed = press * 0x9e3779b97f4a7c15ull;
+        int center = (int)((seed >> 33) % layout->numKeys);
+        double age = (double)(frame - press * every);
+        double radius = age * 0.3;
+        double fade = 1.0 - age / life;
+        
+        for (int key = 0; key < layout->numKeys; key++) {
+            double dx = key % layout->columns - center % layout->columns;
+            double dy = key / layout->columns - center / layout->columns;
+            double ring = 1.0 - fabs(sqrt(dx * dx + dy * dy) - radius);
+            
+            if (ring > 0 && fade > 0) {
+                uint8_t level = framebufferLevel(ring * fade);
+                uint8_t *cp = fb->colors + key * 3;
+                
+                cp[0] = level > cp[0] ? level : cp[0];
+                cp[2] = level / 2 > cp[2] ? level / 2 : cp[2];
+            }
+        }
+    }
+}
+
+// A rainbow across the board scrolling sideways, every key changes every frame
+static void framebufferGradient(struct framebuffer *fb, uint64_t frame)
+{
+    const struct framebufferLayout *layout = fb->layout;
+    
+    for (int key = 0; key < layout->numKeys; key++) {
+        double hue = fmod((double)(key % layout->columns) / layout->columns + frame / 120.0, 1.0) * 6.0;
+        double f = hue - floor(hue);
+        double rgb[6][3] = { { 1, f, 0 }, { 1 - f, 1, 0 }, { 0, 1, f }, { 0, 1 - f, 1 }, { f, 0, 1 }, { 1, 0, 1 - f } };
+        int sector = (int)hue % 6;
+        
+        framebufferSetKey(fb, key, framebufferLevel(rgb[sector][0]), framebufferLevel(rgb[sector][1]), framebufferLevel(rgb[sector][2]));
+    }
+}
+
+// Reports and bytes per frame for a typing ripple and a full board gradient, dirty runs against sending the
+// whole board every frame. Every frame is decoded back and checked against what was drawn
+int framebufferBenchmark(struct benchOptions *opts)
+{
+    static const struct {
+        const char *name;
+        void (*draw)(struct framebuffer *fb, uint64_t frame);
+    } workloads[] = {
+        { "ripple", framebufferRipple },
+        { "gradient", framebufferGradient },
+    };
+    const struct framebufferLayout *layout = &framebufferSampleLayout;
+    uint64_t numFrames = (uint64_t)opts->iterations * 10;
+    uint8_t *decoded = calloc(layout->numKeys, 3);
+    int ret = 0;
+    
+    if (!decoded) {
+        return -1;
+    }
+    
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        for (int naive = 0; naive <= 1; naive++) {
+            struct framebuffer *fb = framebufferCreate(layout);
+            struct framebufferStats stats;
+            uint64_t mismatches = 0, elapsed = 0;
+            char label[32];
+            
+            if (!fb) {
+                free(decoded);
+                return -1;
+            }
+            
+            memset(&stats, 0, sizeof(stats));
+            memset(decoded, 0, (size_t)layout->numKeys * 3);
+            
+            uint64_t allocs = benchAllocations();
+            
+            for (uint64_t frame = 0; frame < numFrames; frame++) {
+                workloads[w].draw(fb, frame);
+                
+                if (naive) {
+                    framebufferInvalidate(fb);
+                }
+                
+                uint64_t startTime = monotonicNanos();
+                size_t numReports = framebufferEncode(fb, &stats);
+                
+                elapsed += monotonicNanos() - startTime;
+                
+                if (framebufferDecode(layout, fb->reports, numReports, decoded) || memcmp(decoded, fb->colors, (size_t)layout->numKeys * 3) != 0) {
+                    mismatches++;
+                }
+            }
+            
+            snprintf(label, sizeof(label), "%s/%s", workloads[w].name, naive ? "full" : "dirty");
+            benchReportThroughput(label, numFrames, elapsed, benchAllocations() - allocs, stats.reports * layout->reportSize);
+            fprintf(benchNotes(), "# %s reports/frame=%.2f bytes/frame=%.1f keys/frame=%.1f full=%llu/%llu mismatches=%llu\n", label,
+                    (double)stats.reports / numFrames, (double)stats.reports * layout->reportSize / numFrames,
+                    (double)stats.dirtyKeys / numFrames, (unsigned long long)stats.fullRefreshes,
+                    (unsigned long long)numFrames, (unsigned long long)mismatches);
+            
+            if (mismatches) {
+                ret = -1;
+            }
+            
+            framebufferFree(fb);
+        }
+    }
+    
+    free(decoded);
+    
+    return ret;
+}
@@ -0,0 +1,84 @@
+//
+//  framebuffer.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef framebuffer_h
+#define framebuffer_h
+
+#include <stdio.h>
+#include "keycolor.h"
+#include "bench.h"
+
+// Every run in a chunk starts with the first key, little endian, and a key count, then r,g,b per key
+#define FRAMEBUFFER_RUN_HEADER 3
+#define FRAMEBUFFER_MAX_HEADER 8
+
+// How a per-key board takes its colors, a fixed size report split into a fixed prefix and then runs.
+// A run count of 0 ends the report early
+struct framebufferLayout {
+    const char *name;
+    uint16_t numKeys;
+    uint8_t reportSize;         // bytes per chunk report, at most TRANSPORT_MAX_REPORT_SIZE
+    uint8_t headerSize;
+    uint8_t header[FRAMEBUFFER_MAX_HEADER];
+    uint8_t columns;            // keys per row, for effects that need a position
+};
+
+struct framebuffer {
+    const struct framebufferLayout *layout;
+    uint8_t *colors;            // numKeys r,g,b, what the next frame should show
+    uint8_t *shown;             // what the board was last sent
+    int valid;                  // shown matches the board, cleared after a failed write
+    size_t maxReports;          // a full refresh, dirty encodings never need more
+    uint8_t *reports;           // maxReports chunks of layout->reportSize
+};
+
+struct framebufferStats {
+    uint64_t frames;
+    uint64_t reports;
+    uint64_t fullRefreshes;     // frames sent whole because that took no more reports than the dirty runs
+    uint64_t dirtyKeys;
+    uint64_t payloadBytes;      // run headers and colors, without prefix or padding
+    uint64_t writeFailures;
+};
+
+extern const struct framebufferLayout framebufferSampleLayout;
+
+struct framebuffer *framebufferCreate(const struct framebufferLayout *layout);
+void framebufferFree(struct framebuffer *fb);
+void framebufferSetKey(struct framebuffer *fb, int key, uint8_t red, uint8_t green, uint8_t blue);
+void framebufferFill(struct framebuffer *fb, uint8_t red, uint8_t green, uint8_t blue);
+void framebufferInvalidate(struct framebuffer *fb);
+size_t framebufferFullReports(const struct framebufferLayout *layout);
+size_t framebufferEncode(struct framebuffer *fb, struct framebufferStats *stats);
+int framebufferWrite(struct framebuffer *fb, struct keyColorTarget *targets, size_t numTargets, struct framebufferStats *stats);
+void framebufferPrintStats(const struct framebuffer *fb, const struct framebufferStats *stats, FILE *fp);
+int framebufferBenchmark(struct benchOptions *opts);
+
+#endif /* framebuffer_h */
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+#  gencolortables.py
+#  logitech_keycolor
+#
+#  Author: Karl Bunch <karlbunch@karlbunch.com>
+#
+#  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+#
+#  The MIT License (MIT), see main.c
+#
+#  Writes colortables.h, the lookup tables behind color.c. Run it after
+#  changing anything below and commit both files:
+#
+#      python3 gencolortables.py > colortables.h
+#
+
+import math
+import sys
+
+LINEAR_MAX = 65535          # linear light is 16 bit fixed point
+ENCODE_BITS = 13            # linear >> 3 indexes the encode table, enough for an exact byte round trip
+KELVIN_MIN = 1700
+KELVIN_MAX = 12000
+KELVIN_STEP = 100
+
+# Per board calibration, one entry per report byte naming the channel it drives.
+# gains are relative LED output (white balance), response is how the board
+# maps a report byte to light. Values here are defaults, not measurements:
+# put measured numbers in and regenerate.
+CALIBRATIONS = [
+    {
+        'name': 'colorCalibrationG710',
+        'board': 'Logitech G710+',
+        'channels': ['white', 'red', 'green', 'blue'],
+        'gains': {'white': 1.0, 'red': 1.0, 'green': 1.0, 'blue': 1.0},
+        'response': 'srgb',
+    },
+]
+
+
+def srgb_decode(v):
+    return v / 12.92 if v <= 0.04045 else ((v + 0.055) / 1.055) ** 2.4
+
+
+def srgb_encode(v):
+    return v * 12.92 if v <= 0.0031308 else 1.055 * v ** (1 / 2.4) - 0.055
+
+
+RESPONSES = {
+    'srgb': srgb_encode,
+    'linear': lambda v: v,
+    'gamma22': lambda v: v ** (1 / 2.2),
+}
+
+
+def planckian_xy(t):
+    # Kim et al. cubic spline fit of the Planckian locus, valid 1667K-25000K
+    if t <= 4000:
+        x = -0.2661239e9 / t**3 - 0.2343589e6 / t**2 + 0.8776956e3 / t + 0.179910
+    else:
+        x = -3.0258469e9 / t**3 + 2.1070379e6 / t**2 + 0.2226347e3 / t + 0.240390
+    if t <= 2222:
+        y = -1.1063814 * x**3 - 1.34811020 * x**2 + 2.18555832 * x - 0.20219683
+    elif t <= 4000:
+        y = -0.9549476 * x**3 - 1.37418593 * x**2 + 2.09137015 * x - 0.16748867
+    else:
+        y = 3.0817580 * x**3 - 5.87338670 * x**2 + 3.75112997 * x - 0.37001483
+    return x, y
+
+
+def kelvin_linear_rgb(t):
+    x, y = planckian_xy(t)
+    X, Y, Z = x / y, 1.0, (1 - x - y) / y
+    rgb = [
+        3.2404542 * X - 1.5371385 * Y - 0.4985314 * Z,
+        -0.9692660 * X + 1.8760108 * Y + 0.0415560 * Z,
+        0.0556434 * X - 0.2040259 * Y + 1.0572252 * Z,
+    ]
+    rgb = [max(c, 0.0) for c in rgb]
+    peak = max(rgb)
+    return [c / peak for c in rgb]
+
+
+def fixed(v):
+    return max(0, min(LINEAR_MAX, int(round(v * LINEAR_MAX))))
+
+
+def emit_array(out, decl, values, per_line=16, fmt='%d'):
+    out.append(decl + ' = {')
+    for i in range(0, len(values), per_line):
+        out.append('    ' + ', '.join(fmt % v for v in values[i:i + per_line]) + ',')
+    out.append('};')
+    out.append('')
+
+
+def main():
+    encode_size = 1 << ENCODE_BITS
+    decode = [fixed(srgb_decode(i / 255.0)) for i in range(256)]
+    encode = [int(round(255 * srgb_encode(i / (encode_size - 1)))) for i in range(encode_size)]
+
+    # Plain -C r,g,b input must come back out as the same bytes
+    for i in range(256):
+        if encode[decode[i] >> (16 - ENCODE_BITS)] != i:
+            sys.exit('encode table does not round trip byte %d' % i)
+
+    kelvins = list(range(KELVIN_MIN, KELVIN_MAX + 1, KELVIN_STEP))
+    out = [
+        '//',
+        '//  colortables.h',
+        '//  logitech_keycolor',
+        '//',
+        '//  Generated by gencolortables.py, edit the script and rerun it instead of this file.',
+        '//  Included once, by color.c.',
+        '//',
+        '',
+        '#ifndef colortables_h',
+        '#define colortables_h',
+        '',
+        '#define COLOR_ENCODE_BITS %d' % ENCODE_BITS,
+        '#define COLOR_KELVIN_MIN %d' % KELVIN_MIN,
+        '#define COLOR_KELVIN_MAX %d' % KELVIN_MAX,
+        '#define COLOR_KELVIN_STEP %d' % KELVIN_STEP,
+        '',
+        '// sRGB byte to 16 bit linear light',
+    ]
+    emit_array(out, 'const uint16_t colorSrgbToLinearTable[256]', decode, 12)
+    out.append('// Linear light >> %d to sRGB byte' % (16 - ENCODE_BITS))
+    emit_array(out, 'const uint8_t colorLinearToSrgbTable[%d]' % encode_size, encode, 24)
+    out.append('// Planckian locus %dK-%dK in %dK steps, linear sRGB with the brightest channel at full' % (KELVIN_MIN, KELVIN_MAX, KELVIN_STEP))
+    out.append('const uint16_t colorKelvinTable[%d][3] = {' % len(kelvins))
+    for t in kelvins:
+        r, g, b = (fixed(c) for c in kelvin_linear_rgb(t))
+        out.append('    { %5d, %5d, %5d },   // %dK' % (r, g, b, t))
+    out.append('};')
+    out.append('')
+
+    for cal in CALIBRATIONS:
+        respond = RESPONSES[cal['response']]
+        rows = []
+        for channel in cal['channels']:
+            gain = cal['gains'][channel]
+            rows.append([int(round(255 * respond(min(1.0, srgb_decode(i / 255.0) * gain)))) for i in range(256)])
+        out.append('// %s, %s response, report byte to board byte' % (cal['board'], cal['response']))
+        out.append('const uint8_t %s[%d][256] = {' % (cal['name'], len(rows)))
+        for channel, row in zip(cal['channels'], rows):
+            out.append('    {   // %s' % channel)
+            for i in range(0, 256, 24):
+                out.append('        ' + ', '.join('%d' % v for v in row[i:i + 24]) + ',')
+            out.append('    },')
+        out.append('};')
+        out.append('')
+
+    out.append('#endif /* colortables_h */')
+    sys.stdout.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
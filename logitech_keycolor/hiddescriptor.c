@@ -0,0 +1,653 @@
+//
+//  hiddescriptor.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hiddescriptor.h"
+#include "dumpwriter.h"
+#include "dumpfilter.h"
+#include "bench.h"
+#include "timeutil.h"
+
+#define HID_MAX_USAGES 64
+#define HID_MAX_GLOBAL_STACK 4
+#define HID_MAX_COLLECTION_DEPTH 32
+
+// Item types and tags, HID 1.11 section 6.2.2
+#define HID_ITEM_TYPE_MAIN 0
+#define HID_ITEM_TYPE_GLOBAL 1
+#define HID_ITEM_TYPE_LOCAL 2
+#define HID_ITEM_LONG 0xfe
+
+// Keyboard plus a vendor collection carrying a 4 byte color feature report, laid out like the G710+
+const uint8_t hidSampleKeyboardDescriptor[] = {
+    0x05, 0x01, 0x09, 0x06, 0xa1, 0x01,             // Generic Desktop, Keyboard, Application
+    0x85, 0x01,                                     //   Report ID 1
+    0x05, 0x07, 0x19, 0xe0, 0x29, 0xe7,             //   Modifiers
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x01,             //   Reserved byte
+    0x05, 0x08, 0x19, 0x01, 0x29, 0x05,             //   LEDs
+    0x95, 0x05, 0x75, 0x01, 0x91, 0x02,
+    0x95, 0x01, 0x75, 0x03, 0x91, 0x01,             //   LED padding
+    0x05, 0x07, 0x19, 0x00, 0x2a, 0xff, 0x00,       //   Key array
+    0x15, 0x00, 0x26, 0xff, 0x00, 0x95, 0x06, 0x75, 0x08, 0x81, 0x00,
+    0xc0,
+    0x06, 0x00, 0xff, 0x09, 0x01, 0xa1, 0x01,       // Vendor, Application
+    0x85, 0x08, 0x09, 0x02,                         //   Report ID 8: wasd, r, g, b
+    0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0xb1, 0x02,
+    0xc0
+};
+const size_t hidSampleKeyboardDescriptorSize = sizeof(hidSampleKeyboardDescriptor);
+
+struct hidGlobalState {
+    uint16_t usagePage;
+    int32_t logicalMin;
+    int32_t logicalMax;
+    int32_t physicalMin;
+    int32_t physicalMax;
+    int8_t unitExponent;
+    uint32_t unit;
+    uint32_t reportSize;
+    uint32_t reportCount;
+    uint8_t reportId;
+};
+
+struct hidLocalState {
+    uint32_t usages[HID_MAX_USAGES];    // extended usages, page in the high 16 bits
+    int numUsages;
+    uint32_t usageMin;
+    uint32_t usageMax;
+    int haveUsageMin;
+    int haveUsageMax;
+};
+
+static struct hidElement *hidElementAppend(struct hidElementTable **tablep)
+{
+    struct hidElementTable *table = *tablep;
+    
+    // Rows refer to each other by index, so growing the arena never invalidates the table
+    if (table->numElements == table->capacity) {
+        size_t capacity = table->capacity * 2;
+        struct hidElementTable *grown = realloc(table, sizeof(struct hidElementTable) + capacity * sizeof(struct hidElement));
+        
+        if (!grown) {
+            return NULL;
+        }
+        grown->capacity = capacity;
+        *tablep = table = grown;
+    }
+    
+    struct hidElement *element = &table->elements[table->numElements];
+    
+    memset(element, 0, sizeof(*element));
+    element->cookie = (uint32_t)++table->numElements;
+    
+    return element;
+}
+
+static uint32_t itemUnsigned(const uint8_t *data, int size)
+{
+    uint32_t value = 0;
+    
+    for (int i = 0; i < size; i++) {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    
+    return value;
+}
+
+static int32_t itemSigned(const uint8_t *data, int size)
+{
+    uint32_t value = itemUnsigned(data, size);
+    
+    if (size == 1) {
+        return (int8_t)value;
+    } else if (size == 2) {
+        return (int16_t)value;
+    }
+    
+    return (int32_t)value;
+}
+
+// Extended usages carry their own page, short ones take the current global page
+static void splitUsage(uint32_t extended, uint16_t page, uint16_t *usagePage, uint32_t *usage)
+{
+    if (extended > 0xffff) {
+        *usagePage = (uint16_t)(extended >> 16);
+        *usage = extended & 0xffff;
+    } else {
+        *usagePage = page;
+        *usage = extended;
+    }
+}
+
+static void fillFromGlobals(struct hidElement *element, const struct hidGlobalState *global)
+{
+    element->usagePage = global->usagePage;
+    element->reportId = global->reportId;
+    element->logicalMin = global->logicalMin;
+    element->logicalMax = global->logicalMax;
+    element->physicalMin = global->physicalMin;
+    element->physicalMax = global->physicalMax;
+    element->unit = global->unit;
+    element->unitExponent = global->unitExponent;
+    element->reportSize = global->reportSize;
+}
+
+// Input, Output or Feature: one row per field for variables, one for a whole array or padding.
+// A count or size no real device uses fails the parse, so an odd descriptor can't grow the table without bound
+static int addValueElements(struct hidElementTable **tablep, enum hidElementType type, uint32_t flags,
+                            const struct hidGlobalState *global, const struct hidLocalState *local,
+                            int32_t parent, uint16_t depth, uint32_t *bitOffset)
+{
+    uint32_t count = global->reportCount;
+    int variable = (flags & HID_ITEM_VARIABLE) && !(flags & HID_ITEM_CONSTANT);
+    uint32_t numRows = variable ? count : 1;
+    
+    if (count > HID_MAX_REPORT_COUNT || global->reportSize > HID_MAX_REPORT_SIZE ||
+        (uint64_t)*bitOffset + (uint64_t)global->reportSize * count > UINT32_MAX) {
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < numRows; i++) {
+        struct hidElement *element = hidElementAppend(tablep);
+        uint32_t extended = 0;
+        
+        if (!element) {
+            return -1;
+        }
+        
+        fillFromGlobals(element, global);
+        element->type = (uint8_t)type;
+        element->flags = flags;
+        element->parent = parent;
+        element->depth = depth;
+        element->bitOffset = *bitOffset;
+        element->reportCount = variable ? 1 : count;
+        
+        if (local->haveUsageMin) {
+            extended = variable ? local->usageMin + i : local->usageMin;
+            
+            if (variable && local->haveUsageMax && extended > local->usageMax) {
+                extended = local->usageMax;
+            }
+        } else if (local->numUsages) {
+            extended = local->usages[i < (uint32_t)local->numUsages ? i : (uint32_t)local->numUsages - 1];
+        }
+        
+        splitUsage(extended, global->usagePage, &element->usagePage, &element->usage);
+        element->usageMax = element->usage;
+        
+        if (!variable && local->haveUsageMax) {
+            uint16_t page;
+            
+            splitUsage(local->usageMax, global->usagePage, &page, &element->usageMax);
+        } else if (!variable && local->numUsages > 1) {
+            uint16_t page;
+            
+            splitUsage(local->usages[local->numUsages - 1], global->usagePage, &page, &element->usageMax);
+        }
+        
+        *bitOffset += element->reportSize * element->reportCount;
+    }
+    
+    return 0;
+}
+
+struct hidElementTable *hidDescriptorParse(const uint8_t *desc, size_t descLen)
+{
+    struct hidElementTable *table = malloc(sizeof(struct hidElementTable) + 64 * sizeof(struct hidElement));
+    struct hidGlobalState global, globalStack[HID_MAX_GLOBAL_STACK];
+    struct hidLocalState local;
+    int32_t collections[HID_MAX_COLLECTION_DEPTH];
+    uint32_t bitOffsets[3][HID_MAX_REPORT_IDS];
+    int globalDepth = 0, depth = 0;
+    
+    if (!table) {
+        return NULL;
+    }
+    
+    table->numElements = 0;
+    table->capacity = 64;
+    table->usesReportIds = 0;
+    memset(&global, 0, sizeof(global));
+    memset(&local, 0, sizeof(local));
+    memset(bitOffsets, 0, sizeof(bitOffsets));
+    
+    for (size_t pos = 0; pos < descLen; ) {
+        uint8_t prefix = desc[pos];
+        
+        if (prefix == HID_ITEM_LONG) {
+            // Long items are reserved and never used in practice, skip the payload
+            if (pos + 2 >= descLen) {
+                break;
+            }
+            pos += 3 + desc[pos + 1];
+            continue;
+        }
+        
+        int size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+        int itemType = (prefix >> 2) & 0x03;
+        int tag = prefix >> 4;
+        const uint8_t *data = &desc[pos + 1];
+        
+        if (pos + 1 + size > descLen) {
+            break;
+        }
+        pos += 1 + size;
+        
+        uint32_t value = itemUnsigned(data, size);
+        
+        if (itemType == HID_ITEM_TYPE_MAIN) {
+            int32_t parent = depth ? collections[depth - 1] : -1;
+            
+            switch (tag) {
+                case 0x8:   // Input
+                case 0x9:   // Output
+                case 0xb: { // Feature
+                    enum hidElementType type = tag == 0x8 ? HID_ELEMENT_INPUT : tag == 0x9 ? HID_ELEMENT_OUTPUT : HID_ELEMENT_FEATURE;
+                    
+                    if (addValueElements(&table, type, value, &global, &local, parent, (uint16_t)depth, &bitOffsets[type][global.reportId])) {
+                        free(table);
+                        return NULL;
+                    }
+                    break;
+                }
+                case 0xa: { // Collection
+                    struct hidElement *element = hidElementAppend(&table);
+                    
+                    if (!element) {
+                        free(table);
+                        return NULL;
+                    }
+                    
+                    element->type = HID_ELEMENT_COLLECTION;
+                    element->collectionType = (uint8_t)value;
+                    element->parent = parent;
+                    element->depth = (uint16_t)depth;
+                    element->reportId = global.reportId;
+                    splitUsage(local.numUsages ? local.usages[0] : local.usageMin, global.usagePage, &element->usagePage, &element->usage);
+                    element->usageMax = element->usage;
+                    
+                    if (depth < HID_MAX_COLLECTION_DEPTH) {
+                        collections[depth++] = (int32_t)(table->numElements - 1);
+                    }
+                    break;
+                }
+                case 0xc:   // End Collection
+                    if (depth > 0) {
+                        depth--;
+                    }
+                    break;
+            }
+            
+            // Local items only ever apply to the next main item
+            memset(&local, 0, sizeof(local));
+        } else if (itemType == HID_ITEM_TYPE_GLOBAL) {
+            switch (tag) {
+                case 0x0: global.usagePage = (uint16_t)value; break;
+                case 0x1: global.logicalMin = itemSigned(data, size); break;
+                case 0x2: global.logicalMax = itemSigned(data, size); break;
+                case 0x3: global.physicalMin = itemSigned(data, size); break;
+                case 0x4: global.physicalMax = itemSigned(data, size); break;
+                case 0x5: global.unitExponent = (int8_t)(value > 7 && value < 16 ? (int)value - 16 : (int)value); break;
+                case 0x6: global.unit = value; break;
+                case 0x7: global.reportSize = value; break;
+                case 0x8: global.reportId = (uint8_t)value; table->usesReportIds = 1; break;
+                case 0x9: global.reportCount = value; break;
+                case 0xa:
+                    if (globalDepth < HID_MAX_GLOBAL_STACK) {
+                        globalStack[globalDepth++] = global;
+                    }
+                    break;
+                case 0xb:
+                    if (globalDepth > 0) {
+                        global = globalStack[--globalDepth];
+                    }
+                    break;
+            }
+            
+            // A maximum that only fits unsigned, e.g. 0xff in one byte with a zero minimum
+            if ((tag == 0x1 || tag == 0x2) && global.logicalMin >= 0 && global.logicalMax < 0) {
+                global.logicalMax = size == 4 ? INT32_MAX : (int32_t)itemUnsigned(data, size);
+            }
+            if ((tag == 0x3 || tag == 0x4) && global.physicalMin >= 0 && global.physicalMax < 0) {
+                global.physicalMax = size == 4 ? INT32_MAX : (int32_t)itemUnsigned(data, size);
+            }
+        } else if (itemType == HID_ITEM_TYPE_LOCAL) {
+            switch (tag) {
+                case 0x0:
+                    if (local.numUsages < HID_MAX_USAGES) {
+                        local.usages[local.numUsages++] = size == 4 ? value : (value | ((uint32_t)global.usagePage << 16));
+                    }
+                    break;
+                case 0x1:
+                    local.usageMin = size == 4 ? value : (value | ((uint32_t)global.usagePage << 16));
+                    local.haveUsageMin = 1;
+                    break;
+                case 0x2:
+                    local.usageMax = size == 4 ? value : (value | ((uint32_t)global.usagePage << 16));
+                    local.haveUsageMax = 1;
+                    break;
+            }
+        }
+    }
+    
+    return table;
+}
+
+void hidElementTableFree(struct hidElementTable *table)
+{
+    free(table);
+}
+
+const struct hidElement *hidElementFindCookie(const struct hidElementTable *table, uint32_t cookie)
+{
+    // Cookies are assigned densely in table order
+    if (cookie == 0 || cookie > table->numElements) {
+        return NULL;
+    }
+    
+    return &table->elements[cookie - 1];
+}
+
+// Pass the previous result as after to iterate over every match
+const struct hidElement *hidElementFindUsage(const struct hidElementTable *table, uint16_t usagePage, uint32_t usage, const struct hidElement *after)
+{
+    size_t start = after ? (size_t)(after - table->elements) + 1 : 0;
+    
+    for (size_t i = start; i < table->numElements; i++) {
+        const struct hidElement *element = &table->elements[i];
+        
+        if (element->usagePage == usagePage && usage >= element->usage && usage <= element->usageMax) {
+            return element;
+        }
+    }
+    
+    return NULL;
+}
+
+// First non-padding field of the report, NULL if the device has no such report
+const struct hidElement *hidElementFindReport(const struct hidElementTable *table, uint8_t reportId, enum hidElementType type)
+{
+    for (size_t i = 0; i < table->numElements; i++) {
+        const struct hidElement *element = &table->elements[i];
+        
+        if (element->type == type && element->reportId == reportId && !(element->flags & HID_ITEM_CONSTANT)) {
+            return element;
+        }
+    }
+    
+    return NULL;
+}
+
+// Payload bytes of the report, not counting the report id
+size_t hidElementReportLength(const struct hidElementTable *table, uint8_t reportId, enum hidElementType type)
+{
+    uint32_t bits = 0;
+    
+    for (size_t i = 0; i < table->numElements; i++) {
+        const struct hidElement *element = &table->elements[i];
+        uint32_t end = element->bitOffset + element->reportSize * element->reportCount;
+        
+        if (element->type == type && element->reportId == reportId && end > bits) {
+            bits = end;
+        }
+    }
+    
+    return (bits + 7) / 8;
+}
+
+const char *hidUsagePageName(uint32_t usagePage)
+{
+    switch(usagePage) {
+        case 0x01: return "GenericDesktop";
+        case 0x02: return "Simulation";
+        case 0x03: return "VR";
+        case 0x04: return "Sport";
+        case 0x05: return "Game";
+        case 0x06: return "DeviceControls";
+        case 0x07: return "Keyboard";
+        case 0x08: return "LEDS";
+        case 0x09: return "Button";
+        case 0x0a: return "Ordinal";
+        case 0x0b: return "Telephony";
+        case 0x0c: return "Consumer";
+        case 0x0d: return "Digitizer";
+        case 0x0f: return "PID";
+        case 0x10: return "Unicode";
+        case 0x14: return "AlphanumericDisplay";
+        case 0x20: return "Sensor";
+        case 0x80: return "Monitor";
+        case 0x81: return "MonitorEnumerated";
+        case 0x82: return "Virtual";
+        case 0x83: return "Reserved";
+        case 0x84: return "PowerDevice";
+        case 0x85: return "BatterySystem";
+        case 0x86: return "PowerReserved";
+        case 0x87: return "PowerReserved2";
+        case 0x8c: return "BarCodeScanner";
+        case 0x8d: return "Scale";
+        case 0x8e: return "MangeticStripeReader";
+        case 0x90: return "CameraControl";
+        case 0x91: return "Arcade";
+        case 0xff00: return "VendorDefinedStart";
+    }
+    
+    return NULL;
+}
+
+static const char *hidElementTypeName(const struct hidElement *element)
+{
+    switch (element->type) {
+        case HID_ELEMENT_OUTPUT: return "Output";
+        case HID_ELEMENT_FEATURE: return "Feature";
+        case HID_ELEMENT_COLLECTION: return "Collection";
+    }
+    
+    if (!(element->flags & HID_ITEM_VARIABLE)) {
+        return element->usagePage == 0x07 ? "ScanCodes" : "Misc";
+    }
+    
+    return element->reportSize == 1 ? "Button" : "Misc";
+}
+
+static const char *hidCollectionTypeName(const struct hidElement *element)
+{
+    static const char *names[] = { "Physical", "Application", "Logical", "Report", "NamedArray", "UsageSwitch", "UsageModifier" };
+    
+    if (element->type != HID_ELEMENT_COLLECTION || element->collectionType >= sizeof(names) / sizeof(names[0])) {
+        return "unknown";
+    }
+    
+    return names[element->collectionType];
+}
+
+static int hidElementFiltered(const struct hidElement *element, const struct dumpFilter *filter)
+{
+    static const enum dumpElementKind kinds[] = { DUMP_KIND_INPUT, DUMP_KIND_OUTPUT, DUMP_KIND_FEATURE, DUMP_KIND_COLLECTION };
+    
+    return dumpFilterElement(filter, kinds[element->type], element->usagePage, element->usage, element->reportId, element->cookie);
+}
+
+// Elements a filter's element fields let through, all of them without a filter
+size_t hidElementTableMatches(const struct hidElementTable *table, const struct dumpFilter *filter)
+{
+    size_t numMatches = 0;
+    
+    if (!dumpFilterElements(filter)) {
+        return table->numElements;
+    }
+    
+    for (size_t i = 0; i < table->numElements; i++) {
+        numMatches += hidElementFiltered(&table->elements[i], filter);
+    }
+    
+    return numMatches;
+}
+
+static void hidElementDump(const struct hidElement *element, struct dumpWriter *writer)
+{
+    struct dumpElement info;
+    
+    memset(&info, 0, sizeof(info));
+    info.cookie = element->cookie;
+    info.type = hidElementTypeName(element);
+    info.collectionType = hidCollectionTypeName(element);
+    info.usagePage = element->usagePage;
+    info.usagePageName = hidUsagePageName(element->usagePage);
+    info.usage = element->usage;
+    info.reportSize = element->reportSize;
+    info.reportCount = element->reportCount;
+    info.reportId = element->reportId;
+    info.unit = element->unit;
+    info.unitExponent = element->unitExponent;
+    info.flags = (element->flags & HID_ITEM_NULL_STATE ? DUMP_ELEMENT_NULL_STATE : 0) |
+                 (element->type != HID_ELEMENT_COLLECTION && !(element->flags & HID_ITEM_NO_PREFERRED) ? DUMP_ELEMENT_PREFERRED_STATE : 0) |
+                 (element->type != HID_ELEMENT_COLLECTION && !(element->flags & HID_ITEM_VARIABLE) ? DUMP_ELEMENT_ARRAY : 0) |
+                 (element->flags & HID_ITEM_NON_LINEAR ? DUMP_ELEMENT_NON_LINEAR : 0) |
+                 (element->flags & HID_ITEM_RELATIVE ? DUMP_ELEMENT_RELATIVE : 0) |
+                 (element->flags & HID_ITEM_WRAP ? DUMP_ELEMENT_WRAPPING : 0);
+    info.logicalMin = element->logicalMin;
+    info.logicalMax = element->logicalMax;
+    info.physicalMin = element->physicalMin;
+    info.physicalMax = element->physicalMax;
+    
+    dumpBeginElement(writer, &info);
+}
+
+// Rows are in pre-order, so a stack of open collections rebuilds the tree without recursion. With element
+// fields in the filter only the matching rows go out, flat and without their collections
+void hidElementTableDump(const struct hidElementTable *table, const struct dumpFilter *filter, struct dumpWriter *writer)
+{
+    int32_t open[HID_MAX_COLLECTION_DEPTH + 1];
+    int numOpen = 0;
+    long numTopLevel = 0;
+    
+    if (dumpFilterElements(filter)) {
+        dumpBeginElements(writer, (long)hidElementTableMatches(table, filter));
+        
+        for (size_t i = 0; i < table->numElements; i++) {
+            if (hidElementFiltered(&table->elements[i], filter)) {
+                hidElementDump(&table->elements[i], writer);
+                dumpEndElement(writer);
+            }
+        }
+        
+        dumpEndElements(writer);
+        return;
+    }
+    
+    for (size_t i = 0; i < table->numElements; i++) {
+        if (table->elements[i].parent < 0) {
+            numTopLevel++;
+        }
+    }
+    
+    dumpBeginElements(writer, numTopLevel);
+    
+    for (size_t i = 0; i < table->numElements; i++) {
+        const struct hidElement *element = &table->elements[i];
+        
+        while (numOpen && open[numOpen - 1] != element->parent) {
+            dumpEndElement(writer);
+            numOpen--;
+        }
+        
+        hidElementDump(element, writer);
+        
+        if (element->type == HID_ELEMENT_COLLECTION && numOpen <= HID_MAX_COLLECTION_DEPTH) {
+            open[numOpen++] = (int32_t)i;
+        } else {
+            dumpEndElement(writer);
+        }
+    }
+    
+    while (numOpen--) {
+        dumpEndElement(writer);
+    }
+    
+    dumpEndElements(writer);
+}
+
+// Parse once per device plus the linear scans a match does
+int hidDescriptorBenchmark(struct benchOptions *opts)
+{
+    uint64_t ops = (uint64_t)opts->iterations * 1000;
+    unsigned sink = 0;
+    struct hidElementTable *table = hidDescriptorParse(hidSampleKeyboardDescriptor, hidSampleKeyboardDescriptorSize);
+    
+    if (!table) {
+        fprintf(stderr, "Failed to parse the sample descriptor!\n");
+        return -1;
+    }
+    
+    fprintf(benchNotes(), "# sample descriptor %zu bytes, %zu elements\n", hidSampleKeyboardDescriptorSize, table->numElements);
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        struct hidElementTable *parsed = hidDescriptorParse(hidSampleKeyboardDescriptor, hidSampleKeyboardDescriptorSize);
+        
+        sink += (unsigned)parsed->numElements;
+        hidElementTableFree(parsed);
+    }
+    
+    benchReportThroughput("parse", ops, monotonicNanos() - startTime, benchAllocations() - allocs, ops * hidSampleKeyboardDescriptorSize);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        const struct hidElement *element = hidElementFindReport(table, 0x08, HID_ELEMENT_FEATURE);
+        
+        sink += element->cookie + (unsigned)hidElementReportLength(table, 0x08, HID_ELEMENT_FEATURE);
+    }
+    
+    benchReportThroughput("report", ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < ops; i++) {
+        const struct hidElement *element = hidElementFindUsage(table, 0x07, 0x04 + (uint32_t)(i & 0x3f), NULL);
+        
+        sink += element ? element->cookie : 0;
+    }
+    
+    benchReportThroughput("usage", ops, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    
+    fprintf(benchNotes(), "# checksum %u\n", sink);
+    hidElementTableFree(table);
+    
+    return 0;
+}
@@ -0,0 +1,111 @@
+//
+//  hiddescriptor.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef hiddescriptor_h
+#define hiddescriptor_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HID_MAX_REPORT_IDS 256
+
+// Same limits as the Linux HID core, a descriptor past them is rejected rather than parsed
+#define HID_MAX_REPORT_COUNT 12288    // HID_MAX_USAGES in the kernel
+#define HID_MAX_REPORT_SIZE 256
+
+enum hidElementType {
+    HID_ELEMENT_INPUT,
+    HID_ELEMENT_OUTPUT,
+    HID_ELEMENT_FEATURE,
+    HID_ELEMENT_COLLECTION
+};
+
+// Main item data bits, HID 1.11 section 6.2.2.5
+#define HID_ITEM_CONSTANT       0x001
+#define HID_ITEM_VARIABLE       0x002
+#define HID_ITEM_RELATIVE       0x004
+#define HID_ITEM_WRAP           0x008
+#define HID_ITEM_NON_LINEAR     0x010
+#define HID_ITEM_NO_PREFERRED   0x020
+#define HID_ITEM_NULL_STATE     0x040
+#define HID_ITEM_VOLATILE       0x080
+#define HID_ITEM_BUFFERED_BYTES 0x100
+
+// One row of the flat table, children always follow their parent
+struct hidElement {
+    uint32_t cookie;            // 1-based, assigned in descriptor order
+    int32_t parent;             // index of the enclosing collection, -1 at top level
+    uint8_t type;               // enum hidElementType
+    uint8_t collectionType;     // collections only
+    uint8_t reportId;
+    int8_t unitExponent;
+    uint16_t usagePage;
+    uint16_t depth;
+    uint32_t usage;             // arrays: first usage of the range
+    uint32_t usageMax;          // arrays: last usage of the range
+    uint32_t flags;             // HID_ITEM_*
+    uint32_t reportSize;        // bits per field
+    uint32_t reportCount;
+    uint32_t bitOffset;         // within the report, after the report id byte
+    uint32_t unit;
+    int32_t logicalMin;
+    int32_t logicalMax;
+    int32_t physicalMin;
+    int32_t physicalMax;
+};
+
+// Header and rows live in one allocation, free() of the table releases everything
+struct hidElementTable {
+    size_t numElements;
+    size_t capacity;
+    int usesReportIds;
+    struct hidElement elements[];
+};
+
+struct dumpWriter;
+struct dumpFilter;
+struct benchOptions;
+
+extern const uint8_t hidSampleKeyboardDescriptor[];
+extern const size_t hidSampleKeyboardDescriptorSize;
+
+struct hidElementTable *hidDescriptorParse(const uint8_t *desc, size_t descLen);
+void hidElementTableFree(struct hidElementTable *table);
+const struct hidElement *hidElementFindCookie(const struct hidElementTable *table, uint32_t cookie);
+const struct hidElement *hidElementFindUsage(const struct hidElementTable *table, uint16_t usagePage, uint32_t usage, const struct hidElement *after);
+const struct hidElement *hidElementFindReport(const struct hidElementTable *table, uint8_t reportId, enum hidElementType type);
+size_t hidElementReportLength(const struct hidElementTable *table, uint8_t reportId, enum hidElementType type);
+const char *hidUsagePageName(uint32_t usagePage);
+size_t hidElementTableMatches(const struct hidElementTable *table, const struct dumpFilter *filter);
+void hidElementTableDump(const struct hidElementTable *table, const struct dumpFilter *filter, struct dumpWriter *writer);
+
+int hidDescriptorBenchmark(struct benchOptions *opts);
+
+#endif /* hiddescriptor_h */
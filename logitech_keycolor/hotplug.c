@@ -0,0 +1,268 @@
+//
+//  hotplug.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "hotplug.h"
+#include "transport.h"
+#include "timeutil.h"
+
+static volatile sig_atomic_t hotplugStopRequested = 0;
+
+// Targets for the keyboards plugged in right now, replaced piecemeal as devices come and go
+struct hotplugState {
+    struct hidTransport *transport;
+    struct keyColorTarget *targets;
+    size_t numTargets;
+    uint8_t desired[TRANSPORT_MAX_REPORT_SIZE];
+    size_t desiredLen;
+    int verbose;
+    struct hotplugStats *stats;
+};
+
+static void hotplugSignalHandler(int sig)
+{
+    hotplugStopRequested = 1;
+}
+
+// Lowest index no current target holds, keeps per device stats slots stable across replugs
+static int hotplugFreeIndex(struct hotplugState *state)
+{
+    for (int index = 0; ; index++) {
+        size_t i;
+        
+        for (i = 0; i < state->numTargets && state->targets[i].index != index; i++)
+            ;
+        
+        if (i == state->numTargets) {
+            return index;
+        }
+    }
+}
+
+static void hotplugForget(struct hotplugState *state, struct keyColorTarget *target)
+{
+    struct hidTransport *transport = state->transport;
+    
+    // Whatever the board showed before it went away is gone
+    pthread_mutex_lock(&transport->cacheLock);
+    reportCacheInvalidate(transport->cache, reportCacheKey(target));
+    pthread_mutex_unlock(&transport->cacheLock);
+    
+    if (transport->ops->releaseTarget) {
+        transport->ops->releaseTarget(target);
+    }
+}
+
+static void hotplugDetach(struct hotplugState *state, struct hidDeviceInfo *device)
+{
+    size_t kept = 0;
+    
+    state->stats->detaches++;
+    
+    for (size_t i = 0; i < state->numTargets; i++) {
+        if (state->targets[i].device == device->handle) {
+            if (state->verbose) {
+                printf("Detached device[%d] productId=0x%x\n", state->targets[i].index, state->targets[i].productId);
+            }
+            hotplugForget(state, &state->targets[i]);
+            continue;
+        }
+        
+        state->targets[kept++] = state->targets[i];
+    }
+    
+    state->numTargets = kept;
+}
+
+static void hotplugAttach(struct hotplugState *state, struct hidDeviceInfo *device, uint64_t eventTime)
+{
+    struct hotplugStats *stats = state->stats;
+    size_t firstNew = state->numTargets;
+    
+    stats->attaches++;
+    
+    // Backends may report a device twice, say on a permission change right after creation
+    for (size_t i = 0; i < state->numTargets; i++) {
+        if (state->targets[i].device == device->handle) {
+            return;
+        }
+    }
+    
+    device->index = hotplugFreeIndex(state);
+    
+    if (transportResolveDevice(state->transport, device, &state->targets, &state->numTargets) <= 0) {
+        stats->unmatched++;
+        return;
+    }
+    
+    for (size_t i = firstNew; i < state->numTargets; i++) {
+        struct keyColorTarget *target = &state->targets[i];
+        
+        pthread_mutex_lock(&state->transport->cacheLock);
+        reportCacheInvalidate(state->transport->cache, reportCacheKey(target));
+        pthread_mutex_unlock(&state->transport->cacheLock);
+        
+        if (transportWriteTarget(target, state->desired, state->desiredLen)) {
+            stats->failed++;
+        } else {
+            stats->applied++;
+        }
+    }
+    
+    uint64_t latency = monotonicNanos() - eventTime;
+    
+    latencyHistogramRecord(&stats->applyLatency, latency, 0);
+    
+    if (stats->samples && stats->numSamples < stats->maxSamples) {
+        stats->samples[stats->numSamples++] = latency;
+    }
+    
+    if (state->verbose) {
+        printf("Attached device[%d] productId=0x%x serial=%s, applied in %.1fus\n",
+               device->index, device->productId, device->serial, latency / 1000.0);
+    }
+}
+
+static void hotplugEvent(struct hidTransport *transport, enum hotplugEvent event, struct hidDeviceInfo *device, uint64_t eventTime, void *context)
+{
+    struct hotplugState *state = context;
+    
+    if (event == HOTPLUG_ATTACH) {
+        hotplugAttach(state, device, eventTime);
+    } else {
+        hotplugDetach(state, device);
+    }
+}
+
+int hotplugRun(struct hidTransport *transport, const uint8_t *report, size_t reportLen, int verbose, struct hotplugStats *stats)
+{
+    struct hotplugState state;
+    uint64_t *samples = stats->samples;
+    size_t maxSamples = stats->maxSamples;
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->samples = samples;
+    stats->maxSamples = maxSamples;
+    
+    if (!transport->ops->watch) {
+        fprintf(stderr, "The %s transport cannot watch for devices\n", transport->ops->name);
+        return -1;
+    }
+    
+    if (reportLen > sizeof(state.desired)) {
+        return -1;
+    }
+    
+    memset(&state, 0, sizeof(state));
+    state.transport = transport;
+    state.verbose = verbose;
+    state.stats = stats;
+    state.desiredLen = reportLen;
+    memcpy(state.desired, report, reportLen);
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = hotplugSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    hotplugStopRequested = 0;
+    
+    int retVal = transport->ops->watch(transport, hotplugEvent, &state, &hotplugStopRequested);
+    
+    transportReleaseTargets(state.targets, state.numTargets);
+    
+    return retVal;
+}
+
+void hotplugPrintStats(struct hotplugStats *stats, FILE *fp)
+{
+    const struct latencyHistogram *latency = &stats->applyLatency;
+    
+    fprintf(fp, "attaches=%llu detaches=%llu applied=%llu failed=%llu unmatched=%llu\n",
+            (unsigned long long)stats->attaches, (unsigned long long)stats->detaches, (unsigned long long)stats->applied,
+            (unsigned long long)stats->failed, (unsigned long long)stats->unmatched);
+    
+    if (latency->count) {
+        fprintf(fp, "attach to applied p50=%.1fus p99=%.1fus max=%.1fus\n",
+                latencyHistogramPercentile(latency, 50) / 1000.0, latencyHistogramPercentile(latency, 99) / 1000.0, latency->max / 1000.0);
+    }
+}
+
+int hotplugBenchmark(struct benchOptions *opts)
+{
+    char spec[128];
+    uint64_t numEvents = (uint64_t)opts->iterations * 10;
+    struct hotplugStats stats;
+    
+    // Back to back toggles across eight boards, the worst storm a flaky hub could produce
+    if (opts->transportSpec) {
+        snprintf(spec, sizeof(spec), "%s", opts->transportSpec);
+    } else {
+        snprintf(spec, sizeof(spec), "fake:devices=8,storm=%llu,interval=0", (unsigned long long)numEvents);
+    }
+    
+    struct hidTransport *transport = transportOpen(spec, 0, opts->verbose);
+    
+    if (!transport) {
+        return -1;
+    }
+    
+    memset(&stats, 0, sizeof(stats));
+    stats.maxSamples = numEvents + 64;
+    stats.samples = calloc(stats.maxSamples, sizeof(uint64_t));
+    
+    if (!stats.samples) {
+        transportClose(transport);
+        return -1;
+    }
+    
+    uint64_t startTime = monotonicNanos();
+    int retVal = hotplugRun(transport, opts->report, sizeof(opts->report), opts->verbose > 1, &stats);
+    uint64_t elapsed = monotonicNanos() - startTime;
+    
+    benchReportLatency("apply", stats.samples, (int)stats.numSamples);
+    benchReportThroughput("events", stats.attaches + stats.detaches, elapsed, 0, 0);
+    fprintf(benchNotes(), "# %s: ", spec);
+    hotplugPrintStats(&stats, benchNotes());
+    
+    int numUnlit = fakeTransportUnlit(transport);
+    
+    if (numUnlit) {
+        fprintf(stderr, "%d attached devices never got the color\n", numUnlit);
+        retVal = -1;
+    }
+    
+    free(stats.samples);
+    transportClose(transport);
+    
+    return retVal;
+}
@@ -0,0 +1,58 @@
+//
+//  hotplug.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef hotplug_h
+#define hotplug_h
+
+#include <stdio.h>
+#include "keycolor.h"
+#include "latency.h"
+#include "bench.h"
+
+struct hidTransport;
+
+struct hotplugStats {
+    uint64_t attaches;
+    uint64_t detaches;
+    uint64_t applied;           // targets that got the desired report on attach
+    uint64_t failed;
+    uint64_t unmatched;         // attaches with no color report, other interfaces or unknown products
+    struct latencyHistogram applyLatency;   // backend event to report written
+    uint64_t *samples;          // optional, every apply latency, benchmarks set this
+    size_t maxSamples;
+    size_t numSamples;
+};
+
+// Resident mode, resolves each keyboard as it attaches and applies report to it until interrupted
+int hotplugRun(struct hidTransport *transport, const uint8_t *report, size_t reportLen, int verbose, struct hotplugStats *stats);
+void hotplugPrintStats(struct hotplugStats *stats, FILE *fp);
+int hotplugBenchmark(struct benchOptions *opts);
+
+#endif /* hotplug_h */
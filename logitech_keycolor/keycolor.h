@@ -0,0 +1,74 @@
+//
+//  keycolor.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef keycolor_h
+#define keycolor_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ratecontrol.h"
+
+// Size of the { wasdColor, colorRed, colorGreen, colorBlue } report
+#define KEYCOLOR_REPORT_SIZE 4
+
+// Serial numbers longer than this are truncated
+#define KEYCOLOR_SERIAL_SIZE 64
+
+// HID report types, numbered as IOHIDReportType
+#define KEYCOLOR_REPORT_TYPE_OUTPUT 1
+#define KEYCOLOR_REPORT_TYPE_FEATURE 2
+
+// Logitech vendor id, and the vendor defined usage page carrying the color report
+#define LOGITECH_VENDOR_ID 0x046d
+#define LOGITECH_VENDOR_USAGE_PAGE 0xff00
+
+struct hidTransport;
+struct deviceProfile;
+
+// A device/element pair resolved once so reports can be written without re-matching
+struct keyColorTarget {
+    struct hidTransport *transport;
+    uint32_t vendorId;
+    uint32_t productId;
+    uint32_t locationId;
+    char serial[KEYCOLOR_SERIAL_SIZE];
+    const struct deviceProfile *profile;
+    uint32_t cookie;        // IOKit element cookie of the color report
+    uint8_t reportId;       // report id the element belongs to
+    uint8_t reportType;     // KEYCOLOR_REPORT_TYPE_*
+    uint8_t reportLen;      // payload bytes, not counting the report id
+    uint8_t fromCache;      // resolved from the on-disk cache without element matching
+    int index;              // position in the device enumeration
+    void *device;           // backend device handle
+    void *element;          // backend element handle, if any
+    struct rateControl rate;    // pacing for this device, see transportWriteTarget
+};
+
+#endif /* keycolor_h */
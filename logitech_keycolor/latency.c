@@ -0,0 +1,385 @@
+//
+//  latency.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "latency.h"
+#include "timeutil.h"
+
+static const char *phaseNames[LATENCY_PHASE_COUNT] = { "enumerate", "match", "build", "write" };
+
+struct latencyStats *latencyStatsCreate(void)
+{
+    struct latencyStats *stats = calloc(1, sizeof(struct latencyStats));
+    
+    if (stats) {
+        stats->startTime = monotonicNanos();
+        stats->devices[0].used = 1;
+        strcpy(stats->devices[0].serial, "*");
+    }
+    
+    return stats;
+}
+
+void latencyStatsFree(struct latencyStats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    
+    latencyStatsStopSignalDump(stats);
+    free(stats);
+}
+
+int latencyFormatParse(const char *name, enum latencyFormat *format)
+{
+    if (strcmp(name, "text") == 0) {
+        *format = LATENCY_FORMAT_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        *format = LATENCY_FORMAT_JSON;
+    } else {
+        return -1;
+    }
+    
+    return 0;
+}
+
+const char *latencyPhaseName(enum latencyPhase phase)
+{
+    return phase < LATENCY_PHASE_COUNT ? phaseNames[phase] : "unknown";
+}
+
+static inline int latencyBucket(uint64_t nanos)
+{
+    if (nanos < 16) {
+        return (int)nanos;
+    }
+    
+    int exponent = 63 - __builtin_clzll(nanos);
+    
+    if (exponent > LATENCY_MAX_EXPONENT) {
+        return LATENCY_BUCKETS - 1;
+    }
+    
+    return 16 + (exponent - 4) * LATENCY_SUB_BUCKETS + (int)((nanos >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+// Largest value that lands in bucket
+static uint64_t latencyBucketLimit(int bucket)
+{
+    if (bucket < 16) {
+        return (uint64_t)bucket;
+    }
+    
+    int exponent = (bucket - 16) / LATENCY_SUB_BUCKETS + 4;
+    uint64_t width = 1ull << (exponent - 3);
+    
+    return (uint64_t)(LATENCY_SUB_BUCKETS + (bucket - 16) % LATENCY_SUB_BUCKETS) * width + width - 1;
+}
+
+void latencyHistogramRecord(struct latencyHistogram *histogram, uint64_t nanos, int failed)
+{
+    if (histogram->count == 0 || nanos < histogram->min) {
+        histogram->min = nanos;
+    }
+    
+    if (nanos > histogram->max) {
+        histogram->max = nanos;
+    }
+    
+    histogram->count++;
+    histogram->sum += nanos;
+    histogram->buckets[latencyBucket(nanos)]++;
+    
+    if (failed) {
+        histogram->errors++;
+    }
+}
+
+// Upper edge of the bucket holding the percentile, never above the largest sample seen
+uint64_t latencyHistogramPercentile(const struct latencyHistogram *histogram, double percentile)
+{
+    uint64_t count = histogram->count;
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.999999);
+    uint64_t seen = 0;
+    
+    if (rank == 0) {
+        rank = 1;
+    }
+    
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        
+        if (seen >= rank) {
+            uint64_t limit = latencyBucketLimit(i);
+            
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    
+    return histogram->max;
+}
+
+void latencyStatsRecord(struct latencyStats *stats, int deviceIndex, enum latencyPhase phase, uint64_t nanos, int failed)
+{
+    if (deviceIndex + 1 < 0 || deviceIndex + 1 > LATENCY_MAX_DEVICES) {
+        stats->dropped++;
+        return;
+    }
+    
+    struct latencyDevice *device = &stats->devices[deviceIndex + 1];
+    
+    device->used = 1;
+    latencyHistogramRecord(&device->phases[phase], nanos, failed);
+}
+
+void latencyStatsNameDevice(struct latencyStats *stats, int deviceIndex, const char *serial)
+{
+    if (deviceIndex < 0 || deviceIndex >= LATENCY_MAX_DEVICES) {
+        return;
+    }
+    
+    struct latencyDevice *device = &stats->devices[deviceIndex + 1];
+    
+    device->used = 1;
+    snprintf(device->serial, sizeof(device->serial), "%s", serial);
+}
+
+static void latencyPrintText(struct latencyStats *stats, FILE *fp)
+{
+    fprintf(fp, "%-8s %-10s %10s %8s %10s %10s %10s %10s\n", "device", "phase", "count", "errors", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    
+    for (int d = 0; d <= LATENCY_MAX_DEVICES; d++) {
+        struct latencyDevice *device = &stats->devices[d];
+        
+        for (int p = 0; device->used && p < LATENCY_PHASE_COUNT; p++) {
+            const struct latencyHistogram *histogram = &device->phases[p];
+            char name[12];
+            
+            if (histogram->count == 0) {
+                continue;
+            }
+            
+            if (d == 0) {
+                strcpy(name, "*");
+            } else {
+                snprintf(name, sizeof(name), "%d", d - 1);
+            }
+            
+            fprintf(fp, "%-8s %-10s %10llu %8llu %10.1f %10.1f %10.1f %10.1f\n", name, phaseNames[p],
+                    (unsigned long long)histogram->count, (unsigned long long)histogram->errors,
+                    latencyHistogramPercentile(histogram, 50) / 1000.0, latencyHistogramPercentile(histogram, 90) / 1000.0,
+                    latencyHistogramPercentile(histogram, 99) / 1000.0, histogram->max / 1000.0);
+        }
+    }
+    
+    if (stats->dropped) {
+        fprintf(fp, "%llu samples dropped, devices past %d are not tracked\n", (unsigned long long)stats->dropped, LATENCY_MAX_DEVICES);
+    }
+}
+
+// Serials come from the device, anything that needs escaping is replaced
+static void latencyPrintJsonString(const char *str, FILE *fp)
+{
+    fputc('"', fp);
+    
+    for (; *str; str++) {
+        fputc(*str == '"' || *str == '\\' || (unsigned char)*str < 0x20 ? '?' : *str, fp);
+    }
+    
+    fputc('"', fp);
+}
+
+static void latencyPrintJson(struct latencyStats *stats, FILE *fp)
+{
+    const char *separator = "";
+    
+    fprintf(fp, "{\"elapsed_ns\":%llu,\"dropped\":%llu,\"stats\":[",
+            (unsigned long long)(monotonicNanos() - stats->startTime), (unsigned long long)stats->dropped);
+    
+    for (int d = 0; d <= LATENCY_MAX_DEVICES; d++) {
+        struct latencyDevice *device = &stats->devices[d];
+        
+        for (int p = 0; device->used && p < LATENCY_PHASE_COUNT; p++) {
+            const struct latencyHistogram *histogram = &device->phases[p];
+            
+            if (histogram->count == 0) {
+                continue;
+            }
+            
+            fprintf(fp, "%s{\"device\":%d,\"serial\":", separator, d - 1);
+            latencyPrintJsonString(device->serial, fp);
+            fprintf(fp, ",\"phase\":\"%s\",\"count\":%llu,\"errors\":%llu,\"min_ns\":%llu,\"mean_ns\":%llu,"
+                    "\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}",
+                    phaseNames[p], (unsigned long long)histogram->count, (unsigned long long)histogram->errors,
+                    (unsigned long long)histogram->min, (unsigned long long)(histogram->sum / histogram->count),
+                    (unsigned long long)latencyHistogramPercentile(histogram, 50),
+                    (unsigned long long)latencyHistogramPercentile(histogram, 90),
+                    (unsigned long long)latencyHistogramPercentile(histogram, 99),
+                    (unsigned long long)histogram->max);
+            separator = ",";
+        }
+    }
+    
+    fprintf(fp, "]}\n");
+}
+
+// Text goes to stderr with the other stats, json to stdout for collection
+void latencyStatsPrint(struct latencyStats *stats, enum latencyFormat format)
+{
+    if (format == LATENCY_FORMAT_JSON) {
+        latencyPrintJson(stats, stdout);
+        fflush(stdout);
+    } else {
+        latencyPrintText(stats, stderr);
+    }
+}
+
+// Waits for SIGUSR1 in its own thread, so the write loops never see the signal
+static void *latencySignalThread(void *arg)
+{
+    struct latencyStats *stats = arg;
+    sigset_t signals;
+    int signum;
+    
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    
+    while (sigwait(&signals, &signum) == 0 && stats->signalRunning) {
+        latencyStatsPrint(stats, stats->signalFormat);
+    }
+    
+    return NULL;
+}
+
+// Threads inherit the mask of the thread creating them, call this before starting any so none
+// of them is left to take SIGUSR1's default action of killing the process
+int latencyStatsBlockSignal(void)
+{
+    sigset_t signals;
+    
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    
+    return pthread_sigmask(SIG_BLOCK, &signals, NULL) ? -1 : 0;
+}
+
+int latencyStatsStartSignalDump(struct latencyStats *stats, enum latencyFormat format)
+{
+    if (latencyStatsBlockSignal()) {
+        return -1;
+    }
+    
+    stats->signalFormat = format;
+    stats->signalRunning = 1;
+    
+    if (pthread_create(&stats->signalThread, NULL, latencySignalThread, stats)) {
+        fprintf(stderr, "Failed to start the stats signal thread!\n");
+        stats->signalRunning = 0;
+        return -1;
+    }
+    
+    return 0;
+}
+
+void latencyStatsStopSignalDump(struct latencyStats *stats)
+{
+    if (!stats->signalRunning) {
+        return;
+    }
+    
+    stats->signalRunning = 0;
+    pthread_kill(stats->signalThread, SIGUSR1);
+    pthread_join(stats->signalThread, NULL);
+}
+
+int latencyBenchmark(struct benchOptions *opts)
+{
+    struct latencyStats *stats = latencyStatsCreate();
+    uint64_t numOps = (uint64_t)opts->iterations * 5000;
+    uint64_t checksum = 0;
+    
+    if (!stats) {
+        return -1;
+    }
+    
+    // Spread across five decades so every part of the bucket math is exercised
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < numOps; i++) {
+        latencyStatsRecord(stats, (int)(i & 3), LATENCY_PHASE_WRITE, (i * 2654435761u) % 10000000, 0);
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    
+    benchReportThroughput("record", numOps, elapsed, benchAllocations() - allocs, 0);
+    
+    uint64_t numQueries = (uint64_t)opts->iterations * 50;
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < numQueries; i++) {
+        checksum += latencyHistogramPercentile(&stats->devices[1 + (i & 3)].phases[LATENCY_PHASE_WRITE], 99);
+    }
+    
+    elapsed = monotonicNanos() - startTime;
+    
+    benchReportThroughput("p99", numQueries, elapsed, benchAllocations() - allocs, 0);
+    
+    uint64_t now = monotonicNanos();
+    
+    allocs = benchAllocations();
+    startTime = monotonicNanos();
+    
+    for (uint64_t i = 0; i < numOps; i++) {
+        checksum += monotonicNanos() - now;
+    }
+    
+    elapsed = monotonicNanos() - startTime;
+    
+    benchReportThroughput("clock", numOps, elapsed, benchAllocations() - allocs, 0);
+    fprintf(benchNotes(), "# checksum %llu\n", (unsigned long long)(checksum & 0xffff));
+    
+    if (opts->verbose) {
+        latencyPrintText(stats, benchNotes());
+    }
+    
+    latencyStatsFree(stats);
+    
+    return 0;
+}
@@ -0,0 +1,107 @@
+//
+//  latency.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef latency_h
+#define latency_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "keycolor.h"
+#include "bench.h"
+
+// Log-linear buckets, exact below 16ns then 8 per power of two (12.5% resolution) up to ~18 minutes
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_MAX_EXPONENT 40
+#define LATENCY_BUCKETS (16 + (LATENCY_MAX_EXPONENT - 3) * LATENCY_SUB_BUCKETS)
+
+// Devices with a larger enumeration index are not tracked
+#define LATENCY_MAX_DEVICES 16
+
+enum latencyPhase {
+    LATENCY_PHASE_ENUMERATE,    // transport wide, not per device
+    LATENCY_PHASE_MATCH,        // element match or resolve cache attach
+    LATENCY_PHASE_BUILD,        // backend report/value construction, part of write
+    LATENCY_PHASE_WRITE,        // the backend write call, suppressed writes are not timed
+    LATENCY_PHASE_COUNT
+};
+
+enum latencyFormat {
+    LATENCY_FORMAT_TEXT,
+    LATENCY_FORMAT_JSON         // one object per report, on stdout
+};
+
+struct latencyHistogram {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[LATENCY_BUCKETS];
+};
+
+struct latencyDevice {
+    int used;
+    char serial[KEYCOLOR_SERIAL_SIZE];
+    struct latencyHistogram phases[LATENCY_PHASE_COUNT];
+};
+
+// Fixed size, slot 0 is the transport itself and slot n + 1 is device index n
+struct latencyStats {
+    uint64_t startTime;
+    uint64_t dropped;                   // samples for devices past LATENCY_MAX_DEVICES
+    struct latencyDevice devices[LATENCY_MAX_DEVICES + 1];
+    
+    // Optional SIGUSR1 dump, see latencyStatsStartSignalDump
+    enum latencyFormat signalFormat;
+    pthread_t signalThread;
+    volatile int signalRunning;
+};
+
+struct latencyStats *latencyStatsCreate(void);
+void latencyStatsFree(struct latencyStats *stats);
+int latencyFormatParse(const char *name, enum latencyFormat *format);
+const char *latencyPhaseName(enum latencyPhase phase);
+
+// deviceIndex -1 records against the transport as a whole
+void latencyStatsRecord(struct latencyStats *stats, int deviceIndex, enum latencyPhase phase, uint64_t nanos, int failed);
+void latencyStatsNameDevice(struct latencyStats *stats, int deviceIndex, const char *serial);
+void latencyHistogramRecord(struct latencyHistogram *histogram, uint64_t nanos, int failed);
+uint64_t latencyHistogramPercentile(const struct latencyHistogram *histogram, double percentile);
+void latencyStatsPrint(struct latencyStats *stats, enum latencyFormat format);
+
+// SIGUSR1 prints the current stats, call before any other thread is started so they all inherit the blocked signal
+int latencyStatsBlockSignal(void);
+int latencyStatsStartSignalDump(struct latencyStats *stats, enum latencyFormat format);
+void latencyStatsStopSignalDump(struct latencyStats *stats);
+
+int latencyBenchmark(struct benchOptions *opts);
+
+#endif /* latency_h */
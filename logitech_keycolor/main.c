@@ -33,46 +33,41 @@
 #define COPYRIGHT "Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <getopt.h>
 #include <string.h>
 #include <libgen.h>
-#include <CoreFoundation/CoreFoundation.h>
-#include <IOKit/hid/IOHIDLib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "keycolor.h"
+#include "transport.h"
+#include "daemon.h"
+#include "bench.h"
+#include "animation.h"
+#include "command.h"
+#include "batch.h"
+#include "timeutil.h"
+#include "profiles.h"
+#include "resolvecache.h"
+#include "latency.h"
+#include "hotplug.h"
+#include "audio.h"
+#include "color.h"
+#include "timeline.h"
+#include "asyncwrite.h"
+#include "compositor.h"
+#include "expr.h"
+#include "recorder.h"
+#include "shmcontrol.h"
+#include "phaselock.h"
+#include "statefile.h"
 
-static CFMutableDictionaryRef setMatchSelection(CFMutableDictionaryRef dictRef, CFStringRef key, UInt32 value)
-{
-    if (dictRef == NULL) {
-        dictRef = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-        
-        CFAutorelease(dictRef);
-    
-        if (!dictRef) {
-            fprintf(stderr, "Failed to alloc matching dictionary!\n");
-            exit(3);
-        }
-    }
-    
-    if (dictRef) {
-        CFNumberRef tCFNumberRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &value);
-        CFDictionarySetValue(dictRef, key, tCFNumberRef);
-        CFRelease(tCFNumberRef);
-    }
-    
-    return dictRef;
-}
+#define MAX_PUBLISH 16
 
-void parseColor(char *str, uint8_t *red, uint8_t *green, uint8_t *blue)
+int parseColor(char *str, uint8_t *red, uint8_t *green, uint8_t *blue)
 {
-    uint8_t *cc[] = { red, green, blue };
-    int cIdx = 0;
-    
-    for (char *cp = strtok(str, ","); cp && cIdx < 3; cp = strtok(NULL, ",")) {
-        *cc[cIdx++] = (uint8_t)(atoi(cp));
-    }
-    
-    while (cIdx < 3) {
-        *cc[cIdx] = 0;
-    }
+    return colorParseBytes(str, red, green, blue);
 }
 
 void usage(int exitCode, char * argv[], struct option *opts)
@@ -87,409 +82,172 @@ void usage(int exitCode, char * argv[], struct option *opts)
         if (opts->has_arg == required_argument) {
             switch(opts->val) {
             case 'c': arg = " {0-255}"; break;
-            case 'C': arg = " {0-255,0-255,0-255}"; break;
+            case 'C': arg = " {r,g,b|#rrggbb|hsv:H,S,V|2700K|name|list}"; break;
+            case 'S': arg = " {path}"; break;
+            case 't': arg = " {name[:args]|list}"; break;
+            case 'e': arg = " {fade|breathe|cycle|strobe}"; break;
+            case 'r': arg = " {1-1000}"; break;
+            case 'i': arg = " {1-64}"; break;
+            case 'A': arg = " {0-255}"; break;
+            case 'x': arg = " {program|@file}"; break;
+            case 'G': arg = " {zone=color[,blend=mode][,opacity=percent][,flash=duration]}"; break;
+            case 'p': case 'u': arg = " {duration}"; break;
+            case 'T': arg = " {color}"; break;
+            case 'b': arg = " {file|-}"; break;
+            case 'W': arg = " {duration}"; break;
+            case 'R': arg = " {path|off}"; break;
+            case 'F': arg = " {text|json|binary}"; break;
+            case 'f': arg = " {vendor=|product=|page=|usage=|type=|report=|cookie=id[-id][/id]...}"; break;
+            case 'O': arg = " {text|json}"; break;
+            case 'B': arg = " {name|list|all}"; break;
+            case 'n': arg = " {count}"; break;
+            case 'k': arg = " {script|-}"; break;
+            case 'l': arg = " {file}"; break;
+            case 'o': case 'y': arg = " {log}"; break;
+            case 'z': arg = " {factor|max}"; break;
+            case 'M': arg = " {zone=color[,priority=0-3][,ttl=duration]|zone=off}"; break;
+            case 'K': arg = " {name}"; break;
+            case 'Y': arg = " {file}"; break;
             default: arg = " {arg}"; break;
             }
         }
+        
+        if (opts->has_arg == optional_argument && opts->val == 'L') {
+            arg = "[={text|json}]";
+        } else if (opts->has_arg == optional_argument && opts->val == 'a') {
+            arg = "[={rate[:channels[:s16|f32]]}]";
+        } else if (opts->has_arg == optional_argument && opts->val == 'm') {
+            arg = "[={poll interval}]";
+        } else if (opts->has_arg == optional_argument && opts->val == 'E') {
+            arg = "[={skew bound}]";
+        }
         fprintf(stderr, " [--%s|-%c%s]", opts->name, opts->val, arg);
     }
     fprintf(stderr, "\n\n");
     exit(exitCode);
 }
 
-#define GUESS_UNKNOWN_TYPES 0
-void cfValueToString(CFMutableStringRef str, CFTypeRef value)
-{
-#if GUESS_UNKNOWN_TYPES
-    struct idMap {
-        const char *name;
-        CFTypeID id;
-    } typeMap[] = {
-        "CFAllocatorGetTypeID", CFAllocatorGetTypeID(),
-        "CFArrayGetTypeID", CFArrayGetTypeID(),
-        "CFAttributedStringGetTypeID", CFAttributedStringGetTypeID(),
-        "CFBagGetTypeID", CFBagGetTypeID(),
-        "CFBinaryHeapGetTypeID", CFBinaryHeapGetTypeID(),
-        "CFBitVectorGetTypeID", CFBitVectorGetTypeID(),
-        "CFBooleanGetTypeID", CFBooleanGetTypeID(),
-        "CFBundleGetTypeID", CFBundleGetTypeID(),
-        "CFCalendarGetTypeID", CFCalendarGetTypeID(),
-        "CFCharacterSetGetTypeID", CFCharacterSetGetTypeID(),
-        "CFDataGetTypeID", CFDataGetTypeID(),
-        "CFDateFormatterGetTypeID", CFDateFormatterGetTypeID(),
-        "CFDateGetTypeID", CFDateGetTypeID(),
-        "CFDictionaryGetTypeID", CFDictionaryGetTypeID(),
-        "CFErrorGetTypeID", CFErrorGetTypeID(),
-        "CFFileDescriptorGetTypeID", CFFileDescriptorGetTypeID(),
-        "CFFileSecurityGetTypeID", CFFileSecurityGetTypeID(),
-        "CFLocaleGetTypeID", CFLocaleGetTypeID(),
-        "CFMachPortGetTypeID", CFMachPortGetTypeID(),
-        "CFMessagePortGetTypeID", CFMessagePortGetTypeID(),
-        "CFNotificationCenterGetTypeID", CFNotificationCenterGetTypeID(),
-        "CFNullGetTypeID", CFNullGetTypeID(),
-        "CFNumberFormatterGetTypeID", CFNumberFormatterGetTypeID(),
-        "CFNumberGetTypeID", CFNumberGetTypeID(),
-        "CFPlugInGetTypeID", CFPlugInGetTypeID(),
-        "CFPlugInInstanceGetTypeID", CFPlugInInstanceGetTypeID(),
-        "CFReadStreamGetTypeID", CFReadStreamGetTypeID(),
-        "CFRunLoopGetTypeID", CFRunLoopGetTypeID(),
-        "CFRunLoopObserverGetTypeID", CFRunLoopObserverGetTypeID(),
-        "CFRunLoopSourceGetTypeID", CFRunLoopSourceGetTypeID(),
-        "CFRunLoopTimerGetTypeID", CFRunLoopTimerGetTypeID(),
-        "CFSetGetTypeID", CFSetGetTypeID(),
-        "CFSocketGetTypeID", CFSocketGetTypeID(),
-        "CFStringGetTypeID", CFStringGetTypeID(),
-        "CFStringTokenizerGetTypeID", CFStringTokenizerGetTypeID(),
-        "CFTimeZoneGetTypeID", CFTimeZoneGetTypeID(),
-        "CFTreeGetTypeID", CFTreeGetTypeID(),
-        "CFURLEnumeratorGetTypeID", CFURLEnumeratorGetTypeID(),
-        "CFURLGetTypeID", CFURLGetTypeID(),
-        "CFUUIDGetTypeID", CFUUIDGetTypeID(),
-        "CFUserNotificationGetTypeID", CFUserNotificationGetTypeID(),
-        "CFWriteStreamGetTypeID", CFWriteStreamGetTypeID(),
-        "CFXMLNodeGetTypeID", CFXMLNodeGetTypeID(),
-        "CFXMLParserGetTypeID", CFXMLParserGetTypeID(),
-        NULL, NULL
-    };
-#endif /* GUESS_UNKNOWN_TYPES */
-    CFTypeID valueType = CFGetTypeID(value);
-    
-    if (valueType == CFStringGetTypeID()) {
-        CFStringAppend(str, value);
-    } else if (valueType == CFNumberGetTypeID()) {
-        int64_t n;
-        CFNumberGetValue(value, kCFNumberSInt64Type, &n);
-        CFStringAppendFormat(str, NULL, CFSTR("0x%llx"), n);
-    } else if (valueType == CFArrayGetTypeID()) {
-        CFStringAppend(str, CFSTR("[ "));
-        CFIndex n = CFArrayGetCount(value);
-        for (CFIndex k = 0; k < n; k++) {
-            if (k > 0) CFStringAppend(str, CFSTR(", "));
-            CFTypeRef vv = CFArrayGetValueAtIndex(value, k);
-            cfValueToString(str, vv);
-        }
-        CFStringAppend(str, CFSTR(" ]"));
-    } else if (valueType == CFDictionaryGetTypeID()) {
-        CFStringAppend(str, CFSTR("{ "));
-        CFIndex n = CFDictionaryGetCount(value);
-        CFTypeRef *keys = CFAllocatorAllocate(kCFAllocatorDefault, sizeof(CFTypeRef) * n, 0);
-        CFTypeRef *values = CFAllocatorAllocate(kCFAllocatorDefault, sizeof(CFTypeRef) * n, 0);
-        CFDictionaryGetKeysAndValues(value, keys, values);
-        for (CFIndex i = 0; i < n; i++) {
-            if (CFGetTypeID(values[i]) == CFBooleanGetTypeID() && !CFBooleanGetValue(values[i]))
-                continue;
-            
-            if (i > 0) CFStringAppend(str, CFSTR(", "));
-            cfValueToString(str, keys[i]);
-            CFStringAppend(str, CFSTR("="));
-            cfValueToString(str, values[i]);
-        }
-        CFAllocatorDeallocate(kCFAllocatorDefault, keys);
-        CFAllocatorDeallocate(kCFAllocatorDefault, values);
-        CFStringAppend(str, CFSTR(" }"));
-    } else if (valueType == CFBooleanGetTypeID()) {
-        CFStringAppend(str, CFBooleanGetValue(value) ? CFSTR("TRUE") : CFSTR("FALSE"));
-    } else {
-#if GUESS_UNKNOWN_TYPES
-        for (struct idMap *l = typeMap;l->name;l++) {
-            if (valueType == l->id) {
-                CFStringAppendFormat(str, NULL, CFSTR("Type[%s]"), l->name);
-                break;
-            }
-        }
-#endif /* GUESS_UNKNOWN_TYPES */
-        CFStringAppendFormat(str, NULL, CFSTR("??type=0x%lx?? %@"), valueType, value);
-    }
-}
-
-void hidElementToString(CFMutableStringRef str, IOHIDElementRef element, char *basePrefix)
-{
-    CFMutableDictionaryRef props = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-    
-    CFAutorelease(props);
-    
-    CFStringRef tCFString = IOHIDElementGetName(element);
-    
-    if (tCFString) {
-        CFDictionarySetValue(props, CFSTR("Name"), tCFString);
-    }
-    
-    IOHIDElementType elementType = IOHIDElementGetType(element);
-    tCFString = CFSTR("unknown");
-    
-    switch(elementType) {
-        case kIOHIDElementTypeInput_Misc: tCFString = CFSTR("Misc"); break;
-        case kIOHIDElementTypeInput_Button: tCFString = CFSTR("Button"); break;
-        case kIOHIDElementTypeInput_Axis: tCFString = CFSTR("Axis"); break;
-        case kIOHIDElementTypeInput_ScanCodes: tCFString = CFSTR("ScanCodes"); break;
-        case kIOHIDElementTypeOutput: tCFString = CFSTR("Output"); break;
-        case kIOHIDElementTypeFeature: tCFString = CFSTR("Feature"); break;
-        case kIOHIDElementTypeCollection: tCFString = CFSTR("Collection"); break;
-    }
-    
-    CFDictionarySetValue(props, CFSTR("Type"), tCFString);
-    
-    IOHIDElementCollectionType elementCollectionType = IOHIDElementGetCollectionType(element);
-    tCFString = CFSTR("unknown");
-    
-    switch(elementCollectionType) {
-        case kIOHIDElementCollectionTypePhysical: tCFString = CFSTR("Physical"); break;
-        case kIOHIDElementCollectionTypeApplication: tCFString = CFSTR("Application"); break;
-        case kIOHIDElementCollectionTypeLogical: tCFString = CFSTR("Application"); break;
-        case kIOHIDElementCollectionTypeReport: tCFString = CFSTR("Report"); break;
-        case kIOHIDElementCollectionTypeNamedArray: tCFString = CFSTR("NamedArray"); break;
-        case kIOHIDElementCollectionTypeUsageSwitch: tCFString = CFSTR("UsageSwitch"); break;
-        case kIOHIDElementCollectionTypeUsageModifier: tCFString = CFSTR("UsageModifier"); break;
-    }
-    
-    CFDictionarySetValue(props, CFSTR("CollectionType"), tCFString);
-    
-    uint32_t tInt32 = IOHIDElementGetUsagePage(element);
-    tCFString = NULL;
-    
-    switch(tInt32) {
-        case kHIDPage_GenericDesktop: tCFString = CFSTR("GenericDesktop"); break;
-        case kHIDPage_Simulation: tCFString = CFSTR("Simulation"); break;
-        case kHIDPage_VR: tCFString = CFSTR("VR"); break;
-        case kHIDPage_Sport: tCFString = CFSTR("Sport"); break;
-        case kHIDPage_Game: tCFString = CFSTR("Game"); break;
-        case kHIDPage_GenericDeviceControls: tCFString = CFSTR("DeviceControls"); break;
-        case kHIDPage_KeyboardOrKeypad: tCFString = CFSTR("Keyboard"); break;
-        case kHIDPage_LEDs: tCFString = CFSTR("LEDS"); break;
-        case kHIDPage_Button: tCFString = CFSTR("Button"); break;
-        case kHIDPage_Ordinal: tCFString = CFSTR("Ordinal"); break;
-        case kHIDPage_Telephony: tCFString = CFSTR("Telephony"); break;
-        case kHIDPage_Consumer: tCFString = CFSTR("Consumer"); break;
-        case kHIDPage_Digitizer: tCFString = CFSTR("Digitizer"); break;
-        case kHIDPage_PID: tCFString = CFSTR("PID"); break;
-        case kHIDPage_Unicode: tCFString = CFSTR("Unicode"); break;
-        case kHIDPage_AlphanumericDisplay: tCFString = CFSTR("AlphanumericDisplay"); break;
-        case kHIDPage_Sensor: tCFString = CFSTR("Sensor"); break;
-        case kHIDPage_Monitor: tCFString = CFSTR("Monitor"); break;
-        case kHIDPage_MonitorEnumerated: tCFString = CFSTR("MonitorEnumerated"); break;
-        case kHIDPage_MonitorVirtual: tCFString = CFSTR("Virtual"); break;
-        case kHIDPage_MonitorReserved: tCFString = CFSTR("Reserved"); break;
-        case kHIDPage_PowerDevice: tCFString = CFSTR("PowerDevice"); break;
-        case kHIDPage_BatterySystem: tCFString = CFSTR("BatterySystem"); break;
-        case kHIDPage_PowerReserved: tCFString = CFSTR("PowerReserved"); break;
-        case kHIDPage_PowerReserved2: tCFString = CFSTR("PowerReserved2"); break;
-        case kHIDPage_BarCodeScanner: tCFString = CFSTR("BarCodeScanner"); break;
-        case kHIDPage_Scale: tCFString = CFSTR("Scale"); break;
-        case kHIDPage_MagneticStripeReader: tCFString = CFSTR("MangeticStripeReader"); break;
-        case kHIDPage_CameraControl: tCFString = CFSTR("CameraControl"); break;
-        case kHIDPage_Arcade: tCFString = CFSTR("Arcade"); break;
-        case kHIDPage_VendorDefinedStart: tCFString = CFSTR("VendorDefinedStart"); break;
-    }
-    
-    if (!tCFString) {
-        tCFString = CFStringCreateWithFormat(kCFAllocatorDefault, NULL, CFSTR("<0x%x>"), tInt32);
-    }
-    
-    CFDictionarySetValue(props, CFSTR("UsagePage"), tCFString);
-    
-    tInt32 = IOHIDElementGetUsage(element);
-    CFDictionarySetValue(props, CFSTR("Usage"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    tInt32 = IOHIDElementGetReportSize(element);
-    CFDictionarySetValue(props, CFSTR("ReportSize"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    tInt32 = IOHIDElementGetReportCount(element);
-    CFDictionarySetValue(props, CFSTR("ReportCount"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    tInt32 = IOHIDElementGetReportID(element);
-    CFDictionarySetValue(props, CFSTR("ReportID"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    tInt32 = IOHIDElementGetUnit(element);
-    CFDictionarySetValue(props, CFSTR("Unit"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    tInt32 = IOHIDElementGetUnitExponent(element);
-    CFDictionarySetValue(props, CFSTR("UnitExponent"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &tInt32));
-    
-    Boolean tBoolean = IOHIDElementHasNullState(element);
-    CFDictionarySetValue(props, CFSTR("HasNullState"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementHasPreferredState(element);
-    CFDictionarySetValue(props, CFSTR("HasPreferredState"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementIsArray(element);
-    CFDictionarySetValue(props, CFSTR("IsArray"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementIsNonLinear(element);
-    CFDictionarySetValue(props, CFSTR("IsNonLinear"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementIsRelative(element);
-    CFDictionarySetValue(props, CFSTR("IsRelative"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementIsVirtual(element);
-    CFDictionarySetValue(props, CFSTR("IsVirtual"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    tBoolean = IOHIDElementIsWrapping(element);
-    CFDictionarySetValue(props, CFSTR("IsWrapping"), (CFBooleanRef)(tBoolean ? kCFBooleanTrue : kCFBooleanFalse));
-    
-    CFIndex tCFIndexMin = IOHIDElementGetLogicalMin(element);
-    CFIndex tCFIndexMax = IOHIDElementGetLogicalMax(element);
-    CFDictionarySetValue(props, CFSTR("LogicalRange"), CFStringCreateWithFormat(kCFAllocatorDefault, NULL, CFSTR("%ld-%ld"), tCFIndexMin, tCFIndexMax));
-    
-    tCFIndexMin = IOHIDElementGetPhysicalMin(element);
-    tCFIndexMax = IOHIDElementGetPhysicalMax(element);
-    CFDictionarySetValue(props, CFSTR("PhysicalRange"), CFStringCreateWithFormat(kCFAllocatorDefault, NULL, CFSTR("%ld-%ld"), tCFIndexMin, tCFIndexMax));
-    
-    CFStringAppendCString(str, basePrefix, kCFStringEncodingMacRoman);
-    cfValueToString(str, props);
-    
-    CFArrayRef elementChildren = IOHIDElementGetChildren(element);
-    
-    if (elementChildren) {
-        CFDictionarySetValue(props, CFSTR("HasChildren"), kCFBooleanTrue);
-        CFIndex numChildren = CFArrayGetCount(elementChildren);
-        CFDictionarySetValue(props, CFSTR("NumChildren"), CFStringCreateWithFormat(kCFAllocatorDefault, NULL, CFSTR("%ld"), numChildren));
-        
-        for (CFIndex i = 0; i < numChildren; i++) {
-            IOHIDElementRef childElement = (IOHIDElementRef)CFArrayGetValueAtIndex(elementChildren, i);
-            char *prefix = NULL;
-            asprintf(&prefix, "%s[%ld] cookie:0x%04x ", basePrefix, i, IOHIDElementGetCookie(childElement));
-            hidElementToString(str, childElement, prefix);
-            free(prefix);
-            CFStringAppend(str, CFSTR("\n"));
-        }
-    }
-}
-
-void dumpElements(char *basePrefix, IOHIDDeviceRef device, int verbose)
-{
-    CFArrayRef elements = IOHIDDeviceCopyMatchingElements(device, NULL, kIOHIDOptionsTypeNone);
-    
-    if (!elements) {
-        if (verbose) {
-            printf("%s No elements found.\n", basePrefix);
-        }
-        return;
-    }
-    
-    CFAutorelease(elements);
-    
-    CFIndex numElements = CFArrayGetCount(elements);
-    
-    printf("%s %ld Elements:\n", basePrefix, numElements);
-    
-    for (CFIndex i = 0;i < numElements;i++) {
-        IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i);
-        
-        char *prefix = NULL;
-        asprintf(&prefix, "%s cookie:0x%04x ", basePrefix, IOHIDElementGetCookie(element));
-        
-        CFMutableStringRef buf = CFStringCreateMutable(kCFAllocatorDefault, 1024);
-        CFAutorelease(buf);
-        hidElementToString(buf, element, prefix);
-        printf("%s\n", CFStringGetCStringPtr(buf, kCFStringEncodingMacRoman));
-        free(prefix);
-    }
-}
-
-void dumpDevices(IOHIDDeviceRef *devices, CFIndex numDevices, int verbose)
-{
-    size_t colWidth = 0;
-    const char *properties[] = {
-        kIOHIDTransportKey,
-        kIOHIDVendorIDKey,
-        kIOHIDManufacturerKey,
-        kIOHIDVendorIDSourceKey,
-        kIOHIDProductIDKey,
-        kIOHIDProductKey,
-        kIOHIDVersionNumberKey,
-        kIOHIDSerialNumberKey,
-        kIOHIDCountryCodeKey,
-        kIOHIDStandardTypeKey,
-        kIOHIDLocationIDKey,
-        kIOHIDDeviceUsageKey,
-        kIOHIDDeviceUsagePageKey,
-        kIOHIDDeviceUsagePairsKey,
-        kIOHIDPrimaryUsageKey,
-        kIOHIDPrimaryUsagePageKey,
-        kIOHIDMaxInputReportSizeKey,
-        kIOHIDMaxOutputReportSizeKey,
-        kIOHIDMaxFeatureReportSizeKey,
-        kIOHIDReportIntervalKey,
-        kIOHIDSampleIntervalKey,
-        kIOHIDBatchIntervalKey,
-        kIOHIDRequestTimeoutKey,
-        kIOHIDResetKey,
-        kIOHIDKeyboardLanguageKey,
-        kIOHIDAltHandlerIdKey,
-        kIOHIDBuiltInKey,
-        kIOHIDDisplayIntegratedKey,
-        kIOHIDProductIDMaskKey,
-        kIOHIDProductIDArrayKey,
-        kIOHIDPowerOnDelayNSKey,
-        kIOHIDCategoryKey,
-        kIOHIDMaxResponseLatencyKey,
-        kIOHIDUniqueIDKey,
-        NULL
-    };
-    CFStringRef cStr_properties[sizeof(properties)/sizeof(const char *)];
-    
-    for (int i = 0; properties[i]; i++) {
-        cStr_properties[i] = CFStringCreateWithCString(kCFAllocatorDefault, properties[i], kCFStringEncodingASCII);
-        CFAutorelease(cStr_properties[i]);
-        
-        if (strlen(properties[i]) > colWidth) {
-            colWidth = strlen(properties[i]);
-        }
-    }
-    colWidth++;
-    
-    printf("Device Dump:\n\n");
-    
-    for (CFIndex i = 0; i < numDevices; i++) {
-        IOHIDDeviceRef device = devices[i];
-        char *prefix = NULL;
-        
-        asprintf(&prefix, "%02ld ", i);
-        
-        for (int j = 0;properties[j];j++) {
-            const char *valStr = "<notSet>";
-            
-            CFTypeRef v = IOHIDDeviceGetProperty(device, cStr_properties[j]);
-            
-            if (!v) {
-                if (!verbose) continue;
-            } else {
-                CFMutableStringRef buf = CFStringCreateMutable(kCFAllocatorDefault, 1024);
-                CFAutorelease(buf);
-                cfValueToString(buf, v);
-                valStr = CFStringGetCStringPtr(buf, kCFStringEncodingMacRoman);
-            }
-        
-            printf("%s %-*s: %s\n", prefix, (int)colWidth, properties[j], valStr);
-        }
-        dumpElements(prefix, device, verbose);
-        printf("\n");
-    }
-}
-
 int main(int argc, char * argv[]) {
     uint8_t wasdColor = 0, colorRed = 0, colorGreen = 0, colorBlue = 0;
     int opt_ch;
     int option_dump = 0;
+    enum dumpFormat option_dump_format = DUMP_FORMAT_TEXT;
+    struct dumpFilter dumpFilter;
+    int option_dump_filter = 0;
     int option_verbose = 0;
+    int option_daemon = 0;
+    int option_send = 0;
+    int option_cache = 1;
+    int option_rate_control = 1;
+    int option_window = 0;
+    int option_iterations = 200;
+    const char *option_socket = NULL;
+    const char *option_bench = NULL;
+    enum benchFormat option_bench_format = BENCH_FORMAT_TEXT;
+    const char *option_transport = NULL;
+    const char *option_batch = NULL;
+    const char *option_resolve_cache = NULL;
+    const char *option_compile = NULL;
+    const char *option_play = NULL;
+    const char *option_record = NULL;
+    const char *option_replay = NULL;
+    double option_speed = 1.0;
+    int option_shared = 0;
+    uint64_t option_poll = 1000000ull;
+    const char *option_shm = NULL;
+    const char *option_publish[MAX_PUBLISH];
+    int numPublish = 0;
+    int option_sync = 0;
+    struct phaseLockOptions phaseLock = { 1000000ull, 1, NULL, NULL, 0 };
+    const char *option_state = NULL;
+    int option_follow = 0;
+    FILE *option_reload_report = NULL;
+    int option_profiles = 0;
+    int option_stats = 0;
+    int option_watch = 0;
+    int option_audio = 0;
+    struct audioOptions audio = { 48000, 2, AUDIO_FORMAT_S16, 60.0, 0, { 0 } };
+    enum latencyFormat option_stats_format = LATENCY_FORMAT_TEXT;
+    struct animationOptions animation = { EFFECT_NONE, 60.0, 2000000000ull, 0, { 0 }, { 0 }, NULL, NULL };
+    struct compositor layers;
+    struct exprProgram program;
+    int64_t option_duration = -1;
+    int64_t option_write_timeout = 250000000ll;
+    const char *progPath = argv[0];
     
     static struct option longopts[] = {
         { "help", no_argument, NULL, 'h' },
         { "dump", no_argument, NULL, 'd' },
+        { "dump-format", required_argument, NULL, 'F' },
+        { "dump-filter", required_argument, NULL, 'f' },
         { "verbose", no_argument, NULL, 'v' },
         { "color", required_argument, NULL, 'c' },
         { "rgb", required_argument, NULL, 'C' },
+        { "wasd", required_argument, NULL, 'A' },
+        { "layer", required_argument, NULL, 'G' },
+        { "daemon", no_argument, NULL, 'D' },
+        { "send", no_argument, NULL, 's' },
+        { "socket", required_argument, NULL, 'S' },
+        { "bench", required_argument, NULL, 'B' },
+        { "bench-format", required_argument, NULL, 'O' },
+        { "iterations", required_argument, NULL, 'n' },
+        { "transport", required_argument, NULL, 't' },
+        { "effect", required_argument, NULL, 'e' },
+        { "expr", required_argument, NULL, 'x' },
+        { "rate", required_argument, NULL, 'r' },
+        { "period", required_argument, NULL, 'p' },
+        { "duration", required_argument, NULL, 'u' },
+        { "to", required_argument, NULL, 'T' },
+        { "no-cache", no_argument, NULL, 'N' },
+        { "no-rate-control", no_argument, NULL, 'Q' },
+        { "window", required_argument, NULL, 'i' },
+        { "batch", required_argument, NULL, 'b' },
+        { "write-timeout", required_argument, NULL, 'W' },
+        { "resolve-cache", required_argument, NULL, 'R' },
+        { "profiles", no_argument, NULL, 'P' },
+        { "stats", optional_argument, NULL, 'L' },
+        { "watch", no_argument, NULL, 'w' },
+        { "audio", optional_argument, NULL, 'a' },
+        { "compile", required_argument, NULL, 'k' },
+        { "play", required_argument, NULL, 'l' },
+        { "record", required_argument, NULL, 'o' },
+        { "replay", required_argument, NULL, 'y' },
+        { "speed", required_argument, NULL, 'z' },
+        { "shared", optional_argument, NULL, 'm' },
+        { "publish", required_argument, NULL, 'M' },
+        { "shm", required_argument, NULL, 'K' },
+        { "sync", optional_argument, NULL, 'E' },
+        { "skew-report", no_argument, NULL, 'X' },
+        { "state", required_argument, NULL, 'Y' },
+        { "follow", no_argument, NULL, 'J' },
+        { "reload-report", no_argument, NULL, 'U' },
         { NULL, 0, NULL, 0 }
     };
     
     if (argc == 1)
         usage(1, argv, longopts);
     
-    while ((opt_ch = getopt_long(argc, argv, "hdvc:C:", longopts, NULL)) != -1) {
+    // Reports are laid out for the first profile, layers name its zones
+    compositorInit(&layers, &deviceProfiles[0]);
+    
+    while ((opt_ch = getopt_long(argc, argv, "hdvc:C:A:G:DsS:B:n:t:e:x:r:p:u:T:NQi:b:W:R:PF:f:O:L::wa::k:l:o:y:z:m::M:K:E::XY:JU", longopts, NULL)) != -1) {
         switch (opt_ch) {
             case 'd':
                 option_dump = 1;
                 break;
+            case 'F':
+                if (dumpFormatParse(optarg, &option_dump_format)) {
+                    fprintf(stderr, "Unknown dump format '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                option_dump = 1;
+                break;
+            case 'f':
+                if (dumpFilterParse(optarg, &dumpFilter))
+                    usage(1, argv, longopts);
+                option_dump_filter = 1;
+                option_dump = 1;
+                break;
             case 'v':
                 option_verbose++;
                 break;
@@ -500,7 +258,194 @@ int main(int argc, char * argv[]) {
                 colorRed = colorGreen = colorBlue = atoi(optarg);
                 break;
             case 'C':
-                parseColor(optarg, &colorRed, &colorGreen, &colorBlue);
+                if (strcmp(optarg, "list") == 0) {
+                    colorList();
+                    exit(0);
+                }
+                
+                if (parseColor(optarg, &colorRed, &colorGreen, &colorBlue)) {
+                    fprintf(stderr, "Unknown color '%s', --rgb list shows the names\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'A':
+                wasdColor = atoi(optarg);
+                break;
+            case 'G':
+                if (compositorAddLayer(&layers, optarg))
+                    usage(1, argv, longopts);
+                break;
+            case 'D':
+                option_daemon = 1;
+                break;
+            case 's':
+                option_send = 1;
+                break;
+            case 'S':
+                option_socket = optarg;
+                break;
+            case 'B':
+                option_bench = optarg;
+                break;
+            case 'O':
+                if (benchFormatParse(optarg, &option_bench_format)) {
+                    fprintf(stderr, "Unknown benchmark format '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'n':
+                option_iterations = atoi(optarg);
+                break;
+            case 't':
+                option_transport = optarg;
+                break;
+            case 'e':
+                if ((animation.effect = animationParseEffect(optarg)) == EFFECT_NONE) {
+                    fprintf(stderr, "Unknown effect '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'x':
+                if (exprLoad(optarg, &deviceProfiles[0], &program))
+                    usage(1, argv, longopts);
+                
+                animation.effect = EFFECT_EXPR;
+                animation.program = &program;
+                break;
+            case 'r':
+                animation.rate = atof(optarg);
+                if (animation.rate < 1 || animation.rate > 1000) {
+                    fprintf(stderr, "Frame rate must be 1-1000\n");
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'p':
+            case 'u':
+            case 'W': {
+                int64_t nanos = parseDuration(optarg);
+                
+                if (nanos < 0) {
+                    fprintf(stderr, "Bad duration '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                
+                if (opt_ch == 'p')
+                    animation.period = nanos;
+                else if (opt_ch == 'u')
+                    option_duration = nanos;
+                else
+                    option_write_timeout = nanos;
+                break;
+            }
+            case 'T':
+                if (parseColor(optarg, &animation.to[1], &animation.to[2], &animation.to[3])) {
+                    fprintf(stderr, "Unknown color '%s', --rgb list shows the names\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'N':
+                option_cache = 0;
+                break;
+            case 'Q':
+                option_rate_control = 0;
+                break;
+            case 'i':
+                option_window = atoi(optarg);
+                if (option_window < 1 || option_window > ASYNC_MAX_WINDOW) {
+                    fprintf(stderr, "Window must be 1-%d\n", ASYNC_MAX_WINDOW);
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'b':
+                option_batch = optarg;
+                break;
+            case 'R':
+                option_resolve_cache = optarg;
+                break;
+            case 'P':
+                option_profiles = 1;
+                break;
+            case 'w':
+                option_watch = 1;
+                break;
+            case 'a':
+                if (audioParseSpec(optarg, &audio)) {
+                    fprintf(stderr, "Bad audio format '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                option_audio = 1;
+                break;
+            case 'k':
+                option_compile = optarg;
+                break;
+            case 'l':
+                option_play = optarg;
+                break;
+            case 'o':
+                option_record = optarg;
+                break;
+            case 'y':
+                option_replay = optarg;
+                break;
+            case 'z':
+                option_speed = strcmp(optarg, "max") == 0 ? 0 : atof(optarg);
+                if (option_speed < 0 || (option_speed == 0 && strcmp(optarg, "max") != 0)) {
+                    fprintf(stderr, "Speed must be a positive factor or max\n");
+                    usage(1, argv, longopts);
+                }
+                break;
+            case 'm':
+                if (optarg) {
+                    int64_t nanos = parseDuration(optarg);
+                    
+                    if (nanos < 0) {
+                        fprintf(stderr, "Bad poll interval '%s'\n", optarg);
+                        usage(1, argv, longopts);
+                    }
+                    option_poll = (uint64_t)nanos;
+                }
+                option_shared = 1;
+                break;
+            case 'M':
+                if (numPublish == MAX_PUBLISH) {
+                    fprintf(stderr, "At most %d --publish updates at once\n", MAX_PUBLISH);
+                    usage(1, argv, longopts);
+                }
+                option_publish[numPublish++] = optarg;
+                break;
+            case 'K':
+                option_shm = optarg;
+                break;
+            case 'E':
+                if (optarg) {
+                    int64_t nanos = parseDuration(optarg);
+                    
+                    if (nanos < 0) {
+                        fprintf(stderr, "Bad skew bound '%s'\n", optarg);
+                        usage(1, argv, longopts);
+                    }
+                    phaseLock.skewBound = (uint64_t)nanos;
+                }
+                option_sync = 1;
+                break;
+            case 'X':
+                phaseLock.report = stderr;
+                break;
+            case 'Y':
+                option_state = optarg;
+                break;
+            case 'J':
+                option_follow = 1;
+                break;
+            case 'U':
+                option_reload_report = stderr;
+                break;
+            case 'L':
+                if (optarg && latencyFormatParse(optarg, &option_stats_format)) {
+                    fprintf(stderr, "Unknown stats format '%s'\n", optarg);
+                    usage(1, argv, longopts);
+                }
+                option_stats = 1;
                 break;
             default:
                 usage(1, argv, longopts);
@@ -514,126 +459,327 @@ int main(int argc, char * argv[]) {
     if (option_verbose >= 4)
         option_dump = 1;
     
-    IOHIDManagerRef hidManagerRef = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
+    if (!option_socket)
+        option_socket = daemonDefaultSocketPath();
     
-    if (!hidManagerRef) {
-        fprintf(stderr, "Failed to get IOHIDManager!\n");
-        exit(2);
+    if (!option_shm)
+        option_shm = shmControlDefaultName();
+    
+    if (option_transport && strcmp(option_transport, "list") == 0) {
+        transportList();
+        exit(0);
     }
     
-    CFAutorelease(hidManagerRef);
+    if (option_profiles) {
+        deviceProfileList();
+        exit(0);
+    }
     
-    // Setup matching to get correct device(s)
-    CFMutableDictionaryRef matchDictRef = setMatchSelection(NULL, CFSTR(kIOHIDDeviceUsagePageKey), kHIDPage_GenericDesktop);
+    // Compiling needs no device, the packed timeline goes to stdout for --play
+    if (option_compile) {
+        FILE *script = strcmp(option_compile, "-") == 0 ? stdin : fopen(option_compile, "r");
+        
+        if (isatty(STDOUT_FILENO)) {
+            fprintf(stderr, "Refusing to write a compiled timeline to a terminal, redirect stdout to a file\n");
+            exit(11);
+        }
+        
+        if (!script) {
+            fprintf(stderr, "Failed to open %s: %s\n", option_compile, strerror(errno));
+            exit(11);
+        }
+        
+        int failed = timelineCompile(script, option_compile, animation.rate, STDOUT_FILENO, option_verbose);
+        
+        if (script != stdin)
+            fclose(script);
+        
+        exit(failed ? 11 : 0);
+    }
     
-    setMatchSelection(matchDictRef, CFSTR(kIOHIDDeviceUsageKey), kHIDUsage_GD_Keyboard);
+    // Replays open their own transport, the fake device sized to the log unless --transport says otherwise
+    if (option_replay) {
+        struct replayStats stats;
+        int failed = recorderReplay(option_replay, option_transport, option_speed, option_verbose, &stats);
+        
+        if (failed < 0)
+            exit(12);
+        
+        recorderPrintReplayStats(&stats, option_speed);
+        exit(failed ? 100 : 0);
+    }
     
-    if (!option_dump) {
-        // Look for Logitech (0x046d) with Vendor extensions (DeviceUsagePage=0xff00, DeviceUsage=0x0)
-        setMatchSelection(matchDictRef, CFSTR(kIOHIDVendorIDKey), 0x046d);
+    // Producer side, the slots go straight into the writer's shared memory and nothing touches a device here
+    if (numPublish) {
+        struct shmControl shm;
+        int failed = 0;
+        
+        if (shmControlAttach(option_shm, &shm))
+            exit(12);
         
-        CFMutableDictionaryRef deviceUsagePairs = CFDictionaryCreateMutable(kCFAllocatorDefault, 2, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-        int32_t matchUsagePage = 0xff00, matchUsage = 0x0;
-        CFDictionarySetValue(deviceUsagePairs, CFSTR("DeviceUsagePage"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &matchUsagePage));
-        CFDictionarySetValue(deviceUsagePairs, CFSTR("DeviceUsage"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &matchUsage));
-        CFMutableArrayRef deviceUsagePairsArray = CFArrayCreateMutable(kCFAllocatorDefault, 1, &kCFTypeArrayCallBacks);
-        CFArrayAppendValue(deviceUsagePairsArray, deviceUsagePairs);
-        CFDictionarySetValue(matchDictRef, CFSTR("DeviceUsagePairs"), deviceUsagePairsArray);
+        for (int i = 0; i < numPublish && !failed; i++) {
+            failed = shmControlPublishSpec(&shm, option_publish[i]);
+        }
+        
+        shmControlDetach(&shm);
+        exit(failed ? 12 : 0);
+    }
+    
+    uint8_t usb_data[KEYCOLOR_REPORT_SIZE] = { wasdColor, colorRed, colorGreen, colorBlue };
+    
+    if (animation.program && option_verbose > 1)
+        exprDisassemble(animation.program, stderr);
+    
+    // Still layers flatten into the color once, an effect or a flash restacks them every frame
+    if (layers.numLayers) {
+        if (animation.effect == EFFECT_NONE && !compositorAnimated(&layers))
+            compositorRender(&layers, 0, usb_data, usb_data, sizeof(usb_data));
+        else
+            animation.layers = &layers;
+    }
+    
+    if (option_bench) {
+        struct benchOptions benchOpts = { progPath, option_socket, option_transport, option_iterations > 0 ? option_iterations : 1, option_verbose, { 0 }, option_bench_format };
+        memcpy(benchOpts.report, usb_data, sizeof(usb_data));
+        exit(benchRun(option_bench, &benchOpts));
     }
     
-    IOHIDManagerSetDeviceMatching(hidManagerRef, matchDictRef);
-    CFRelease(matchDictRef);
-    matchDictRef = NULL;
+    // Thin client, the daemon already holds the devices open
+    if (option_send)
+        exit(daemonSend(option_socket, usb_data) ? 100 : 0);
     
-    // Open the device manager
-    IOReturn retVal = IOHIDManagerOpen(hidManagerRef, kIOHIDOptionsTypeNone);
+    // The recorder, writer and run loop threads started below all inherit SIGUSR1 blocked, only the stats thread takes it
+    if (option_stats && !option_dump)
+        latencyStatsBlockSignal();
     
-    if (retVal) {
+    struct hidTransport *transport = transportOpen(option_transport, option_dump, option_verbose);
+    
+    if (!transport) {
         fprintf(stderr, "Failed to open HID device manager!\n");
         exit(4);
     }
     
-    CFSetRef devicesFound = IOHIDManagerCopyDevices(hidManagerRef);
+    transportSetCaching(transport, option_cache);
+    transportSetRateControl(transport, option_rate_control);
+    
+    // Every report that reaches a keyboard, with its result, for --replay
+    struct recorder *recorder = NULL;
     
-    if (!devicesFound) {
-        fprintf(stderr, "Failed to copy out devices that were found!\n");
-        exit(5);
+    if (option_record && !option_dump) {
+        if (!(recorder = recorderOpen(option_record))) {
+            transportClose(transport);
+            exit(12);
+        }
+        transportSetRecorder(transport, recorder);
     }
     
-    CFIndex numDevices = CFSetGetCount(devicesFound);
+    // Remembers where each keyboard's color report lives so the next run can skip element matching
+    struct resolveCache *resolveCache = NULL;
     
-    IOHIDDeviceRef *devices = malloc(sizeof(IOHIDDeviceRef) * numDevices);
+    if (!option_resolve_cache)
+        option_resolve_cache = resolveCacheDefaultPath();
     
-    if (!devices) {
-        fprintf(stderr, "Failed to allocate memory for device list!\n");
-        CFRelease(devicesFound);
-        exit(6);
+    if (!option_dump && option_resolve_cache && strcmp(option_resolve_cache, "off") != 0) {
+        resolveCache = resolveCacheOpen(option_resolve_cache);
+        transportSetResolveCache(transport, resolveCache);
     }
     
-    CFSetGetValues(devicesFound, (const void **)devices);
-    CFRelease(devicesFound);
-    devicesFound = NULL;
+    // Per device phase timings, SIGUSR1 prints them while a daemon or animation keeps running
+    struct latencyStats *latency = NULL;
+    
+    if (option_stats && !option_dump) {
+        if (!(latency = latencyStatsCreate())) {
+            fprintf(stderr, "Failed to allocate latency stats!\n");
+        } else {
+            transportSetLatencyStats(transport, latency);
+            latencyStatsStartSignalDump(latency, option_stats_format);
+        }
+    }
     
     int exitValue = 0;
     
-    if (option_dump)
-        dumpDevices(devices, numDevices, option_verbose > 4 ? 1 : 0);
-    else
-        for (CFIndex i = 0;i < numDevices;i++) {
-            CFNumberRef productIdRef = IOHIDDeviceGetProperty(devices[i], CFSTR(kIOHIDProductIDKey));
-            int32_t productId = 0, cookieId = 0;
-            CFNumberGetValue(productIdRef, kCFNumberSInt32Type, &productId);
+    if (option_dump) {
+        if (transportDump(transport, option_dump_format, option_dump_filter ? &dumpFilter : NULL, option_verbose > 4 ? 1 : 0))
+            exitValue = 9;
+    } else if (option_watch) {
+        struct hotplugStats stats;
+        
+        // Stays resident, each keyboard gets the color within a write of being plugged in
+        memset(&stats, 0, sizeof(stats));
+        
+        if (hotplugRun(transport, usb_data, sizeof(usb_data), option_verbose, &stats))
+            exitValue = 10;
+        
+        hotplugPrintStats(&stats, stderr);
+        
+        if (option_verbose)
+            transportPrintStats(transport, stderr);
+        
+        if (latency)
+            latencyStatsPrint(latency, option_stats_format);
+    } else {
+        struct keyColorTarget *targets = NULL;
+        size_t numTargets = 0;
+        
+        if (transportResolveTargets(transport, &targets, &numTargets)) {
+            recorderClose(recorder, 0);
+            transportClose(transport);
+            resolveCacheClose(resolveCache);
+            latencyStatsFree(latency);
+            exit(5);
+        }
+        
+        // An effect under --sync runs its own thread per keyboard to time each write
+        int phaseLocked = option_sync && !option_daemon && !option_shared && !option_batch && !option_play && !option_audio && (animation.effect != EFFECT_NONE || animation.layers);
+        
+        // Several keyboards get a writer thread each so one slow board can't hold up the rest, a window
+        // keeps that many writes in flight per keyboard instead. A state file writes only the keyboards
+        // whose report changed, one at a time
+        if (phaseLocked || option_state) {
+            // Nothing to start
+        } else if (option_window) {
+            if (transportStartAsync(transport, targets, numTargets, (unsigned)option_window, (uint64_t)option_write_timeout)) {
+                transportReleaseTargets(targets, numTargets);
+                recorderClose(recorder, 0);
+                transportClose(transport);
+                resolveCacheClose(resolveCache);
+                latencyStatsFree(latency);
+                exit(6);
+            }
+        } else if (numTargets > 1 && transportStartWriters(transport, targets, numTargets, (uint64_t)option_write_timeout)) {
+            transportReleaseTargets(targets, numTargets);
+            recorderClose(recorder, 0);
+            transportClose(transport);
+            resolveCacheClose(resolveCache);
+            latencyStatsFree(latency);
+            exit(6);
+        }
+        
+        if (option_daemon) {
+            if (daemonRun(option_socket, targets, numTargets, option_verbose))
+                exitValue = 7;
+        } else if (option_shared) {
+            struct shmControl shm;
+            struct shmControlStats stats;
             
-            if (productId == 0xc24d) {
-                // Logitech G710+ not sure about others yet
-                cookieId = 0x11d;
+            // Zones nobody publishes show the -c/-C color
+            if (shmControlCreate(option_shm, numTargets && targets[0].profile ? targets[0].profile : &deviceProfiles[0], &shm)) {
+                exitValue = 12;
+            } else {
+                if (shmControlRun(&shm, usb_data, targets, numTargets, option_poll, NULL, &stats))
+                    exitValue = 100;
+                
+                if (option_verbose)
+                    shmControlPrintStats(&stats, stderr);
+                
+                shmControlDetach(&shm);
             }
+        } else if (option_state) {
+            struct stateFileStats stats;
+            
+            // Zones the file leaves out show the -c/-C color, --follow stays resident and reloads on every change
+            memset(&stats, 0, sizeof(stats));
+            
+            int failed = stateFileRun(option_state, usb_data, targets, numTargets, option_follow, animation.rate, option_reload_report, NULL, &stats);
+            
+            if (failed)
+                exitValue = failed < 0 ? 13 : 100;
             
-            if (cookieId == 0) {
-                printf("Skipping unknown productId = 0x%x\n", productId);
-                continue;
+            if (option_verbose || (option_follow && option_reload_report))
+                stateFilePrintStats(&stats, stderr);
+        } else if (option_batch) {
+            struct batchStats stats;
+            int fd = strcmp(option_batch, "-") == 0 ? STDIN_FILENO : open(option_batch, O_RDONLY);
+            
+            if (fd < 0) {
+                fprintf(stderr, "Failed to open %s: %s\n", option_batch, strerror(errno));
+                exitValue = 8;
+            } else {
+                if (batchRun(fd, usb_data, targets, numTargets, option_verbose, &stats))
+                    exitValue = 100;
+                
+                if (option_verbose)
+                    batchPrintStats(&stats);
+                
+                if (fd != STDIN_FILENO)
+                    close(fd);
             }
+        } else if (option_play) {
+            struct timeline timeline;
+            struct timelineStats stats;
             
-            matchDictRef = setMatchSelection(NULL, CFSTR(kIOHIDElementCookieKey), cookieId);
-            CFAutorelease(matchDictRef);
+            if (timelineOpen(option_play, &timeline)) {
+                exitValue = 11;
+            } else {
+                if (timelinePlay(&timeline, targets, numTargets, 1, &stats))
+                    exitValue = 100;
+                
+                timelinePrintStats(&timeline, &stats);
+                timelineClose(&timeline);
+            }
+        } else if (option_audio) {
+            struct audioStats stats;
             
-            CFArrayRef elements = IOHIDDeviceCopyMatchingElements(devices[i], matchDictRef, kIOHIDOptionsTypeNone);
+            // Bands map onto the report fields, a -c/-C color caps each field and otherwise they go to full
+            audio.rate = animation.rate;
+            audio.duration = option_duration > 0 ? (uint64_t)option_duration : 0;
             
-            if (!elements) {
-                if (option_verbose) {
-                    fprintf(stderr, "NOTE: Device[%lx] did not have any matching elements\n", (unsigned long)devices[i]);
-                }
-                continue;
+            for (int i = 0; i < KEYCOLOR_REPORT_SIZE; i++) {
+                audio.ceiling[i] = usb_data[1] || usb_data[2] || usb_data[3] ? usb_data[i] : 255;
             }
             
-            CFAutorelease(elements);
+            if (audioRun(&audio, STDIN_FILENO, targets, numTargets, &stats))
+                exitValue = 100;
             
-            CFIndex numElements = CFArrayGetCount(elements);
+            audioPrintStats(&stats, stderr);
+        } else if (animation.effect != EFFECT_NONE || animation.layers) {
+            struct animationStats stats;
             
-            for (CFIndex j = 0;j < numElements;j++) {
-                IOHIDElementRef elementRef = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, j);
-                
-                if (!elementRef) {
-                    continue;
-                }
+            memcpy(animation.from, usb_data, sizeof(usb_data));
+            // A fade runs once unless told otherwise, everything else loops until interrupted
+            animation.duration = option_duration >= 0 ? (uint64_t)option_duration : animation.effect == EFFECT_FADE ? animation.period : 0;
+            
+            if (phaseLocked) {
+                struct phaseLockStats lockStats;
                 
-                uint64_t timestamp = 0;
-                uint8_t usb_data[] = { wasdColor, colorRed, colorGreen, colorBlue };
+                if (phaseLockRun(&animation, targets, numTargets, &phaseLock, &lockStats))
+                    exitValue = 100;
                 
-                IOHIDValueRef valueRef = IOHIDValueCreateWithBytes(kCFAllocatorDefault, elementRef, timestamp, usb_data, sizeof(usb_data));
+                phaseLockPrintStats(&phaseLock, &lockStats, stderr);
+            } else {
+                if (animationRun(&animation, targets, numTargets, &stats))
+                    exitValue = 100;
                 
-                if (valueRef) {
-                    retVal = IOHIDDeviceSetValue(devices[i], elementRef, valueRef);
-                    CFRelease(valueRef);
-                    
-                    if (retVal) {
-                        fprintf(stderr, "WARNING: DeviceSetValue returned %d\n", retVal);
-                        exitValue = 100;
-                    }
-                }
+                animationPrintStats(&animation, &stats);
             }
+        } else if (transportWrite(targets, numTargets, usb_data, sizeof(usb_data))) {
+            exitValue = 100;
         }
+        
+        transportStopWriters(transport);
+        
+        if (transportStopAsync(transport))
+            exitValue = 100;
+        
+        if (option_verbose)
+            transportPrintRateStats(targets, numTargets, stderr);
+        
+        transportReleaseTargets(targets, numTargets);
+        
+        if (option_verbose)
+            transportPrintStats(transport, stderr);
+        
+        if (latency)
+            latencyStatsPrint(latency, option_stats_format);
+    }
     
-    free(devices);
+    transportSetRecorder(transport, NULL);
+    
+    if (recorderClose(recorder, option_verbose) && !exitValue)
+        exitValue = 12;
+    
+    transportClose(transport);
+    resolveCacheClose(resolveCache);
+    latencyStatsFree(latency);
     exit(exitValue);
-}
\ No newline at end of file
+}
@@ -0,0 +1,400 @@
+//
+//  phaselock.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include "phaselock.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "compositor.h"
+
+static volatile sig_atomic_t phaseLockStopRequested = 0;
+
+static void phaseLockSignalHandler(int sig)
+{
+    phaseLockStopRequested = sig;
+}
+
+struct phaseLockSession;
+
+// One thread per board so each can start its write at its own moment
+struct phaseLockDevice {
+    struct phaseLockSession *session;
+    struct keyColorTarget *target;
+    pthread_t thread;
+    double estimate;            // nanoseconds from starting a write to it landing, moving average
+    double deviation;           // mean absolute deviation of the same
+    uint64_t frame;             // last frame taken
+    uint64_t landed;            // monotonicNanos() the last frame landed, 0 if the board held or skipped it
+    int status;
+    int late;
+    uint8_t lastReport[KEYCOLOR_REPORT_SIZE];
+    int haveLast;
+};
+
+struct phaseLockSession {
+    const struct phaseLockOptions *opts;
+    struct phaseLockDevice *devices;
+    size_t numDevices;
+    pthread_mutex_t lock;
+    pthread_cond_t posted;
+    pthread_cond_t done;
+    uint64_t frame;             // newest frame posted, numbered from 1
+    uint64_t presentAt;         // monotonicNanos() every board should show it at
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    size_t pending;             // boards still working on the posted frame
+    int stop;
+};
+
+static void *phaseLockThread(void *arg)
+{
+    struct phaseLockDevice *device = arg;
+    struct phaseLockSession *session = device->session;
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    
+    pthread_mutex_lock(&session->lock);
+    
+    for (;;) {
+        while (!session->stop && session->frame == device->frame) {
+            pthread_cond_wait(&session->posted, &session->lock);
+        }
+        
+        if (session->stop) {
+            break;
+        }
+        
+        uint64_t presentAt = session->presentAt;
+        
+        device->frame = session->frame;
+        memcpy(report, session->report, sizeof(report));
+        pthread_mutex_unlock(&session->lock);
+        
+        uint64_t landed = 0;
+        int status = 0, late = 0;
+        
+        // The board already shows it, nothing lands and it stays out of the skew
+        if (!device->haveLast || memcmp(report, device->lastReport, sizeof(report)) != 0) {
+            uint64_t estimate = session->opts->compensate ? (uint64_t)device->estimate : 0;
+            
+            sleepUntilNanos(presentAt - estimate);
+            
+            uint64_t startTime = monotonicNanos();
+            
+            if (session->opts->compensate && session->opts->skewBound && device->haveLast && startTime + estimate > presentAt + session->opts->skewBound) {
+                late = 1;
+            } else {
+                status = transportWriteTarget(device->target, report, sizeof(report));
+                landed = monotonicNanos();
+                
+                double sample = (double)(landed - startTime);
+                
+                // First sample seeds the average, after that roughly the last 8 writes count
+                if (!device->haveLast) {
+                    device->estimate = sample;
+                } else {
+                    device->deviation += (fabs(sample - device->estimate) - device->deviation) / 8.0;
+                    device->estimate += (sample - device->estimate) / 8.0;
+                }
+                
+                if (!status) {
+                    memcpy(device->lastReport, report, sizeof(report));
+                    device->haveLast = 1;
+                }
+            }
+        }
+        
+        pthread_mutex_lock(&session->lock);
+        device->landed = status ? 0 : landed;
+        device->status = status;
+        device->late = late;
+        
+        if (--session->pending == 0) {
+            pthread_cond_signal(&session->done);
+        }
+    }
+    
+    pthread_mutex_unlock(&session->lock);
+    
+    return NULL;
+}
+
+// How far ahead of its time a frame goes out, enough for the slowest board to start its write on time
+static uint64_t phaseLockLead(const struct phaseLockSession *session)
+{
+    double lead = 0;
+    
+    if (!session->opts->compensate) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < session->numDevices; i++) {
+        double need = session->devices[i].estimate + 2.0 * session->devices[i].deviation;
+        
+        lead = need > lead ? need : lead;
+    }
+    
+    return (uint64_t)lead + PHASE_LOCK_MARGIN;
+}
+
+static void phaseLockReportFrame(const struct phaseLockSession *session, uint64_t t, uint64_t skew, FILE *fp)
+{
+    fprintf(fp, "frame=%llu t=%.3fs skew=%.1fus", (unsigned long long)session->frame, t / 1e9, skew / 1e3);
+    
+    for (size_t i = 0; i < session->numDevices; i++) {
+        const struct phaseLockDevice *device = &session->devices[i];
+        
+        if (device->status) {
+            fprintf(fp, " %d:failed", device->target->index);
+        } else if (device->late) {
+            fprintf(fp, " %d:late", device->target->index);
+        } else if (!device->landed) {
+            fprintf(fp, " %d:held", device->target->index);
+        } else {
+            fprintf(fp, " %d:%+.1fus", device->target->index, ((double)device->landed - (double)session->presentAt) / 1e3);
+        }
+    }
+    
+    fprintf(fp, "\n");
+}
+
+// Every board is written the frame for one shared time. Each starts its write early by its own measured
+// latency so the reports land together, and the skew between the first and last to land is kept per frame
+int phaseLockRun(const struct animationOptions *animation, struct keyColorTarget *targets, size_t numTargets, const struct phaseLockOptions *opts, struct phaseLockStats *stats)
+{
+    struct phaseLockSession session;
+    uint64_t framePeriod = (uint64_t)(1e9 / animation->rate);
+    uint64_t frame = 0;
+    size_t numStarted = 0;
+    
+    memset(stats, 0, sizeof(*stats));
+    memset(&session, 0, sizeof(session));
+    
+    if (framePeriod == 0) {
+        framePeriod = 1;
+    }
+    
+    if (!(session.devices = calloc(numTargets ? numTargets : 1, sizeof(struct phaseLockDevice)))) {
+        fprintf(stderr, "Failed to allocate phase lock state!\n");
+        return -1;
+    }
+    
+    session.opts = opts;
+    session.numDevices = numTargets;
+    pthread_mutex_init(&session.lock, NULL);
+    pthread_cond_init(&session.posted, NULL);
+    pthread_cond_init(&session.done, NULL);
+    
+    for (; numStarted < numTargets; numStarted++) {
+        struct phaseLockDevice *device = &session.devices[numStarted];
+        
+        device->session = &session;
+        device->target = &targets[numStarted];
+        
+        if (pthread_create(&device->thread, NULL, phaseLockThread, device)) {
+            fprintf(stderr, "Failed to start phase lock thread for device %d\n", targets[numStarted].index);
+            stats->writeFailures++;
+            break;
+        }
+    }
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = phaseLockSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    
+    uint64_t startTime = monotonicNanos();
+    
+    while (numStarted == numTargets && !phaseLockStopRequested) {
+        uint64_t t = frame * framePeriod;
+        
+        if (animation->duration && t > animation->duration) {
+            break;
+        }
+        
+        sleepUntilNanos(startTime + t);
+        
+        uint64_t lead = phaseLockLead(&session);
+        
+        stats->leadMax = lead > stats->leadMax ? lead : stats->leadMax;
+        
+        // Rendered for the frame's own time, whenever each board gets it
+        pthread_mutex_lock(&session.lock);
+        animationRender(animation, t, session.report);
+        
+        if (animation->layers) {
+            compositorRender(animation->layers, t, session.report, session.report, sizeof(session.report));
+        }
+        
+        session.presentAt = startTime + t + lead;
+        session.pending = numTargets;
+        session.frame++;
+        pthread_cond_broadcast(&session.posted);
+        
+        // Writes have no deadline of their own here, a wedged board holds every frame like it would a plain write
+        while (session.pending) {
+            pthread_cond_wait(&session.done, &session.lock);
+        }
+        
+        uint64_t first = UINT64_MAX, last = 0;
+        
+        for (size_t i = 0; i < numTargets; i++) {
+            struct phaseLockDevice *device = &session.devices[i];
+            
+            stats->writeFailures += device->status ? 1 : 0;
+            stats->lateWrites += (uint64_t)device->late;
+            
+            if (device->landed) {
+                first = device->landed < first ? device->landed : first;
+                last = device->landed > last ? device->landed : last;
+            }
+        }
+        
+        uint64_t skew = last >= first ? last - first : 0;
+        
+        // The first frame is what seeds each board's latency, it lands however it lands
+        if (session.frame > 1) {
+            latencyHistogramRecord(&stats->skew, skew, opts->skewBound && skew > opts->skewBound);
+            stats->overBound += opts->skewBound && skew > opts->skewBound ? 1 : 0;
+            
+            if (opts->skews && stats->numSkews < opts->maxSkews) {
+                opts->skews[stats->numSkews++] = skew;
+            }
+        }
+        
+        if (opts->report) {
+            phaseLockReportFrame(&session, t, skew, opts->report);
+        }
+        pthread_mutex_unlock(&session.lock);
+        
+        stats->frames++;
+        
+        // Same as animationRun, missed deadlines are skipped rather than burst through
+        uint64_t now = monotonicNanos() - startTime;
+        uint64_t nextFrame = frame + 1;
+        
+        if (now > nextFrame * framePeriod) {
+            uint64_t caughtUp = now / framePeriod + 1;
+            
+            stats->framesDropped += caughtUp - nextFrame;
+            nextFrame = caughtUp;
+        }
+        
+        frame = nextFrame;
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    
+    pthread_mutex_lock(&session.lock);
+    session.stop = 1;
+    pthread_cond_broadcast(&session.posted);
+    pthread_mutex_unlock(&session.lock);
+    
+    for (size_t i = 0; i < numStarted; i++) {
+        pthread_join(session.devices[i].thread, NULL);
+    }
+    
+    pthread_cond_destroy(&session.done);
+    pthread_cond_destroy(&session.posted);
+    pthread_mutex_destroy(&session.lock);
+    free(session.devices);
+    
+    return stats->writeFailures ? -1 : 0;
+}
+
+void phaseLockPrintStats(const struct phaseLockOptions *opts, const struct phaseLockStats *stats, FILE *fp)
+{
+    double seconds = stats->elapsed / 1e9;
+    
+    fprintf(fp, "frames=%llu dropped=%llu failed=%llu late=%llu elapsed=%.3fs achieved=%.1ffps lead=%.1fus\n",
+            (unsigned long long)stats->frames, (unsigned long long)stats->framesDropped,
+            (unsigned long long)stats->writeFailures, (unsigned long long)stats->lateWrites, seconds,
+            seconds > 0 ? stats->frames / seconds : 0.0, stats->leadMax / 1e3);
+    
+    if (stats->skew.count) {
+        fprintf(fp, "skew p50=%.1fus p99=%.1fus max=%.1fus bound=%.1fus over=%llu/%llu\n",
+                latencyHistogramPercentile(&stats->skew, 50) / 1e3, latencyHistogramPercentile(&stats->skew, 99) / 1e3,
+                stats->skew.max / 1e3, opts->skewBound / 1e3, (unsigned long long)stats->overBound,
+                (unsigned long long)stats->skew.count);
+    }
+}
+
+// Three boards 1ms, 4ms and 9ms slow with up to 300us of jitter each, written all at once and phase locked
+int phaseLockBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:devices=3,latency=1ms/4ms/9ms,jitter=300us";
+    struct animationOptions animation = { EFFECT_CYCLE, 50.0, 2000000000ull, 0, { 0, 255, 0, 0 }, { 0 }, NULL, NULL };
+    int numFrames = opts->iterations < 200 ? opts->iterations : 200;
+    uint64_t *skews = calloc((size_t)numFrames, sizeof(uint64_t));
+    int ret = 0;
+    
+    if (!skews) {
+        return -1;
+    }
+    
+    animation.duration = (uint64_t)numFrames * (uint64_t)(1e9 / animation.rate);
+    
+    for (int compensate = 0; compensate <= 1 && ret == 0; compensate++) {
+        struct hidTransport *transport = transportOpen(spec, 0, 0);
+        struct keyColorTarget *targets = NULL;
+        size_t numTargets = 0;
+        struct phaseLockOptions lockOpts = { 1000000ull, compensate, NULL, skews, (size_t)numFrames };
+        struct phaseLockStats stats;
+        
+        if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets < 2) {
+            fprintf(stderr, "phase lock benchmark needs at least two keyboards\n");
+            transportClose(transport);
+            free(skews);
+            return -1;
+        }
+        
+        if (phaseLockRun(&animation, targets, numTargets, &lockOpts, &stats)) {
+            ret = -1;
+        }
+        
+        benchReportLatency(compensate ? "phase-locked" : "fan-out", skews, (int)stats.numSkews);
+        fprintf(benchNotes(), "# %s over 1ms bound=%llu/%llu late=%llu lead=%.1fus\n", compensate ? "phase-locked" : "fan-out",
+                (unsigned long long)stats.overBound, (unsigned long long)stats.skew.count,
+                (unsigned long long)stats.lateWrites, stats.leadMax / 1e3);
+        
+        transportReleaseTargets(targets, numTargets);
+        transportClose(transport);
+    }
+    
+    free(skews);
+    
+    return ret;
+}
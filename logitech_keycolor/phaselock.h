@@ -0,0 +1,67 @@
+//
+//  phaselock.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef phaselock_h
+#define phaselock_h
+
+#include <stdio.h>
+#include "keycolor.h"
+#include "animation.h"
+#include "latency.h"
+#include "bench.h"
+
+// Added to the slowest board's expected latency, how far ahead of a frame's time its writes start
+#define PHASE_LOCK_MARGIN 500000ull
+
+struct phaseLockOptions {
+    uint64_t skewBound;         // nanoseconds, a board that would land later than this past the frame's time skips it
+    int compensate;             // issue early by each board's latency, 0 issues all at once like a plain fan out
+    FILE *report;               // optional, one line per frame with each board's offset
+    uint64_t *skews;            // optional, each frame's skew in nanoseconds for up to maxSkews frames
+    size_t maxSkews;
+};
+
+struct phaseLockStats {
+    uint64_t frames;
+    uint64_t framesDropped;
+    uint64_t writeFailures;
+    uint64_t lateWrites;        // skipped, they would have landed out of bound
+    uint64_t overBound;         // frames whose measured skew exceeded the bound anyway
+    uint64_t leadMax;           // nanoseconds, the furthest ahead a frame was started
+    uint64_t elapsed;
+    size_t numSkews;
+    struct latencyHistogram skew;
+};
+
+int phaseLockRun(const struct animationOptions *animation, struct keyColorTarget *targets, size_t numTargets, const struct phaseLockOptions *opts, struct phaseLockStats *stats);
+void phaseLockPrintStats(const struct phaseLockOptions *opts, const struct phaseLockStats *stats, FILE *fp);
+int phaseLockBenchmark(struct benchOptions *opts);
+
+#endif /* phaselock_h */
@@ -0,0 +1,159 @@
+//
+//  profiles.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include "profiles.h"
+#include "keycolor.h"
+#include "bench.h"
+#include "timeutil.h"
+#include "color.h"
+
+// Add new boards here, nothing else in the write path is device specific
+const struct deviceProfile deviceProfiles[] = {
+    {
+        LOGITECH_VENDOR_ID, 0xc24d, "Logitech G710+",
+        0x11d, 0x08, KEYCOLOR_REPORT_SIZE,
+        2, {
+            { "wasd", 0, 1, 0, 255 },
+            { "keys", 1, 3, 0, 255 },
+        },
+        colorCalibrationG710
+    },
+    { 0, 0, NULL, 0, 0, 0, 0, { { NULL, 0, 0, 0, 0 } }, NULL }
+};
+
+const struct deviceProfile *deviceProfileLookup(uint32_t vendorId, uint32_t productId)
+{
+    for (const struct deviceProfile *profile = deviceProfiles; profile->name; profile++) {
+        if (profile->vendorId == vendorId && profile->productId == productId) {
+            return profile;
+        }
+    }
+    
+    return NULL;
+}
+
+const struct deviceZone *deviceProfileZone(const struct deviceProfile *profile, const char *name)
+{
+    for (int i = 0; i < profile->numZones; i++) {
+        if (strcmp(profile->zones[i].name, name) == 0) {
+            return &profile->zones[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Copies zone->length values into the zone's bytes clamped to its range, -1 if the zone lies outside the report
+int deviceProfileEncodeZone(const struct deviceZone *zone, const uint8_t *values, uint8_t *report, size_t reportLen)
+{
+    if ((size_t)zone->offset + zone->length > reportLen) {
+        return -1;
+    }
+    
+    for (int i = 0; i < zone->length; i++) {
+        uint8_t value = values[i];
+        
+        report[zone->offset + i] = value < zone->minValue ? zone->minValue : value > zone->maxValue ? zone->maxValue : value;
+    }
+    
+    return 0;
+}
+
+void deviceProfileList(void)
+{
+    for (const struct deviceProfile *profile = deviceProfiles; profile->name; profile++) {
+        printf("%04x:%04x %-20s cookie=0x%x reportId=0x%02x reportSize=%d zones:",
+               profile->vendorId, profile->productId, profile->name, profile->cookie, profile->reportId, profile->reportSize);
+        
+        for (int i = 0; i < profile->numZones; i++) {
+            const struct deviceZone *zone = &profile->zones[i];
+            
+            printf(" %s[%d..%d]=%d-%d", zone->name, zone->offset, zone->offset + zone->length - 1, zone->minValue, zone->maxValue);
+        }
+        printf("\n");
+    }
+}
+
+// Every zone of every profile per op, with and without looking the zone up by name first
+int deviceProfileBenchmark(struct benchOptions *opts)
+{
+    uint64_t ops = (uint64_t)opts->iterations * 10000;
+    unsigned sink = 0;
+    
+    for (const struct deviceProfile *profile = deviceProfiles; profile->name; profile++) {
+        uint8_t report[64];
+        uint8_t values[64];
+        char label[32];
+        
+        if (profile->reportSize > sizeof(report)) {
+            continue;
+        }
+        
+        for (size_t i = 0; i < sizeof(values); i++) {
+            values[i] = (uint8_t)(i * 29);
+        }
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (uint64_t i = 0; i < ops; i++) {
+            values[0] = (uint8_t)i;
+            
+            for (int z = 0; z < profile->numZones; z++) {
+                deviceProfileEncodeZone(&profile->zones[z], values, report, profile->reportSize);
+            }
+            sink += report[0];
+        }
+        
+        snprintf(label, sizeof(label), "%04x", profile->productId);
+        benchReportThroughput(label, ops, monotonicNanos() - startTime, benchAllocations() - allocs, ops * profile->reportSize);
+        
+        allocs = benchAllocations();
+        startTime = monotonicNanos();
+        
+        for (uint64_t i = 0; i < ops; i++) {
+            values[0] = (uint8_t)i;
+            
+            for (int z = 0; z < profile->numZones; z++) {
+                deviceProfileEncodeZone(deviceProfileZone(profile, profile->zones[z].name), values, report, profile->reportSize);
+            }
+            sink += report[0];
+        }
+        
+        snprintf(label, sizeof(label), "%04x+name", profile->productId);
+        benchReportThroughput(label, ops, monotonicNanos() - startTime, benchAllocations() - allocs, ops * profile->reportSize);
+    }
+    
+    fprintf(benchNotes(), "# checksum %u\n", sink);
+    
+    return 0;
+}
@@ -0,0 +1,70 @@
+//
+//  profiles.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef profiles_h
+#define profiles_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROFILE_MAX_ZONES 8
+
+// A group of keys driven by a contiguous run of bytes in the color report
+struct deviceZone {
+    const char *name;
+    uint8_t offset;             // first report byte
+    uint8_t length;             // 1 for a single level, 3 for r,g,b
+    uint8_t minValue;
+    uint8_t maxValue;
+};
+
+struct deviceProfile {
+    uint16_t vendorId;
+    uint16_t productId;
+    const char *name;
+    uint32_t cookie;            // IOKit element cookie of the color report
+    uint8_t reportId;           // feature report id, prefixed by the raw backends
+    uint8_t reportSize;         // payload bytes after the report id
+    int numZones;
+    struct deviceZone zones[PROFILE_MAX_ZONES];
+    const uint8_t (*calibration)[256];  // optional, one table per report byte, see gencolortables.py
+};
+
+extern const struct deviceProfile deviceProfiles[];
+
+const struct deviceProfile *deviceProfileLookup(uint32_t vendorId, uint32_t productId);
+const struct deviceZone *deviceProfileZone(const struct deviceProfile *profile, const char *name);
+int deviceProfileEncodeZone(const struct deviceZone *zone, const uint8_t *values, uint8_t *report, size_t reportLen);
+void deviceProfileList(void);
+
+struct benchOptions;
+int deviceProfileBenchmark(struct benchOptions *opts);
+
+#endif /* profiles_h */
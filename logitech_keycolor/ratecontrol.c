@@ -0,0 +1,171 @@
+//
+//  ratecontrol.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ratecontrol.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "bench.h"
+
+// Both in nanoseconds, 0 when the device doesn't say. The report interval is only the starting point
+void rateControlInit(struct rateControl *rate, uint64_t reportInterval, uint64_t requestTimeout)
+{
+    memset(rate, 0, sizeof(*rate));
+    rate->ceiling = requestTimeout && requestTimeout < RATE_MAX_INTERVAL ? requestTimeout : RATE_MAX_INTERVAL;
+    rate->interval = reportInterval < rate->ceiling ? reportInterval : rate->ceiling;
+}
+
+// Nanoseconds until the next write may start, 0 if it can go now
+uint64_t rateControlDelay(const struct rateControl *rate, uint64_t now)
+{
+    return rate->nextWrite > now ? rate->nextWrite - now : 0;
+}
+
+// Backs off by half again when the device pushes back, closes in on that edge quickly and then probes below it slowly
+void rateControlRecord(struct rateControl *rate, uint64_t startTime, uint64_t latency, int failed)
+{
+    if (rate->latencyAverage == 0) {
+        rate->latencyAverage = latency;
+    } else {
+        rate->latencyAverage = rate->latencyAverage + latency / 8 - rate->latencyAverage / 8;
+    }
+    
+    // The baseline slowly forgets so a device that really got slower stops looking congested
+    if (rate->latencyBase == 0 || latency < rate->latencyBase) {
+        rate->latencyBase = latency;
+    } else {
+        rate->latencyBase += rate->latencyBase / 256 + 1;
+    }
+    
+    if (failed || latency > 2 * rate->latencyBase + RATE_CONGESTION_SLACK) {
+        uint64_t interval = rate->interval + rate->interval / 2;
+        
+        // Nothing learned yet, the slow write itself is the best guess at what the device needs
+        if (interval < latency && rate->edge == 0) {
+            interval = latency;
+        }
+        
+        rate->edge = rate->interval;
+        rate->interval = interval < rate->ceiling ? interval : rate->ceiling;
+        rate->backoffs++;
+    } else {
+        // Until the device has pushed back there is no reason to hold anything
+        uint64_t target = rate->edge ? rate->latencyAverage / 4 : 0;
+        uint64_t floor = rate->edge > target ? rate->edge : target;
+        
+        if (rate->interval > floor + floor / 8) {
+            rate->interval -= (rate->interval - floor) / 4;
+        } else if (rate->interval > target) {
+            rate->interval -= rate->interval / 64 + 1;
+        }
+        
+        rate->edge -= rate->edge / 256;
+    }
+    
+    // Devices recover after a report has landed, so the gap runs from the end of the write
+    rate->nextWrite = rate->interval >= RATE_MIN_INTERVAL ? startTime + latency + rate->interval : 0;
+}
+
+void rateControlPrint(const struct rateControl *rate, int index, FILE *fp)
+{
+    fprintf(fp, "rate[%d] interval=%.1fus latency=%.1fus base=%.1fus ceiling=%.1fms waits=%llu waited=%.1fms backoffs=%llu\n",
+            index, rate->interval / 1e3, rate->latencyAverage / 1e3, rate->latencyBase / 1e3, rate->ceiling / 1e6,
+            (unsigned long long)rate->waits, rate->waited / 1e6, (unsigned long long)rate->backoffs);
+}
+
+// A 500fps producer against a fake board that needs 4ms between reports and punishes anything sooner
+static int rateBenchmarkRun(const char *spec, int enabled, int numFrames)
+{
+    struct hidTransport *transport = transportOpen(spec, 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        transportClose(transport);
+        return -1;
+    }
+    
+    transportSetCaching(transport, 0);
+    transportSetRateControl(transport, enabled);
+    
+    uint64_t *samples = calloc((size_t)numFrames, sizeof(uint64_t));
+    uint64_t framePeriod = 2000000ull;
+    uint8_t report[KEYCOLOR_REPORT_SIZE] = { 0, 0, 0, 0 };
+    int frame = 0, sent = 0, failed = 0;
+    
+    uint64_t startTime = monotonicNanos();
+    
+    while (samples && frame < numFrames) {
+        uint64_t deadline = startTime + (uint64_t)frame * framePeriod;
+        
+        sleepUntilNanos(deadline);
+        report[1] = (uint8_t)frame;
+        failed += transportWrite(targets, numTargets, report, sizeof(report));
+        
+        // How old the frame is by the time the board has it
+        samples[sent++] = monotonicNanos() - deadline;
+        
+        // Frames that came due during the write are stale, skip to the newest like animationRun
+        uint64_t now = monotonicNanos() - startTime;
+        int next = frame + 1;
+        
+        if (now > (uint64_t)next * framePeriod) {
+            next = (int)(now / framePeriod) + 1;
+        }
+        frame = next;
+    }
+    
+    double seconds = (monotonicNanos() - startTime) / 1e9;
+    
+    fprintf(benchNotes(), "# %s sent=%d/%d achieved=%.0ffps failed=%d\n", enabled ? "controlled" : "uncontrolled",
+            sent, numFrames, seconds > 0 ? sent / seconds : 0.0, failed);
+    transportPrintRateStats(targets, numTargets, benchNotes());
+    benchReportLatency(enabled ? "controlled" : "uncontrolled", samples, samples ? sent : 0);
+    
+    free(samples);
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return 0;
+}
+
+int rateControlBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:latency=200us,recover=4ms";
+    int numFrames = opts->iterations * 2;
+    
+    if (rateBenchmarkRun(spec, 0, numFrames) || rateBenchmarkRun(spec, 1, numFrames)) {
+        return -1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,66 @@
+//
+//  ratecontrol.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef ratecontrol_h
+#define ratecontrol_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bench.h"
+
+// Longest a target is ever held off between writes, also used when the device reports no timeout
+#define RATE_MAX_INTERVAL 100000000ull
+
+// Gaps shorter than this are not enforced, sleeping would cost more than the device does
+#define RATE_MIN_INTERVAL 50000ull
+
+// A write slower than twice the uncongested latency plus this is taken as the device pushing back
+#define RATE_CONGESTION_SLACK 250000ull
+
+// Per target estimate of how often the device can take a report, seeded from what it advertises
+struct rateControl {
+    uint64_t interval;          // nanoseconds the device is left alone after a write completes, the current estimate
+    uint64_t ceiling;           // backoff limit, the device's request timeout capped at RATE_MAX_INTERVAL
+    uint64_t edge;              // last interval the device pushed back at, slowly forgotten so it gets probed again
+    uint64_t latencyBase;       // lowest recent write latency, what an idle device costs
+    uint64_t latencyAverage;    // moving average over roughly the last 8 writes
+    uint64_t nextWrite;         // monotonicNanos() before which the next write is held
+    uint64_t waits;             // writes that had to be held back
+    uint64_t waited;            // nanoseconds spent holding them
+    uint64_t backoffs;
+};
+
+void rateControlInit(struct rateControl *rate, uint64_t reportInterval, uint64_t requestTimeout);
+uint64_t rateControlDelay(const struct rateControl *rate, uint64_t now);
+void rateControlRecord(struct rateControl *rate, uint64_t startTime, uint64_t latency, int failed);
+void rateControlPrint(const struct rateControl *rate, int index, FILE *fp);
+int rateControlBenchmark(struct benchOptions *opts);
+
+#endif /* ratecontrol_h */
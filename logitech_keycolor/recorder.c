@@ -0,0 +1,587 @@
+//
+//  recorder.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "recorder.h"
+#include "timeutil.h"
+
+#define RECORDER_FLUSH_INTERVAL 100000000ull
+
+// Lock free, never blocks the write that is being recorded. A full ring drops the record and counts it
+void recorderAppend(struct recorder *recorder, const struct keyColorTarget *target, uint64_t startTime, uint64_t latency, const uint8_t *report, size_t reportLen, int status)
+{
+    uint64_t pos = __atomic_load_n(&recorder->enqueuePos, __ATOMIC_RELAXED);
+    struct recorderSlot *slot;
+    
+    for (;;) {
+        slot = &recorder->ring[pos & (RECORDER_RING_SIZE - 1)];
+        
+        int64_t diff = (int64_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+        
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&recorder->enqueuePos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&recorder->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&recorder->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+    
+    struct recorderRecord *record = &slot->record;
+    
+    if (reportLen > TRANSPORT_MAX_REPORT_SIZE) {
+        reportLen = TRANSPORT_MAX_REPORT_SIZE;
+    }
+    
+    record->timestamp = startTime;
+    record->latency = latency > UINT32_MAX ? UINT32_MAX : (uint32_t)latency;
+    record->status = status;
+    record->locationId = target->locationId;
+    record->cookie = target->cookie;
+    record->vendorId = (uint16_t)target->vendorId;
+    record->productId = (uint16_t)target->productId;
+    record->deviceIndex = (uint8_t)target->index;
+    record->reportId = target->reportId;
+    record->reportLen = (uint8_t)reportLen;
+    record->reserved = 0;
+    memcpy(record->report, report, reportLen);
+    
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Flusher thread only, moves whatever is ready from the ring to the log
+static void recorderDrain(struct recorder *recorder)
+{
+    for (;;) {
+        uint64_t pos = recorder->dequeuePos;
+        struct recorderSlot *slot = &recorder->ring[pos & (RECORDER_RING_SIZE - 1)];
+        
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1) {
+            break;
+        }
+        
+        size_t len = RECORDER_RECORD_HEADER_SIZE + slot->record.reportLen;
+        
+        if (!recorder->failed && fwrite(&slot->record, 1, len, recorder->fp) != len) {
+            fprintf(stderr, "Failed to write %s: %s\n", recorder->path, strerror(errno));
+            recorder->failed = 1;
+        }
+        
+        recorder->recorded++;
+        recorder->bytes += len;
+        recorder->dequeuePos = pos + 1;
+        __atomic_store_n(&slot->sequence, pos + RECORDER_RING_SIZE, __ATOMIC_RELEASE);
+    }
+    
+    if (!recorder->failed && fflush(recorder->fp)) {
+        fprintf(stderr, "Failed to write %s: %s\n", recorder->path, strerror(errno));
+        recorder->failed = 1;
+    }
+}
+
+static void *recorderFlusher(void *arg)
+{
+    struct recorder *recorder = arg;
+    
+    pthread_mutex_lock(&recorder->lock);
+    
+    while (!recorder->stop) {
+        struct timespec ts;
+        
+        pthread_mutex_unlock(&recorder->lock);
+        recorderDrain(recorder);
+        pthread_mutex_lock(&recorder->lock);
+        
+        if (!recorder->stop) {
+            deadlineToTimespec(RECORDER_FLUSH_INTERVAL, &ts);
+            pthread_cond_timedwait(&recorder->wake, &recorder->lock, &ts);
+        }
+    }
+    
+    pthread_mutex_unlock(&recorder->lock);
+    
+    return NULL;
+}
+
+struct recorder *recorderOpen(const char *path)
+{
+    struct recorder *recorder = calloc(1, sizeof(struct recorder));
+    struct recorderLogHeader header;
+    
+    if (!recorder || !(recorder->ring = calloc(RECORDER_RING_SIZE, sizeof(struct recorderSlot)))) {
+        fprintf(stderr, "Failed to allocate recorder!\n");
+        free(recorder);
+        return NULL;
+    }
+    
+    if (!(recorder->fp = fopen(path, "wb"))) {
+        fprintf(stderr, "Failed to create %s: %s\n", path, strerror(errno));
+        free(recorder->ring);
+        free(recorder);
+        return NULL;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORDER_MAGIC, sizeof(header.magic));
+    header.version = RECORDER_VERSION;
+    header.headerSize = RECORDER_RECORD_HEADER_SIZE;
+    
+    if (fwrite(&header, sizeof(header), 1, recorder->fp) != 1) {
+        fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+        recorder->failed = 1;
+    }
+    
+    for (uint64_t i = 0; i < RECORDER_RING_SIZE; i++) {
+        recorder->ring[i].sequence = i;
+    }
+    
+    recorder->path = path;
+    pthread_mutex_init(&recorder->lock, NULL);
+    pthread_cond_init(&recorder->wake, NULL);
+    
+    if (pthread_create(&recorder->flusher, NULL, recorderFlusher, recorder)) {
+        fprintf(stderr, "Failed to start recorder flush thread!\n");
+        pthread_cond_destroy(&recorder->wake);
+        pthread_mutex_destroy(&recorder->lock);
+        fclose(recorder->fp);
+        free(recorder->ring);
+        free(recorder);
+        return NULL;
+    }
+    
+    return recorder;
+}
+
+// Call once nothing can write any more, flushes the rest and returns -1 if the log is incomplete
+int recorderClose(struct recorder *recorder, int verbose)
+{
+    if (!recorder) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&recorder->lock);
+    recorder->stop = 1;
+    pthread_cond_signal(&recorder->wake);
+    pthread_mutex_unlock(&recorder->lock);
+    pthread_join(recorder->flusher, NULL);
+    
+    recorderDrain(recorder);
+    
+    if (fclose(recorder->fp) && !recorder->failed) {
+        fprintf(stderr, "Failed to write %s: %s\n", recorder->path, strerror(errno));
+        recorder->failed = 1;
+    }
+    
+    if (recorder->dropped) {
+        fprintf(stderr, "WARNING: recorder dropped %llu reports, the log is incomplete\n", (unsigned long long)recorder->dropped);
+    }
+    
+    if (verbose) {
+        fprintf(stderr, "recorded %llu reports (%llu bytes) to %s\n", (unsigned long long)recorder->recorded,
+                (unsigned long long)recorder->bytes, recorder->path);
+    }
+    
+    int ret = recorder->failed || recorder->dropped ? -1 : 0;
+    
+    pthread_cond_destroy(&recorder->wake);
+    pthread_mutex_destroy(&recorder->lock);
+    free(recorder->ring);
+    free(recorder);
+    
+    return ret;
+}
+
+// Reads a whole log, records are variable length so they are unpacked into fixed size entries
+static struct recorderRecord *recorderLoad(const char *path, size_t *numRecords)
+{
+    FILE *fp = fopen(path, "rb");
+    struct recorderLogHeader header;
+    struct recorderRecord *records = NULL;
+    size_t maxRecords = 0;
+    
+    *numRecords = 0;
+    
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, RECORDER_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s is not a report log\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    
+    if (header.version != RECORDER_VERSION || header.headerSize != RECORDER_RECORD_HEADER_SIZE) {
+        fprintf(stderr, "%s is report log version %u, this build reads version %d\n", path, header.version, RECORDER_VERSION);
+        fclose(fp);
+        return NULL;
+    }
+    
+    for (;;) {
+        if (*numRecords == maxRecords) {
+            size_t grownMax = maxRecords ? maxRecords * 2 : 1024;
+            struct recorderRecord *grown = realloc(records, sizeof(struct recorderRecord) * grownMax);
+            
+            if (!grown) {
+                fprintf(stderr, "Failed to allocate memory for %s!\n", path);
+                free(records);
+                fclose(fp);
+                return NULL;
+            }
+            records = grown;
+            maxRecords = grownMax;
+        }
+        
+        struct recorderRecord *record = &records[*numRecords];
+        size_t len = fread(record, 1, RECORDER_RECORD_HEADER_SIZE, fp);
+        
+        if (len == 0) {
+            break;
+        }
+        
+        if (len != RECORDER_RECORD_HEADER_SIZE || record->reportLen > TRANSPORT_MAX_REPORT_SIZE ||
+            fread(record->report, 1, record->reportLen, fp) != record->reportLen) {
+            // A run that died mid flush leaves a torn last record, everything before it is still good
+            fprintf(stderr, "WARNING: %s is truncated after %zu records\n", path, *numRecords);
+            break;
+        }
+        
+        (*numRecords)++;
+    }
+    
+    fclose(fp);
+    
+    if (*numRecords == 0) {
+        fprintf(stderr, "%s has no reports\n", path);
+        free(records);
+        return NULL;
+    }
+    
+    return records;
+}
+
+// Same keyboard and element as the record, distinct ones are numbered in order of first appearance
+static size_t recorderDeviceSlot(const struct recorderRecord *records, size_t index, size_t *slots, size_t *numDevices)
+{
+    const struct recorderRecord *record = &records[index];
+    
+    for (size_t i = 0; i < index; i++) {
+        if (records[i].locationId == record->locationId && records[i].cookie == record->cookie &&
+            records[i].vendorId == record->vendorId && records[i].productId == record->productId) {
+            return slots[i];
+        }
+    }
+    
+    return (*numDevices)++;
+}
+
+// Sends every logged report straight to the backend of its keyboard, bypassing calibration, the cache and
+// rate control so the device sees exactly the recorded bytes. speed scales the recorded gaps, 0 sends them
+// back to back. Against the fake device every report it kept is checked against the log
+int recorderReplay(const char *path, const char *transportSpec, double speed, int verbose, struct replayStats *stats)
+{
+    size_t numRecords = 0;
+    struct recorderRecord *records = recorderLoad(path, &numRecords);
+    size_t numDevices = 0;
+    char spec[64];
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    if (!records) {
+        return -1;
+    }
+    
+    size_t *slots = calloc(numRecords, sizeof(size_t));
+    
+    if (!slots) {
+        fprintf(stderr, "Failed to allocate memory for %s!\n", path);
+        free(records);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < numRecords; i++) {
+        slots[i] = recorderDeviceSlot(records, i, slots, &numDevices);
+    }
+    
+    if (!transportSpec) {
+        snprintf(spec, sizeof(spec), "fake:devices=%zu,product=0x%04x", numDevices, records[0].productId);
+        transportSpec = spec;
+    }
+    
+    struct hidTransport *transport = transportOpen(transportSpec, 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        fprintf(stderr, "No keyboard to replay %s to\n", path);
+        transportClose(transport);
+        free(slots);
+        free(records);
+        return -1;
+    }
+    
+    if (numTargets < numDevices) {
+        fprintf(stderr, "WARNING: %s has %zu keyboards, replaying to %zu\n", path, numDevices, numTargets);
+    }
+    
+    // Writes on different keyboards finish out of order, a record can start before the one logged ahead of it
+    uint64_t firstTime = records[0].timestamp;
+    uint64_t offset = 0;
+    
+    for (size_t i = 0; i < numRecords; i++) {
+        firstTime = records[i].timestamp < firstTime ? records[i].timestamp : firstTime;
+    }
+    
+    stats->records = numRecords;
+    stats->devices = numDevices;
+    
+    uint64_t startTime = monotonicNanos();
+    
+    for (size_t i = 0; i < numRecords; i++) {
+        struct recorderRecord *record = &records[i];
+        struct keyColorTarget *target = &targets[slots[i] % numTargets];
+        
+        offset = record->timestamp - firstTime > offset ? record->timestamp - firstTime : offset;
+        
+        if (speed > 0) {
+            uint64_t deadline = startTime + (uint64_t)(offset / speed);
+            
+            sleepUntilNanos(deadline);
+            
+            uint64_t late = monotonicNanos() - deadline;
+            
+            if (late > stats->lateMax) {
+                stats->lateMax = late;
+            }
+        }
+        
+        int status = transport->ops->write(target, record->report, record->reportLen);
+        
+        if (status) {
+            stats->replayFailures++;
+        }
+        
+        if ((status != 0) != (record->status != 0)) {
+            stats->statusChanged++;
+        }
+        
+        if (verbose > 1) {
+            printf("replay %zu @%.6fs -> %s[%d] status=%d recorded=%d\n", i, offset / 1e9,
+                   transport->ops->name, target->index, status, record->status);
+        }
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    stats->recordedSpan = offset;
+    
+    // The fake keeps every report in the order it took them, which must be the log's order
+    size_t numFake = 0;
+    const struct fakeReportRecord *fake = fakeTransportRecords(transport, &numFake);
+    
+    if (fake) {
+        size_t compared = numFake < numRecords ? numFake : numRecords;
+        
+        stats->mismatches = numRecords - compared;
+        
+        for (size_t i = 0; i < compared; i++) {
+            if (fake[i].deviceIndex != (uint32_t)targets[slots[i] % numTargets].index || fake[i].reportLen != records[i].reportLen ||
+                memcmp(fake[i].report, records[i].report, records[i].reportLen) != 0) {
+                stats->mismatches++;
+            }
+        }
+    }
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    free(slots);
+    free(records);
+    
+    return stats->replayFailures || stats->mismatches ? 1 : 0;
+}
+
+void recorderPrintReplayStats(const struct replayStats *stats, double speed)
+{
+    double seconds = stats->elapsed / 1e9;
+    
+    fprintf(stderr, "replayed %llu reports to %llu keyboards in %.3fs (recorded over %.3fs, speed %s) %.0f reports/s\n",
+            (unsigned long long)stats->records, (unsigned long long)stats->devices, seconds, stats->recordedSpan / 1e9,
+            speed > 0 ? "paced" : "max", seconds > 0 ? stats->records / seconds : 0.0);
+    fprintf(stderr, "failed=%llu status-changed=%llu mismatches=%llu late-max=%.1fus\n",
+            (unsigned long long)stats->replayFailures, (unsigned long long)stats->statusChanged,
+            (unsigned long long)stats->mismatches, stats->lateMax / 1e3);
+}
+
+struct recorderBenchThread {
+    struct recorder *recorder;
+    struct keyColorTarget *target;
+    uint64_t count;
+};
+
+static void *recorderBenchProducer(void *arg)
+{
+    struct recorderBenchThread *thread = arg;
+    uint8_t report[KEYCOLOR_REPORT_SIZE] = { 0, 1, 2, 3 };
+    
+    for (uint64_t i = 0; i < thread->count; i++) {
+        report[1] = (uint8_t)i;
+        recorderAppend(thread->recorder, thread->target, monotonicNanos(), 1000, report, sizeof(report), 0);
+    }
+    
+    return NULL;
+}
+
+// Append cost from one and four threads, recording overhead on the fake write path, then replaying the
+// recorded run back to back
+int recorderBenchmark(struct benchOptions *opts)
+{
+    char path[] = "/tmp/keycolor-record-XXXXXX";
+    int fd = mkstemp(path);
+    struct keyColorTarget target;
+    int ret = 0;
+    
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create a temporary log: %s\n", strerror(errno));
+        return -1;
+    }
+    close(fd);
+    
+    memset(&target, 0, sizeof(target));
+    target.vendorId = LOGITECH_VENDOR_ID;
+    target.productId = 0xc24d;
+    
+    static const int numThreads[] = { 1, 4 };
+    
+    for (size_t n = 0; n < sizeof(numThreads) / sizeof(numThreads[0]) && ret == 0; n++) {
+        struct recorder *recorder = recorderOpen(path);
+        struct recorderBenchThread threads[4];
+        pthread_t ids[4];
+        char label[32];
+        
+        if (!recorder) {
+            ret = -1;
+            break;
+        }
+        
+        // Stays under the ring size between flushes so nothing is dropped
+        uint64_t total = (uint64_t)opts->iterations * 10 < RECORDER_RING_SIZE ? (uint64_t)opts->iterations * 10 : RECORDER_RING_SIZE;
+        uint64_t perThread = total / (uint64_t)numThreads[n];
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < numThreads[n]; i++) {
+            threads[i].recorder = recorder;
+            threads[i].target = &target;
+            threads[i].count = perThread;
+            pthread_create(&ids[i], NULL, recorderBenchProducer, &threads[i]);
+        }
+        
+        for (int i = 0; i < numThreads[n]; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        
+        uint64_t elapsed = monotonicNanos() - startTime;
+        uint64_t dropped = recorder->dropped;
+        
+        snprintf(label, sizeof(label), "append/%d", numThreads[n]);
+        benchReportThroughput(label, perThread * (uint64_t)numThreads[n], elapsed, benchAllocations() - allocs, 0);
+        fprintf(benchNotes(), "# %s dropped=%llu\n", label, (unsigned long long)dropped);
+        recorderClose(recorder, 0);
+    }
+    
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:devices=2";
+    
+    for (int recording = 0; recording < 2 && ret == 0; recording++) {
+        struct hidTransport *transport = transportOpen(spec, 0, 0);
+        struct keyColorTarget *targets = NULL;
+        size_t numTargets = 0;
+        struct recorder *recorder = NULL;
+        uint8_t report[KEYCOLOR_REPORT_SIZE];
+        int numFailed = 0;
+        
+        if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0 ||
+            (recording && !(recorder = recorderOpen(path)))) {
+            transportReleaseTargets(targets, numTargets);
+            transportClose(transport);
+            ret = -1;
+            break;
+        }
+        
+        transportSetCaching(transport, 0);
+        transportSetRateControl(transport, 0);
+        transportSetRecorder(transport, recorder);
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < opts->iterations; i++) {
+            memcpy(report, opts->report, sizeof(report));
+            report[1] = (uint8_t)i;
+            numFailed += transportWrite(targets, numTargets, report, sizeof(report));
+        }
+        
+        uint64_t elapsed = monotonicNanos() - startTime;
+        
+        benchReportThroughput(recording ? "recorded" : "unrecorded", (uint64_t)opts->iterations * numTargets, elapsed, benchAllocations() - allocs, 0);
+        
+        transportSetRecorder(transport, NULL);
+        
+        if (recorderClose(recorder, 0) || numFailed) {
+            ret = -1;
+        }
+        
+        transportReleaseTargets(targets, numTargets);
+        transportClose(transport);
+    }
+    
+    if (ret == 0) {
+        struct replayStats stats;
+        uint64_t allocs = benchAllocations();
+        
+        if (recorderReplay(path, NULL, 0, 0, &stats)) {
+            ret = -1;
+        }
+        
+        benchReportThroughput("replay", stats.records, stats.elapsed, benchAllocations() - allocs, 0);
+        fprintf(benchNotes(), "# replayed %llu reports to %llu keyboards, mismatches=%llu\n", (unsigned long long)stats.records,
+                (unsigned long long)stats.devices, (unsigned long long)stats.mismatches);
+    }
+    
+    unlink(path);
+    
+    return ret;
+}
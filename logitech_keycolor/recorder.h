@@ -0,0 +1,113 @@
+//
+//  recorder.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef recorder_h
+#define recorder_h
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "keycolor.h"
+#include "transport.h"
+#include "bench.h"
+
+#define RECORDER_MAGIC "KCRECORD"
+#define RECORDER_VERSION 1
+
+// Entries the ring holds between flushes, a power of two
+#define RECORDER_RING_SIZE 8192
+
+// One outgoing report. The log stores everything up to report, then reportLen payload bytes
+struct recorderRecord {
+    uint64_t timestamp;         // monotonicNanos() when the write started
+    uint32_t latency;           // nanoseconds the write took, saturated
+    int32_t status;             // backend return code, 0 on success
+    uint32_t locationId;
+    uint32_t cookie;
+    uint16_t vendorId;
+    uint16_t productId;
+    uint8_t deviceIndex;
+    uint8_t reportId;
+    uint8_t reportLen;
+    uint8_t reserved;
+    uint8_t report[TRANSPORT_MAX_REPORT_SIZE];
+};
+
+#define RECORDER_RECORD_HEADER_SIZE offsetof(struct recorderRecord, report)
+
+// Host byte order, followed by the records in the order they were flushed
+struct recorderLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;        // RECORDER_RECORD_HEADER_SIZE
+};
+
+// Multiple producer, single consumer: a slot is free for position p when its sequence is p and
+// holds a record for the flusher when it is p + 1
+struct recorderSlot {
+    uint64_t sequence;
+    struct recorderRecord record;
+};
+
+struct recorder {
+    struct recorderSlot *ring;
+    uint64_t enqueuePos;        // producers claim positions with a compare and swap
+    uint64_t dequeuePos;        // flusher only
+    uint64_t dropped;           // ring full, the writer never waits for the log
+    uint64_t recorded;
+    uint64_t bytes;
+    FILE *fp;
+    const char *path;
+    int failed;
+    int stop;
+    pthread_t flusher;
+    pthread_mutex_t lock;       // flusher sleep only, producers never take it
+    pthread_cond_t wake;
+};
+
+struct replayStats {
+    uint64_t records;
+    uint64_t devices;
+    uint64_t replayFailures;    // writes that failed on replay
+    uint64_t statusChanged;     // replay result differs from the recorded one
+    uint64_t mismatches;        // reports the fake device saw differently, or never saw
+    uint64_t lateMax;           // nanoseconds a write went out after its deadline
+    uint64_t recordedSpan;      // nanoseconds from first to last recorded write
+    uint64_t elapsed;
+};
+
+struct recorder *recorderOpen(const char *path);
+void recorderAppend(struct recorder *recorder, const struct keyColorTarget *target, uint64_t startTime, uint64_t latency, const uint8_t *report, size_t reportLen, int status);
+int recorderClose(struct recorder *recorder, int verbose);
+int recorderReplay(const char *path, const char *transportSpec, double speed, int verbose, struct replayStats *stats);
+void recorderPrintReplayStats(const struct replayStats *stats, double speed);
+int recorderBenchmark(struct benchOptions *opts);
+
+#endif /* recorder_h */
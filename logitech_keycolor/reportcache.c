@@ -0,0 +1,142 @@
+//
+//  reportcache.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include "reportcache.h"
+
+struct reportCache *reportCacheCreate(void)
+{
+    struct reportCache *cache = calloc(1, sizeof(struct reportCache));
+    
+    if (cache) {
+        cache->enabled = 1;
+    }
+    
+    return cache;
+}
+
+void reportCacheFree(struct reportCache *cache)
+{
+    free(cache);
+}
+
+// Linear probe from the hashed slot, returns the entry for key or the empty slot it would go in
+static struct reportCacheEntry *reportCacheFind(struct reportCache *cache, uint64_t key)
+{
+    uint32_t slot = (uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 40) & (REPORT_CACHE_SIZE - 1);
+    
+    for (int i = 0; i < REPORT_CACHE_SIZE; i++) {
+        struct reportCacheEntry *entry = &cache->entries[(slot + i) & (REPORT_CACHE_SIZE - 1)];
+        
+        if (!entry->used || entry->key == key) {
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+int reportCacheMatches(struct reportCache *cache, uint64_t key, const uint8_t *report, size_t reportLen)
+{
+    struct reportCacheEntry *entry = cache->enabled ? reportCacheFind(cache, key) : NULL;
+    
+    if (entry && entry->used && entry->reportLen == reportLen && memcmp(entry->report, report, reportLen) == 0) {
+        cache->writesSuppressed++;
+        return 1;
+    }
+    
+    cache->writesIssued++;
+    
+    return 0;
+}
+
+void reportCacheUpdate(struct reportCache *cache, uint64_t key, const uint8_t *report, size_t reportLen)
+{
+    struct reportCacheEntry *entry = reportCacheFind(cache, key);
+    
+    // A full table or an oversized report just means that element is never suppressed
+    if (!entry || reportLen == 0 || reportLen > REPORT_CACHE_MAX_REPORT) {
+        return;
+    }
+    
+    entry->key = key;
+    entry->used = 1;
+    entry->reportLen = (uint32_t)reportLen;
+    memcpy(entry->report, report, reportLen);
+}
+
+void reportCacheInvalidate(struct reportCache *cache, uint64_t key)
+{
+    struct reportCacheEntry *entry = reportCacheFind(cache, key);
+    
+    // The slot stays owned by key so later keys in the same probe chain stay reachable
+    if (entry && entry->used) {
+        entry->reportLen = 0;
+    }
+}
+
+void reportCachePrintStats(struct reportCache *cache, FILE *fp)
+{
+    uint64_t total = cache->writesIssued + cache->writesSuppressed;
+    
+    fprintf(fp, "writes issued=%llu suppressed=%llu (%.1f%%) coalesced=%llu\n",
+            (unsigned long long)cache->writesIssued, (unsigned long long)cache->writesSuppressed,
+            total ? 100.0 * cache->writesSuppressed / total : 0.0,
+            (unsigned long long)cache->requestsCoalesced);
+}
+
+int latestReportPut(struct latestReport *slot, const uint8_t *report, size_t reportLen)
+{
+    int replaced = slot->pending;
+    
+    if (reportLen > REPORT_CACHE_MAX_REPORT) {
+        reportLen = REPORT_CACHE_MAX_REPORT;
+    }
+    
+    memcpy(slot->report, report, reportLen);
+    slot->reportLen = (uint32_t)reportLen;
+    slot->pending = 1;
+    
+    return replaced;
+}
+
+int latestReportTake(struct latestReport *slot, uint8_t *report, size_t *reportLen)
+{
+    if (!slot->pending) {
+        return 0;
+    }
+    
+    memcpy(report, slot->report, slot->reportLen);
+    *reportLen = slot->reportLen;
+    slot->pending = 0;
+    
+    return 1;
+}
@@ -0,0 +1,79 @@
+//
+//  reportcache.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef reportcache_h
+#define reportcache_h
+
+#include <stdio.h>
+#include "keycolor.h"
+
+#define REPORT_CACHE_SIZE 64            // power of two, entries per transport
+#define REPORT_CACHE_MAX_REPORT 64
+
+// Last report actually sent to one element, keyed by device location id and element cookie
+struct reportCacheEntry {
+    uint64_t key;
+    uint32_t used;                      // slot owned by key, stays set for the life of the cache
+    uint32_t reportLen;                 // 0 when the device state is unknown
+    uint8_t report[REPORT_CACHE_MAX_REPORT];
+};
+
+struct reportCache {
+    struct reportCacheEntry entries[REPORT_CACHE_SIZE];
+    int enabled;                        // when clear every write is issued but still counted
+    uint64_t writesIssued;
+    uint64_t writesSuppressed;
+    uint64_t requestsCoalesced;
+};
+
+// Single slot where a newer report replaces one that has not been written yet
+struct latestReport {
+    uint8_t report[REPORT_CACHE_MAX_REPORT];
+    uint32_t reportLen;
+    int pending;
+};
+
+static inline uint64_t reportCacheKey(const struct keyColorTarget *target)
+{
+    return ((uint64_t)target->locationId << 32) | target->cookie;
+}
+
+struct reportCache *reportCacheCreate(void);
+void reportCacheFree(struct reportCache *cache);
+int reportCacheMatches(struct reportCache *cache, uint64_t key, const uint8_t *report, size_t reportLen);
+void reportCacheUpdate(struct reportCache *cache, uint64_t key, const uint8_t *report, size_t reportLen);
+void reportCacheInvalidate(struct reportCache *cache, uint64_t key);
+void reportCachePrintStats(struct reportCache *cache, FILE *fp);
+
+// Returns 1 if an unwritten report was replaced
+int latestReportPut(struct latestReport *slot, const uint8_t *report, size_t reportLen);
+int latestReportTake(struct latestReport *slot, uint8_t *report, size_t *reportLen);
+
+#endif /* reportcache_h */
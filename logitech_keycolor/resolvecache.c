@@ -0,0 +1,249 @@
+//
+//  resolvecache.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "resolvecache.h"
+
+#define RESOLVE_CACHE_HEADER "# logitech_keycolor resolved elements v1"
+
+const char *resolveCacheDefaultPath(void)
+{
+    static char path[PATH_MAX];
+    const char *home = getenv("HOME");
+    
+#ifdef __APPLE__
+    if (!home || !*home) {
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "%s/Library/Caches/logitech_keycolor.devices", home);
+#else
+    const char *cacheHome = getenv("XDG_CACHE_HOME");
+    
+    if (cacheHome && *cacheHome) {
+        snprintf(path, sizeof(path), "%s/logitech_keycolor.devices", cacheHome);
+    } else if (home && *home) {
+        snprintf(path, sizeof(path), "%s/.cache/logitech_keycolor.devices", home);
+    } else {
+        return NULL;
+    }
+#endif
+    
+    return path;
+}
+
+// Serials are stored as one whitespace free token, "-" when the device has none
+static void serialToken(const char *serial, char *token, size_t tokenSize)
+{
+    size_t i = 0;
+    
+    for (; serial[i] && i + 1 < tokenSize; i++) {
+        token[i] = (serial[i] <= ' ' || serial[i] == '#') ? '_' : serial[i];
+    }
+    token[i] = '\0';
+    
+    if (i == 0) {
+        snprintf(token, tokenSize, "-");
+    }
+}
+
+struct resolveCache *resolveCacheOpen(const char *path)
+{
+    struct resolveCache *cache = calloc(1, sizeof(struct resolveCache));
+    
+    if (!cache) {
+        return NULL;
+    }
+    
+    snprintf(cache->path, sizeof(cache->path), "%s", path);
+    
+    FILE *fp = fopen(path, "r");
+    
+    if (!fp) {
+        return cache;
+    }
+    
+    char line[256];
+    
+    while (fgets(line, sizeof(line), fp) && cache->numEntries < RESOLVE_CACHE_MAX_ENTRIES) {
+        struct resolveCacheEntry *entry = &cache->entries[cache->numEntries];
+        unsigned reportId, reportType, reportLen;
+        
+        if (line[0] == '#') {
+            continue;
+        }
+        
+        if (sscanf(line, "%15s %x %x %x %63s %x %x %u %u", entry->transport, &entry->vendorId, &entry->productId,
+                   &entry->locationId, entry->serial, &entry->cookie, &reportId, &reportType, &reportLen) != 9) {
+            continue;
+        }
+        
+        entry->reportId = (uint8_t)reportId;
+        entry->reportType = (uint8_t)reportType;
+        entry->reportLen = (uint8_t)reportLen;
+        cache->numEntries++;
+    }
+    
+    fclose(fp);
+    
+    return cache;
+}
+
+static struct resolveCacheEntry *resolveCacheFind(struct resolveCache *cache, const char *transportName, uint32_t vendorId, uint32_t productId, uint32_t locationId, const char *serial, uint32_t cookie)
+{
+    char token[KEYCOLOR_SERIAL_SIZE];
+    
+    serialToken(serial, token, sizeof(token));
+    
+    for (int i = 0; i < cache->numEntries; i++) {
+        struct resolveCacheEntry *entry = &cache->entries[i];
+        
+        if (entry->vendorId == vendorId && entry->productId == productId && entry->locationId == locationId &&
+            entry->cookie == cookie && strcmp(entry->serial, token) == 0 && strcmp(entry->transport, transportName) == 0) {
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+const struct resolveCacheEntry *resolveCacheLookup(struct resolveCache *cache, const char *transportName, uint32_t vendorId, uint32_t productId, uint32_t locationId, const char *serial, uint32_t cookie)
+{
+    struct resolveCacheEntry *entry = resolveCacheFind(cache, transportName, vendorId, productId, locationId, serial, cookie);
+    
+    if (entry) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    
+    return entry;
+}
+
+void resolveCacheStore(struct resolveCache *cache, const char *transportName, const struct keyColorTarget *target)
+{
+    struct resolveCacheEntry *entry = resolveCacheFind(cache, transportName, target->vendorId, target->productId, target->locationId, target->serial, target->cookie);
+    
+    if (!entry) {
+        // Full, the oldest entry goes
+        if (cache->numEntries == RESOLVE_CACHE_MAX_ENTRIES) {
+            memmove(&cache->entries[0], &cache->entries[1], sizeof(cache->entries[0]) * (RESOLVE_CACHE_MAX_ENTRIES - 1));
+            cache->numEntries--;
+        }
+        entry = &cache->entries[cache->numEntries++];
+    } else if (entry->reportId == target->reportId && entry->reportType == target->reportType && entry->reportLen == target->reportLen) {
+        return;
+    }
+    
+    snprintf(entry->transport, sizeof(entry->transport), "%s", transportName);
+    entry->vendorId = target->vendorId;
+    entry->productId = target->productId;
+    entry->locationId = target->locationId;
+    serialToken(target->serial, entry->serial, sizeof(entry->serial));
+    entry->cookie = target->cookie;
+    entry->reportId = target->reportId;
+    entry->reportType = target->reportType;
+    entry->reportLen = target->reportLen;
+    cache->dirty = 1;
+}
+
+void resolveCacheForget(struct resolveCache *cache, const char *transportName, const struct keyColorTarget *target)
+{
+    struct resolveCacheEntry *entry = resolveCacheFind(cache, transportName, target->vendorId, target->productId, target->locationId, target->serial, target->cookie);
+    
+    if (entry) {
+        *entry = cache->entries[--cache->numEntries];
+        cache->dirty = 1;
+    }
+}
+
+// Written to a temporary file and renamed so concurrent invocations never see a torn cache
+int resolveCacheSave(struct resolveCache *cache)
+{
+    char tmpPath[PATH_MAX + 16];
+    
+    if (!cache->dirty) {
+        return 0;
+    }
+    
+    snprintf(tmpPath, sizeof(tmpPath), "%s.%d", cache->path, (int)getpid());
+    
+    FILE *fp = fopen(tmpPath, "w");
+    
+    if (!fp) {
+        // First run on a fresh account, the parent cache directory may not exist yet
+        char dir[PATH_MAX];
+        char *slash;
+        
+        snprintf(dir, sizeof(dir), "%s", cache->path);
+        
+        if ((slash = strrchr(dir, '/')) != NULL && slash != dir) {
+            *slash = '\0';
+            mkdir(dir, 0700);
+            fp = fopen(tmpPath, "w");
+        }
+        
+        if (!fp) {
+            return -1;
+        }
+    }
+    
+    fprintf(fp, "%s\n", RESOLVE_CACHE_HEADER);
+    
+    for (int i = 0; i < cache->numEntries; i++) {
+        struct resolveCacheEntry *entry = &cache->entries[i];
+        
+        fprintf(fp, "%s %04x %04x %08x %s %x %02x %u %u\n", entry->transport, entry->vendorId, entry->productId,
+                entry->locationId, entry->serial, entry->cookie, entry->reportId, entry->reportType, entry->reportLen);
+    }
+    
+    if (fclose(fp) != 0 || rename(tmpPath, cache->path) != 0) {
+        unlink(tmpPath);
+        return -1;
+    }
+    
+    cache->dirty = 0;
+    
+    return 0;
+}
+
+void resolveCacheClose(struct resolveCache *cache)
+{
+    if (!cache) {
+        return;
+    }
+    
+    resolveCacheSave(cache);
+    free(cache);
+}
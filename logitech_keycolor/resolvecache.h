@@ -0,0 +1,69 @@
+//
+//  resolvecache.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef resolvecache_h
+#define resolvecache_h
+
+#include <limits.h>
+#include "keycolor.h"
+
+#define RESOLVE_CACHE_MAX_ENTRIES 64
+
+// Where a device's color report was found last time, so element matching can be skipped
+struct resolveCacheEntry {
+    char transport[16];
+    uint32_t vendorId;
+    uint32_t productId;
+    uint32_t locationId;
+    char serial[KEYCOLOR_SERIAL_SIZE];
+    uint32_t cookie;
+    uint8_t reportId;
+    uint8_t reportType;
+    uint8_t reportLen;
+};
+
+struct resolveCache {
+    char path[PATH_MAX];
+    struct resolveCacheEntry entries[RESOLVE_CACHE_MAX_ENTRIES];
+    int numEntries;
+    int dirty;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+const char *resolveCacheDefaultPath(void);
+struct resolveCache *resolveCacheOpen(const char *path);
+const struct resolveCacheEntry *resolveCacheLookup(struct resolveCache *cache, const char *transportName, uint32_t vendorId, uint32_t productId, uint32_t locationId, const char *serial, uint32_t cookie);
+void resolveCacheStore(struct resolveCache *cache, const char *transportName, const struct keyColorTarget *target);
+void resolveCacheForget(struct resolveCache *cache, const char *transportName, const struct keyColorTarget *target);
+int resolveCacheSave(struct resolveCache *cache);
+void resolveCacheClose(struct resolveCache *cache);
+
+#endif /* resolvecache_h */
@@ -0,0 +1,615 @@
+//
+//  shmcontrol.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmcontrol.h"
+#include "transport.h"
+#include "color.h"
+#include "timeutil.h"
+
+// A producer holding a slot this long is checked on, the next one takes the slot over if it died mid write
+#define SHM_CONTROL_STALE_SPINS 1000000
+
+// The writer gives up on a slot for this pass after this many torn reads, the producer bumps the generation when done
+#define SHM_CONTROL_READ_ATTEMPTS 1000
+
+static volatile sig_atomic_t shmControlStopRequested = 0;
+
+static void shmControlSignalHandler(int sig)
+{
+    shmControlStopRequested = sig;
+}
+
+// Per user so two logins never share a region, short enough for macOS shm names
+const char *shmControlDefaultName(void)
+{
+    static char name[32];
+    
+    snprintf(name, sizeof(name), "/logitech_keycolor.%u", (unsigned)getuid());
+    
+    return name;
+}
+
+static int shmControlMap(const char *name, int create, struct shmControl *shm)
+{
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT : O_RDWR, 0600);
+    struct stat st;
+    
+    memset(shm, 0, sizeof(*shm));
+    
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            fprintf(stderr, "No shared color region %s, start a writer with --shared\n", name);
+        } else {
+            fprintf(stderr, "Failed to open shared memory %s: %s\n", name, strerror(errno));
+        }
+        return -1;
+    }
+    
+    if (fstat(fd, &st)) {
+        fprintf(stderr, "Failed to stat shared memory %s: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    // macOS only sizes a shared memory object once, a region left by an earlier writer is reused as is
+    if ((size_t)st.st_size != sizeof(struct shmControlRegion)) {
+        if (!create || st.st_size != 0 || ftruncate(fd, sizeof(struct shmControlRegion))) {
+            fprintf(stderr, "Shared memory %s is not a color region of this version\n", name);
+            close(fd);
+            return -1;
+        }
+    }
+    
+    void *map = mmap(NULL, sizeof(struct shmControlRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    
+    close(fd);
+    
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map shared memory %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    
+    shm->region = map;
+    snprintf(shm->name, sizeof(shm->name), "%s", name);
+    
+    return 0;
+}
+
+// Creates the region, or takes over the one a previous writer left so producers keep their state
+int shmControlCreate(const char *name, const struct deviceProfile *profile, struct shmControl *shm)
+{
+    if (shmControlMap(name, 1, shm)) {
+        return -1;
+    }
+    
+    struct shmControlRegion *region = shm->region;
+    
+    if (memcmp(region->magic, SHM_CONTROL_MAGIC, sizeof(region->magic)) != 0 || region->version != SHM_CONTROL_VERSION) {
+        memset(region, 0, sizeof(*region));
+        region->version = SHM_CONTROL_VERSION;
+    } else if (region->writerPid && kill((pid_t)region->writerPid, 0) == 0) {
+        fprintf(stderr, "Process %llu is already writing from %s\n", (unsigned long long)region->writerPid, name);
+        shmControlDetach(shm);
+        return -1;
+    }
+    
+    region->numZones = (uint32_t)profile->numZones;
+    
+    for (int i = 0; i < profile->numZones; i++) {
+        snprintf(region->zoneNames[i], sizeof(region->zoneNames[i]), "%s", profile->zones[i].name);
+        region->zoneLengths[i] = profile->zones[i].length;
+    }
+    
+    region->writerPid = (uint64_t)getpid();
+    
+    // Producers check the magic last, everything above is in place by then
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(region->magic, SHM_CONTROL_MAGIC, sizeof(region->magic));
+    shm->owner = 1;
+    
+    return 0;
+}
+
+int shmControlAttach(const char *name, struct shmControl *shm)
+{
+    if (shmControlMap(name, 0, shm)) {
+        return -1;
+    }
+    
+    if (memcmp(shm->region->magic, SHM_CONTROL_MAGIC, sizeof(shm->region->magic)) != 0 || shm->region->version != SHM_CONTROL_VERSION) {
+        fprintf(stderr, "Shared memory %s is not a color region of this version\n", name);
+        shmControlDetach(shm);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// The region outlives the writer, a restarted writer picks up whatever producers left in it
+void shmControlDetach(struct shmControl *shm)
+{
+    if (!shm->region) {
+        return;
+    }
+    
+    if (shm->owner) {
+        __atomic_store_n(&shm->region->writerPid, 0, __ATOMIC_RELAXED);
+    }
+    
+    munmap(shm->region, sizeof(struct shmControlRegion));
+    shm->region = NULL;
+}
+
+int shmControlZone(const struct shmControl *shm, const char *name)
+{
+    for (uint32_t i = 0; i < shm->region->numZones && i < PROFILE_MAX_ZONES; i++) {
+        if (strcmp(shm->region->zoneNames[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    
+    return -1;
+}
+
+static void shmControlSlotWrite(struct shmControlRegion *region, struct shmControlSlot *slot, uint64_t value, uint64_t expires, uint64_t publishedAt)
+{
+    unsigned spins = 0;
+    uint64_t seq, locked;
+    
+    for (;;) {
+        seq = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+        
+        if (!(seq & 1)) {
+            locked = seq + 1;
+        } else if (++spins > SHM_CONTROL_STALE_SPINS) {
+            pid_t ownerPid = (pid_t)__atomic_load_n(&slot->ownerPid, __ATOMIC_RELAXED);
+            
+            // Usually the owner was only preempted, it keeps the slot for as long as it lives
+            if (ownerPid && (kill(ownerPid, 0) == 0 || errno != ESRCH)) {
+                spins = 0;
+                continue;
+            }
+            locked = seq + 2;
+        } else {
+            continue;
+        }
+        
+        if (__atomic_compare_exchange_n(&slot->sequence, &seq, locked, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    
+    __atomic_store_n(&slot->ownerPid, (uint64_t)getpid(), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->expires, expires, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->publishedAt, publishedAt, __ATOMIC_RELAXED);
+    
+    // Released only if nobody took the slot over meanwhile, a superseded write leaves the slot to its new owner
+    if (!__atomic_compare_exchange_n(&slot->sequence, &locked, locked + 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_fetch_add(&region->generation, 1, __ATOMIC_RELEASE);
+}
+
+// No syscalls: a compare and swap on the slot's sequence, four stores and a generation bump. A ttl
+// makes the writer drop the color on its own if the producer stops refreshing it
+void shmControlPublish(struct shmControl *shm, int zone, int priority, const uint8_t *values, uint64_t ttl)
+{
+    uint64_t now = monotonicNanos();
+    uint64_t value = (uint64_t)values[0] | (uint64_t)values[1] << 8 | (uint64_t)values[2] << 16 | 1ull << 24;
+    
+    shmControlSlotWrite(shm->region, &shm->region->slots[zone][priority], value, ttl ? now + ttl : 0, now);
+}
+
+void shmControlRelease(struct shmControl *shm, int zone, int priority)
+{
+    shmControlSlotWrite(shm->region, &shm->region->slots[zone][priority], 0, 0, monotonicNanos());
+}
+
+// zone=color[,priority=N][,ttl=DURATION], or zone=off to release the slot
+int shmControlPublishSpec(struct shmControl *shm, const char *spec)
+{
+    char *specCopy = strdup(spec);
+    char *value = specCopy ? strchr(specCopy, '=') : NULL;
+    char *options = NULL;
+    int priority = 0, zone, ret = 0;
+    int64_t ttl = 0;
+    uint8_t values[3];
+    
+    if (!value) {
+        fprintf(stderr, "Bad update '%s', expected zone=color\n", spec);
+        free(specCopy);
+        return -1;
+    }
+    *value++ = '\0';
+    
+    // Colors have commas of their own, the options start at the first comma followed by name=
+    for (char *cp = strchr(value, ','); cp; cp = strchr(cp + 1, ',')) {
+        size_t len = strcspn(cp + 1, ",");
+        char *equals = strchr(cp + 1, '=');
+        
+        if (equals && equals < cp + 1 + len) {
+            *cp = '\0';
+            options = cp + 1;
+            break;
+        }
+    }
+    
+    for (char *cp = options ? strtok(options, ",") : NULL; cp && ret == 0; cp = strtok(NULL, ",")) {
+        char *arg = strchr(cp, '=');
+        
+        if (!arg) {
+            fprintf(stderr, "Bad update option '%s', expected name=value\n", cp);
+            ret = -1;
+            break;
+        }
+        *arg++ = '\0';
+        
+        if (strcmp(cp, "priority") == 0) {
+            priority = atoi(arg);
+            
+            if (priority < 0 || priority >= SHM_CONTROL_PRIORITIES) {
+                fprintf(stderr, "Priority must be 0-%d\n", SHM_CONTROL_PRIORITIES - 1);
+                ret = -1;
+            }
+        } else if (strcmp(cp, "ttl") == 0) {
+            if ((ttl = parseDuration(arg)) < 0) {
+                fprintf(stderr, "Bad ttl '%s'\n", arg);
+                ret = -1;
+            }
+        } else {
+            fprintf(stderr, "Unknown update option '%s'\n", cp);
+            ret = -1;
+        }
+    }
+    
+    if (ret == 0 && (zone = shmControlZone(shm, specCopy)) < 0) {
+        fprintf(stderr, "No zone '%s' in %s\n", specCopy, shm->name);
+        ret = -1;
+    }
+    
+    if (ret == 0) {
+        char *end;
+        long level = strtol(value, &end, 10);
+        
+        if (strcmp(value, "off") == 0) {
+            shmControlRelease(shm, zone, priority);
+        } else if (shm->region->zoneLengths[zone] == 1 && end != value && *end == '\0' && level >= 0 && level <= 255) {
+            values[0] = values[1] = values[2] = (uint8_t)level;
+            shmControlPublish(shm, zone, priority, values, (uint64_t)ttl);
+        } else if (colorParseBytes(value, &values[0], &values[1], &values[2]) == 0) {
+            // Single level zones take the brightest channel
+            if (shm->region->zoneLengths[zone] == 1) {
+                values[0] = values[1] > values[0] ? values[1] : values[0];
+                values[0] = values[2] > values[0] ? values[2] : values[0];
+            }
+            shmControlPublish(shm, zone, priority, values, (uint64_t)ttl);
+        } else {
+            fprintf(stderr, "Unknown color '%s', --rgb list shows the names\n", value);
+            ret = -1;
+        }
+    }
+    
+    free(specCopy);
+    
+    return ret;
+}
+
+// Seqlock read, 0 if a producer held the slot through every attempt
+static int shmControlSlotRead(struct shmControlSlot *slot, uint64_t *value, uint64_t *expires, uint64_t *publishedAt, uint64_t *retries)
+{
+    for (int attempt = 0; attempt < SHM_CONTROL_READ_ATTEMPTS; attempt++) {
+        uint64_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        
+        if (!(seq & 1)) {
+            *value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+            *expires = __atomic_load_n(&slot->expires, __ATOMIC_RELAXED);
+            *publishedAt = __atomic_load_n(&slot->publishedAt, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == seq) {
+                return 1;
+            }
+        }
+        
+        (*retries)++;
+    }
+    
+    return 0;
+}
+
+// Polls the generation word, rebuilds the report from the winning slot of every zone when it moves or a
+// winner expires, and writes it only if it differs from the last one. Zones no producer holds show base.
+// A zero poll interval spins with sched_yield for the lowest latency
+int shmControlRun(struct shmControl *shm, const uint8_t *base, struct keyColorTarget *targets, size_t numTargets, uint64_t pollInterval, volatile sig_atomic_t *stop, struct shmControlStats *stats)
+{
+    struct shmControlRegion *region = shm->region;
+    const struct deviceProfile *profile = numTargets && targets[0].profile ? targets[0].profile : &deviceProfiles[0];
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    uint8_t lastReport[KEYCOLOR_REPORT_SIZE];
+    uint64_t lastGeneration = 0;
+    uint64_t nextExpiry = UINT64_MAX;
+    int haveLast = 0;
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    if (!stop) {
+        struct sigaction sa;
+        
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = shmControlSignalHandler;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+    
+    while (!shmControlStopRequested && !(stop && __atomic_load_n(stop, __ATOMIC_RELAXED))) {
+        uint64_t generation = __atomic_load_n(&region->generation, __ATOMIC_ACQUIRE);
+        uint64_t now = monotonicNanos();
+        
+        stats->polls++;
+        
+        if (haveLast && generation == lastGeneration && now < nextExpiry) {
+            if (pollInterval) {
+                sleepNanos(pollInterval);
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+        
+        uint64_t newest = 0;
+        // Expiries and the state an earlier writer left behind have no publish to measure from
+        int published = haveLast && generation != lastGeneration;
+        
+        stats->changes++;
+        lastGeneration = generation;
+        nextExpiry = UINT64_MAX;
+        memcpy(report, base, sizeof(report));
+        
+        for (int z = 0; z < profile->numZones && z < (int)region->numZones; z++) {
+            int shown = 0;
+            
+            for (int p = SHM_CONTROL_PRIORITIES - 1; p >= 0; p--) {
+                uint64_t value, expires, publishedAt;
+                
+                if (!shmControlSlotRead(&region->slots[z][p], &value, &expires, &publishedAt, &stats->retries)) {
+                    continue;
+                }
+                
+                newest = publishedAt > newest ? publishedAt : newest;
+                
+                if (shown || !(value >> 24 & 0xff) || (expires && expires <= now)) {
+                    continue;
+                }
+                
+                uint8_t values[3] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16) };
+                
+                deviceProfileEncodeZone(&profile->zones[z], values, report, sizeof(report));
+                nextExpiry = expires && expires < nextExpiry ? expires : nextExpiry;
+                shown = 1;
+            }
+        }
+        
+        if (haveLast && memcmp(report, lastReport, sizeof(report)) == 0) {
+            continue;
+        }
+        
+        int numFailed = transportWrite(targets, numTargets, report, sizeof(report));
+        
+        stats->writes++;
+        stats->writeFailures += (uint64_t)numFailed;
+        
+        if (published && newest) {
+            latencyHistogramRecord(&stats->latency, monotonicNanos() - newest, numFailed != 0);
+        }
+        
+        memcpy(lastReport, report, sizeof(report));
+        haveLast = 1;
+    }
+    
+    if (!stop) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+    }
+    
+    return stats->writeFailures ? -1 : 0;
+}
+
+void shmControlPrintStats(const struct shmControlStats *stats, FILE *fp)
+{
+    fprintf(fp, "shared polls=%llu changes=%llu writes=%llu failed=%llu torn-reads=%llu\n",
+            (unsigned long long)stats->polls, (unsigned long long)stats->changes, (unsigned long long)stats->writes,
+            (unsigned long long)stats->writeFailures, (unsigned long long)stats->retries);
+    
+    if (stats->latency.count) {
+        fprintf(fp, "shared publish to write p50=%.1fus p99=%.1fus max=%.1fus\n",
+                latencyHistogramPercentile(&stats->latency, 50) / 1e3,
+                latencyHistogramPercentile(&stats->latency, 99) / 1e3, stats->latency.max / 1e3);
+    }
+}
+
+struct shmControlBenchProducer {
+    struct shmControl *shm;
+    int zone;
+    int priority;
+    uint64_t count;
+};
+
+static void *shmControlBenchPublish(void *arg)
+{
+    struct shmControlBenchProducer *producer = arg;
+    uint8_t values[3] = { 0, 64, 128 };
+    
+    for (uint64_t i = 0; i < producer->count; i++) {
+        values[0] = (uint8_t)i;
+        shmControlPublish(producer->shm, producer->zone, producer->priority, values, 0);
+    }
+    
+    return NULL;
+}
+
+struct shmControlBenchWriter {
+    struct shmControl *shm;
+    struct keyColorTarget *targets;
+    size_t numTargets;
+    uint64_t pollInterval;
+    volatile sig_atomic_t stop;
+    struct shmControlStats stats;
+};
+
+static void *shmControlBenchRun(void *arg)
+{
+    struct shmControlBenchWriter *writer = arg;
+    const uint8_t base[KEYCOLOR_REPORT_SIZE] = { 0 };
+    
+    shmControlRun(writer->shm, base, writer->targets, writer->numTargets, writer->pollInterval, &writer->stop, &writer->stats);
+    
+    return NULL;
+}
+
+// Producer cost per update alone, from four threads on their own slots and on one shared slot, then
+// publish to written latency with the writer spinning and polling
+int shmControlBenchmark(struct benchOptions *opts)
+{
+    struct shmControl shm;
+    char name[32];
+    int ret = 0;
+    
+    snprintf(name, sizeof(name), "/kc-bench.%d", (int)getpid());
+    
+    if (shmControlCreate(name, &deviceProfiles[0], &shm)) {
+        return -1;
+    }
+    
+    static const struct {
+        const char *label;
+        int numThreads;
+        int shared;
+    } cases[] = {
+        { "publish/1", 1, 0 },
+        { "publish/4", 4, 0 },
+        { "shared/4", 4, 1 },
+    };
+    
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        struct shmControlBenchProducer producers[4];
+        pthread_t ids[4];
+        uint64_t perThread = (uint64_t)opts->iterations * 5000 / (uint64_t)cases[c].numThreads;
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < cases[c].numThreads; i++) {
+            producers[i].shm = &shm;
+            producers[i].zone = cases[c].shared ? 1 : i % 2;
+            producers[i].priority = cases[c].shared ? 0 : i / 2;
+            producers[i].count = perThread;
+            pthread_create(&ids[i], NULL, shmControlBenchPublish, &producers[i]);
+        }
+        
+        for (int i = 0; i < cases[c].numThreads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        
+        benchReportThroughput(cases[c].label, perThread * (uint64_t)cases[c].numThreads, monotonicNanos() - startTime, benchAllocations() - allocs, 0);
+    }
+    
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        transportClose(transport);
+        shmControlDetach(&shm);
+        shm_unlink(name);
+        return -1;
+    }
+    
+    transportSetCaching(transport, 0);
+    
+    static const uint64_t pollIntervals[] = { 0, 100000ull, 1000000ull };
+    
+    for (size_t i = 0; i < sizeof(pollIntervals) / sizeof(pollIntervals[0]); i++) {
+        struct shmControlBenchWriter writer;
+        pthread_t id;
+        uint8_t values[3] = { 0, 0, 0 };
+        int numUpdates = opts->iterations < 500 ? opts->iterations : 500;
+        char label[32];
+        
+        memset(&writer, 0, sizeof(writer));
+        writer.shm = &shm;
+        writer.targets = targets;
+        writer.numTargets = numTargets;
+        writer.pollInterval = pollIntervals[i];
+        
+        if (pthread_create(&id, NULL, shmControlBenchRun, &writer)) {
+            ret = -1;
+            break;
+        }
+        
+        // Far enough apart that every update is written on its own
+        for (int n = 0; n < numUpdates; n++) {
+            values[1] = (uint8_t)(n + 1);
+            shmControlPublish(&shm, 1, 2, values, 0);
+            sleepNanos(pollIntervals[i] * 2 + 500000ull);
+        }
+        
+        __atomic_store_n(&writer.stop, 1, __ATOMIC_RELAXED);
+        pthread_join(id, NULL);
+        
+        if (pollIntervals[i]) {
+            snprintf(label, sizeof(label), "poll=%lluus", (unsigned long long)(pollIntervals[i] / 1000));
+        } else {
+            snprintf(label, sizeof(label), "spin");
+        }
+        
+        fprintf(benchNotes(), "# %s publish to written p50=%.1fus p99=%.1fus max=%.1fus writes=%llu/%d\n", label,
+                latencyHistogramPercentile(&writer.stats.latency, 50) / 1e3,
+                latencyHistogramPercentile(&writer.stats.latency, 99) / 1e3, writer.stats.latency.max / 1e3,
+                (unsigned long long)writer.stats.writes, numUpdates);
+    }
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    shmControlDetach(&shm);
+    shm_unlink(name);
+    
+    return ret;
+}
@@ -0,0 +1,99 @@
+//
+//  shmcontrol.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef shmcontrol_h
+#define shmcontrol_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include "keycolor.h"
+#include "profiles.h"
+#include "latency.h"
+#include "bench.h"
+
+#define SHM_CONTROL_MAGIC "KCSHMCTL"
+#define SHM_CONTROL_VERSION 1
+
+// Per zone, the writer shows the highest priority slot that is active and not expired
+#define SHM_CONTROL_PRIORITIES 4
+
+// Seqlock protected desired state. Producers on the same slot serialize on the odd sequence, everything
+// else is plain stores. A cache line each so producers on different slots never share one
+struct shmControlSlot {
+    uint64_t sequence;          // odd while a producer is writing
+    uint64_t value;             // bytes 0-2 the zone's report bytes, byte 3 nonzero while active
+    uint64_t expires;           // monotonicNanos() after which the writer ignores the slot, 0 never
+    uint64_t publishedAt;       // monotonicNanos() of the update, for end to end latency
+    uint64_t ownerPid;          // producer holding the odd sequence, a slot is only taken over once it is gone
+    uint64_t reserved[3];
+};
+
+// Mapped by the writer and every producer, host byte order
+struct shmControlRegion {
+    char magic[8];
+    uint32_t version;
+    uint32_t numZones;
+    char zoneNames[PROFILE_MAX_ZONES][16];
+    uint8_t zoneLengths[PROFILE_MAX_ZONES];
+    uint64_t writerPid;
+    uint64_t generation;        // bumped after every publish, the one word the writer polls
+    uint64_t reserved[4];
+    struct shmControlSlot slots[PROFILE_MAX_ZONES][SHM_CONTROL_PRIORITIES];
+};
+
+struct shmControl {
+    struct shmControlRegion *region;
+    char name[32];
+    int owner;                  // created it, unlinks it on detach
+};
+
+struct shmControlStats {
+    uint64_t polls;
+    uint64_t changes;           // generation moved or a slot expired
+    uint64_t writes;
+    uint64_t writeFailures;
+    uint64_t retries;           // reads that raced a producer and went again
+    struct latencyHistogram latency;    // publish to report written
+};
+
+const char *shmControlDefaultName(void);
+int shmControlCreate(const char *name, const struct deviceProfile *profile, struct shmControl *shm);
+int shmControlAttach(const char *name, struct shmControl *shm);
+void shmControlDetach(struct shmControl *shm);
+int shmControlZone(const struct shmControl *shm, const char *name);
+void shmControlPublish(struct shmControl *shm, int zone, int priority, const uint8_t *values, uint64_t ttl);
+void shmControlRelease(struct shmControl *shm, int zone, int priority);
+int shmControlPublishSpec(struct shmControl *shm, const char *spec);
+int shmControlRun(struct shmControl *shm, const uint8_t *base, struct keyColorTarget *targets, size_t numTargets, uint64_t pollInterval, volatile sig_atomic_t *stop, struct shmControlStats *stats);
+void shmControlPrintStats(const struct shmControlStats *stats, FILE *fp);
+int shmControlBenchmark(struct benchOptions *opts);
+
+#endif /* shmcontrol_h */
@@ -0,0 +1,777 @@
+//
+//  statefile.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#ifdef __APPLE__
+#include <sys/event.h>
+#endif
+#include "statefile.h"
+#include "transport.h"
+#include "color.h"
+#include "command.h"
+#include "timeutil.h"
+
+// Keyboards that failed a write get it again this often while nothing else happens
+#define STATE_FILE_RETRY_INTERVAL 1000000000ull
+
+// Longest the watch blocks before looking at the stop flag again
+#define STATE_FILE_WAKE_INTERVAL 250000000ull
+
+static volatile sig_atomic_t stateFileStopRequested = 0;
+
+static void stateFileSignalHandler(int sig)
+{
+    stateFileStopRequested = sig;
+}
+
+static char *stateFileTrim(char *str)
+{
+    char *end = str + strlen(str);
+    
+    while (*str == ' ' || *str == '\t' || *str == '\r') {
+        str++;
+    }
+    
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    
+    return str;
+}
+
+// Same rules as --publish, single level zones take a level or the brightest channel of a color
+static int stateFileZoneValue(const struct deviceZone *zone, const char *value, uint8_t *values)
+{
+    char *end;
+    long level = strtol(value, &end, 10);
+    
+    if (zone->length == 1 && end != value && *end == '\0' && level >= 0 && level <= 255) {
+        values[0] = values[1] = values[2] = (uint8_t)level;
+        return 0;
+    }
+    
+    if (colorParseBytes(value, &values[0], &values[1], &values[2])) {
+        return -1;
+    }
+    
+    if (zone->length == 1) {
+        values[0] = values[1] > values[0] ? values[1] : values[0];
+        values[0] = values[2] > values[0] ? values[2] : values[0];
+    }
+    
+    return 0;
+}
+
+// One name = value per line, a line starting with # is a comment. Names are the profile's zones,
+// brightness, effect, period and to. Every bad line is reported, text is modified in place
+int stateFileParse(const char *name, char *text, const struct deviceProfile *profile, struct stateFile *state)
+{
+    int lineNumber = 0, ret = 0;
+    
+    memset(state, 0, sizeof(*state));
+    state->brightness = 65536;
+    state->period = 2000000000ull;
+    
+    for (char *line = text, *next; line; line = next) {
+        if ((next = strchr(line, '\n'))) {
+            *next++ = '\0';
+        }
+        lineNumber++;
+        line = stateFileTrim(line);
+        
+        if (*line == '\0' || *line == '#') {
+            continue;
+        }
+        
+        char *value = strchr(line, '=');
+        
+        if (!value) {
+            fprintf(stderr, "%s:%d: expected name = value\n", name, lineNumber);
+            ret = -1;
+            continue;
+        }
+        *value++ = '\0';
+        line = stateFileTrim(line);
+        value = stateFileTrim(value);
+        
+        const struct deviceZone *zone = deviceProfileZone(profile, line);
+        
+        if (zone) {
+            int z = (int)(zone - profile->zones);
+            
+            if (stateFileZoneValue(zone, value, state->zones[z])) {
+                fprintf(stderr, "%s:%d: unknown color '%s', --rgb list shows the names\n", name, lineNumber, value);
+                ret = -1;
+            }
+            state->zonesSet |= 1u << z;
+        } else if (strcmp(line, "brightness") == 0) {
+            char *end;
+            double percent = strtod(value, &end);
+            
+            if (end == value || (*end && strcmp(end, "%") != 0) || percent < 0 || percent > 100) {
+                fprintf(stderr, "%s:%d: brightness must be 0-100%%\n", name, lineNumber);
+                ret = -1;
+            } else {
+                state->brightness = (uint32_t)(percent * 65536.0 / 100.0 + 0.5);
+            }
+        } else if (strcmp(line, "effect") == 0) {
+            state->effect = animationParseEffect(value);
+            
+            if (state->effect == EFFECT_NONE && strcmp(value, "none") != 0) {
+                fprintf(stderr, "%s:%d: unknown effect '%s', expected none, fade, breathe, cycle or strobe\n", name, lineNumber, value);
+                ret = -1;
+            }
+        } else if (strcmp(line, "period") == 0) {
+            int64_t nanos = parseDuration(value);
+            
+            if (nanos <= 0) {
+                fprintf(stderr, "%s:%d: bad period '%s'\n", name, lineNumber, value);
+                ret = -1;
+            } else {
+                state->period = (uint64_t)nanos;
+            }
+        } else if (strcmp(line, "to") == 0) {
+            if (colorParseBytes(value, &state->to[0], &state->to[1], &state->to[2])) {
+                fprintf(stderr, "%s:%d: unknown color '%s', --rgb list shows the names\n", name, lineNumber, value);
+                ret = -1;
+            }
+            state->toSet = 1;
+        } else {
+            fprintf(stderr, "%s:%d: unknown setting '%s', expected a zone of the %s, brightness, effect, period or to\n",
+                    name, lineNumber, line, profile->name);
+            ret = -1;
+        }
+    }
+    
+    return ret;
+}
+
+int stateFileLoad(const char *path, const struct deviceProfile *profile, struct stateFile *state)
+{
+    int fd = open(path, O_RDONLY);
+    char *text = malloc(STATE_FILE_MAX_SIZE + 1);
+    size_t len = 0;
+    ssize_t n = 0;
+    
+    if (fd < 0 || !text) {
+        fprintf(stderr, "%s: %s\n", path, strerror(fd < 0 ? errno : ENOMEM));
+        if (fd >= 0) close(fd);
+        free(text);
+        return -1;
+    }
+    
+    while (len <= STATE_FILE_MAX_SIZE && (n = read(fd, text + len, STATE_FILE_MAX_SIZE + 1 - len)) > 0) {
+        len += (size_t)n;
+    }
+    close(fd);
+    
+    if (n < 0 || len > STATE_FILE_MAX_SIZE) {
+        fprintf(stderr, "%s: %s\n", path, n < 0 ? strerror(errno) : "larger than 64KB");
+        free(text);
+        return -1;
+    }
+    text[len] = '\0';
+    
+    int ret = stateFileParse(path, text, profile, state);
+    
+    free(text);
+    
+    return ret;
+}
+
+// Changes that cannot show are left out, period and to mean nothing without an effect
+uint32_t stateFileDiff(const struct stateFile *from, const struct stateFile *to)
+{
+    uint32_t changed = 0;
+    
+    for (int z = 0; z < PROFILE_MAX_ZONES; z++) {
+        uint32_t bit = 1u << z;
+        
+        if ((from->zonesSet & bit) != (to->zonesSet & bit) ||
+            ((to->zonesSet & bit) && memcmp(from->zones[z], to->zones[z], sizeof(to->zones[z])) != 0)) {
+            changed |= bit;
+        }
+    }
+    
+    if (from->brightness != to->brightness) {
+        changed |= STATE_CHANGED_BRIGHTNESS;
+    }
+    
+    if (from->effect != to->effect ||
+        (to->effect != EFFECT_NONE && (from->period != to->period || from->toSet != to->toSet || memcmp(from->to, to->to, sizeof(to->to)) != 0))) {
+        changed |= STATE_CHANGED_EFFECT;
+    }
+    
+    return changed;
+}
+
+// from is base with the file's zones over it, to swaps in the to color on every r,g,b zone, both at the brightness
+void stateFileAnimation(const struct stateFile *state, const struct deviceProfile *profile, const uint8_t *base, struct animationOptions *animation)
+{
+    memcpy(animation->from, base, sizeof(animation->from));
+    
+    for (int z = 0; z < profile->numZones; z++) {
+        if (state->zonesSet & (1u << z)) {
+            deviceProfileEncodeZone(&profile->zones[z], state->zones[z], animation->from, sizeof(animation->from));
+        }
+    }
+    
+    memcpy(animation->to, animation->from, sizeof(animation->to));
+    
+    for (int z = 0; z < profile->numZones; z++) {
+        if (profile->zones[z].length == 3) {
+            deviceProfileEncodeZone(&profile->zones[z], state->to, animation->to, sizeof(animation->to));
+        }
+    }
+    
+    if (state->brightness != 65536) {
+        colorScaleReport(animation->from, state->brightness, animation->from, sizeof(animation->from));
+        colorScaleReport(animation->to, state->brightness, animation->to, sizeof(animation->to));
+    }
+    
+    animation->effect = state->effect;
+    animation->period = state->period;
+    animation->layers = NULL;
+    animation->program = NULL;
+}
+
+static void stateFileChangedNames(uint32_t changed, const struct deviceProfile *profile, char *buf, size_t bufSize)
+{
+    size_t len = 0;
+    
+    buf[0] = '\0';
+    
+    for (int z = 0; z < profile->numZones; z++) {
+        if (changed & (1u << z) && len < bufSize) {
+            len += (size_t)snprintf(buf + len, bufSize - len, "%s%s", len ? "," : "", profile->zones[z].name);
+        }
+    }
+    
+    if (changed & STATE_CHANGED_BRIGHTNESS && len < bufSize) {
+        len += (size_t)snprintf(buf + len, bufSize - len, "%sbrightness", len ? "," : "");
+    }
+    
+    if (changed & STATE_CHANGED_EFFECT && len < bufSize) {
+        snprintf(buf + len, bufSize - len, "%seffect", len ? "," : "");
+    }
+}
+
+// Only keyboards not already showing report get it, a failed one stays pending for the retry
+static int stateFileWrite(struct keyColorTarget *targets, size_t numTargets, uint8_t (*shown)[KEYCOLOR_REPORT_SIZE], uint8_t *pending,
+                          const uint8_t *report, struct stateFileStats *stats)
+{
+    int numFailed = 0;
+    
+    for (size_t i = 0; i < numTargets; i++) {
+        if (!pending[i] && memcmp(shown[i], report, KEYCOLOR_REPORT_SIZE) == 0) {
+            stats->reportsSkipped++;
+            continue;
+        }
+        
+        if (transportWriteTarget(&targets[i], report, KEYCOLOR_REPORT_SIZE)) {
+            stats->writeFailures++;
+            pending[i] = 1;
+            numFailed++;
+            continue;
+        }
+        
+        memcpy(shown[i], report, KEYCOLOR_REPORT_SIZE);
+        pending[i] = 0;
+        stats->reportsWritten++;
+    }
+    
+    return numFailed;
+}
+
+// Change notification for one file. Linux and macOS watch the directory so editors and config
+// management that replace the file by rename are seen, elsewhere the file is polled
+struct stateWatch {
+    int fd;
+    int dirFd;                  // kqueue, the directory's vnode
+    int fileFd;                 // kqueue, the file's own vnode, reopened after each event
+    char dir[PATH_MAX];
+    char base[NAME_MAX + 1];
+    const char *path;
+    struct stat last;
+};
+
+#ifdef __APPLE__
+static void stateWatchFile(struct stateWatch *watch)
+{
+    struct kevent change;
+    
+    if (watch->fileFd >= 0) {
+        close(watch->fileFd);
+    }
+    
+    if ((watch->fileFd = open(watch->path, O_EVTONLY)) >= 0) {
+        EV_SET(&change, watch->fileFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+        kevent(watch->fd, &change, 1, NULL, 0, NULL);
+    }
+}
+#endif
+
+static int stateWatchOpen(struct stateWatch *watch, const char *path)
+{
+    char copy[PATH_MAX];
+    
+    memset(watch, 0, sizeof(*watch));
+    watch->fd = watch->dirFd = watch->fileFd = -1;
+    watch->path = path;
+    snprintf(copy, sizeof(copy), "%s", path);
+    snprintf(watch->dir, sizeof(watch->dir), "%s", dirname(copy));
+    snprintf(copy, sizeof(copy), "%s", path);
+    snprintf(watch->base, sizeof(watch->base), "%s", basename(copy));
+    
+#if defined(__linux__)
+    if ((watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 ||
+        inotify_add_watch(watch->fd, watch->dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Failed to watch %s: %s\n", watch->dir, strerror(errno));
+        if (watch->fd >= 0) close(watch->fd);
+        return -1;
+    }
+#elif defined(__APPLE__)
+    struct kevent change;
+    
+    if ((watch->dirFd = open(watch->dir, O_EVTONLY)) < 0 || (watch->fd = kqueue()) < 0) {
+        fprintf(stderr, "Failed to watch %s: %s\n", watch->dir, strerror(errno));
+        if (watch->dirFd >= 0) close(watch->dirFd);
+        return -1;
+    }
+    
+    // Entries added, removed or renamed in the directory
+    EV_SET(&change, watch->dirFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, NULL);
+    kevent(watch->fd, &change, 1, NULL, 0, NULL);
+    stateWatchFile(watch);
+#else
+    stat(path, &watch->last);
+#endif
+    
+    return 0;
+}
+
+// Events for the file within timeout nanoseconds, 0 when none came
+static int stateWatchWait(struct stateWatch *watch, uint64_t timeout)
+{
+    int numEvents = 0;
+    
+#if defined(__linux__)
+    struct pollfd pfd = { watch->fd, POLLIN, 0 };
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    
+    if (poll(&pfd, 1, (int)(timeout / 1000000ull)) <= 0) {
+        return 0;
+    }
+    
+    // Drain everything queued, a save is often several events and one reload covers them all.
+    // Any rename into the directory counts, symlink swaps move a directory entry, not the file
+    while ((len = read(watch->fd, buf, sizeof(buf))) > 0) {
+        for (char *cp = buf; cp < buf + len;) {
+            struct inotify_event *event = (struct inotify_event *)cp;
+            
+            if (event->mask & IN_MOVED_TO || (event->len && strcmp(event->name, watch->base) == 0)) {
+                numEvents++;
+            }
+            cp += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#elif defined(__APPLE__)
+    struct kevent events[8];
+    struct timespec ts = { (time_t)(timeout / 1000000000ull), (long)(timeout % 1000000000ull) };
+    struct timespec none = { 0, 0 };
+    int n = kevent(watch->fd, NULL, 0, events, 8, &ts);
+    
+    while (n > 0) {
+        numEvents += n;
+        n = kevent(watch->fd, NULL, 0, events, 8, &none);
+    }
+    
+    // The file may be a different vnode now, or gone until the next rename brings it back
+    if (numEvents) {
+        stateWatchFile(watch);
+    }
+#else
+    struct stat st;
+    
+    sleepNanos(timeout);
+    
+    if (stat(watch->path, &st) == 0 &&
+        (st.st_mtime != watch->last.st_mtime || st.st_size != watch->last.st_size || st.st_ino != watch->last.st_ino)) {
+        watch->last = st;
+        numEvents = 1;
+    }
+#endif
+    
+    return numEvents;
+}
+
+static void stateWatchClose(struct stateWatch *watch)
+{
+#ifdef __APPLE__
+    if (watch->fileFd >= 0) {
+        close(watch->fileFd);
+    }
+    close(watch->dirFd);
+#endif
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+}
+
+static void stateFileRecordLatency(struct stateFileStats *stats, uint64_t latency, int failed)
+{
+    latencyHistogramRecord(&stats->latency, latency, failed);
+    
+    if (stats->samples && stats->numSamples < stats->maxSamples) {
+        stats->samples[stats->numSamples++] = latency;
+    }
+}
+
+// Applies path, then with follow reloads it on every change until SIGINT/SIGTERM or *stop. A reload matching
+// the applied state writes nothing, otherwise only keyboards whose report changed are written. An effect keeps
+// running between reloads and only restarts its phase when the effect itself changed. Returns -1 when the
+// file can't be watched or read at the start, 1 when keyboards were left without the last state
+int stateFileRun(const char *path, const uint8_t *base, struct keyColorTarget *targets, size_t numTargets, int follow, double rate, FILE *report, volatile sig_atomic_t *stop, struct stateFileStats *stats)
+{
+    const struct deviceProfile *profile = numTargets && targets[0].profile ? targets[0].profile : &deviceProfiles[0];
+    uint8_t (*shown)[KEYCOLOR_REPORT_SIZE] = calloc(numTargets ? numTargets : 1, KEYCOLOR_REPORT_SIZE);
+    uint8_t *pending = calloc(numTargets ? numTargets : 1, 1);
+    uint64_t framePeriod = (uint64_t)(1e9 / (rate > 0 ? rate : 60.0));
+    uint64_t *samples = stats->samples;
+    size_t maxSamples = stats->maxSamples;
+    struct stateFile applied, next;
+    struct animationOptions animation;
+    struct stateWatch watch;
+    uint8_t frame[KEYCOLOR_REPORT_SIZE];
+    char names[128];
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->samples = samples;
+    stats->maxSamples = maxSamples;
+    
+    if (!shown || !pending) {
+        fprintf(stderr, "Failed to allocate state file tracking!\n");
+        free(shown);
+        free(pending);
+        return -1;
+    }
+    
+    // Watching starts before the first read so a change landing in between is not missed
+    if (follow && stateWatchOpen(&watch, path)) {
+        free(shown);
+        free(pending);
+        return -1;
+    }
+    
+    if (stateFileLoad(path, profile, &applied)) {
+        if (follow) stateWatchClose(&watch);
+        free(shown);
+        free(pending);
+        return -1;
+    }
+    
+    // Nothing is known about what the keyboards show yet, the first apply writes them all
+    memset(pending, 1, numTargets);
+    memset(&animation, 0, sizeof(animation));
+    animation.rate = rate;
+    stateFileAnimation(&applied, profile, base, &animation);
+    
+    uint64_t effectStart = monotonicNanos();
+    
+    animationRender(&animation, 0, frame);
+    
+    int numFailed = stateFileWrite(targets, numTargets, shown, pending, frame, stats);
+    uint64_t nextFrame = monotonicNanos() + framePeriod;
+    uint64_t nextRetry = monotonicNanos() + STATE_FILE_RETRY_INTERVAL;
+    
+    if (report) {
+        fprintf(report, "state applied %s: written %llu failed %d\n", path, (unsigned long long)stats->reportsWritten, numFailed);
+    }
+    
+    if (follow && !stop) {
+        struct sigaction sa;
+        
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = stateFileSignalHandler;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+    
+    while (follow && !stateFileStopRequested && !(stop && __atomic_load_n(stop, __ATOMIC_RELAXED))) {
+        uint64_t now = monotonicNanos();
+        uint64_t wake = now + STATE_FILE_WAKE_INTERVAL;
+        
+        if (animation.effect != EFFECT_NONE && nextFrame < wake) {
+            wake = nextFrame;
+        }
+        
+        if (numFailed && nextRetry < wake) {
+            wake = nextRetry;
+        }
+        
+        int numEvents = stateWatchWait(&watch, wake > now ? wake - now : 0);
+        
+        now = monotonicNanos();
+        
+        if (numEvents) {
+            stats->events += (uint64_t)numEvents;
+            stats->reloads++;
+            
+            if (stateFileLoad(path, profile, &next)) {
+                stats->errors++;
+                
+                if (report) {
+                    fprintf(report, "state reload %llu: kept the applied state\n", (unsigned long long)stats->reloads);
+                }
+                continue;
+            }
+            
+            uint64_t parsed = monotonicNanos();
+            uint32_t changed = stateFileDiff(&applied, &next);
+            
+            if (!changed) {
+                stats->unchanged++;
+                
+                if (report) {
+                    fprintf(report, "state reload %llu: unchanged, parse %.1fus\n", (unsigned long long)stats->reloads, (parsed - now) / 1e3);
+                }
+                continue;
+            }
+            
+            if (changed & STATE_CHANGED_EFFECT) {
+                effectStart = now;
+            }
+            
+            uint64_t written = stats->reportsWritten, skipped = stats->reportsSkipped;
+            
+            applied = next;
+            stateFileAnimation(&applied, profile, base, &animation);
+            animationRender(&animation, now - effectStart, frame);
+            numFailed = stateFileWrite(targets, numTargets, shown, pending, frame, stats);
+            
+            uint64_t appliedAt = monotonicNanos();
+            
+            stateFileRecordLatency(stats, appliedAt - now, numFailed != 0);
+            nextFrame = appliedAt + framePeriod;
+            nextRetry = appliedAt + STATE_FILE_RETRY_INTERVAL;
+            
+            if (report) {
+                stateFileChangedNames(changed, profile, names, sizeof(names));
+                fprintf(report, "state reload %llu: changed %s, parse %.1fus apply %.1fus total %.1fus, written %llu skipped %llu failed %d\n",
+                        (unsigned long long)stats->reloads, names, (parsed - now) / 1e3, (appliedAt - parsed) / 1e3, (appliedAt - now) / 1e3,
+                        (unsigned long long)(stats->reportsWritten - written), (unsigned long long)(stats->reportsSkipped - skipped), numFailed);
+            }
+        } else if (animation.effect != EFFECT_NONE && now >= nextFrame) {
+            animationRender(&animation, now - effectStart, frame);
+            numFailed = stateFileWrite(targets, numTargets, shown, pending, frame, stats);
+            stats->frames++;
+            
+            // A frame that came due while a reload was applied is dropped, not caught up on
+            nextFrame += framePeriod;
+            
+            if (nextFrame < now) {
+                nextFrame = now + framePeriod;
+            }
+        } else if (numFailed && now >= nextRetry) {
+            numFailed = stateFileWrite(targets, numTargets, shown, pending, frame, stats);
+            nextRetry = now + STATE_FILE_RETRY_INTERVAL;
+        }
+    }
+    
+    if (follow) {
+        stateWatchClose(&watch);
+        
+        if (!stop) {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+        }
+    }
+    
+    free(shown);
+    free(pending);
+    
+    return numFailed ? 1 : 0;
+}
+
+void stateFilePrintStats(const struct stateFileStats *stats, FILE *fp)
+{
+    fprintf(fp, "state events=%llu reloads=%llu unchanged=%llu errors=%llu written=%llu skipped=%llu failed=%llu frames=%llu\n",
+            (unsigned long long)stats->events, (unsigned long long)stats->reloads, (unsigned long long)stats->unchanged,
+            (unsigned long long)stats->errors, (unsigned long long)stats->reportsWritten, (unsigned long long)stats->reportsSkipped,
+            (unsigned long long)stats->writeFailures, (unsigned long long)stats->frames);
+    
+    if (stats->latency.count) {
+        fprintf(fp, "state reload to applied p50=%.1fus p99=%.1fus max=%.1fus\n",
+                latencyHistogramPercentile(&stats->latency, 50) / 1e3,
+                latencyHistogramPercentile(&stats->latency, 99) / 1e3, stats->latency.max / 1e3);
+    }
+}
+
+struct stateFileBenchWatcher {
+    const char *path;
+    const uint8_t *base;
+    struct keyColorTarget *targets;
+    size_t numTargets;
+    volatile sig_atomic_t stop;
+    struct stateFileStats stats;
+};
+
+static void *stateFileBenchWatch(void *arg)
+{
+    struct stateFileBenchWatcher *watcher = arg;
+    
+    stateFileRun(watcher->path, watcher->base, watcher->targets, watcher->numTargets, 1, 60.0, NULL, &watcher->stop, &watcher->stats);
+    
+    return NULL;
+}
+
+static int stateFileBenchWrite(const char *path, const char *text, int replace)
+{
+    char tmpPath[PATH_MAX + 8];
+    
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    
+    int fd = open(replace ? tmpPath : path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    
+    if (fd < 0 || write(fd, text, strlen(text)) != (ssize_t)strlen(text)) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    close(fd);
+    
+    return replace ? rename(tmpPath, path) : 0;
+}
+
+// Parse cost, then config pushes into a followed file: every other push changes a color and is swapped in
+// by rename, the rest rewrite the same settings in place and should cost no report at all
+int stateFileBenchmark(struct benchOptions *opts)
+{
+    static const char sample[] =
+        "# workstation keyboard\n"
+        "keys = #ff6000\n"
+        "wasd = 255\n"
+        "brightness = 80%\n"
+        "effect = none\n"
+        "period = 4s\n"
+        "to = blue\n";
+    const struct deviceProfile *profile = &deviceProfiles[0];
+    char text[sizeof(sample)];
+    struct stateFile state;
+    int numParses = opts->iterations * 100;
+    
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (int i = 0; i < numParses; i++) {
+        memcpy(text, sample, sizeof(sample));
+        stateFileParse("bench", text, profile, &state);
+    }
+    
+    benchReportThroughput("parse", (uint64_t)numParses, monotonicNanos() - startTime, benchAllocations() - allocs, (uint64_t)numParses * sizeof(sample));
+    
+    char dir[] = "/tmp/logitech_keycolor.bench.XXXXXX";
+    char path[PATH_MAX], tmpPath[PATH_MAX + 8];
+    struct hidTransport *transport = mkdtemp(dir) ? transportOpen(opts->transportSpec ? opts->transportSpec : "fake:devices=4", 0, opts->verbose) : NULL;
+    struct stateFileBenchWatcher watcher;
+    int numPushes = opts->iterations / 2 * 2;
+    pthread_t thread;
+    
+    if (!transport) {
+        fprintf(stderr, "Failed to set up state file benchmark!\n");
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "%s/keyboard.state", dir);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.path = path;
+    watcher.base = opts->report;
+    watcher.stats.maxSamples = (size_t)numPushes + 64;
+    watcher.stats.samples = calloc(watcher.stats.maxSamples, sizeof(uint64_t));
+    
+    if (!watcher.stats.samples || stateFileBenchWrite(path, sample, 1) ||
+        transportResolveTargets(transport, &watcher.targets, &watcher.numTargets) ||
+        pthread_create(&thread, NULL, stateFileBenchWatch, &watcher)) {
+        fprintf(stderr, "Failed to set up state file benchmark!\n");
+        transportReleaseTargets(watcher.targets, watcher.numTargets);
+        transportClose(transport);
+        free(watcher.stats.samples);
+        unlink(path);
+        rmdir(dir);
+        return -1;
+    }
+    
+    // Pushes are spaced so each is its own reload instead of folding into the one before
+    sleepNanos(50000000ull);
+    
+    int numFailed = 0;
+    
+    for (int i = 0; i < numPushes; i++) {
+        if (i % 2 == 0) {
+            snprintf(text, sizeof(text), "keys = %d,%d,%d\n", (i * 7) & 0xff, 64, 128);
+        }
+        
+        numFailed += stateFileBenchWrite(path, text, i % 2 == 0) != 0;
+        sleepNanos(5000000ull);
+    }
+    
+    sleepNanos(50000000ull);
+    __atomic_store_n(&watcher.stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+    
+    benchReportLatency("reload", watcher.stats.samples, (int)watcher.stats.numSamples);
+    fprintf(benchNotes(), "# pushes=%d targets=%zu, writing every push to every keyboard would be %llu reports\n# ",
+            numPushes, watcher.numTargets, (unsigned long long)numPushes * watcher.numTargets);
+    stateFilePrintStats(&watcher.stats, benchNotes());
+    
+    transportReleaseTargets(watcher.targets, watcher.numTargets);
+    transportClose(transport);
+    free(watcher.stats.samples);
+    unlink(tmpPath);
+    unlink(path);
+    rmdir(dir);
+    
+    return numFailed ? -1 : 0;
+}
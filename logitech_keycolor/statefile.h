@@ -0,0 +1,85 @@
+//
+//  statefile.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+
+#ifndef statefile_h
+#define statefile_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include "keycolor.h"
+#include "profiles.h"
+#include "animation.h"
+#include "latency.h"
+#include "bench.h"
+
+#define STATE_FILE_MAX_SIZE 65536
+
+// What stateFileDiff() found changed, one bit per profile zone below these
+#define STATE_CHANGED_ZONES         ((1u << PROFILE_MAX_ZONES) - 1)
+#define STATE_CHANGED_BRIGHTNESS    (1u << PROFILE_MAX_ZONES)
+#define STATE_CHANGED_EFFECT        (1u << (PROFILE_MAX_ZONES + 1))   // effect, period or to, restarts it
+
+// Desired keyboard state, zones the file leaves out show the command line color
+struct stateFile {
+    uint32_t zonesSet;          // bit per profile zone the file names
+    uint8_t zones[PROFILE_MAX_ZONES][3];
+    uint32_t brightness;        // 0-65536 of linear light
+    enum animationEffect effect;
+    uint64_t period;
+    int toSet;
+    uint8_t to[3];              // second color of fade and strobe, every r,g,b zone
+};
+
+struct stateFileStats {
+    uint64_t events;            // change notifications, a burst of them folds into one reload
+    uint64_t reloads;
+    uint64_t unchanged;         // reloads that matched what was already applied
+    uint64_t errors;            // reloads that failed to read or parse, the applied state stays
+    uint64_t reportsWritten;
+    uint64_t reportsSkipped;    // keyboards already showing the new report
+    uint64_t writeFailures;
+    uint64_t frames;            // effect frames rendered
+    struct latencyHistogram latency;    // change noticed to last report written
+    uint64_t *samples;          // optional, every reload to apply latency, benchmarks set this
+    size_t maxSamples;
+    size_t numSamples;
+};
+
+int stateFileParse(const char *name, char *text, const struct deviceProfile *profile, struct stateFile *state);
+int stateFileLoad(const char *path, const struct deviceProfile *profile, struct stateFile *state);
+uint32_t stateFileDiff(const struct stateFile *from, const struct stateFile *to);
+void stateFileAnimation(const struct stateFile *state, const struct deviceProfile *profile, const uint8_t *base, struct animationOptions *animation);
+int stateFileRun(const char *path, const uint8_t *base, struct keyColorTarget *targets, size_t numTargets, int follow, double rate, FILE *report, volatile sig_atomic_t *stop, struct stateFileStats *stats);
+void stateFilePrintStats(const struct stateFileStats *stats, FILE *fp);
+int stateFileBenchmark(struct benchOptions *opts);
+
+#endif /* statefile_h */
@@ -0,0 +1,555 @@
+//
+//  timeline.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "timeline.h"
+#include "command.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "color.h"
+
+// Longest the player sleeps before looking at the stop flag again, a show can hold a color for an hour
+#define TIMELINE_SLEEP_SLICE 100000000ull
+
+static volatile sig_atomic_t timelineStopRequested = 0;
+
+static void timelineSignalHandler(int sig)
+{
+    timelineStopRequested = sig;
+}
+
+struct timelineBuilder {
+    struct timelineFrame *frames;
+    size_t numFrames;
+    size_t maxFrames;
+    uint64_t at;                // time of the last keyframe
+    uint8_t current[KEYCOLOR_REPORT_SIZE];
+};
+
+// Frames at the same time collapse into the last one, frames that change nothing on the board are dropped
+static int timelineEmit(struct timelineBuilder *builder, uint64_t at, const uint8_t *report)
+{
+    if (builder->numFrames) {
+        struct timelineFrame *last = &builder->frames[builder->numFrames - 1];
+        
+        if (last->at == at) {
+            memcpy(last->report, report, KEYCOLOR_REPORT_SIZE);
+            return 0;
+        }
+        
+        if (memcmp(last->report, report, KEYCOLOR_REPORT_SIZE) == 0) {
+            return 0;
+        }
+    }
+    
+    if (builder->numFrames == builder->maxFrames) {
+        size_t maxFrames = builder->maxFrames ? builder->maxFrames * 2 : 1024;
+        struct timelineFrame *grown = realloc(builder->frames, sizeof(struct timelineFrame) * maxFrames);
+        
+        if (!grown) {
+            return -1;
+        }
+        builder->frames = grown;
+        builder->maxFrames = maxFrames;
+    }
+    
+    struct timelineFrame *frame = &builder->frames[builder->numFrames++];
+    
+    memset(frame, 0, sizeof(*frame));
+    frame->at = at;
+    memcpy(frame->report, report, KEYCOLOR_REPORT_SIZE);
+    
+    return 0;
+}
+
+// A fade is rendered at rate frames per second from the previous keyframe, landing exactly on to at the end
+static int timelineFade(struct timelineBuilder *builder, uint64_t at, const uint8_t *to, double rate)
+{
+    uint64_t from = builder->at;
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    
+    for (uint64_t frame = 1; ; frame++) {
+        uint64_t t = from + (uint64_t)((double)frame * 1e9 / rate);
+        
+        if (t >= at) {
+            break;
+        }
+        
+        colorMixReport(builder->current, to, (uint32_t)((t - from) * 65536 / (at - from)), report, KEYCOLOR_REPORT_SIZE);
+        
+        if (timelineEmit(builder, t, report)) {
+            return -1;
+        }
+    }
+    
+    return timelineEmit(builder, at, to);
+}
+
+static int isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static char *skipSpace(char *str)
+{
+    while (isSpace(*str)) {
+        str++;
+    }
+    
+    return str;
+}
+
+// Split off the first word, returns what follows it
+static char *nextWord(char *str)
+{
+    while (*str && !isSpace(*str)) {
+        str++;
+    }
+    
+    if (*str) {
+        *str++ = '\0';
+    }
+    
+    return skipSpace(str);
+}
+
+static int timelineWriteAll(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (n <= 0) {
+            return -1;
+        }
+        
+        p += n;
+        len -= (size_t)n;
+    }
+    
+    return 0;
+}
+
+// Keyframe script in, packed frames out. Each line is "[+]TIME [fade] COMMAND", "TIME end" or "rate FPS"
+int timelineCompile(FILE *script, const char *name, double rate, int fd, int verbose)
+{
+    struct timelineBuilder builder;
+    struct timelineHeader header;
+    char *line = NULL;
+    size_t lineSize = 0;
+    uint64_t duration = 0, keyframes = 0;
+    int lineNumber = 0, errors = 0;
+    
+    memset(&builder, 0, sizeof(builder));
+    
+    while (getline(&line, &lineSize, script) > 0) {
+        char *word = skipSpace(line);
+        char *end = word + strlen(word);
+        struct keyColorCommand cmd;
+        int fade = 0;
+        
+        lineNumber++;
+        
+        while (end > word && isSpace(end[-1])) {
+            *--end = '\0';
+        }
+        
+        if (*word == '\0' || *word == '#') {
+            continue;
+        }
+        
+        char *rest = nextWord(word);
+        
+        if (strcmp(word, "rate") == 0) {
+            rate = atof(rest);
+            
+            if (rate < 1 || rate > 1000) {
+                fprintf(stderr, "%s:%d: frame rate must be 1-1000\n", name, lineNumber);
+                errors++;
+                rate = 60;
+            }
+            continue;
+        }
+        
+        int64_t at = parseDuration(*word == '+' ? word + 1 : word);
+        
+        if (at < 0) {
+            fprintf(stderr, "%s:%d: bad time '%s'\n", name, lineNumber, word);
+            errors++;
+            continue;
+        }
+        
+        if (*word == '+') {
+            at += (int64_t)builder.at;
+        } else if ((uint64_t)at < builder.at) {
+            fprintf(stderr, "%s:%d: %s is before the previous keyframe\n", name, lineNumber, word);
+            errors++;
+            continue;
+        }
+        
+        if (strncmp(rest, "fade", 4) == 0 && isSpace(rest[4])) {
+            fade = 1;
+            rest = skipSpace(rest + 4);
+        }
+        
+        if (strcmp(rest, "end") == 0) {
+            duration = (uint64_t)at;
+            builder.at = (uint64_t)at;
+            continue;
+        }
+        
+        uint8_t to[KEYCOLOR_REPORT_SIZE];
+        
+        memcpy(to, builder.current, sizeof(to));
+        
+        switch (parseCommand(rest, &cmd)) {
+            case COMMAND_RGB:
+            case COMMAND_GRAY:
+                to[1] = cmd.red;
+                to[2] = cmd.green;
+                to[3] = cmd.blue;
+                break;
+            case COMMAND_WASD:
+                to[0] = cmd.red;
+                break;
+            case COMMAND_SLEEP:
+                fprintf(stderr, "%s:%d: sleep has no meaning in a timeline, give the keyframe a time instead\n", name, lineNumber);
+                errors++;
+                continue;
+            default:
+                fprintf(stderr, "%s:%d: bad command '%s'\n", name, lineNumber, rest);
+                errors++;
+                continue;
+        }
+        
+        if (fade ? timelineFade(&builder, (uint64_t)at, to, rate) : timelineEmit(&builder, (uint64_t)at, to)) {
+            fprintf(stderr, "%s: out of memory at %zu frames\n", name, builder.numFrames);
+            errors++;
+            break;
+        }
+        
+        memcpy(builder.current, to, sizeof(to));
+        builder.at = (uint64_t)at;
+        keyframes++;
+    }
+    
+    free(line);
+    
+    if (ferror(script)) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        errors++;
+    }
+    
+    if (errors) {
+        free(builder.frames);
+        return -1;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TIMELINE_MAGIC, sizeof(header.magic));
+    header.version = TIMELINE_VERSION;
+    header.reportSize = KEYCOLOR_REPORT_SIZE;
+    header.numFrames = builder.numFrames;
+    header.duration = builder.numFrames && builder.frames[builder.numFrames - 1].at > duration ? builder.frames[builder.numFrames - 1].at : duration;
+    
+    int ret = 0;
+    
+    if (timelineWriteAll(fd, &header, sizeof(header)) || timelineWriteAll(fd, builder.frames, sizeof(struct timelineFrame) * builder.numFrames)) {
+        fprintf(stderr, "%s: write failed: %s\n", name, strerror(errno));
+        ret = -1;
+    } else if (verbose) {
+        fprintf(stderr, "%s: keyframes=%llu frames=%zu duration=%.3fs bytes=%zu\n", name,
+                (unsigned long long)keyframes, builder.numFrames, header.duration / 1e9,
+                sizeof(header) + sizeof(struct timelineFrame) * builder.numFrames);
+    }
+    
+    free(builder.frames);
+    
+    return ret;
+}
+
+static int timelineMap(int fd, const char *name, struct timeline *timeline)
+{
+    struct stat st;
+    
+    memset(timeline, 0, sizeof(*timeline));
+    
+    if (fstat(fd, &st)) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    
+    if (!S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(struct timelineHeader)) {
+        fprintf(stderr, "%s: not a compiled timeline\n", name);
+        return -1;
+    }
+    
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap: %s\n", name, strerror(errno));
+        return -1;
+    }
+    
+    const struct timelineHeader *header = map;
+    size_t frameBytes = (size_t)st.st_size - sizeof(*header);
+    
+    if (memcmp(header->magic, TIMELINE_MAGIC, sizeof(header->magic)) != 0 || header->version != TIMELINE_VERSION ||
+        header->reportSize != KEYCOLOR_REPORT_SIZE || header->numFrames != frameBytes / sizeof(struct timelineFrame) ||
+        frameBytes % sizeof(struct timelineFrame) != 0) {
+        fprintf(stderr, "%s: not a compiled timeline, or compiled by another version\n", name);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    
+    // Playback walks the file front to back, let the kernel read ahead so no frame waits on a page fault
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+    
+    timeline->header = header;
+    timeline->frames = (const struct timelineFrame *)(header + 1);
+    timeline->map = map;
+    timeline->mapLen = (size_t)st.st_size;
+    
+    return 0;
+}
+
+int timelineOpen(const char *path, struct timeline *timeline)
+{
+    int fd = open(path, O_RDONLY);
+    
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    int ret = timelineMap(fd, path, timeline);
+    
+    close(fd);
+    
+    return ret;
+}
+
+void timelineClose(struct timeline *timeline)
+{
+    if (timeline->map) {
+        munmap(timeline->map, timeline->mapLen);
+    }
+    
+    memset(timeline, 0, sizeof(*timeline));
+}
+
+static void timelineSleepUntil(uint64_t deadline)
+{
+    uint64_t now;
+    
+    while (!timelineStopRequested && (now = monotonicNanos()) < deadline) {
+        sleepUntilNanos(deadline - now > TIMELINE_SLEEP_SLICE ? now + TIMELINE_SLEEP_SLICE : deadline);
+    }
+}
+
+// Reports go to the device straight out of the mapping, nothing is parsed or allocated per frame
+int timelinePlay(const struct timeline *timeline, struct keyColorTarget *targets, size_t numTargets, int paced, struct timelineStats *stats)
+{
+    const struct timelineFrame *frames = timeline->frames;
+    size_t numFrames = (size_t)timeline->header->numFrames;
+    uint64_t previous = 0;
+    int corrupt = 0;
+    
+    memset(stats, 0, sizeof(*stats));
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = timelineSignalHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    
+    uint64_t startTime = monotonicNanos();
+    
+    for (size_t i = 0; i < numFrames && !timelineStopRequested; i++) {
+        const struct timelineFrame *frame = &frames[i];
+        
+        if (frame->at < previous) {
+            fprintf(stderr, "frame %zu goes back in time, the timeline is corrupt\n", i);
+            corrupt = 1;
+            break;
+        }
+        previous = frame->at;
+        
+        if (paced) {
+            // Behind schedule only the newest due frame matters to the board, no bursting to catch up
+            if (i + 1 < numFrames && startTime + frames[i + 1].at <= monotonicNanos()) {
+                stats->framesSkipped++;
+                continue;
+            }
+            
+            timelineSleepUntil(startTime + frame->at);
+            
+            if (timelineStopRequested) {
+                break;
+            }
+            
+            uint64_t jitter = monotonicNanos() - (startTime + frame->at);
+            double delta = (double)jitter - stats->jitterMean;
+            
+            stats->jitterMean += delta / (double)(stats->framesSent + 1);
+            stats->jitterM2 += delta * ((double)jitter - stats->jitterMean);
+            
+            if (jitter > stats->jitterMax) {
+                stats->jitterMax = jitter;
+            }
+        }
+        
+        if (transportWrite(targets, numTargets, frame->report, KEYCOLOR_REPORT_SIZE)) {
+            stats->writeFailures++;
+        }
+        stats->framesSent++;
+    }
+    
+    // The last color stays up until the show's end time
+    if (paced && !corrupt) {
+        timelineSleepUntil(startTime + timeline->header->duration);
+    }
+    
+    stats->elapsed = monotonicNanos() - startTime;
+    
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    
+    return corrupt || stats->writeFailures ? -1 : 0;
+}
+
+void timelinePrintStats(const struct timeline *timeline, const struct timelineStats *stats)
+{
+    double seconds = stats->elapsed / 1e9;
+    double jitterStdDev = stats->framesSent > 1 ? sqrt(stats->jitterM2 / (double)(stats->framesSent - 1)) : 0.0;
+    
+    fprintf(stderr, "frames=%llu/%llu skipped=%llu failed=%llu elapsed=%.3fs duration=%.3fs\n",
+            (unsigned long long)stats->framesSent, (unsigned long long)timeline->header->numFrames,
+            (unsigned long long)stats->framesSkipped, (unsigned long long)stats->writeFailures,
+            seconds, timeline->header->duration / 1e9);
+    fprintf(stderr, "jitter mean=%.1fus stddev=%.1fus max=%.1fus\n",
+            stats->jitterMean / 1000.0, jitterStdDev / 1000.0, stats->jitterMax / 1000.0);
+}
+
+// Streams a compiled show unpaced through the fake device to price each frame
+static int timelineBenchmarkPlay(struct benchOptions *opts, int fd, int keyframes)
+{
+    struct timeline timeline;
+    struct timelineStats stats;
+    
+    if (timelineMap(fd, "bench", &timeline)) {
+        return -1;
+    }
+    
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets)) {
+        transportClose(transport);
+        timelineClose(&timeline);
+        return -1;
+    }
+    
+    uint64_t allocs = benchAllocations();
+    int ret = timelinePlay(&timeline, targets, numTargets, 0, &stats);
+    
+    benchReportThroughput("play", stats.framesSent, stats.elapsed, benchAllocations() - allocs, stats.framesSent * sizeof(struct timelineFrame));
+    
+    fprintf(benchNotes(), "# %d keyframes -> %llu frames, %.1f minutes of show in %zu bytes\n", keyframes,
+            (unsigned long long)timeline.header->numFrames, timeline.header->duration / 60e9, timeline.mapLen);
+    transportPrintStats(transport, benchNotes());
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    timelineClose(&timeline);
+    
+    return ret;
+}
+
+int timelineBenchmark(struct benchOptions *opts)
+{
+    FILE *script = tmpfile();
+    FILE *compiled = tmpfile();
+    int keyframes = opts->iterations * 10;
+    int ret = -1;
+    
+    if (!script || !compiled) {
+        perror("tmpfile");
+    } else {
+        fprintf(script, "rate 250\n0 rgb black\n");
+        
+        for (int i = 0; i < keyframes; i++) {
+            switch (i % 4) {
+                case 0: fprintf(script, "+1s fade rgb %d,%d,%d\n", i & 0xff, (i * 7) & 0xff, 255 - (i & 0xff)); break;
+                case 1: fprintf(script, "+250ms wasd %d\n", (i * 13) & 0xff); break;
+                case 2: fprintf(script, "+500ms fade rgb %uK\n", 1700u + (unsigned)(i % 100) * 100u); break;
+                default: fprintf(script, "+2s gray %d\n", (i * 3) & 0xff); break;
+            }
+        }
+        
+        long scriptBytes = ftell(script);
+        
+        rewind(script);
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        if (timelineCompile(script, "bench", 60, fileno(compiled), 0) == 0) {
+            benchReportThroughput("compile", (uint64_t)keyframes + 1, monotonicNanos() - startTime, benchAllocations() - allocs, scriptBytes > 0 ? (uint64_t)scriptBytes : 0);
+            ret = timelineBenchmarkPlay(opts, fileno(compiled), keyframes + 1);
+        }
+    }
+    
+    if (script) {
+        fclose(script);
+    }
+    
+    if (compiled) {
+        fclose(compiled);
+    }
+    
+    return ret;
+}
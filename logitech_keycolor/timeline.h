@@ -0,0 +1,81 @@
+//
+//  timeline.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef timeline_h
+#define timeline_h
+
+#include <stdio.h>
+#include "keycolor.h"
+#include "bench.h"
+
+#define TIMELINE_MAGIC "KCTIMELN"
+#define TIMELINE_VERSION 1
+
+// Compiled show, host byte order: this header then numFrames frames sorted by time
+struct timelineHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reportSize;        // KEYCOLOR_REPORT_SIZE
+    uint64_t numFrames;
+    uint64_t duration;          // nanoseconds, the last frame is held until then
+};
+
+struct timelineFrame {
+    uint64_t at;                // nanoseconds from the start of the show
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    uint8_t reserved[8 - KEYCOLOR_REPORT_SIZE];
+};
+
+// A compiled show mapped read-only, frames point straight into the mapping
+struct timeline {
+    const struct timelineHeader *header;
+    const struct timelineFrame *frames;
+    void *map;
+    size_t mapLen;
+};
+
+struct timelineStats {
+    uint64_t framesSent;
+    uint64_t framesSkipped;     // superseded by a later frame that was already due
+    uint64_t writeFailures;
+    uint64_t elapsed;
+    uint64_t jitterMax;         // nanoseconds a frame went out after its deadline
+    double jitterMean;
+    double jitterM2;
+};
+
+int timelineCompile(FILE *script, const char *name, double rate, int fd, int verbose);
+int timelineOpen(const char *path, struct timeline *timeline);
+void timelineClose(struct timeline *timeline);
+int timelinePlay(const struct timeline *timeline, struct keyColorTarget *targets, size_t numTargets, int paced, struct timelineStats *stats);
+void timelinePrintStats(const struct timeline *timeline, const struct timelineStats *stats);
+int timelineBenchmark(struct benchOptions *opts);
+
+#endif /* timeline_h */
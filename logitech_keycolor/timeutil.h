@@ -0,0 +1,126 @@
+//
+//  timeutil.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef timeutil_h
+#define timeutil_h
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+// Monotonic clock in nanoseconds, cheap enough to call on every report write
+static inline uint64_t monotonicNanos(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void sleepNanos(uint64_t nanos)
+{
+    struct timespec ts = { (time_t)(nanos / 1000000000ull), (long)(nanos % 1000000000ull) };
+    
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+// Sleep until an absolute monotonicNanos() deadline, returns immediately if it already passed
+static inline void sleepUntilNanos(uint64_t deadline)
+{
+#ifdef __APPLE__
+    uint64_t now = monotonicNanos();
+    
+    if (deadline > now) {
+        sleepNanos(deadline - now);
+    }
+#else
+    struct timespec ts = { (time_t)(deadline / 1000000000ull), (long)(deadline % 1000000000ull) };
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+#endif
+}
+
+// Absolute deadline for pthread_cond_timedwait, which wants CLOCK_REALTIME since macOS has no condattr clock selection
+static inline void deadlineToTimespec(uint64_t nanosFromNow, struct timespec *ts)
+{
+    struct timeval tv;
+    
+    gettimeofday(&tv, NULL);
+    
+    uint64_t nanos = (uint64_t)tv.tv_usec * 1000ull + nanosFromNow;
+    
+    ts->tv_sec = tv.tv_sec + (time_t)(nanos / 1000000000ull);
+    ts->tv_nsec = (long)(nanos % 1000000000ull);
+}
+
+// "16ms", "500us", "250ns", "2s" or a bare number of milliseconds, returns -1 if malformed
+static inline int64_t parseDuration(const char *str)
+{
+    char *end;
+    double value = strtod(str, &end);
+    
+    if (end == str || value < 0) {
+        return -1;
+    }
+    
+    if (*end == '\0' || strcmp(end, "ms") == 0) {
+        return (int64_t)(value * 1000000.0);
+    } else if (strcmp(end, "us") == 0) {
+        return (int64_t)(value * 1000.0);
+    } else if (strcmp(end, "ns") == 0) {
+        return (int64_t)value;
+    } else if (strcmp(end, "s") == 0) {
+        return (int64_t)(value * 1000000000.0);
+    }
+    
+    return -1;
+}
+
+#endif /* timeutil_h */
@@ -0,0 +1,838 @@
+//
+//  transport.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "transport.h"
+#include "timeutil.h"
+#include "animation.h"
+#include "writers.h"
+#include "asyncwrite.h"
+#include "recorder.h"
+#include "bench.h"
+#include "color.h"
+
+static const struct hidTransportOps *transports[] = {
+#ifdef __APPLE__
+    &iokitTransportOps,
+#endif
+#ifdef __linux__
+    &hidrawTransportOps,
+#endif
+    &fakeTransportOps,
+    NULL
+};
+
+void transportList(void)
+{
+    for (int i = 0; transports[i]; i++) {
+        printf("%-8s %s%s\n", transports[i]->name, transports[i]->description, i == 0 ? " (default)" : "");
+    }
+}
+
+struct hidTransport *transportOpen(const char *spec, int matchAll, int verbose)
+{
+    const struct hidTransportOps *ops = transports[0];
+    const char *args = NULL;
+    
+    if (spec) {
+        size_t nameLen = strcspn(spec, ":");
+        
+        ops = NULL;
+        
+        for (int i = 0; transports[i]; i++) {
+            if (strlen(transports[i]->name) == nameLen && strncmp(transports[i]->name, spec, nameLen) == 0) {
+                ops = transports[i];
+                break;
+            }
+        }
+        
+        if (!ops) {
+            fprintf(stderr, "Unknown transport '%.*s', available transports:\n", (int)nameLen, spec);
+            transportList();
+            return NULL;
+        }
+        
+        if (spec[nameLen] == ':') {
+            args = spec + nameLen + 1;
+        }
+    }
+    
+    struct hidTransport *transport = calloc(1, sizeof(struct hidTransport));
+    
+    if (!transport) {
+        fprintf(stderr, "Failed to allocate transport!\n");
+        return NULL;
+    }
+    
+    transport->ops = ops;
+    transport->verbose = verbose;
+    transport->rateControl = 1;
+    transport->cache = reportCacheCreate();
+    pthread_mutex_init(&transport->cacheLock, NULL);
+    
+    if (!transport->cache || ops->open(transport, args, matchAll)) {
+        reportCacheFree(transport->cache);
+        free(transport);
+        return NULL;
+    }
+    
+    return transport;
+}
+
+void transportClose(struct hidTransport *transport)
+{
+    if (!transport) {
+        return;
+    }
+    
+    transportStopWriters(transport);
+    transportStopAsync(transport);
+    transport->ops->close(transport);
+    pthread_mutex_destroy(&transport->cacheLock);
+    reportCacheFree(transport->cache);
+    free(transport);
+}
+
+// New zeroed target carrying the device identity and profile defaults, the backend fills in the element
+struct keyColorTarget *transportAppendTarget(struct keyColorTarget **targets, size_t *numTargets, struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile)
+{
+    struct keyColorTarget *grown = realloc(*targets, sizeof(struct keyColorTarget) * (*numTargets + 1));
+    
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for target list!\n");
+        return NULL;
+    }
+    
+    *targets = grown;
+    
+    struct keyColorTarget *target = &grown[(*numTargets)++];
+    
+    memset(target, 0, sizeof(*target));
+    target->transport = transport;
+    target->vendorId = device->vendorId;
+    target->productId = device->productId;
+    target->locationId = device->locationId;
+    memcpy(target->serial, device->serial, sizeof(target->serial));
+    target->profile = profile;
+    target->cookie = profile->cookie;
+    target->reportId = profile->reportId;
+    target->reportType = KEYCOLOR_REPORT_TYPE_FEATURE;
+    target->reportLen = profile->reportSize;
+    target->index = device->index;
+    target->device = device->handle;
+    rateControlInit(&target->rate, device->reportInterval * 1000ull, device->requestTimeout * 1000ull);
+    
+    return target;
+}
+
+// Generic attach for backends whose targets need nothing beyond the device handle
+int transportAttachFromCache(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct resolveCacheEntry *entry, struct keyColorTarget **targets, size_t *numTargets)
+{
+    struct keyColorTarget *target = transportAppendTarget(targets, numTargets, transport, device, profile);
+    
+    if (!target) {
+        return 0;
+    }
+    
+    target->reportId = entry->reportId;
+    target->reportType = entry->reportType;
+    target->reportLen = entry->reportLen;
+    target->fromCache = 1;
+    
+    return 1;
+}
+
+// Appends a target when the parsed descriptor declares the profile's color report, feature preferred over output.
+// A report of another length than the profile's is some other report sharing the id and is not matched
+int transportMatchDescriptor(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct hidElementTable *table, struct keyColorTarget **targets, size_t *numTargets)
+{
+    enum hidElementType type = HID_ELEMENT_FEATURE;
+    
+    if (!table) {
+        return 0;
+    }
+    
+    if (!hidElementFindReport(table, profile->reportId, type)) {
+        type = HID_ELEMENT_OUTPUT;
+        
+        if (!hidElementFindReport(table, profile->reportId, type)) {
+            return 0;
+        }
+    }
+    
+    if (hidElementReportLength(table, profile->reportId, type) != profile->reportSize) {
+        return 0;
+    }
+    
+    struct keyColorTarget *target = transportAppendTarget(targets, numTargets, transport, device, profile);
+    
+    if (!target) {
+        return 0;
+    }
+    
+    target->reportType = type == HID_ELEMENT_OUTPUT ? KEYCOLOR_REPORT_TYPE_OUTPUT : KEYCOLOR_REPORT_TYPE_FEATURE;
+    target->reportLen = profile->reportSize;
+    
+    return 1;
+}
+
+void transportSetResolveCache(struct hidTransport *transport, struct resolveCache *cache)
+{
+    transport->resolveCache = cache;
+}
+
+void transportSetLatencyStats(struct hidTransport *transport, struct latencyStats *stats)
+{
+    transport->latency = stats;
+}
+
+// Every report that reaches a backend is appended to the recorder with the backend's result
+void transportSetRecorder(struct hidTransport *transport, struct recorder *recorder)
+{
+    transport->recorder = recorder;
+}
+
+// Resolves one device, from the resolve cache when it has an entry, returns the number of targets appended
+int transportResolveDevice(struct hidTransport *transport, struct hidDeviceInfo *device, struct keyColorTarget **targets, size_t *numTargets)
+{
+    const struct deviceProfile *profile = deviceProfileLookup(device->vendorId, device->productId);
+    const struct resolveCacheEntry *entry = NULL;
+    int numMatched = 0;
+    
+    if (!profile) {
+        printf("Skipping unknown productId = 0x%x\n", device->productId);
+        return 0;
+    }
+    
+    if (transport->latency) {
+        latencyStatsNameDevice(transport->latency, device->index, device->serial);
+    }
+    
+    uint64_t startTime = transportLatencyStart(transport);
+    
+    if (transport->resolveCache && transport->ops->attach) {
+        entry = resolveCacheLookup(transport->resolveCache, transport->ops->name, device->vendorId, device->productId, device->locationId, device->serial, profile->cookie);
+    }
+    
+    if (entry) {
+        numMatched = transport->ops->attach(transport, device, profile, entry, targets, numTargets);
+    } else {
+        size_t firstNew = *numTargets;
+        
+        numMatched = transport->ops->match(transport, device, profile, targets, numTargets);
+        
+        for (size_t j = firstNew; transport->resolveCache && j < *numTargets; j++) {
+            resolveCacheStore(transport->resolveCache, transport->ops->name, &(*targets)[j]);
+        }
+    }
+    
+    transportLatencyEnd(transport, device->index, LATENCY_PHASE_MATCH, startTime, 0);
+    
+    if (numMatched == 0 && transport->verbose) {
+        fprintf(stderr, "NOTE: Device[%d] did not have any matching elements\n", device->index);
+    }
+    
+    return numMatched;
+}
+
+int transportResolveTargets(struct hidTransport *transport, struct keyColorTarget **targets, size_t *numTargets)
+{
+    struct hidDeviceInfo *devices = NULL;
+    size_t numDevices = 0;
+    
+    *targets = NULL;
+    *numTargets = 0;
+    
+    uint64_t startTime = transportLatencyStart(transport);
+    int retVal = transport->ops->enumerate(transport, &devices, &numDevices);
+    
+    transportLatencyEnd(transport, -1, LATENCY_PHASE_ENUMERATE, startTime, retVal);
+    
+    if (retVal) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < numDevices; i++) {
+        transportResolveDevice(transport, &devices[i], targets, numTargets);
+    }
+    
+    free(devices);
+    
+    return 0;
+}
+
+void transportReleaseTargets(struct keyColorTarget *targets, size_t numTargets)
+{
+    for (size_t i = 0; i < numTargets; i++) {
+        if (targets[i].transport->ops->releaseTarget) {
+            targets[i].transport->ops->releaseTarget(&targets[i]);
+        }
+    }
+    
+    free(targets);
+}
+
+// Report cache and resolve cache bookkeeping once a write has landed or failed
+static void transportWriteFinished(struct keyColorTarget *target, uint64_t key, const uint8_t *report, size_t reportLen, int retVal)
+{
+    struct hidTransport *transport = target->transport;
+    
+    pthread_mutex_lock(&transport->cacheLock);
+    if (retVal) {
+        reportCacheInvalidate(transport->cache, key);
+        
+        // A cached resolution that no longer works gets matched properly next run
+        if (target->fromCache && transport->resolveCache) {
+            resolveCacheForget(transport->resolveCache, transport->ops->name, target);
+        }
+    } else {
+        reportCacheUpdate(transport->cache, key, report, reportLen);
+    }
+    pthread_mutex_unlock(&transport->cacheLock);
+    
+    if (retVal) {
+        fprintf(stderr, "WARNING: DeviceSetValue returned %d\n", retVal);
+    }
+}
+
+int transportWriteTarget(struct keyColorTarget *target, const uint8_t *report, size_t reportLen)
+{
+    struct hidTransport *transport = target->transport;
+    uint8_t calibrated[TRANSPORT_MAX_REPORT_SIZE];
+    
+    // Report bytes are sRGB, the board's own response and white balance are applied per target
+    if (target->profile && target->profile->calibration && reportLen <= target->profile->reportSize) {
+        colorCalibrate(target->profile->calibration, report, calibrated, reportLen);
+        report = calibrated;
+    }
+    
+    uint64_t key = reportCacheKey(target);
+    
+    pthread_mutex_lock(&transport->cacheLock);
+    int unchanged = reportCacheMatches(transport->cache, key, report, reportLen);
+    pthread_mutex_unlock(&transport->cacheLock);
+    
+    // The keyboard already shows exactly this report, skip the control transfer
+    if (unchanged) {
+        return 0;
+    }
+    
+    // Hold the write until the device can take it, producers merge or drop whatever comes due meanwhile
+    if (transport->rateControl && target->rate.nextWrite) {
+        uint64_t delay = rateControlDelay(&target->rate, monotonicNanos());
+        
+        if (delay) {
+            target->rate.waits++;
+            target->rate.waited += delay;
+            sleepNanos(delay);
+        }
+    }
+    
+    uint64_t startTime = transport->rateControl || transport->recorder ? monotonicNanos() : transportLatencyStart(transport);
+    int retVal = transport->ops->write(target, report, reportLen);
+    
+    transportLatencyEnd(transport, target->index, LATENCY_PHASE_WRITE, startTime, retVal);
+    
+    if (transport->rateControl || transport->recorder) {
+        uint64_t latency = monotonicNanos() - startTime;
+        
+        if (transport->rateControl) {
+            rateControlRecord(&target->rate, startTime, latency, retVal);
+        }
+        
+        if (transport->recorder) {
+            recorderAppend(transport->recorder, target, startTime, latency, report, reportLen, retVal);
+        }
+    }
+    
+    transportWriteFinished(target, key, report, reportLen, retVal);
+    
+    return retVal;
+}
+
+// Starts write->report on write->target without waiting for it. Returns 0 when write->completion will run,
+// 1 when the board already shows the report and -1 when the write could not be started
+int transportWriteTargetAsync(struct transportAsyncWrite *write)
+{
+    struct keyColorTarget *target = write->target;
+    struct hidTransport *transport = target->transport;
+    
+    if (target->profile && target->profile->calibration && write->reportLen <= target->profile->reportSize) {
+        colorCalibrate(target->profile->calibration, write->report, write->report, write->reportLen);
+    }
+    
+    write->cacheKey = reportCacheKey(target);
+    
+    // Recorded as shown right away so repeats submitted while this one is in flight are suppressed,
+    // a failed completion takes it back out
+    pthread_mutex_lock(&transport->cacheLock);
+    int unchanged = reportCacheMatches(transport->cache, write->cacheKey, write->report, write->reportLen);
+    
+    if (!unchanged) {
+        reportCacheUpdate(transport->cache, write->cacheKey, write->report, write->reportLen);
+    }
+    pthread_mutex_unlock(&transport->cacheLock);
+    
+    if (unchanged) {
+        return 1;
+    }
+    
+    write->startTime = monotonicNanos();
+    
+    if (!transport->ops->writeAsync) {
+        transportAsyncComplete(write, transport->ops->write(target, write->report, write->reportLen));
+        return 0;
+    }
+    
+    int retVal = transport->ops->writeAsync(write);
+    
+    if (retVal) {
+        transportWriteFinished(target, write->cacheKey, write->report, write->reportLen, retVal);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Backends call this from whatever thread the write landed on
+void transportAsyncComplete(struct transportAsyncWrite *write, int status)
+{
+    struct keyColorTarget *target = write->target;
+    
+    transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_WRITE, write->startTime, status);
+    
+    if (target->transport->recorder) {
+        recorderAppend(target->transport->recorder, target, write->startTime, monotonicNanos() - write->startTime, write->report, write->reportLen, status);
+    }
+    
+    if (status) {
+        transportWriteFinished(target, write->cacheKey, write->report, write->reportLen, status);
+    }
+    
+    write->completion(write, status);
+}
+
+int transportWrite(struct keyColorTarget *targets, size_t numTargets, const uint8_t *report, size_t reportLen)
+{
+    int numFailed = 0;
+    
+    if (numTargets && targets[0].transport->writers && targets == targets[0].transport->writerTargets) {
+        return writerPoolWrite(targets[0].transport->writers, report, reportLen);
+    }
+    
+    if (numTargets && targets[0].transport->async && targets == targets[0].transport->asyncTargets) {
+        return asyncWriterSubmit(targets[0].transport->async, report, reportLen);
+    }
+    
+    for (size_t i = 0; i < numTargets; i++) {
+        if (transportWriteTarget(&targets[i], report, reportLen)) {
+            numFailed++;
+        }
+    }
+    
+    return numFailed;
+}
+
+// From here on transportWrite() on exactly these targets fans out to one thread per target
+int transportStartWriters(struct hidTransport *transport, struct keyColorTarget *targets, size_t numTargets, uint64_t timeout)
+{
+    transportStopWriters(transport);
+    
+    if (!(transport->writers = writerPoolCreate(targets, numTargets, timeout))) {
+        return -1;
+    }
+    
+    transport->writerTargets = targets;
+    
+    return 0;
+}
+
+void transportStopWriters(struct hidTransport *transport)
+{
+    if (!transport->writers) {
+        return;
+    }
+    
+    if (transport->verbose) {
+        writerPoolPrintStats(transport->writers, stderr);
+    }
+    
+    writerPoolDestroy(transport->writers);
+    transport->writers = NULL;
+    transport->writerTargets = NULL;
+}
+
+// Streams every device, or those the filter lets through, to stdout, fleet inventory reads the json and binary forms
+int transportDump(struct hidTransport *transport, enum dumpFormat format, const struct dumpFilter *filter, int verbose)
+{
+    if (!transport->ops->dump) {
+        fprintf(stderr, "The %s transport has no device dump\n", transport->ops->name);
+        return -1;
+    }
+    
+    struct dumpWriter *writer = malloc(sizeof(struct dumpWriter));
+    
+    if (!writer) {
+        fprintf(stderr, "Failed to allocate dump writer!\n");
+        return -1;
+    }
+    
+    fflush(stdout);
+    dumpWriterInit(writer, STDOUT_FILENO, format);
+    transport->ops->dump(transport, writer, filter, verbose);
+    
+    int retVal = dumpWriterFinish(writer);
+    
+    if (retVal) {
+        fprintf(stderr, "Failed to write device dump: %s\n", strerror(writer->error));
+    }
+    
+    free(writer);
+    
+    return retVal;
+}
+
+void transportSetCaching(struct hidTransport *transport, int enabled)
+{
+    transport->cache->enabled = enabled;
+}
+
+// From here on transportWrite() on exactly these targets returns once the report is handed to the backend,
+// with up to window writes per target in flight
+int transportStartAsync(struct hidTransport *transport, struct keyColorTarget *targets, size_t numTargets, unsigned window, uint64_t timeout)
+{
+    transportStopAsync(transport);
+    
+    if (!(transport->async = asyncWriterCreate(targets, numTargets, window, timeout))) {
+        return -1;
+    }
+    
+    transport->asyncTargets = targets;
+    
+    return 0;
+}
+
+// Waits for writes still in flight, returns how many of them failed
+int transportStopAsync(struct hidTransport *transport)
+{
+    if (!transport->async) {
+        return 0;
+    }
+    
+    int numFailed = asyncWriterDrain(transport->async);
+    
+    if (transport->verbose) {
+        asyncWriterPrintStats(transport->async, stderr);
+    }
+    
+    asyncWriterDestroy(transport->async);
+    transport->async = NULL;
+    transport->asyncTargets = NULL;
+    
+    return numFailed;
+}
+
+void transportSetRateControl(struct hidTransport *transport, int enabled)
+{
+    transport->rateControl = enabled;
+}
+
+// Nanoseconds until every target can take a write without being held, writer threads pace themselves
+uint64_t transportWriteDelay(struct keyColorTarget *targets, size_t numTargets)
+{
+    uint64_t delay = 0;
+    
+    if (!numTargets || !targets[0].transport->rateControl || targets == targets[0].transport->writerTargets ||
+        targets == targets[0].transport->asyncTargets) {
+        return 0;
+    }
+    
+    uint64_t now = 0;
+    
+    for (size_t i = 0; i < numTargets; i++) {
+        if (!targets[i].rate.nextWrite) {
+            continue;
+        }
+        
+        if (!now) {
+            now = monotonicNanos();
+        }
+        
+        uint64_t targetDelay = rateControlDelay(&targets[i].rate, now);
+        
+        if (targetDelay > delay) {
+            delay = targetDelay;
+        }
+    }
+    
+    return delay;
+}
+
+void transportPrintRateStats(struct keyColorTarget *targets, size_t numTargets, FILE *fp)
+{
+    for (size_t i = 0; i < numTargets; i++) {
+        if (targets[i].transport->rateControl) {
+            rateControlPrint(&targets[i].rate, targets[i].index, fp);
+        }
+    }
+}
+
+void transportPrintStats(struct hidTransport *transport, FILE *fp)
+{
+    reportCachePrintStats(transport->cache, fp);
+    
+    if (transport->resolveCache) {
+        fprintf(fp, "Resolve cache: %llu hits, %llu misses\n",
+                (unsigned long long)transport->resolveCache->hits, (unsigned long long)transport->resolveCache->misses);
+    }
+}
+
+int transportBenchmark(struct benchOptions *opts)
+{
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, opts->verbose);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport) {
+        return -1;
+    }
+    
+    if (transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        fprintf(stderr, "No targets to benchmark on the %s transport\n", transport->ops->name);
+        transportClose(transport);
+        return -1;
+    }
+    
+    uint64_t *samples = calloc(opts->iterations, sizeof(uint64_t));
+    
+    if (!samples) {
+        fprintf(stderr, "Failed to allocate benchmark samples!\n");
+        transportReleaseTargets(targets, numTargets);
+        transportClose(transport);
+        return -1;
+    }
+    
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    int numFailed = 0;
+    uint64_t allocs = benchAllocations();
+    uint64_t startTime = monotonicNanos();
+    
+    for (int i = 0; i < opts->iterations; i++) {
+        memcpy(report, opts->report, sizeof(report));
+        report[1] = (uint8_t)i;
+        
+        uint64_t writeStart = monotonicNanos();
+        numFailed += transportWrite(targets, numTargets, report, sizeof(report));
+        samples[i] = monotonicNanos() - writeStart;
+    }
+    
+    uint64_t elapsed = monotonicNanos() - startTime;
+    
+    fprintf(benchNotes(), "# transport=%s targets=%zu failed=%d\n", transport->ops->name, numTargets, numFailed);
+    benchReportThroughput("reports", (uint64_t)opts->iterations * numTargets, elapsed, benchAllocations() - allocs, 0);
+    benchReportLatency("write", samples, opts->iterations);
+    
+    size_t numRecords = 0;
+    const struct fakeReportRecord *records = fakeTransportRecords(transport, &numRecords);
+    
+    if (records && numRecords != (size_t)opts->iterations * numTargets) {
+        fprintf(stderr, "WARNING: fake device recorded %zu reports, expected %zu\n", numRecords, (size_t)opts->iterations * numTargets);
+        numFailed++;
+    }
+    
+    free(samples);
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return numFailed ? -1 : 0;
+}
+
+// Breathe at 500fps through the cache, 8-bit quantization leaves many consecutive frames identical
+int transportCacheBenchmark(struct benchOptions *opts)
+{
+    struct animationOptions animation = { EFFECT_BREATHE, 500.0, 2000000000ull, 0, { 0 }, { 0 }, NULL, NULL };
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake", 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport) {
+        return -1;
+    }
+    
+    if (transportResolveTargets(transport, &targets, &numTargets) || numTargets == 0) {
+        fprintf(stderr, "No targets to benchmark on the %s transport\n", transport->ops->name);
+        transportClose(transport);
+        return -1;
+    }
+    
+    memcpy(animation.from, opts->report, sizeof(animation.from));
+    
+    if (!animation.from[1] && !animation.from[2] && !animation.from[3]) {
+        animation.from[1] = 255;
+    }
+    
+    for (int pass = 0; pass < 2; pass++) {
+        uint8_t report[KEYCOLOR_REPORT_SIZE];
+        
+        memset(transport->cache, 0, sizeof(*transport->cache));
+        transportSetCaching(transport, pass);
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < opts->iterations; i++) {
+            animationRender(&animation, (uint64_t)i * 2000000ull, report);
+            transportWrite(targets, numTargets, report, sizeof(report));
+        }
+        
+        uint64_t elapsed = monotonicNanos() - startTime;
+        
+        benchReportThroughput(pass ? "cached" : "uncached", opts->iterations, elapsed, benchAllocations() - allocs, 0);
+        transportPrintStats(transport, benchNotes());
+    }
+    
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return 0;
+}
+
+// Process startup to first report, matching every element vs. attaching from the resolve cache
+int transportStartupBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:match=5ms";
+    uint64_t *samples = calloc(opts->iterations, sizeof(uint64_t));
+    char cachePath[] = "/tmp/logitech_keycolor.bench.XXXXXX";
+    char rgb[16];
+    int numSamples;
+    int fd = mkstemp(cachePath);
+    
+    if (!samples || fd < 0) {
+        fprintf(stderr, "Failed to set up startup benchmark!\n");
+        free(samples);
+        return -1;
+    }
+    close(fd);
+    
+    snprintf(rgb, sizeof(rgb), "%d,%d,%d", opts->report[1], opts->report[2], opts->report[3]);
+    
+    char *coldArgv[] = { (char *)opts->progPath, "-C", rgb, "--transport", (char *)spec, "--resolve-cache", "off", NULL };
+    char *cachedArgv[] = { (char *)opts->progPath, "-C", rgb, "--transport", (char *)spec, "--resolve-cache", cachePath, NULL };
+    
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        if ((samples[numSamples] = benchTimeSpawn(coldArgv)) == 0) {
+            break;
+        }
+    }
+    benchReportLatency("cold", samples, numSamples);
+    
+    // First run primes the cache file, every run after it attaches directly
+    benchTimeSpawn(cachedArgv);
+    
+    for (numSamples = 0; numSamples < opts->iterations; numSamples++) {
+        if ((samples[numSamples] = benchTimeSpawn(cachedArgv)) == 0) {
+            break;
+        }
+    }
+    benchReportLatency("cached", samples, numSamples);
+    
+    unlink(cachePath);
+    free(samples);
+    
+    return 0;
+}
+
+// A full --dump of a fleet with a per-device read cost, one device at a time vs. dumpDevicesParallel, with and without a filter
+int transportDumpBenchmark(struct benchOptions *opts)
+{
+    static const struct {
+        const char *label;
+        int threads;
+        const char *filter;
+    } cases[] = {
+        { "serial", 1, NULL },
+        { "parallel", 0, NULL },
+        { "serial-filtered", 1, "page=0xff00,type=feature" },
+        { "parallel-filtered", 0, "page=0xff00,type=feature" },
+    };
+    struct hidTransport *transport = transportOpen(opts->transportSpec ? opts->transportSpec : "fake:devices=48,match=1ms", 1, opts->verbose);
+    struct dumpWriter *writer = malloc(sizeof(struct dumpWriter));
+    int fd = open("/dev/null", O_WRONLY);
+    int runs = opts->iterations / 40 + 1;
+    uint64_t *samples = calloc(runs, sizeof(uint64_t));
+    
+    if (!transport || !transport->ops->dump || !writer || !samples || fd < 0) {
+        fprintf(stderr, "Failed to set up device dump benchmark!\n");
+        if (transport) transportClose(transport);
+        if (fd >= 0) close(fd);
+        free(writer);
+        free(samples);
+        return -1;
+    }
+    
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        struct dumpFilter filter;
+        uint64_t bytes = 0;
+        
+        if (cases[c].filter) {
+            dumpFilterParse(cases[c].filter, &filter);
+        }
+        
+        uint64_t allocs = benchAllocations();
+        uint64_t startTime = monotonicNanos();
+        
+        for (int i = 0; i < runs; i++) {
+            uint64_t dumpStart = monotonicNanos();
+            
+            dumpWriterInit(writer, fd, DUMP_FORMAT_JSON);
+            writer->threads = cases[c].threads;
+            transport->ops->dump(transport, writer, cases[c].filter ? &filter : NULL, 0);
+            dumpWriterFinish(writer);
+            bytes += writer->bytesWritten;
+            samples[i] = monotonicNanos() - dumpStart;
+        }
+        
+        uint64_t elapsed = monotonicNanos() - startTime;
+        
+        benchReportThroughput(cases[c].label, (uint64_t)runs, elapsed, benchAllocations() - allocs, bytes);
+        benchReportLatency(cases[c].label, samples, runs);
+    }
+    
+    close(fd);
+    free(samples);
+    free(writer);
+    transportClose(transport);
+    
+    return 0;
+}
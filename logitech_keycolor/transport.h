@@ -0,0 +1,189 @@
+//
+//  transport.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef transport_h
+#define transport_h
+
+#include "keycolor.h"
+#include "bench.h"
+#include "reportcache.h"
+#include "profiles.h"
+#include "resolvecache.h"
+#include "dumpwriter.h"
+#include "dumpfilter.h"
+#include "hiddescriptor.h"
+#include "latency.h"
+#include "timeutil.h"
+#include <pthread.h>
+#include <signal.h>
+
+#define TRANSPORT_MAX_REPORT_SIZE 64
+
+// A device as seen by enumeration, before the color element is matched
+struct hidDeviceInfo {
+    uint32_t vendorId;
+    uint32_t productId;
+    uint32_t locationId;
+    char serial[KEYCOLOR_SERIAL_SIZE];
+    int index;
+    uint32_t reportInterval;    // microseconds, as advertised by the device, 0 if unknown
+    uint32_t requestTimeout;    // microseconds, 0 if unknown
+    void *handle;
+};
+
+enum hotplugEvent {
+    HOTPLUG_ATTACH,
+    HOTPLUG_DETACH
+};
+
+// device is only valid for the call, eventTime is monotonicNanos() when the backend saw the change
+typedef void (*hotplugCallback)(struct hidTransport *transport, enum hotplugEvent event, struct hidDeviceInfo *device, uint64_t eventTime, void *context);
+
+// One write in flight without blocking its caller, owned by the caller until completion runs
+struct transportAsyncWrite {
+    struct keyColorTarget *target;
+    uint8_t report[TRANSPORT_MAX_REPORT_SIZE];
+    size_t reportLen;
+    uint8_t wire[TRANSPORT_MAX_REPORT_SIZE + 1];    // backend scratch, the bytes on the wire must outlive the call
+    void *backend;                                  // backend scratch, e.g. an IOHIDValueRef to release
+    uint64_t timeout;                               // nanoseconds the backend may take before failing it
+    uint64_t startTime;
+    uint64_t cacheKey;
+    void (*completion)(struct transportAsyncWrite *write, int status);
+    void *context;
+};
+
+struct hidTransportOps {
+    const char *name;
+    const char *description;
+    
+    // args is whatever followed "name:" in the --transport spec, or NULL
+    int (*open)(struct hidTransport *transport, const char *args, int matchAll);
+    int (*enumerate)(struct hidTransport *transport, struct hidDeviceInfo **devices, size_t *numDevices);
+    
+    // Append a target for each element of device carrying the color report, returns the number appended
+    int (*match)(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, struct keyColorTarget **targets, size_t *numTargets);
+    
+    // Optional, append a target straight from a resolve cache entry without matching, returns the number appended
+    int (*attach)(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct resolveCacheEntry *entry, struct keyColorTarget **targets, size_t *numTargets);
+    
+    // Returns 0 on success or a backend specific error code
+    int (*write)(struct keyColorTarget *target, const uint8_t *report, size_t reportLen);
+    
+    // Optional, start a write and return at once, the backend calls transportAsyncComplete from its own
+    // thread once it lands. Returns 0 if started, otherwise the error and no completion follows
+    int (*writeAsync)(struct transportAsyncWrite *write);
+    
+    void (*releaseTarget)(struct keyColorTarget *target);
+    
+    // Optional, reports each present device as attached then follows attach/detach until *stop is set,
+    // targets on the devices it reported must not be written once it returns
+    int (*watch)(struct hidTransport *transport, hotplugCallback callback, void *context, volatile sig_atomic_t *stop);
+    
+    // Devices go through dumpDevicesParallel, filter is NULL to dump everything
+    void (*dump)(struct hidTransport *transport, struct dumpWriter *writer, const struct dumpFilter *filter, int verbose);
+    void (*close)(struct hidTransport *transport);
+};
+
+struct hidTransport {
+    const struct hidTransportOps *ops;
+    void *priv;
+    int verbose;
+    struct reportCache *cache;          // last report written per element, see transportWrite
+    pthread_mutex_t cacheLock;          // writer threads share the cache
+    struct writerPool *writers;         // per device threads, see transportStartWriters
+    struct keyColorTarget *writerTargets;
+    struct asyncWriter *async;          // pipelined writes, see transportStartAsync
+    struct keyColorTarget *asyncTargets;
+    struct resolveCache *resolveCache;  // optional, see transportSetResolveCache
+    struct latencyStats *latency;       // optional, see transportSetLatencyStats
+    int rateControl;                    // pace writes per target, see transportWriteTarget
+    struct recorder *recorder;          // optional, see transportSetRecorder
+};
+
+// Phase timing is a NULL check when --stats is off, backends bracket their own build step with these
+static inline uint64_t transportLatencyStart(struct hidTransport *transport)
+{
+    return transport->latency ? monotonicNanos() : 0;
+}
+
+static inline void transportLatencyEnd(struct hidTransport *transport, int deviceIndex, enum latencyPhase phase, uint64_t startTime, int failed)
+{
+    if (transport->latency) {
+        latencyStatsRecord(transport->latency, deviceIndex, phase, monotonicNanos() - startTime, failed);
+    }
+}
+
+// Fake backend, every write is kept so tests and benchmarks can inspect it
+struct fakeReportRecord {
+    uint64_t timestamp;
+    uint32_t deviceIndex;
+    uint32_t reportLen;
+    uint8_t report[TRANSPORT_MAX_REPORT_SIZE];
+};
+
+extern const struct hidTransportOps iokitTransportOps;
+extern const struct hidTransportOps hidrawTransportOps;
+extern const struct hidTransportOps fakeTransportOps;
+
+struct hidTransport *transportOpen(const char *spec, int matchAll, int verbose);
+void transportClose(struct hidTransport *transport);
+void transportList(void);
+struct keyColorTarget *transportAppendTarget(struct keyColorTarget **targets, size_t *numTargets, struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile);
+int transportAttachFromCache(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct resolveCacheEntry *entry, struct keyColorTarget **targets, size_t *numTargets);
+int transportMatchDescriptor(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct hidElementTable *table, struct keyColorTarget **targets, size_t *numTargets);
+void transportSetResolveCache(struct hidTransport *transport, struct resolveCache *cache);
+void transportSetLatencyStats(struct hidTransport *transport, struct latencyStats *stats);
+void transportSetRecorder(struct hidTransport *transport, struct recorder *recorder);
+int transportResolveDevice(struct hidTransport *transport, struct hidDeviceInfo *device, struct keyColorTarget **targets, size_t *numTargets);
+int transportResolveTargets(struct hidTransport *transport, struct keyColorTarget **targets, size_t *numTargets);
+void transportReleaseTargets(struct keyColorTarget *targets, size_t numTargets);
+int transportWriteTarget(struct keyColorTarget *target, const uint8_t *report, size_t reportLen);
+int transportWrite(struct keyColorTarget *targets, size_t numTargets, const uint8_t *report, size_t reportLen);
+int transportWriteTargetAsync(struct transportAsyncWrite *write);
+void transportAsyncComplete(struct transportAsyncWrite *write, int status);
+int transportStartAsync(struct hidTransport *transport, struct keyColorTarget *targets, size_t numTargets, unsigned window, uint64_t timeout);
+int transportStopAsync(struct hidTransport *transport);
+int transportStartWriters(struct hidTransport *transport, struct keyColorTarget *targets, size_t numTargets, uint64_t timeout);
+void transportStopWriters(struct hidTransport *transport);
+int transportDump(struct hidTransport *transport, enum dumpFormat format, const struct dumpFilter *filter, int verbose);
+void transportSetCaching(struct hidTransport *transport, int enabled);
+void transportSetRateControl(struct hidTransport *transport, int enabled);
+uint64_t transportWriteDelay(struct keyColorTarget *targets, size_t numTargets);
+void transportPrintRateStats(struct keyColorTarget *targets, size_t numTargets, FILE *fp);
+void transportPrintStats(struct hidTransport *transport, FILE *fp);
+const struct fakeReportRecord *fakeTransportRecords(struct hidTransport *transport, size_t *numRecords);
+int fakeTransportUnlit(struct hidTransport *transport);
+int transportBenchmark(struct benchOptions *opts);
+int transportCacheBenchmark(struct benchOptions *opts);
+int transportStartupBenchmark(struct benchOptions *opts);
+int transportDumpBenchmark(struct benchOptions *opts);
+
+#endif /* transport_h */
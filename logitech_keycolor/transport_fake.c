@@ -0,0 +1,599 @@
+//
+//  transport_fake.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "transport.h"
+#include "timeutil.h"
+
+#define FAKE_MAX_DEVICES 64
+#define FAKE_QUEUE_DEPTH 64
+
+// Reports accepted by fakeWriteAsync, completed in order by the device's worker once due
+struct fakeQueue {
+    struct transportAsyncWrite *writes[FAKE_QUEUE_DEPTH];
+    uint64_t due[FAKE_QUEUE_DEPTH];
+    unsigned head;
+    unsigned count;
+    uint64_t lastDue;
+    int started;
+    pthread_t thread;
+    pthread_cond_t wake;
+};
+
+// In-memory stand-in for a keyboard, records every report written to it
+struct fakeDevice {
+    uint32_t productId;
+    uint32_t locationId;
+    uint64_t numWrites;
+    uint64_t writeLatency;      // nanoseconds each write blocks for, see latency= in fakeOpen
+    uint64_t numJittered;       // writes given a jitter draw, the draw's sequence number
+    int present;                // cleared while a hotplug storm has it unplugged
+    int lit;                    // written since it was last attached, a replugged board comes back dark
+    uint64_t readyAt;           // monotonicNanos() once the board has digested the last report
+    struct fakeTransport *fake;
+    struct fakeQueue queue;
+};
+
+struct fakeTransport {
+    struct fakeDevice devices[FAKE_MAX_DEVICES];
+    int numDevices;
+    uint64_t writeLatency[FAKE_MAX_DEVICES];    // per device, the last one given covers the rest
+    int numLatencies;
+    uint64_t writeJitter;       // up to this much more per write, a board under load
+    uint64_t stallLatency;      // device 0 blocks this long instead, simulates a wedged board
+    uint64_t matchLatency;      // element matching cost per device, what the resolve cache saves
+    uint64_t recoverTime;       // a board needs this long after each report, sooner ones are retried at a penalty
+    uint64_t reportInterval;    // advertised to the rate controller like IOKit's ReportInterval
+    uint64_t serviceTime;       // asynchronous writes, the board takes one report per service time
+    uint64_t stormEvents;       // random attach/detach toggles the watch delivers before returning
+    uint64_t stormInterval;     // pause between storm events
+    uint64_t stormSeed;
+    struct hidElementTable *elements;   // every fake board reports the sample keyboard descriptor
+    pthread_mutex_t lock;       // writer threads append records concurrently
+    int stopping;               // queue workers exit
+    struct fakeReportRecord *records;
+    size_t numRecords;
+    size_t maxRecords;
+};
+
+// args: devices=N,latency=DURATION[/DURATION...],jitter=DURATION,stall=DURATION,match=DURATION,
+//       recover=DURATION,report=DURATION,service=DURATION,product=0xNNNN,storm=N,interval=DURATION,seed=N
+static int fakeOpen(struct hidTransport *transport, const char *args, int matchAll)
+{
+    struct fakeTransport *fake = calloc(1, sizeof(struct fakeTransport));
+    uint32_t productId = 0xc24d;
+    
+    if (!fake) {
+        fprintf(stderr, "Failed to allocate fake transport!\n");
+        return -1;
+    }
+    
+    fake->numDevices = 1;
+    fake->stormInterval = 1000000ull;
+    fake->stormSeed = 1;
+    
+    if (args) {
+        char *argsCopy = strdup(args);
+        
+        for (char *cp = strtok(argsCopy, ","); cp; cp = strtok(NULL, ",")) {
+            char *value = strchr(cp, '=');
+            
+            if (!value) {
+                fprintf(stderr, "Bad fake transport argument '%s'\n", cp);
+                free(argsCopy);
+                free(fake);
+                return -1;
+            }
+            *value++ = '\0';
+            
+            if (strcmp(cp, "devices") == 0) {
+                fake->numDevices = atoi(value);
+            } else if (strcmp(cp, "latency") == 0) {
+                // One per device, boards that differ are what --sync has to line up
+                fake->numLatencies = 0;
+                
+                for (char *next = value; next && fake->numLatencies < FAKE_MAX_DEVICES; ) {
+                    char *slash = strchr(next, '/');
+                    
+                    if (slash) {
+                        *slash++ = '\0';
+                    }
+                    
+                    int64_t latency = parseDuration(next);
+                    fake->writeLatency[fake->numLatencies++] = latency > 0 ? (uint64_t)latency : 0;
+                    next = slash;
+                }
+            } else if (strcmp(cp, "jitter") == 0) {
+                int64_t jitter = parseDuration(value);
+                fake->writeJitter = jitter > 0 ? (uint64_t)jitter : 0;
+            } else if (strcmp(cp, "stall") == 0) {
+                int64_t latency = parseDuration(value);
+                fake->stallLatency = latency > 0 ? (uint64_t)latency : 0;
+            } else if (strcmp(cp, "match") == 0) {
+                int64_t latency = parseDuration(value);
+                fake->matchLatency = latency > 0 ? (uint64_t)latency : 0;
+            } else if (strcmp(cp, "recover") == 0) {
+                int64_t recover = parseDuration(value);
+                fake->recoverTime = recover > 0 ? (uint64_t)recover : 0;
+            } else if (strcmp(cp, "report") == 0) {
+                int64_t interval = parseDuration(value);
+                fake->reportInterval = interval > 0 ? (uint64_t)interval : 0;
+            } else if (strcmp(cp, "service") == 0) {
+                int64_t service = parseDuration(value);
+                fake->serviceTime = service > 0 ? (uint64_t)service : 0;
+            } else if (strcmp(cp, "product") == 0) {
+                productId = (uint32_t)strtoul(value, NULL, 0);
+            } else if (strcmp(cp, "storm") == 0) {
+                fake->stormEvents = strtoull(value, NULL, 0);
+            } else if (strcmp(cp, "interval") == 0) {
+                int64_t interval = parseDuration(value);
+                fake->stormInterval = interval > 0 ? (uint64_t)interval : 0;
+            } else if (strcmp(cp, "seed") == 0) {
+                fake->stormSeed = strtoull(value, NULL, 0);
+            } else {
+                fprintf(stderr, "Unknown fake transport argument '%s'\n", cp);
+                free(argsCopy);
+                free(fake);
+                return -1;
+            }
+        }
+        
+        free(argsCopy);
+    }
+    
+    if (fake->numDevices < 0 || fake->numDevices > FAKE_MAX_DEVICES) {
+        fprintf(stderr, "Fake transport supports 0-%d devices\n", FAKE_MAX_DEVICES);
+        free(fake);
+        return -1;
+    }
+    
+    for (int i = 0; i < fake->numDevices; i++) {
+        fake->devices[i].productId = productId;
+        fake->devices[i].locationId = 0xfa000000 | (uint32_t)i;
+        fake->devices[i].writeLatency = fake->numLatencies ? fake->writeLatency[i < fake->numLatencies ? i : fake->numLatencies - 1] : 0;
+        fake->devices[i].present = 1;
+        fake->devices[i].fake = fake;
+    }
+    
+    if (!(fake->elements = hidDescriptorParse(hidSampleKeyboardDescriptor, hidSampleKeyboardDescriptorSize))) {
+        fprintf(stderr, "Failed to parse fake report descriptor!\n");
+        free(fake);
+        return -1;
+    }
+    
+    pthread_mutex_init(&fake->lock, NULL);
+    transport->priv = fake;
+    
+    return 0;
+}
+
+static void fakeDeviceInfo(struct fakeTransport *fake, int i, struct hidDeviceInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->vendorId = LOGITECH_VENDOR_ID;
+    info->productId = fake->devices[i].productId;
+    info->locationId = fake->devices[i].locationId;
+    snprintf(info->serial, sizeof(info->serial), "FAKE-%d", i);
+    info->index = i;
+    info->reportInterval = (uint32_t)(fake->reportInterval / 1000);
+    info->handle = &fake->devices[i];
+}
+
+static int fakeEnumerate(struct hidTransport *transport, struct hidDeviceInfo **devices, size_t *numDevices)
+{
+    struct fakeTransport *fake = transport->priv;
+    
+    *numDevices = 0;
+    *devices = calloc(fake->numDevices ? fake->numDevices : 1, sizeof(struct hidDeviceInfo));
+    
+    if (!*devices) {
+        fprintf(stderr, "Failed to allocate memory for device list!\n");
+        return -1;
+    }
+    
+    for (int i = 0; i < fake->numDevices; i++) {
+        if (fake->devices[i].present) {
+            fakeDeviceInfo(fake, i, &(*devices)[(*numDevices)++]);
+        }
+    }
+    
+    return 0;
+}
+
+static int fakeMatch(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, struct keyColorTarget **targets, size_t *numTargets)
+{
+    struct fakeTransport *fake = transport->priv;
+    
+    if (fake->matchLatency) {
+        sleepNanos(fake->matchLatency);
+    }
+    
+    return transportMatchDescriptor(transport, device, profile, fake->elements, targets, numTargets);
+}
+
+static int fakeRecord(struct fakeTransport *fake, struct fakeDevice *device, const uint8_t *report, size_t reportLen)
+{
+    pthread_mutex_lock(&fake->lock);
+    
+    if (!device->present) {
+        pthread_mutex_unlock(&fake->lock);
+        return -1;
+    }
+    
+    if (fake->numRecords == fake->maxRecords) {
+        size_t maxRecords = fake->maxRecords ? fake->maxRecords * 2 : 1024;
+        struct fakeReportRecord *grown = realloc(fake->records, sizeof(struct fakeReportRecord) * maxRecords);
+        
+        if (!grown) {
+            pthread_mutex_unlock(&fake->lock);
+            return -1;
+        }
+        fake->records = grown;
+        fake->maxRecords = maxRecords;
+    }
+    
+    struct fakeReportRecord *record = &fake->records[fake->numRecords++];
+    
+    record->timestamp = monotonicNanos();
+    record->deviceIndex = (uint32_t)(device - fake->devices);
+    record->reportLen = (uint32_t)reportLen;
+    memcpy(record->report, report, reportLen);
+    device->numWrites++;
+    device->lit = 1;
+    device->readyAt = record->timestamp + fake->recoverTime;
+    
+    pthread_mutex_unlock(&fake->lock);
+    
+    return 0;
+}
+
+static uint64_t fakeLatency(struct fakeTransport *fake, struct fakeDevice *device)
+{
+    uint64_t latency = device == &fake->devices[0] && fake->stallLatency ? fake->stallLatency : device->writeLatency;
+    
+    // Stateless draw keyed on the seed, device and write number, repeatable and safe from any thread
+    if (fake->writeJitter) {
+        uint64_t x = fake->stormSeed + (uint64_t)(device - fake->devices) * 0x9e3779b97f4a7c15ull + __atomic_fetch_add(&device->numJittered, 1, __ATOMIC_RELAXED) * 0xbf58476d1ce4e5b9ull;
+        
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        latency += (x ^ (x >> 31)) % fake->writeJitter;
+    }
+    
+    return latency;
+}
+
+static int fakeWrite(struct keyColorTarget *target, const uint8_t *report, size_t reportLen)
+{
+    struct fakeTransport *fake = target->transport->priv;
+    struct fakeDevice *device = target->device;
+    
+    if (reportLen > TRANSPORT_MAX_REPORT_SIZE || !device->present) {
+        return -1;
+    }
+    
+    uint64_t latency = fakeLatency(fake, device);
+    
+    // A board still digesting the last report NAKs this one, the retry waits it out and then some
+    if (fake->recoverTime) {
+        pthread_mutex_lock(&fake->lock);
+        uint64_t now = monotonicNanos();
+        
+        if (now < device->readyAt) {
+            latency += device->readyAt - now + fake->recoverTime;
+        }
+        pthread_mutex_unlock(&fake->lock);
+    }
+    
+    if (latency) {
+        sleepNanos(latency);
+    }
+    
+    uint64_t buildStart = transportLatencyStart(target->transport);
+    
+    if (fakeRecord(fake, device, report, reportLen)) {
+        return -1;
+    }
+    
+    // The record stands in for the report a real backend would assemble
+    transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, 0);
+    
+    return 0;
+}
+
+// Completes the device's queued reports in order as each falls due
+static void *fakeQueueWorker(void *arg)
+{
+    struct fakeDevice *device = arg;
+    struct fakeTransport *fake = device->fake;
+    struct fakeQueue *queue = &device->queue;
+    
+    pthread_mutex_lock(&fake->lock);
+    
+    while (!fake->stopping || queue->count) {
+        if (!queue->count) {
+            pthread_cond_wait(&queue->wake, &fake->lock);
+            continue;
+        }
+        
+        uint64_t now = monotonicNanos();
+        
+        if (!fake->stopping && now < queue->due[queue->head]) {
+            struct timespec ts;
+            
+            deadlineToTimespec(queue->due[queue->head] - now, &ts);
+            pthread_cond_timedwait(&queue->wake, &fake->lock, &ts);
+            continue;
+        }
+        
+        struct transportAsyncWrite *write = queue->writes[queue->head];
+        
+        queue->head = (queue->head + 1) % FAKE_QUEUE_DEPTH;
+        queue->count--;
+        
+        int stopping = fake->stopping;
+        
+        pthread_mutex_unlock(&fake->lock);
+        
+        // Writes still queued at close never reach the board
+        transportAsyncComplete(write, stopping ? -1 : fakeRecord(fake, device, write->report, write->reportLen));
+        
+        pthread_mutex_lock(&fake->lock);
+    }
+    
+    pthread_mutex_unlock(&fake->lock);
+    
+    return NULL;
+}
+
+// Queues the report on the device's worker, each report lands latency after it was sent but no sooner
+// than one service time after the previous one, so a deep enough window keeps the board busy
+static int fakeWriteAsync(struct transportAsyncWrite *write)
+{
+    struct keyColorTarget *target = write->target;
+    struct fakeTransport *fake = target->transport->priv;
+    struct fakeDevice *device = target->device;
+    struct fakeQueue *queue = &device->queue;
+    
+    if (write->reportLen > TRANSPORT_MAX_REPORT_SIZE) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&fake->lock);
+    
+    if (!device->present || queue->count == FAKE_QUEUE_DEPTH || fake->stopping) {
+        pthread_mutex_unlock(&fake->lock);
+        return -1;
+    }
+    
+    if (!queue->started) {
+        pthread_cond_init(&queue->wake, NULL);
+        
+        if (pthread_create(&queue->thread, NULL, fakeQueueWorker, device)) {
+            pthread_cond_destroy(&queue->wake);
+            pthread_mutex_unlock(&fake->lock);
+            fprintf(stderr, "Failed to start fake device queue!\n");
+            return -1;
+        }
+        queue->started = 1;
+    }
+    
+    uint64_t due = monotonicNanos() + fakeLatency(fake, device);
+    
+    if (queue->count && due < queue->lastDue + fake->serviceTime) {
+        due = queue->lastDue + fake->serviceTime;
+    }
+    
+    unsigned tail = (queue->head + queue->count) % FAKE_QUEUE_DEPTH;
+    
+    queue->writes[tail] = write;
+    queue->due[tail] = due;
+    queue->count++;
+    queue->lastDue = due;
+    pthread_cond_signal(&queue->wake);
+    
+    pthread_mutex_unlock(&fake->lock);
+    
+    return 0;
+}
+
+// Simulated bus, a storm toggles random devices so attach/detach handling can be driven without hardware
+static int fakeWatch(struct hidTransport *transport, hotplugCallback callback, void *context, volatile sig_atomic_t *stop)
+{
+    struct fakeTransport *fake = transport->priv;
+    struct hidDeviceInfo info;
+    uint64_t seed = fake->stormSeed;
+    
+    for (int i = 0; i < fake->numDevices && !*stop; i++) {
+        if (fake->devices[i].present) {
+            fakeDeviceInfo(fake, i, &info);
+            callback(transport, HOTPLUG_ATTACH, &info, monotonicNanos(), context);
+        }
+    }
+    
+    // Without a storm the bus stays quiet until interrupted
+    if (!fake->stormEvents) {
+        while (!*stop) {
+            sleepNanos(10000000ull);
+        }
+        return 0;
+    }
+    
+    for (uint64_t n = 0; n < fake->stormEvents && fake->numDevices && !*stop; n++) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        
+        int i = (int)((seed >> 33) % (uint64_t)fake->numDevices);
+        struct fakeDevice *device = &fake->devices[i];
+        
+        pthread_mutex_lock(&fake->lock);
+        device->present = !device->present;
+        device->lit = 0;
+        pthread_mutex_unlock(&fake->lock);
+        
+        fakeDeviceInfo(fake, i, &info);
+        callback(transport, device->present ? HOTPLUG_ATTACH : HOTPLUG_DETACH, &info, monotonicNanos(), context);
+        
+        if (fake->stormInterval) {
+            sleepNanos(fake->stormInterval);
+        }
+    }
+    
+    return 0;
+}
+
+struct fakeDumpContext {
+    struct fakeTransport *fake;
+    const struct dumpFilter *filter;
+};
+
+// Reading a board's elements costs the match latency, as it would going through the real stack
+static void fakeDumpDevice(struct dumpWriter *writer, int i, void *context)
+{
+    struct fakeDumpContext *dump = context;
+    struct fakeTransport *fake = dump->fake;
+    
+    if (!dumpFilterDevice(dump->filter, LOGITECH_VENDOR_ID, fake->devices[i].productId)) {
+        return;
+    }
+    
+    if (fake->matchLatency) {
+        sleepNanos(fake->matchLatency);
+    }
+    
+    if (dumpFilterElements(dump->filter) && hidElementTableMatches(fake->elements, dump->filter) == 0) {
+        return;
+    }
+    
+    dumpBeginDevice(writer, i);
+    dumpHex(writer, "VendorID", LOGITECH_VENDOR_ID);
+    dumpHex(writer, "ProductID", fake->devices[i].productId);
+    dumpHex(writer, "LocationID", fake->devices[i].locationId);
+    dumpInt(writer, "WriteLatencyNS", (int64_t)fake->devices[i].writeLatency);
+    hidElementTableDump(fake->elements, dump->filter, writer);
+    dumpEndDevice(writer);
+}
+
+static void fakeDump(struct hidTransport *transport, struct dumpWriter *writer, const struct dumpFilter *filter, int verbose)
+{
+    struct fakeDumpContext dump = { transport->priv, filter };
+    
+    writer->keyWidth = 14;
+    dumpDevicesParallel(writer, dump.fake->numDevices, fakeDumpDevice, &dump);
+}
+
+static void fakeClose(struct hidTransport *transport)
+{
+    struct fakeTransport *fake = transport->priv;
+    
+    pthread_mutex_lock(&fake->lock);
+    fake->stopping = 1;
+    
+    for (int i = 0; i < fake->numDevices; i++) {
+        if (fake->devices[i].queue.started) {
+            pthread_cond_signal(&fake->devices[i].queue.wake);
+        }
+    }
+    pthread_mutex_unlock(&fake->lock);
+    
+    for (int i = 0; i < fake->numDevices; i++) {
+        if (fake->devices[i].queue.started) {
+            pthread_join(fake->devices[i].queue.thread, NULL);
+            pthread_cond_destroy(&fake->devices[i].queue.wake);
+        }
+    }
+    
+    if (transport->verbose) {
+        for (size_t i = 0; i < fake->numRecords; i++) {
+            struct fakeReportRecord *record = &fake->records[i];
+            
+            printf("fake[%u] @%llu:", record->deviceIndex, (unsigned long long)record->timestamp);
+            for (uint32_t j = 0; j < record->reportLen; j++) {
+                printf(" %02x", record->report[j]);
+            }
+            printf("\n");
+        }
+    }
+    
+    pthread_mutex_destroy(&fake->lock);
+    hidElementTableFree(fake->elements);
+    free(fake->records);
+    free(fake);
+}
+
+const struct fakeReportRecord *fakeTransportRecords(struct hidTransport *transport, size_t *numRecords)
+{
+    if (transport->ops != &fakeTransportOps) {
+        *numRecords = 0;
+        return NULL;
+    }
+    
+    struct fakeTransport *fake = transport->priv;
+    
+    *numRecords = fake->numRecords;
+    
+    return fake->records;
+}
+
+// Plugged in devices still showing the color they came back with
+int fakeTransportUnlit(struct hidTransport *transport)
+{
+    if (transport->ops != &fakeTransportOps) {
+        return 0;
+    }
+    
+    struct fakeTransport *fake = transport->priv;
+    int numUnlit = 0;
+    
+    for (int i = 0; i < fake->numDevices; i++) {
+        if (fake->devices[i].present && !fake->devices[i].lit) {
+            numUnlit++;
+        }
+    }
+    
+    return numUnlit;
+}
+
+const struct hidTransportOps fakeTransportOps = {
+    "fake",
+    "in-memory keyboard that records every report (devices=N,latency=DURATION[/DURATION...],jitter=DURATION,stall=DURATION,match=DURATION,recover=DURATION,report=DURATION,service=DURATION,product=ID,storm=N,interval=DURATION,seed=N)",
+    fakeOpen,
+    fakeEnumerate,
+    fakeMatch,
+    transportAttachFromCache,
+    fakeWrite,
+    fakeWriteAsync,
+    NULL,
+    fakeWatch,
+    fakeDump,
+    fakeClose
+};
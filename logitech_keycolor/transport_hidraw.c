@@ -0,0 +1,458 @@
+//
+//  transport_hidraw.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include "transport.h"
+
+#ifdef __linux__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+#include <linux/hidraw.h>
+
+struct hidrawDevice {
+    int fd;
+    int minor;
+    struct hidraw_devinfo info;
+    struct hidElementTable *elements;   // parsed report descriptor, loaded on first use
+    struct hidrawDevice *next;          // watched devices are individually allocated and chained
+};
+
+struct hidrawTransport {
+    struct hidrawDevice *devices;
+    int numDevices;
+    int matchAll;
+};
+
+static int hidrawOpen(struct hidTransport *transport, const char *args, int matchAll)
+{
+    struct hidrawTransport *hidraw = calloc(1, sizeof(struct hidrawTransport));
+    
+    if (!hidraw) {
+        fprintf(stderr, "Failed to allocate hidraw transport!\n");
+        return -1;
+    }
+    
+    hidraw->matchAll = matchAll;
+    transport->priv = hidraw;
+    
+    return 0;
+}
+
+// Opens /dev/hidrawN and keeps it if it is a device we would drive
+static int hidrawProbe(struct hidTransport *transport, int minor, struct hidrawDevice *device)
+{
+    struct hidrawTransport *hidraw = transport->priv;
+    char path[64];
+    
+    snprintf(path, sizeof(path), "/dev/hidraw%d", minor);
+    
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    
+    if (fd < 0) {
+        if (transport->verbose) {
+            fprintf(stderr, "NOTE: %s: %s\n", path, strerror(errno));
+        }
+        return -1;
+    }
+    
+    if (ioctl(fd, HIDIOCGRAWINFO, &device->info) < 0 ||
+        (!hidraw->matchAll && (uint16_t)device->info.vendor != LOGITECH_VENDOR_ID)) {
+        close(fd);
+        return -1;
+    }
+    
+    device->fd = fd;
+    device->minor = minor;
+    device->elements = NULL;
+    device->next = NULL;
+    
+    return 0;
+}
+
+static void hidrawDeviceInfo(struct hidrawDevice *device, int index, struct hidDeviceInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->vendorId = (uint16_t)device->info.vendor;
+    info->productId = (uint16_t)device->info.product;
+    info->locationId = (uint32_t)device->minor;
+    // The physical path is the closest thing to a serial hidraw reports for every device
+    ioctl(device->fd, HIDIOCGRAWPHYS(sizeof(info->serial) - 1), info->serial);
+    info->index = index;
+    info->handle = device;
+}
+
+static int hidrawEnumerate(struct hidTransport *transport, struct hidDeviceInfo **devices, size_t *numDevices)
+{
+    struct hidrawTransport *hidraw = transport->priv;
+    DIR *dir = opendir("/dev");
+    struct dirent *entry;
+    
+    *devices = NULL;
+    *numDevices = 0;
+    
+    // Start over on re-enumeration, handles from an earlier pass must be released by now
+    for (int i = 0; i < hidraw->numDevices; i++) {
+        close(hidraw->devices[i].fd);
+        hidElementTableFree(hidraw->devices[i].elements);
+    }
+    free(hidraw->devices);
+    hidraw->devices = NULL;
+    hidraw->numDevices = 0;
+    
+    if (!dir) {
+        fprintf(stderr, "Failed to open /dev: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        struct hidrawDevice device;
+        int minor;
+        
+        if (sscanf(entry->d_name, "hidraw%d", &minor) != 1 || hidrawProbe(transport, minor, &device)) {
+            continue;
+        }
+        
+        struct hidrawDevice *grown = realloc(hidraw->devices, sizeof(struct hidrawDevice) * (hidraw->numDevices + 1));
+        
+        if (!grown) {
+            close(device.fd);
+            break;
+        }
+        
+        hidraw->devices = grown;
+        hidraw->devices[hidraw->numDevices++] = device;
+    }
+    
+    closedir(dir);
+    
+    *devices = calloc(hidraw->numDevices ? hidraw->numDevices : 1, sizeof(struct hidDeviceInfo));
+    
+    if (!*devices) {
+        fprintf(stderr, "Failed to allocate memory for device list!\n");
+        return -1;
+    }
+    
+    for (int i = 0; i < hidraw->numDevices; i++) {
+        hidrawDeviceInfo(&hidraw->devices[i], i, &(*devices)[(*numDevices)++]);
+    }
+    
+    return 0;
+}
+
+static const struct hidElementTable *hidrawElements(struct hidrawDevice *device)
+{
+    struct hidraw_report_descriptor desc;
+    int descSize = 0;
+    
+    if (device->elements) {
+        return device->elements;
+    }
+    
+    if (ioctl(device->fd, HIDIOCGRDESCSIZE, &descSize) < 0) {
+        return NULL;
+    }
+    
+    desc.size = descSize;
+    
+    if (ioctl(device->fd, HIDIOCGRDESC, &desc) < 0) {
+        return NULL;
+    }
+    
+    return device->elements = hidDescriptorParse(desc.value, desc.size);
+}
+
+// The keyboard exposes several interfaces, only the one declaring the color report will take it
+static int hidrawMatch(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, struct keyColorTarget **targets, size_t *numTargets)
+{
+    return transportMatchDescriptor(transport, device, profile, hidrawElements(device->handle), targets, numTargets);
+}
+
+static int hidrawWrite(struct keyColorTarget *target, const uint8_t *report, size_t reportLen)
+{
+    struct hidrawDevice *hidrawDevice = target->device;
+    uint8_t buf[TRANSPORT_MAX_REPORT_SIZE + 1];
+    
+    if (reportLen > TRANSPORT_MAX_REPORT_SIZE) {
+        return -EINVAL;
+    }
+    
+    uint64_t buildStart = transportLatencyStart(target->transport);
+    
+    buf[0] = target->reportId;
+    memcpy(buf + 1, report, reportLen);
+    transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, 0);
+    
+    if (target->reportType == KEYCOLOR_REPORT_TYPE_OUTPUT) {
+        if (write(hidrawDevice->fd, buf, reportLen + 1) < 0) {
+            return -errno;
+        }
+    } else if (ioctl(hidrawDevice->fd, HIDIOCSFEATURE(reportLen + 1), buf) < 0) {
+        return -errno;
+    }
+    
+    return 0;
+}
+
+static void hidrawWatchAttach(struct hidTransport *transport, struct hidrawDevice **watched, int minor, hotplugCallback callback, void *context)
+{
+    struct hidDeviceInfo info;
+    uint64_t eventTime = monotonicNanos();
+    
+    for (struct hidrawDevice *device = *watched; device; device = device->next) {
+        if (device->minor == minor) {
+            return;
+        }
+    }
+    
+    struct hidrawDevice *device = malloc(sizeof(struct hidrawDevice));
+    
+    if (!device) {
+        return;
+    }
+    
+    // udev may not have fixed the permissions yet, the IN_ATTRIB that follows retries
+    if (hidrawProbe(transport, minor, device)) {
+        free(device);
+        return;
+    }
+    
+    device->next = *watched;
+    *watched = device;
+    
+    hidrawDeviceInfo(device, minor, &info);
+    callback(transport, HOTPLUG_ATTACH, &info, eventTime, context);
+}
+
+static void hidrawWatchDetach(struct hidTransport *transport, struct hidrawDevice **watched, int minor, hotplugCallback callback, void *context)
+{
+    struct hidDeviceInfo info;
+    uint64_t eventTime = monotonicNanos();
+    
+    for (struct hidrawDevice **link = watched; *link; link = &(*link)->next) {
+        struct hidrawDevice *device = *link;
+        
+        if (device->minor != minor) {
+            continue;
+        }
+        
+        memset(&info, 0, sizeof(info));
+        info.vendorId = (uint16_t)device->info.vendor;
+        info.productId = (uint16_t)device->info.product;
+        info.locationId = (uint32_t)minor;
+        info.index = minor;
+        info.handle = device;
+        callback(transport, HOTPLUG_DETACH, &info, eventTime, context);
+        
+        *link = device->next;
+        close(device->fd);
+        hidElementTableFree(device->elements);
+        free(device);
+        return;
+    }
+}
+
+// Follows /dev with inotify, udev creating or removing a hidraw node is the attach or detach
+static int hidrawWatch(struct hidTransport *transport, hotplugCallback callback, void *context, volatile sig_atomic_t *stop)
+{
+    struct hidrawDevice *watched = NULL;
+    int notifyFd = inotify_init1(IN_CLOEXEC);
+    
+    if (notifyFd < 0 || inotify_add_watch(notifyFd, "/dev", IN_CREATE | IN_ATTRIB | IN_DELETE) < 0) {
+        fprintf(stderr, "Failed to watch /dev: %s\n", strerror(errno));
+        if (notifyFd >= 0) {
+            close(notifyFd);
+        }
+        return -1;
+    }
+    
+    // The watch is already in place, anything created during the scan is caught either way
+    DIR *dir = opendir("/dev");
+    struct dirent *entry;
+    
+    while (dir && (entry = readdir(dir)) != NULL) {
+        int minor;
+        
+        if (sscanf(entry->d_name, "hidraw%d", &minor) == 1) {
+            hidrawWatchAttach(transport, &watched, minor, callback, context);
+        }
+    }
+    
+    if (dir) {
+        closedir(dir);
+    }
+    
+    int retVal = 0;
+    
+    while (!*stop) {
+        struct pollfd pfd = { notifyFd, POLLIN, 0 };
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        
+        // Short timeout so a stop request is noticed even on a quiet bus
+        int numReady = poll(&pfd, 1, 250);
+        
+        if (numReady < 0 && errno != EINTR) {
+            fprintf(stderr, "Failed to poll /dev events: %s\n", strerror(errno));
+            retVal = -1;
+            break;
+        }
+        
+        if (numReady <= 0) {
+            continue;
+        }
+        
+        ssize_t len = read(notifyFd, buf, sizeof(buf));
+        
+        for (char *ptr = buf; len > 0 && ptr < buf + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            int minor;
+            
+            ptr += sizeof(struct inotify_event) + event->len;
+            
+            if (!event->len || sscanf(event->name, "hidraw%d", &minor) != 1) {
+                continue;
+            }
+            
+            if (event->mask & IN_DELETE) {
+                hidrawWatchDetach(transport, &watched, minor, callback, context);
+            } else {
+                hidrawWatchAttach(transport, &watched, minor, callback, context);
+            }
+        }
+    }
+    
+    while (watched) {
+        struct hidrawDevice *next = watched->next;
+        
+        close(watched->fd);
+        hidElementTableFree(watched->elements);
+        free(watched);
+        watched = next;
+    }
+    
+    close(notifyFd);
+    
+    return retVal;
+}
+
+struct hidrawDumpContext {
+    struct hidrawTransport *hidraw;
+    const struct dumpFilter *filter;
+};
+
+// Ids come from enumeration, the ioctls and the descriptor parse only run for devices the filter keeps
+static void hidrawDumpDevice(struct dumpWriter *writer, int i, void *context)
+{
+    struct hidrawDumpContext *dump = context;
+    struct hidrawDevice *device = &dump->hidraw->devices[i];
+    char name[256] = "", phys[256] = "", path[64];
+    int descSize = 0;
+    
+    if (!dumpFilterDevice(dump->filter, (uint16_t)device->info.vendor, (uint16_t)device->info.product)) {
+        return;
+    }
+    
+    const struct hidElementTable *elements = hidrawElements(device);
+    
+    if (dumpFilterElements(dump->filter) && (!elements || hidElementTableMatches(elements, dump->filter) == 0)) {
+        return;
+    }
+    
+    ioctl(device->fd, HIDIOCGRAWNAME(sizeof(name)), name);
+    ioctl(device->fd, HIDIOCGRAWPHYS(sizeof(phys)), phys);
+    ioctl(device->fd, HIDIOCGRDESCSIZE, &descSize);
+    snprintf(path, sizeof(path), "/dev/hidraw%d", device->minor);
+    
+    dumpBeginDevice(writer, i);
+    dumpString(writer, "Path", path);
+    dumpString(writer, "Product", name);
+    dumpString(writer, "Phys", phys);
+    dumpHex(writer, "BusType", (uint32_t)device->info.bustype);
+    dumpHex(writer, "VendorID", (uint16_t)device->info.vendor);
+    dumpHex(writer, "ProductID", (uint16_t)device->info.product);
+    dumpInt(writer, "DescriptorSize", descSize);
+    
+    if (elements) {
+        hidElementTableDump(elements, dump->filter, writer);
+    }
+    dumpEndDevice(writer);
+}
+
+static void hidrawDump(struct hidTransport *transport, struct dumpWriter *writer, const struct dumpFilter *filter, int verbose)
+{
+    struct hidrawDumpContext dump = { transport->priv, filter };
+    struct hidDeviceInfo *devices = NULL;
+    size_t numDevices = 0;
+    
+    if (hidrawEnumerate(transport, &devices, &numDevices)) {
+        return;
+    }
+    
+    writer->keyWidth = 17;
+    dumpDevicesParallel(writer, dump.hidraw->numDevices, hidrawDumpDevice, &dump);
+    free(devices);
+}
+
+static void hidrawClose(struct hidTransport *transport)
+{
+    struct hidrawTransport *hidraw = transport->priv;
+    
+    for (int i = 0; i < hidraw->numDevices; i++) {
+        close(hidraw->devices[i].fd);
+        hidElementTableFree(hidraw->devices[i].elements);
+    }
+    
+    free(hidraw->devices);
+    free(hidraw);
+}
+
+const struct hidTransportOps hidrawTransportOps = {
+    "hidraw",
+    "Linux /dev/hidraw* feature and output reports",
+    hidrawOpen,
+    hidrawEnumerate,
+    hidrawMatch,
+    transportAttachFromCache,
+    hidrawWrite,
+    NULL,
+    NULL,
+    hidrawWatch,
+    hidrawDump,
+    hidrawClose
+};
+
+#endif /* __linux__ */
@@ -0,0 +1,948 @@
+//
+//  transport_iokit.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include "transport.h"
+
+#ifdef __APPLE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/hid/IOHIDLib.h>
+
+struct iokitTransport {
+    IOHIDManagerRef hidManagerRef;
+    IOHIDDeviceRef *devices;
+    CFIndex numDevices;
+    
+    // Asynchronous writes complete on a run loop of their own, started with the first one
+    pthread_mutex_t asyncLock;
+    pthread_cond_t asyncReady;
+    pthread_t runLoopThread;
+    CFRunLoopRef runLoop;
+    int runLoopStarted;
+    volatile int runLoopStop;
+    IOHIDDeviceRef *scheduled;  // devices on runLoop, retained
+    size_t numScheduled;
+};
+
+static CFMutableDictionaryRef setMatchSelection(CFMutableDictionaryRef dictRef, CFStringRef key, UInt32 value)
+{
+    if (dictRef == NULL) {
+        dictRef = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        
+        CFAutorelease(dictRef);
+    
+        if (!dictRef) {
+            fprintf(stderr, "Failed to alloc matching dictionary!\n");
+            exit(3);
+        }
+    }
+    
+    if (dictRef) {
+        CFNumberRef tCFNumberRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &value);
+        CFDictionarySetValue(dictRef, key, tCFNumberRef);
+        CFRelease(tCFNumberRef);
+    }
+    
+    return dictRef;
+}
+
+// CFStringGetCStringPtr() is allowed to return NULL, fall back to copying into buf
+static const char *cfStringToC(CFStringRef str, char *buf, size_t bufSize)
+{
+    const char *cp = CFStringGetCStringPtr(str, kCFStringEncodingUTF8);
+    
+    if (cp) {
+        return cp;
+    }
+    
+    if (!CFStringGetCString(str, buf, (CFIndex)bufSize, kCFStringEncodingUTF8)) {
+        snprintf(buf, bufSize, "<unconvertible>");
+    }
+    
+    return buf;
+}
+
+#define GUESS_UNKNOWN_TYPES 0
+static void cfValueDump(struct dumpWriter *writer, const char *key, CFTypeRef value)
+{
+#if GUESS_UNKNOWN_TYPES
+    struct idMap {
+        const char *name;
+        CFTypeID id;
+    } typeMap[] = {
+        "CFAllocatorGetTypeID", CFAllocatorGetTypeID(),
+        "CFArrayGetTypeID", CFArrayGetTypeID(),
+        "CFAttributedStringGetTypeID", CFAttributedStringGetTypeID(),
+        "CFBagGetTypeID", CFBagGetTypeID(),
+        "CFBinaryHeapGetTypeID", CFBinaryHeapGetTypeID(),
+        "CFBitVectorGetTypeID", CFBitVectorGetTypeID(),
+        "CFBooleanGetTypeID", CFBooleanGetTypeID(),
+        "CFBundleGetTypeID", CFBundleGetTypeID(),
+        "CFCalendarGetTypeID", CFCalendarGetTypeID(),
+        "CFCharacterSetGetTypeID", CFCharacterSetGetTypeID(),
+        "CFDataGetTypeID", CFDataGetTypeID(),
+        "CFDateFormatterGetTypeID", CFDateFormatterGetTypeID(),
+        "CFDateGetTypeID", CFDateGetTypeID(),
+        "CFDictionaryGetTypeID", CFDictionaryGetTypeID(),
+        "CFErrorGetTypeID", CFErrorGetTypeID(),
+        "CFFileDescriptorGetTypeID", CFFileDescriptorGetTypeID(),
+        "CFFileSecurityGetTypeID", CFFileSecurityGetTypeID(),
+        "CFLocaleGetTypeID", CFLocaleGetTypeID(),
+        "CFMachPortGetTypeID", CFMachPortGetTypeID(),
+        "CFMessagePortGetTypeID", CFMessagePortGetTypeID(),
+        "CFNotificationCenterGetTypeID", CFNotificationCenterGetTypeID(),
+        "CFNullGetTypeID", CFNullGetTypeID(),
+        "CFNumberFormatterGetTypeID", CFNumberFormatterGetTypeID(),
+        "CFNumberGetTypeID", CFNumberGetTypeID(),
+        "CFPlugInGetTypeID", CFPlugInGetTypeID(),
+        "CFPlugInInstanceGetTypeID", CFPlugInInstanceGetTypeID(),
+        "CFReadStreamGetTypeID", CFReadStreamGetTypeID(),
+        "CFRunLoopGetTypeID", CFRunLoopGetTypeID(),
+        "CFRunLoopObserverGetTypeID", CFRunLoopObserverGetTypeID(),
+        "CFRunLoopSourceGetTypeID", CFRunLoopSourceGetTypeID(),
+        "CFRunLoopTimerGetTypeID", CFRunLoopTimerGetTypeID(),
+        "CFSetGetTypeID", CFSetGetTypeID(),
+        "CFSocketGetTypeID", CFSocketGetTypeID(),
+        "CFStringGetTypeID", CFStringGetTypeID(),
+        "CFStringTokenizerGetTypeID", CFStringTokenizerGetTypeID(),
+        "CFTimeZoneGetTypeID", CFTimeZoneGetTypeID(),
+        "CFTreeGetTypeID", CFTreeGetTypeID(),
+        "CFURLEnumeratorGetTypeID", CFURLEnumeratorGetTypeID(),
+        "CFURLGetTypeID", CFURLGetTypeID(),
+        "CFUUIDGetTypeID", CFUUIDGetTypeID(),
+        "CFUserNotificationGetTypeID", CFUserNotificationGetTypeID(),
+        "CFWriteStreamGetTypeID", CFWriteStreamGetTypeID(),
+        "CFXMLNodeGetTypeID", CFXMLNodeGetTypeID(),
+        "CFXMLParserGetTypeID", CFXMLParserGetTypeID(),
+        NULL, NULL
+    };
+#endif /* GUESS_UNKNOWN_TYPES */
+    CFTypeID valueType = CFGetTypeID(value);
+    char buf[1024];
+    
+    if (valueType == CFStringGetTypeID()) {
+        dumpString(writer, key, cfStringToC(value, buf, sizeof(buf)));
+    } else if (valueType == CFNumberGetTypeID()) {
+        int64_t n;
+        CFNumberGetValue(value, kCFNumberSInt64Type, &n);
+        dumpHex(writer, key, (uint64_t)n);
+    } else if (valueType == CFArrayGetTypeID()) {
+        CFIndex n = CFArrayGetCount(value);
+        dumpBeginList(writer, key);
+        for (CFIndex k = 0; k < n; k++) {
+            cfValueDump(writer, NULL, CFArrayGetValueAtIndex(value, k));
+        }
+        dumpEndList(writer);
+    } else if (valueType == CFDictionaryGetTypeID()) {
+        CFIndex n = CFDictionaryGetCount(value);
+        CFTypeRef keys[64], values[64];
+        
+        // Property dictionaries are tiny, anything bigger is summarized rather than allocated for
+        if (n > 64) {
+            snprintf(buf, sizeof(buf), "<%ld entries>", (long)n);
+            dumpString(writer, key, buf);
+            return;
+        }
+        
+        CFDictionaryGetKeysAndValues(value, keys, values);
+        dumpBeginMap(writer, key);
+        for (CFIndex i = 0; i < n; i++) {
+            char keyBuf[256];
+            
+            if (CFGetTypeID(values[i]) == CFBooleanGetTypeID() && !CFBooleanGetValue(values[i]))
+                continue;
+            
+            cfValueDump(writer, CFGetTypeID(keys[i]) == CFStringGetTypeID() ? cfStringToC(keys[i], keyBuf, sizeof(keyBuf)) : "?", values[i]);
+        }
+        dumpEndMap(writer);
+    } else if (valueType == CFBooleanGetTypeID()) {
+        dumpBool(writer, key, CFBooleanGetValue(value));
+    } else {
+        const char *typeName = NULL;
+#if GUESS_UNKNOWN_TYPES
+        for (struct idMap *l = typeMap;l->name;l++) {
+            if (valueType == l->id) {
+                typeName = l->name;
+                break;
+            }
+        }
+#endif /* GUESS_UNKNOWN_TYPES */
+        snprintf(buf, sizeof(buf), "??type=0x%lx%s%s??", (unsigned long)valueType, typeName ? " " : "", typeName ? typeName : "");
+        dumpString(writer, key, buf);
+    }
+}
+
+static int32_t deviceIntProperty(IOHIDDeviceRef device, CFStringRef key)
+{
+    CFNumberRef numberRef = IOHIDDeviceGetProperty(device, key);
+    int32_t value = 0;
+    
+    if (numberRef) {
+        CFNumberGetValue(numberRef, kCFNumberSInt32Type, &value);
+    }
+    
+    return value;
+}
+
+static const char *elementTypeName(IOHIDElementType elementType)
+{
+    switch(elementType) {
+        case kIOHIDElementTypeInput_Misc: return "Misc";
+        case kIOHIDElementTypeInput_Button: return "Button";
+        case kIOHIDElementTypeInput_Axis: return "Axis";
+        case kIOHIDElementTypeInput_ScanCodes: return "ScanCodes";
+        case kIOHIDElementTypeOutput: return "Output";
+        case kIOHIDElementTypeFeature: return "Feature";
+        case kIOHIDElementTypeCollection: return "Collection";
+    }
+    
+    return "unknown";
+}
+
+static const char *elementCollectionTypeName(IOHIDElementCollectionType elementCollectionType)
+{
+    switch(elementCollectionType) {
+        case kIOHIDElementCollectionTypePhysical: return "Physical";
+        case kIOHIDElementCollectionTypeApplication: return "Application";
+        case kIOHIDElementCollectionTypeLogical: return "Logical";
+        case kIOHIDElementCollectionTypeReport: return "Report";
+        case kIOHIDElementCollectionTypeNamedArray: return "NamedArray";
+        case kIOHIDElementCollectionTypeUsageSwitch: return "UsageSwitch";
+        case kIOHIDElementCollectionTypeUsageModifier: return "UsageModifier";
+    }
+    
+    return "unknown";
+}
+
+static enum dumpElementKind elementKind(IOHIDElementType elementType)
+{
+    switch(elementType) {
+        case kIOHIDElementTypeOutput: return DUMP_KIND_OUTPUT;
+        case kIOHIDElementTypeFeature: return DUMP_KIND_FEATURE;
+        case kIOHIDElementTypeCollection: return DUMP_KIND_COLLECTION;
+        default: return DUMP_KIND_INPUT;
+    }
+}
+
+// Only raw getters, nothing is formatted for an element the filter drops
+static int elementFiltered(const struct dumpFilter *filter, IOHIDElementRef element)
+{
+    return dumpFilterElement(filter, elementKind(IOHIDElementGetType(element)),
+                             IOHIDElementGetUsagePage(element), IOHIDElementGetUsage(element),
+                             IOHIDElementGetReportID(element), (uint32_t)IOHIDElementGetCookie(element));
+}
+
+// Streams the element and, when recursing, its children, only the name ever needs converting
+static void dumpHidElement(struct dumpWriter *writer, IOHIDElementRef element, int recurse)
+{
+    struct dumpElement info;
+    char nameBuf[256];
+    CFStringRef nameRef = IOHIDElementGetName(element);
+    
+    info.cookie = (uint32_t)IOHIDElementGetCookie(element);
+    info.name = nameRef ? cfStringToC(nameRef, nameBuf, sizeof(nameBuf)) : NULL;
+    info.type = elementTypeName(IOHIDElementGetType(element));
+    info.collectionType = elementCollectionTypeName(IOHIDElementGetCollectionType(element));
+    info.usagePage = IOHIDElementGetUsagePage(element);
+    info.usagePageName = hidUsagePageName(info.usagePage);
+    info.usage = IOHIDElementGetUsage(element);
+    info.reportSize = IOHIDElementGetReportSize(element);
+    info.reportCount = IOHIDElementGetReportCount(element);
+    info.reportId = IOHIDElementGetReportID(element);
+    info.unit = IOHIDElementGetUnit(element);
+    info.unitExponent = (int32_t)IOHIDElementGetUnitExponent(element);
+    info.flags = (IOHIDElementHasNullState(element) ? DUMP_ELEMENT_NULL_STATE : 0) |
+                 (IOHIDElementHasPreferredState(element) ? DUMP_ELEMENT_PREFERRED_STATE : 0) |
+                 (IOHIDElementIsArray(element) ? DUMP_ELEMENT_ARRAY : 0) |
+                 (IOHIDElementIsNonLinear(element) ? DUMP_ELEMENT_NON_LINEAR : 0) |
+                 (IOHIDElementIsRelative(element) ? DUMP_ELEMENT_RELATIVE : 0) |
+                 (IOHIDElementIsVirtual(element) ? DUMP_ELEMENT_VIRTUAL : 0) |
+                 (IOHIDElementIsWrapping(element) ? DUMP_ELEMENT_WRAPPING : 0);
+    info.logicalMin = IOHIDElementGetLogicalMin(element);
+    info.logicalMax = IOHIDElementGetLogicalMax(element);
+    info.physicalMin = IOHIDElementGetPhysicalMin(element);
+    info.physicalMax = IOHIDElementGetPhysicalMax(element);
+    
+    dumpBeginElement(writer, &info);
+    
+    CFArrayRef elementChildren = recurse ? IOHIDElementGetChildren(element) : NULL;
+    
+    if (elementChildren) {
+        CFIndex numChildren = CFArrayGetCount(elementChildren);
+        
+        for (CFIndex i = 0; i < numChildren; i++) {
+            dumpHidElement(writer, (IOHIDElementRef)CFArrayGetValueAtIndex(elementChildren, i), 1);
+        }
+    }
+    
+    dumpEndElement(writer);
+}
+
+static size_t elementsMatching(CFArrayRef elements, const struct dumpFilter *filter)
+{
+    size_t numMatches = 0;
+    
+    for (CFIndex i = 0; elements && i < CFArrayGetCount(elements); i++) {
+        numMatches += elementFiltered(filter, (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i));
+    }
+    
+    return numMatches;
+}
+
+// With element fields in the filter the matches are listed flat, a matching child can sit under a collection that does not match
+static void dumpElements(struct dumpWriter *writer, CFArrayRef elements, const struct dumpFilter *filter, int verbose)
+{
+    if (!elements) {
+        if (verbose) {
+            dumpBeginElements(writer, 0);
+            dumpEndElements(writer);
+        }
+        return;
+    }
+    
+    CFIndex numElements = CFArrayGetCount(elements);
+    
+    if (!dumpFilterElements(filter)) {
+        dumpBeginElements(writer, numElements);
+        
+        for (CFIndex i = 0;i < numElements;i++) {
+            dumpHidElement(writer, (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i), 1);
+        }
+        
+        dumpEndElements(writer);
+        return;
+    }
+    
+    dumpBeginElements(writer, (long)elementsMatching(elements, filter));
+    
+    for (CFIndex i = 0; i < numElements; i++) {
+        IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i);
+        
+        if (elementFiltered(filter, element)) {
+            dumpHidElement(writer, element, 0);
+        }
+    }
+    
+    dumpEndElements(writer);
+}
+
+static const char *dumpProperties[] = {
+    kIOHIDTransportKey,
+    kIOHIDVendorIDKey,
+    kIOHIDManufacturerKey,
+    kIOHIDVendorIDSourceKey,
+    kIOHIDProductIDKey,
+    kIOHIDProductKey,
+    kIOHIDVersionNumberKey,
+    kIOHIDSerialNumberKey,
+    kIOHIDCountryCodeKey,
+    kIOHIDStandardTypeKey,
+    kIOHIDLocationIDKey,
+    kIOHIDDeviceUsageKey,
+    kIOHIDDeviceUsagePageKey,
+    kIOHIDDeviceUsagePairsKey,
+    kIOHIDPrimaryUsageKey,
+    kIOHIDPrimaryUsagePageKey,
+    kIOHIDMaxInputReportSizeKey,
+    kIOHIDMaxOutputReportSizeKey,
+    kIOHIDMaxFeatureReportSizeKey,
+    kIOHIDReportIntervalKey,
+    kIOHIDSampleIntervalKey,
+    kIOHIDBatchIntervalKey,
+    kIOHIDRequestTimeoutKey,
+    kIOHIDResetKey,
+    kIOHIDKeyboardLanguageKey,
+    kIOHIDAltHandlerIdKey,
+    kIOHIDBuiltInKey,
+    kIOHIDDisplayIntegratedKey,
+    kIOHIDProductIDMaskKey,
+    kIOHIDProductIDArrayKey,
+    kIOHIDPowerOnDelayNSKey,
+    kIOHIDCategoryKey,
+    kIOHIDMaxResponseLatencyKey,
+    kIOHIDUniqueIDKey,
+    NULL
+};
+
+struct iokitDumpContext {
+    IOHIDDeviceRef *devices;
+    CFStringRef *properties;
+    const struct dumpFilter *filter;
+    int verbose;
+};
+
+// Ids are checked before any property is read or formatted, filtered elements are copied once and counted on raw getters
+static void dumpDevice(struct dumpWriter *writer, int i, void *context)
+{
+    struct iokitDumpContext *dump = context;
+    IOHIDDeviceRef device = dump->devices[i];
+    
+    if (!dumpFilterDevice(dump->filter,
+                          (uint32_t)deviceIntProperty(device, CFSTR(kIOHIDVendorIDKey)),
+                          (uint32_t)deviceIntProperty(device, CFSTR(kIOHIDProductIDKey)))) {
+        return;
+    }
+    
+    CFArrayRef elements = IOHIDDeviceCopyMatchingElements(device, NULL, kIOHIDOptionsTypeNone);
+    
+    if (dumpFilterElements(dump->filter) && elementsMatching(elements, dump->filter) == 0) {
+        if (elements) CFRelease(elements);
+        return;
+    }
+    
+    dumpBeginDevice(writer, i);
+    
+    for (int j = 0;dumpProperties[j];j++) {
+        CFTypeRef v = IOHIDDeviceGetProperty(device, dump->properties[j]);
+        
+        if (!v) {
+            if (dump->verbose) dumpNull(writer, dumpProperties[j]);
+        } else {
+            cfValueDump(writer, dumpProperties[j], v);
+        }
+    }
+    dumpElements(writer, elements, dump->filter, dump->verbose);
+    dumpEndDevice(writer);
+    
+    if (elements) {
+        CFRelease(elements);
+    }
+}
+
+static void dumpDevices(struct dumpWriter *writer, IOHIDDeviceRef *devices, CFIndex numDevices, const struct dumpFilter *filter, int verbose)
+{
+    size_t colWidth = 0;
+    CFStringRef cStr_properties[sizeof(dumpProperties)/sizeof(const char *)];
+    struct iokitDumpContext dump = { devices, cStr_properties, filter, verbose };
+    
+    for (int i = 0; dumpProperties[i]; i++) {
+        cStr_properties[i] = CFStringCreateWithCString(kCFAllocatorDefault, dumpProperties[i], kCFStringEncodingASCII);
+        
+        if (strlen(dumpProperties[i]) > colWidth) {
+            colWidth = strlen(dumpProperties[i]);
+        }
+    }
+    writer->keyWidth = (int)colWidth + 1;
+    
+    dumpDevicesParallel(writer, (int)numDevices, dumpDevice, &dump);
+    
+    for (int i = 0; dumpProperties[i]; i++) {
+        CFRelease(cStr_properties[i]);
+    }
+}
+
+static int iokitOpen(struct hidTransport *transport, const char *args, int matchAll)
+{
+    struct iokitTransport *iokit = calloc(1, sizeof(struct iokitTransport));
+    
+    if (!iokit) {
+        fprintf(stderr, "Failed to allocate IOKit transport!\n");
+        return -1;
+    }
+    
+    IOHIDManagerRef hidManagerRef = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
+    
+    if (!hidManagerRef) {
+        fprintf(stderr, "Failed to get IOHIDManager!\n");
+        free(iokit);
+        return -1;
+    }
+    
+    // Setup matching to get correct device(s)
+    CFMutableDictionaryRef matchDictRef = setMatchSelection(NULL, CFSTR(kIOHIDDeviceUsagePageKey), kHIDPage_GenericDesktop);
+    
+    setMatchSelection(matchDictRef, CFSTR(kIOHIDDeviceUsageKey), kHIDUsage_GD_Keyboard);
+    
+    if (!matchAll) {
+        // Look for Logitech (0x046d) with Vendor extensions (DeviceUsagePage=0xff00, DeviceUsage=0x0)
+        setMatchSelection(matchDictRef, CFSTR(kIOHIDVendorIDKey), LOGITECH_VENDOR_ID);
+        
+        CFMutableDictionaryRef deviceUsagePairs = CFDictionaryCreateMutable(kCFAllocatorDefault, 2, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        int32_t matchUsagePage = LOGITECH_VENDOR_USAGE_PAGE, matchUsage = 0x0;
+        CFDictionarySetValue(deviceUsagePairs, CFSTR("DeviceUsagePage"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &matchUsagePage));
+        CFDictionarySetValue(deviceUsagePairs, CFSTR("DeviceUsage"), CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &matchUsage));
+        CFMutableArrayRef deviceUsagePairsArray = CFArrayCreateMutable(kCFAllocatorDefault, 1, &kCFTypeArrayCallBacks);
+        CFArrayAppendValue(deviceUsagePairsArray, deviceUsagePairs);
+        CFDictionarySetValue(matchDictRef, CFSTR("DeviceUsagePairs"), deviceUsagePairsArray);
+    }
+    
+    IOHIDManagerSetDeviceMatching(hidManagerRef, matchDictRef);
+    
+    // Open the device manager
+    IOReturn retVal = IOHIDManagerOpen(hidManagerRef, kIOHIDOptionsTypeNone);
+    
+    if (retVal) {
+        fprintf(stderr, "Failed to open HID device manager!\n");
+        CFRelease(hidManagerRef);
+        free(iokit);
+        return -1;
+    }
+    
+    iokit->hidManagerRef = hidManagerRef;
+    pthread_mutex_init(&iokit->asyncLock, NULL);
+    pthread_cond_init(&iokit->asyncReady, NULL);
+    transport->priv = iokit;
+    
+    return 0;
+}
+
+static void iokitDeviceInfo(IOHIDDeviceRef deviceRef, int index, struct hidDeviceInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->vendorId = deviceIntProperty(deviceRef, CFSTR(kIOHIDVendorIDKey));
+    info->productId = deviceIntProperty(deviceRef, CFSTR(kIOHIDProductIDKey));
+    info->locationId = deviceIntProperty(deviceRef, CFSTR(kIOHIDLocationIDKey));
+    
+    CFTypeRef serialRef = IOHIDDeviceGetProperty(deviceRef, CFSTR(kIOHIDSerialNumberKey));
+    
+    if (serialRef && CFGetTypeID(serialRef) == CFStringGetTypeID()) {
+        CFStringGetCString(serialRef, info->serial, sizeof(info->serial), kCFStringEncodingUTF8);
+    }
+    
+    // Seeds for the rate controller, both in microseconds
+    info->reportInterval = (uint32_t)deviceIntProperty(deviceRef, CFSTR(kIOHIDReportIntervalKey));
+    info->requestTimeout = (uint32_t)deviceIntProperty(deviceRef, CFSTR(kIOHIDRequestTimeoutKey));
+    info->index = index;
+    info->handle = deviceRef;
+}
+
+static int iokitEnumerate(struct hidTransport *transport, struct hidDeviceInfo **devices, size_t *numDevices)
+{
+    struct iokitTransport *iokit = transport->priv;
+    CFSetRef devicesFound = IOHIDManagerCopyDevices(iokit->hidManagerRef);
+    
+    *devices = NULL;
+    *numDevices = 0;
+    
+    if (!devicesFound) {
+        fprintf(stderr, "Failed to copy out devices that were found!\n");
+        return -1;
+    }
+    
+    CFIndex numFound = CFSetGetCount(devicesFound);
+    
+    free(iokit->devices);
+    iokit->devices = malloc(sizeof(IOHIDDeviceRef) * (numFound ? numFound : 1));
+    *devices = calloc(numFound ? numFound : 1, sizeof(struct hidDeviceInfo));
+    
+    if (!iokit->devices || !*devices) {
+        fprintf(stderr, "Failed to allocate memory for device list!\n");
+        CFRelease(devicesFound);
+        return -1;
+    }
+    
+    CFSetGetValues(devicesFound, (const void **)iokit->devices);
+    CFRelease(devicesFound);
+    devicesFound = NULL;
+    iokit->numDevices = numFound;
+    
+    for (CFIndex i = 0; i < numFound; i++) {
+        iokitDeviceInfo(iokit->devices[i], (int)i, &(*devices)[(*numDevices)++]);
+    }
+    
+    return 0;
+}
+
+// Parsed from the raw descriptor bytes, NULL when the device does not publish them
+static struct hidElementTable *iokitElements(IOHIDDeviceRef deviceRef)
+{
+    CFTypeRef descriptorRef = IOHIDDeviceGetProperty(deviceRef, CFSTR(kIOHIDReportDescriptorKey));
+    
+    if (!descriptorRef || CFGetTypeID(descriptorRef) != CFDataGetTypeID()) {
+        return NULL;
+    }
+    
+    return hidDescriptorParse(CFDataGetBytePtr(descriptorRef), (size_t)CFDataGetLength(descriptorRef));
+}
+
+// A linear scan of the parsed descriptor for the profile's report id and length, the target then writes
+// with IOHIDDeviceSetReport just like a resolve cache hit
+static int iokitMatchDescriptor(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, struct keyColorTarget **targets, size_t *numTargets)
+{
+    IOHIDDeviceRef deviceRef = device->handle;
+    struct hidElementTable *table = iokitElements(deviceRef);
+    int numMatched = 0;
+    
+    if (table) {
+        numMatched = transportMatchDescriptor(transport, device, profile, table, targets, numTargets);
+        hidElementTableFree(table);
+        
+        if (numMatched) {
+            (*targets)[*numTargets - 1].device = (void *)CFRetain(deviceRef);
+        }
+    }
+    
+    return numMatched;
+}
+
+static int iokitMatch(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, struct keyColorTarget **targets, size_t *numTargets)
+{
+    IOHIDDeviceRef deviceRef = device->handle;
+    int numMatched = 0;
+    
+    // The element with the profile's cookie written with IOHIDDeviceSetValue is the path known to work on the
+    // hardware, the parsed descriptor is only a fallback for a board whose element tree doesn't carry the cookie
+    CFMutableDictionaryRef matchDictRef = setMatchSelection(NULL, CFSTR(kIOHIDElementCookieKey), profile->cookie);
+    
+    CFArrayRef elements = IOHIDDeviceCopyMatchingElements(deviceRef, matchDictRef, kIOHIDOptionsTypeNone);
+    
+    CFRelease(matchDictRef);
+    
+    if (!elements) {
+        return iokitMatchDescriptor(transport, device, profile, targets, numTargets);
+    }
+    
+    CFIndex numElements = CFArrayGetCount(elements);
+    
+    for (CFIndex j = 0;j < numElements;j++) {
+        IOHIDElementRef elementRef = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, j);
+        
+        if (!elementRef) {
+            continue;
+        }
+        
+        struct keyColorTarget *target = transportAppendTarget(targets, numTargets, transport, device, profile);
+        
+        if (!target) {
+            break;
+        }
+        
+        // Remembered so a later run can write the report directly, see iokitAttach
+        uint32_t reportBits = IOHIDElementGetReportSize(elementRef) * IOHIDElementGetReportCount(elementRef);
+        
+        target->reportId = (uint8_t)IOHIDElementGetReportID(elementRef);
+        target->reportType = IOHIDElementGetType(elementRef) == kIOHIDElementTypeOutput ? KEYCOLOR_REPORT_TYPE_OUTPUT : KEYCOLOR_REPORT_TYPE_FEATURE;
+        target->reportLen = reportBits / 8 ? (uint8_t)(reportBits / 8) : profile->reportSize;
+        
+        // Retained so the pair outlives the matching array, the daemon holds these for its lifetime
+        target->device = (void *)CFRetain(deviceRef);
+        target->element = (void *)CFRetain(elementRef);
+        numMatched++;
+    }
+    
+    CFRelease(elements);
+    
+    return numMatched ? numMatched : iokitMatchDescriptor(transport, device, profile, targets, numTargets);
+}
+
+// Cache hit: skip copying the element tree and write the remembered report with SetReport
+static int iokitAttach(struct hidTransport *transport, struct hidDeviceInfo *device, const struct deviceProfile *profile, const struct resolveCacheEntry *entry, struct keyColorTarget **targets, size_t *numTargets)
+{
+    // Only a report the cookie's element was seen to carry is written directly, anything else goes back through matching
+    if (entry->reportId != profile->reportId || entry->reportLen != profile->reportSize) {
+        return 0;
+    }
+    
+    if (!transportAttachFromCache(transport, device, profile, entry, targets, numTargets)) {
+        return 0;
+    }
+    
+    struct keyColorTarget *target = &(*targets)[*numTargets - 1];
+    
+    target->device = (void *)CFRetain(device->handle);
+    target->element = NULL;
+    
+    return 1;
+}
+
+static int iokitWrite(struct keyColorTarget *target, const uint8_t *report, size_t reportLen)
+{
+    IOReturn retVal = kIOReturnError;
+    
+    if (!target->element) {
+        uint8_t buf[TRANSPORT_MAX_REPORT_SIZE + 1];
+        size_t offset = target->reportId ? 1 : 0;
+        IOHIDReportType reportType = target->reportType == KEYCOLOR_REPORT_TYPE_OUTPUT ? kIOHIDReportTypeOutput : kIOHIDReportTypeFeature;
+        
+        if (reportLen > TRANSPORT_MAX_REPORT_SIZE || reportLen != target->reportLen) {
+            return kIOReturnBadArgument;
+        }
+        
+        uint64_t buildStart = transportLatencyStart(target->transport);
+        
+        // Devices with numbered reports expect the id as the first byte
+        buf[0] = target->reportId;
+        memcpy(buf + offset, report, reportLen);
+        transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, 0);
+        
+        return IOHIDDeviceSetReport(target->device, reportType, target->reportId, buf, reportLen + offset);
+    }
+    
+    uint64_t buildStart = transportLatencyStart(target->transport);
+    // Stamped with when it was built, the HID stack delivers at once whatever the stamp says so --sync times the call itself
+    IOHIDValueRef valueRef = IOHIDValueCreateWithBytes(kCFAllocatorDefault, target->element, mach_absolute_time(), report, reportLen);
+    
+    transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, valueRef == NULL);
+    
+    if (valueRef) {
+        retVal = IOHIDDeviceSetValue(target->device, target->element, valueRef);
+        CFRelease(valueRef);
+    }
+    
+    return retVal;
+}
+
+static void *iokitRunLoopThread(void *arg)
+{
+    struct iokitTransport *iokit = arg;
+    
+    pthread_mutex_lock(&iokit->asyncLock);
+    iokit->runLoop = CFRunLoopGetCurrent();
+    pthread_cond_broadcast(&iokit->asyncReady);
+    pthread_mutex_unlock(&iokit->asyncLock);
+    
+    // Returns at once until the first device is scheduled, the short sleep keeps that from spinning
+    while (!iokit->runLoopStop) {
+        if (CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false) == kCFRunLoopRunFinished) {
+            sleepNanos(1000000ull);
+        }
+    }
+    
+    return NULL;
+}
+
+// Call with asyncLock held, schedules the device on the completion run loop the first time it is written
+static int iokitScheduleDevice(struct iokitTransport *iokit, IOHIDDeviceRef deviceRef)
+{
+    if (!iokit->runLoopStarted) {
+        if (pthread_create(&iokit->runLoopThread, NULL, iokitRunLoopThread, iokit)) {
+            fprintf(stderr, "Failed to start IOKit completion thread!\n");
+            return -1;
+        }
+        iokit->runLoopStarted = 1;
+        
+        while (!iokit->runLoop) {
+            pthread_cond_wait(&iokit->asyncReady, &iokit->asyncLock);
+        }
+    }
+    
+    for (size_t i = 0; i < iokit->numScheduled; i++) {
+        if (iokit->scheduled[i] == deviceRef) {
+            return 0;
+        }
+    }
+    
+    IOHIDDeviceRef *grown = realloc(iokit->scheduled, sizeof(IOHIDDeviceRef) * (iokit->numScheduled + 1));
+    
+    if (!grown) {
+        fprintf(stderr, "Failed to allocate memory for scheduled devices!\n");
+        return -1;
+    }
+    
+    iokit->scheduled = grown;
+    iokit->scheduled[iokit->numScheduled++] = (IOHIDDeviceRef)CFRetain(deviceRef);
+    IOHIDDeviceScheduleWithRunLoop(deviceRef, iokit->runLoop, kCFRunLoopDefaultMode);
+    CFRunLoopWakeUp(iokit->runLoop);
+    
+    return 0;
+}
+
+static void iokitReportWritten(void *context, IOReturn result, void *sender, IOHIDReportType type, uint32_t reportID, uint8_t *report, CFIndex reportLength)
+{
+    transportAsyncComplete(context, result);
+}
+
+static void iokitValueWritten(void *context, IOReturn result, void *sender, IOHIDValueRef value)
+{
+    struct transportAsyncWrite *write = context;
+    
+    CFRelease(write->backend);
+    write->backend = NULL;
+    transportAsyncComplete(write, result);
+}
+
+// Same report iokitWrite sends, the callback runs on the completion run loop. IOKit takes the timeout in seconds
+static int iokitWriteAsync(struct transportAsyncWrite *write)
+{
+    struct keyColorTarget *target = write->target;
+    struct iokitTransport *iokit = target->transport->priv;
+    CFTimeInterval timeout = write->timeout ? write->timeout / 1e9 : 1.0;
+    IOReturn retVal = kIOReturnError;
+    
+    if (write->reportLen > TRANSPORT_MAX_REPORT_SIZE) {
+        return kIOReturnBadArgument;
+    }
+    
+    pthread_mutex_lock(&iokit->asyncLock);
+    int scheduled = iokitScheduleDevice(iokit, target->device);
+    pthread_mutex_unlock(&iokit->asyncLock);
+    
+    if (scheduled) {
+        return kIOReturnNoResources;
+    }
+    
+    uint64_t buildStart = transportLatencyStart(target->transport);
+    
+    if (!target->element) {
+        size_t offset = target->reportId ? 1 : 0;
+        IOHIDReportType reportType = target->reportType == KEYCOLOR_REPORT_TYPE_OUTPUT ? kIOHIDReportTypeOutput : kIOHIDReportTypeFeature;
+        
+        if (write->reportLen != target->reportLen) {
+            transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, 1);
+            return kIOReturnBadArgument;
+        }
+        
+        write->wire[0] = target->reportId;
+        memcpy(write->wire + offset, write->report, write->reportLen);
+        transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, 0);
+        
+        return IOHIDDeviceSetReportWithCallback(target->device, reportType, target->reportId, write->wire, write->reportLen + offset, timeout, iokitReportWritten, write);
+    }
+    
+    IOHIDValueRef valueRef = IOHIDValueCreateWithBytes(kCFAllocatorDefault, target->element, mach_absolute_time(), write->report, write->reportLen);
+    
+    transportLatencyEnd(target->transport, target->index, LATENCY_PHASE_BUILD, buildStart, valueRef == NULL);
+    
+    if (valueRef) {
+        write->backend = (void *)valueRef;
+        retVal = IOHIDDeviceSetValueWithCallback(target->device, target->element, valueRef, timeout, iokitValueWritten, write);
+        
+        if (retVal) {
+            CFRelease(valueRef);
+            write->backend = NULL;
+        }
+    }
+    
+    return retVal;
+}
+
+static void iokitReleaseTarget(struct keyColorTarget *target)
+{
+    if (target->element) {
+        CFRelease(target->element);
+    }
+    CFRelease(target->device);
+}
+
+struct iokitWatchContext {
+    struct hidTransport *transport;
+    hotplugCallback callback;
+    void *context;
+};
+
+static void iokitDeviceMatched(void *context, IOReturn result, void *sender, IOHIDDeviceRef deviceRef)
+{
+    struct iokitWatchContext *watch = context;
+    struct hidDeviceInfo info;
+    uint64_t eventTime = monotonicNanos();
+    
+    iokitDeviceInfo(deviceRef, 0, &info);
+    watch->callback(watch->transport, HOTPLUG_ATTACH, &info, eventTime, watch->context);
+}
+
+static void iokitDeviceRemoved(void *context, IOReturn result, void *sender, IOHIDDeviceRef deviceRef)
+{
+    struct iokitWatchContext *watch = context;
+    struct hidDeviceInfo info;
+    uint64_t eventTime = monotonicNanos();
+    
+    iokitDeviceInfo(deviceRef, 0, &info);
+    watch->callback(watch->transport, HOTPLUG_DETACH, &info, eventTime, watch->context);
+}
+
+// Callbacks on the same matching dictionary enumeration uses, the manager reports present devices as matched first
+static int iokitWatch(struct hidTransport *transport, hotplugCallback callback, void *context, volatile sig_atomic_t *stop)
+{
+    struct iokitTransport *iokit = transport->priv;
+    struct iokitWatchContext watch = { transport, callback, context };
+    
+    IOHIDManagerRegisterDeviceMatchingCallback(iokit->hidManagerRef, iokitDeviceMatched, &watch);
+    IOHIDManagerRegisterDeviceRemovalCallback(iokit->hidManagerRef, iokitDeviceRemoved, &watch);
+    IOHIDManagerScheduleWithRunLoop(iokit->hidManagerRef, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
+    
+    // Signals don't wake the run loop, short slices keep a stop request responsive
+    while (!*stop) {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false);
+    }
+    
+    IOHIDManagerUnscheduleFromRunLoop(iokit->hidManagerRef, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
+    IOHIDManagerRegisterDeviceMatchingCallback(iokit->hidManagerRef, NULL, NULL);
+    IOHIDManagerRegisterDeviceRemovalCallback(iokit->hidManagerRef, NULL, NULL);
+    
+    return 0;
+}
+
+static void iokitDump(struct hidTransport *transport, struct dumpWriter *writer, const struct dumpFilter *filter, int verbose)
+{
+    struct iokitTransport *iokit = transport->priv;
+    struct hidDeviceInfo *devices = NULL;
+    size_t numDevices = 0;
+    
+    if (iokitEnumerate(transport, &devices, &numDevices)) {
+        return;
+    }
+    
+    dumpDevices(writer, iokit->devices, iokit->numDevices, filter, verbose);
+    free(devices);
+}
+
+static void iokitClose(struct hidTransport *transport)
+{
+    struct iokitTransport *iokit = transport->priv;
+    
+    if (iokit->runLoopStarted) {
+        iokit->runLoopStop = 1;
+        CFRunLoopStop(iokit->runLoop);
+        pthread_join(iokit->runLoopThread, NULL);
+        
+        for (size_t i = 0; i < iokit->numScheduled; i++) {
+            IOHIDDeviceUnscheduleFromRunLoop(iokit->scheduled[i], iokit->runLoop, kCFRunLoopDefaultMode);
+            CFRelease(iokit->scheduled[i]);
+        }
+    }
+    
+    pthread_cond_destroy(&iokit->asyncReady);
+    pthread_mutex_destroy(&iokit->asyncLock);
+    free(iokit->scheduled);
+    free(iokit->devices);
+    CFRelease(iokit->hidManagerRef);
+    free(iokit);
+}
+
+const struct hidTransportOps iokitTransportOps = {
+    "iokit",
+    "macOS IOHIDManager element writes",
+    iokitOpen,
+    iokitEnumerate,
+    iokitMatch,
+    iokitAttach,
+    iokitWrite,
+    iokitWriteAsync,
+    iokitReleaseTarget,
+    iokitWatch,
+    iokitDump,
+    iokitClose
+};
+
+#endif /* __APPLE__ */
@@ -0,0 +1,315 @@
+//
+//  writers.c
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "writers.h"
+#include "transport.h"
+#include "timeutil.h"
+#include "bench.h"
+
+// Nanoseconds writerPoolDestroy waits for writes in flight before abandoning them
+#define WRITER_SHUTDOWN_GRACE 1000000000ull
+
+static void *writerThread(void *arg)
+{
+    struct deviceWriter *writer = arg;
+    struct writerPool *pool = writer->pool;
+    uint8_t report[REPORT_CACHE_MAX_REPORT];
+    size_t reportLen;
+    int held = 0;
+    
+    pthread_mutex_lock(&pool->lock);
+    
+    while (!pool->stop) {
+        struct rateControl *rate = &writer->target->rate;
+        uint64_t delay = writer->mailbox.pending && writer->target->transport->rateControl ? rateControlDelay(rate, monotonicNanos()) : 0;
+        
+        // Wait out the device's interval with the mailbox open, newer reports replace the one held back
+        if (delay) {
+            struct timespec ts;
+            uint64_t waitStart = monotonicNanos();
+            
+            if (!held) {
+                rate->waits++;
+                held = 1;
+            }
+            
+            deadlineToTimespec(delay, &ts);
+            pthread_cond_timedwait(&writer->wake, &pool->lock, &ts);
+            rate->waited += monotonicNanos() - waitStart;
+            continue;
+        }
+        
+        held = 0;
+        
+        uint64_t generation = writer->posted;
+        
+        if (!latestReportTake(&writer->mailbox, report, &reportLen)) {
+            pthread_cond_wait(&writer->wake, &pool->lock);
+            continue;
+        }
+        
+        writer->busySince = monotonicNanos();
+        pthread_mutex_unlock(&pool->lock);
+        
+        int status = transportWriteTarget(writer->target, report, reportLen);
+        
+        pthread_mutex_lock(&pool->lock);
+        writer->busySince = 0;
+        writer->lastStatus = status;
+        writer->completed = generation;
+        pthread_cond_broadcast(&pool->done);
+    }
+    
+    pthread_mutex_unlock(&pool->lock);
+    
+    return NULL;
+}
+
+struct writerPool *writerPoolCreate(struct keyColorTarget *targets, size_t numTargets, uint64_t timeout)
+{
+    struct writerPool *pool = calloc(1, sizeof(struct writerPool));
+    
+    if (!pool || !(pool->writers = calloc(numTargets ? numTargets : 1, sizeof(struct deviceWriter)))) {
+        fprintf(stderr, "Failed to allocate writer threads!\n");
+        free(pool);
+        return NULL;
+    }
+    
+    pool->timeout = timeout;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    
+    for (size_t i = 0; i < numTargets; i++) {
+        struct deviceWriter *writer = &pool->writers[i];
+        
+        writer->pool = pool;
+        writer->target = &targets[i];
+        pthread_cond_init(&writer->wake, NULL);
+        
+        if (pthread_create(&writer->thread, NULL, writerThread, writer)) {
+            fprintf(stderr, "Failed to start writer thread for device %d\n", targets[i].index);
+            pthread_cond_destroy(&writer->wake);
+            writerPoolDestroy(pool);
+            return NULL;
+        }
+        pool->numWriters++;
+    }
+    
+    return pool;
+}
+
+// Fan one report out to every writer and wait for all of them, a device gets at most pool->timeout
+int writerPoolWrite(struct writerPool *pool, const uint8_t *report, size_t reportLen)
+{
+    uint64_t generation[pool->numWriters ? pool->numWriters : 1];
+    uint64_t startTime = monotonicNanos();
+    int numFailed = 0;
+    
+    pthread_mutex_lock(&pool->lock);
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        struct deviceWriter *writer = &pool->writers[i];
+        
+        if (latestReportPut(&writer->mailbox, report, reportLen)) {
+            writer->coalesced++;
+        }
+        generation[i] = ++writer->posted;
+        pthread_cond_signal(&writer->wake);
+    }
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        struct deviceWriter *writer = &pool->writers[i];
+        
+        while (writer->completed < generation[i]) {
+            uint64_t now = monotonicNanos();
+            
+            // Already wedged in an older write before this call, don't make everyone wait on it again
+            if (writer->busySince && writer->busySince + pool->timeout <= startTime) {
+                break;
+            }
+            
+            if (now >= startTime + pool->timeout) {
+                break;
+            }
+            
+            struct timespec ts;
+            deadlineToTimespec(startTime + pool->timeout - now, &ts);
+            pthread_cond_timedwait(&pool->done, &pool->lock, &ts);
+        }
+        
+        // Held back for the device's interval, it still goes out without the caller waiting on it
+        if (writer->completed < generation[i] && !writer->busySince && writer->mailbox.pending) {
+            continue;
+        }
+        
+        if (writer->completed < generation[i]) {
+            writer->timeouts++;
+            numFailed++;
+        } else if (writer->lastStatus) {
+            numFailed++;
+        }
+    }
+    
+    pthread_mutex_unlock(&pool->lock);
+    
+    return numFailed;
+}
+
+void writerPoolPrintStats(struct writerPool *pool, FILE *fp)
+{
+    pthread_mutex_lock(&pool->lock);
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        struct deviceWriter *writer = &pool->writers[i];
+        
+        fprintf(fp, "writer[%d] location=0x%x completed=%llu coalesced=%llu timeouts=%llu%s\n",
+                writer->target->index, writer->target->locationId,
+                (unsigned long long)writer->completed, (unsigned long long)writer->coalesced,
+                (unsigned long long)writer->timeouts, writer->busySince ? " (busy)" : "");
+    }
+    
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void writerPoolDestroy(struct writerPool *pool)
+{
+    int wedged = 0;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        pthread_cond_signal(&pool->writers[i].wake);
+    }
+    
+    // Give writes in flight a grace period, the transport is usually closed right after this
+    uint64_t graceEnd = monotonicNanos() + WRITER_SHUTDOWN_GRACE;
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        uint64_t now;
+        
+        while (pool->writers[i].busySince && (now = monotonicNanos()) < graceEnd) {
+            struct timespec ts;
+            deadlineToTimespec(graceEnd - now, &ts);
+            pthread_cond_timedwait(&pool->done, &pool->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        pthread_mutex_lock(&pool->lock);
+        int busy = pool->writers[i].busySince != 0;
+        pthread_mutex_unlock(&pool->lock);
+        
+        if (busy) {
+            pthread_detach(pool->writers[i].thread);
+            wedged = 1;
+        } else {
+            pthread_join(pool->writers[i].thread, NULL);
+        }
+    }
+    
+    // A writer wedged inside a device write is left behind along with the pool it references
+    if (wedged) {
+        return;
+    }
+    
+    for (size_t i = 0; i < pool->numWriters; i++) {
+        pthread_cond_destroy(&pool->writers[i].wake);
+    }
+    
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->writers);
+    free(pool);
+}
+
+static int writerBenchmarkRun(const char *transportSpec, int parallel, int iterations, struct benchOptions *opts)
+{
+    struct hidTransport *transport = transportOpen(transportSpec, 0, 0);
+    struct keyColorTarget *targets = NULL;
+    size_t numTargets = 0;
+    
+    if (!transport || transportResolveTargets(transport, &targets, &numTargets)) {
+        transportClose(transport);
+        return -1;
+    }
+    
+    transportSetCaching(transport, 0);
+    
+    if (parallel && transportStartWriters(transport, targets, numTargets, 50000000ull)) {
+        transportReleaseTargets(targets, numTargets);
+        transportClose(transport);
+        return -1;
+    }
+    
+    uint64_t *samples = calloc(iterations, sizeof(uint64_t));
+    uint8_t report[KEYCOLOR_REPORT_SIZE];
+    int numFailed = 0;
+    
+    memcpy(report, opts->report, sizeof(report));
+    
+    for (int i = 0; samples && i < iterations; i++) {
+        uint64_t startTime = monotonicNanos();
+        
+        report[1] = (uint8_t)i;
+        numFailed += transportWrite(targets, numTargets, report, sizeof(report));
+        samples[i] = monotonicNanos() - startTime;
+    }
+    
+    fprintf(benchNotes(), "# %s targets=%zu failed=%d\n", transportSpec, numTargets, numFailed);
+    benchReportLatency(parallel ? "parallel" : "serial", samples, samples ? iterations : 0);
+    
+    free(samples);
+    transportStopWriters(transport);
+    transportReleaseTargets(targets, numTargets);
+    transportClose(transport);
+    
+    return 0;
+}
+
+int writerPoolBenchmark(struct benchOptions *opts)
+{
+    const char *spec = opts->transportSpec ? opts->transportSpec : "fake:devices=4,latency=2ms";
+    
+    const char *stalled = "fake:devices=4,latency=2ms,stall=200ms";
+    
+    writerBenchmarkRun(spec, 0, opts->iterations, opts);
+    writerBenchmarkRun(spec, 1, opts->iterations, opts);
+    
+    // One wedged board, the others should still see a single device latency per command
+    writerBenchmarkRun(stalled, 0, opts->iterations < 20 ? opts->iterations : 20, opts);
+    writerBenchmarkRun(stalled, 1, opts->iterations, opts);
+    
+    return 0;
+}
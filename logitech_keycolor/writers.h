@@ -0,0 +1,69 @@
+//
+//  writers.h
+//  logitech_keycolor
+//
+//  Author: Karl Bunch <karlbunch@karlbunch.com>
+//
+//  Created: Sat Oct 17 09:12:41 EDT 2026
+//
+//  Copyright © 2016 Karl Bunch <http://www.karlbunch.com/>
+//
+//  The MIT License (MIT)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#ifndef writers_h
+#define writers_h
+
+#include <pthread.h>
+#include "keycolor.h"
+#include "reportcache.h"
+#include "bench.h"
+
+// One thread per target so a slow keyboard only delays itself
+struct deviceWriter {
+    struct writerPool *pool;
+    struct keyColorTarget *target;
+    pthread_t thread;
+    pthread_cond_t wake;
+    struct latestReport mailbox;        // capacity one, a newer report replaces an unwritten one
+    uint64_t posted;                    // generation of the newest report in the mailbox
+    uint64_t completed;                 // generation of the last report written
+    uint64_t busySince;                 // monotonicNanos() when the current write started, 0 when idle
+    int lastStatus;
+    uint64_t coalesced;
+    uint64_t timeouts;
+};
+
+struct writerPool {
+    struct deviceWriter *writers;
+    size_t numWriters;
+    uint64_t timeout;                   // nanoseconds to wait for any one device
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int stop;
+};
+
+struct writerPool *writerPoolCreate(struct keyColorTarget *targets, size_t numTargets, uint64_t timeout);
+int writerPoolWrite(struct writerPool *pool, const uint8_t *report, size_t reportLen);
+void writerPoolPrintStats(struct writerPool *pool, FILE *fp);
+void writerPoolDestroy(struct writerPool *pool);
+int writerPoolBenchmark(struct benchOptions *opts);
+
+#endif /* writers_h */